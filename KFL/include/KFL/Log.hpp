@@ -35,10 +35,23 @@
 
 namespace KlayGE
 {
+	enum class LogMode
+	{
+		// Records are written on the calling thread
+		Sync,
+		// Records are formatted on the calling thread, and written by a background thread. Errors are still written before
+		// LogError() << ... << std::endl returns.
+		Async
+	};
+
 	std::ostream& LogDebug();
 	std::ostream& LogInfo();
 	std::ostream& LogWarn();
 	std::ostream& LogError();
+
+	void SetLogMode(LogMode mode);
+	// Waits until all records so far are written. An unfinished record of the calling thread is ended first.
+	void FlushLog();
 }
 
 #endif		// _KFL_LOG_HPP
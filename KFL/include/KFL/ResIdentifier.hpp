@@ -33,12 +33,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <istream>
 #include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include <KFL/CXX20/span.hpp>
+#include <KFL/CustomizedStreamBuf.hpp>
+
 namespace KlayGE
 {
 	class ResIdentifier final
@@ -54,6 +58,15 @@ namespace KlayGE
 			: res_name_(std::move(name)), timestamp_(timestamp), istream_(is), streambuf_(streambuf)
 		{
 		}
+		// The content is already in memory, e.g. a mapped file. data_owner keeps it alive.
+		ResIdentifier(std::string_view name, uint64_t timestamp,
+				std::span<uint8_t const> data, std::shared_ptr<void> const & data_owner)
+			: res_name_(std::move(name)), timestamp_(timestamp),
+				streambuf_(std::make_shared<MemInputStreamBuf>(data.data(), static_cast<std::streamsize>(data.size()))),
+				data_(data), data_owner_(data_owner)
+		{
+			istream_ = std::make_shared<std::istream>(streambuf_.get());
+		}
 
 		void ResName(std::string_view name)
 		{
@@ -113,11 +126,33 @@ namespace KlayGE
 			return *istream_;
 		}
 
+		// The whole content in memory, or empty if it can only be streamed
+		std::span<uint8_t const> Data() const
+		{
+			return data_;
+		}
+
+		// Like read, but returns the bytes in place instead of copying them. Needs a non-empty Data().
+		std::span<uint8_t const> ReadView(size_t size)
+		{
+			int64_t const offset = this->tellg();
+			if ((offset < 0) || data_.empty())
+			{
+				return std::span<uint8_t const>();
+			}
+
+			auto const view = data_.subspan(static_cast<size_t>(offset), std::min(size, data_.size() - static_cast<size_t>(offset)));
+			this->seekg(static_cast<int64_t>(view.size()), std::ios_base::cur);
+			return view;
+		}
+
 	private:
 		std::string res_name_;
 		uint64_t timestamp_;
 		std::shared_ptr<std::istream> istream_;
 		std::shared_ptr<std::streambuf> streambuf_;
+		std::span<uint8_t const> data_;
+		std::shared_ptr<void> data_owner_;
 	};
 
 	using ResIdentifierPtr = std::shared_ptr<ResIdentifier>;
@@ -83,6 +83,7 @@ namespace KlayGE
 		void StoreVector2(float2& fs, SIMDVectorF4 const & v);
 		void StoreVector3(float3& fs, SIMDVectorF4 const & v);
 		void StoreVector4(float4& fs, SIMDVectorF4 const & v);
+		void StoreVector4(float* fs, SIMDVectorF4 const & v);
 		SIMDVectorF4 SetVector(float x, float y, float z, float w);
 		SIMDVectorF4 SetVector(float v);
 		float GetX(SIMDVectorF4 const & rhs);
@@ -102,6 +103,14 @@ namespace KlayGE
 		SIMDVectorF4 Reflect(SIMDVectorF4 const & incident, SIMDVectorF4 const & normal);
 		SIMDVectorF4 Refract(SIMDVectorF4 const & incident, SIMDVectorF4 const & normal, float refraction_index);
 
+		// Per-component comparisons. All bits of a component are set where it's true.
+		SIMDVectorF4 Less(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs);
+		SIMDVectorF4 LessEqual(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs);
+		SIMDVectorF4 Greater(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs);
+		SIMDVectorF4 GreaterEqual(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs);
+		// Takes the components of if_true where mask is set, and the ones of if_false elsewhere
+		SIMDVectorF4 Select(SIMDVectorF4 const & mask, SIMDVectorF4 const & if_true, SIMDVectorF4 const & if_false);
+
 		// 2D Vector
 		///////////////////////////////////////////////////////////////////////////////
 		SIMDVectorF4 CrossVector2(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs);
@@ -254,6 +263,13 @@ namespace KlayGE
 		///////////////////////////////////////////////////////////////////////////////
 		SIMDVectorF4 NegativeColor(SIMDVectorF4 const & rhs);
 		SIMDVectorF4 ModulateColor(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs);
+
+		// Bound
+		///////////////////////////////////////////////////////////////////////////////
+		// Tests 4 AABBs given in SoA layout at once. Each result is the same as MathLib::intersect_aabb_frustum's.
+		void IntersectAABBFrustum(BoundOverlap results[4], SIMDVectorF4 const & min_x, SIMDVectorF4 const & min_y,
+			SIMDVectorF4 const & min_z, SIMDVectorF4 const & max_x, SIMDVectorF4 const & max_y, SIMDVectorF4 const & max_z,
+			Frustum const & frustum);
 	}
 }
 
@@ -0,0 +1,169 @@
+/**
+ * @file Sort.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _KFL_SORT_HPP
+#define _KFL_SORT_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <KFL/CXX20/bit.hpp>
+#include <KFL/CXX20/span.hpp>
+
+namespace KlayGE
+{
+	// Maps a float to an unsigned integer of the same order, so floats can be radix sorted
+	inline uint32_t FloatToSortableUInt(float f) noexcept
+	{
+		uint32_t const u = std::bit_cast<uint32_t>(f);
+		return u ^ ((u & 0x80000000U) ? 0xFFFFFFFFU : 0x80000000U);
+	}
+
+	namespace Detail
+	{
+		uint32_t constexpr INSERTION_SORT_THRESHOLD = 64;
+
+		// Stable insertion sort. Gives up after max_moves moves, leaving items partially sorted.
+		template <typename T, typename KeyFunc>
+		bool BoundedInsertionSort(std::span<T> items, KeyFunc const & key_func, size_t max_moves)
+		{
+			size_t num_moves = 0;
+			for (size_t i = 1; i < items.size(); ++ i)
+			{
+				float const key = key_func(items[i]);
+				if (key < key_func(items[i - 1]))
+				{
+					T tmp = std::move(items[i]);
+					size_t j = i;
+					do
+					{
+						items[j] = std::move(items[j - 1]);
+						-- j;
+						++ num_moves;
+					} while ((j > 0) && (key < key_func(items[j - 1])));
+					items[j] = std::move(tmp);
+
+					if (num_moves > max_moves)
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+	}
+
+	// Stable LSD radix sort of items in ascending order of a float key. Negate the key for descending order.
+	// scratch is working memory, keep it around to avoid allocations.
+	template <typename T, typename KeyFunc>
+	void RadixSort(std::span<T> items, std::vector<T>& scratch, KeyFunc const & key_func)
+	{
+		size_t const num = items.size();
+		if (num <= Detail::INSERTION_SORT_THRESHOLD)
+		{
+			Detail::BoundedInsertionSort(items, key_func, static_cast<size_t>(-1));
+			return;
+		}
+
+		uint32_t constexpr RADIX_BITS = 11;
+		uint32_t constexpr RADIX_SIZE = 1U << RADIX_BITS;
+		uint32_t constexpr NUM_PASSES = (32 + RADIX_BITS - 1) / RADIX_BITS;
+
+		// Histograms of all passes in one go
+		std::vector<size_t> histograms(NUM_PASSES * RADIX_SIZE, 0);
+		for (auto const & item : items)
+		{
+			uint32_t const key = FloatToSortableUInt(key_func(item));
+			for (uint32_t pass = 0; pass < NUM_PASSES; ++ pass)
+			{
+				++ histograms[pass * RADIX_SIZE + ((key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1))];
+			}
+		}
+
+		scratch.resize(num);
+		T* src = items.data();
+		T* dst = scratch.data();
+		for (uint32_t pass = 0; pass < NUM_PASSES; ++ pass)
+		{
+			uint32_t const shift = pass * RADIX_BITS;
+			size_t* offsets = &histograms[pass * RADIX_SIZE];
+
+			// A digit shared by all keys doesn't change the order. That's common in the high bits of depths.
+			uint32_t const first_digit = (FloatToSortableUInt(key_func(src[0])) >> shift) & (RADIX_SIZE - 1);
+			if (offsets[first_digit] == num)
+			{
+				continue;
+			}
+
+			size_t sum = 0;
+			for (uint32_t i = 0; i < RADIX_SIZE; ++ i)
+			{
+				size_t const count = offsets[i];
+				offsets[i] = sum;
+				sum += count;
+			}
+
+			for (size_t i = 0; i < num; ++ i)
+			{
+				uint32_t const digit = (FloatToSortableUInt(key_func(src[i])) >> shift) & (RADIX_SIZE - 1);
+				dst[offsets[digit]] = std::move(src[i]);
+				++ offsets[digit];
+			}
+			std::swap(src, dst);
+		}
+
+		if (src != items.data())
+		{
+			std::move(src, src + num, items.data());
+		}
+	}
+
+	// Sorts items that are already close to sorted, such as last frame's order with this frame's keys.
+	// An insertion pass repairs the order as long as few items move, otherwise it falls back to RadixSort.
+	// Returns true if the insertion pass was enough.
+	template <typename T, typename KeyFunc>
+	bool IncrementalSort(std::span<T> items, std::vector<T>& scratch, KeyFunc const & key_func)
+	{
+		// About a third of the work of a radix sort, so a failed attempt costs little
+		size_t const max_moves = std::max<size_t>(items.size(), Detail::INSERTION_SORT_THRESHOLD * Detail::INSERTION_SORT_THRESHOLD);
+		if (Detail::BoundedInsertionSort(items, key_func, max_moves))
+		{
+			return true;
+		}
+
+		RadixSort(items, scratch, key_func);
+		return false;
+	}
+}
+
+#endif		// _KFL_SORT_HPP
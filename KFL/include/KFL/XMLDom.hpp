@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string_view>
 #include <vector>
 
@@ -39,6 +40,7 @@ namespace KlayGE
 {
 	class XMLAttribute;
 	class XMLNode;
+	class XMLDocumentStorage;
 
 	enum class XMLNodeType
 	{
@@ -52,6 +54,14 @@ namespace KlayGE
 		PI
 	};
 
+	enum class XMLDomMode
+	{
+		// Every name and value is copied into its node
+		Copy,
+		// Names and values point into the retained source text, nodes are allocated from a per-document arena
+		Arena
+	};
+
 	class XMLNode final
 	{
 	public:
@@ -150,7 +160,20 @@ namespace KlayGE
 
 	private:
 		class Impl;
-		std::unique_ptr<Impl> pimpl_;
+		struct ImplDeleter
+		{
+			void operator()(Impl* impl) const noexcept;
+		};
+
+		explicit XMLNode(std::unique_ptr<Impl, ImplDeleter> impl) noexcept;
+
+		static XMLAttribute MakeArenaAttrib(
+			std::string_view name, std::string_view value, std::shared_ptr<XMLDocumentStorage> const& storage);
+
+		friend XMLNode LoadXml(ResIdentifier& source, XMLDomMode mode);
+
+	private:
+		std::unique_ptr<Impl, ImplDeleter> pimpl_;
 	};
 
 	class XMLAttribute final
@@ -200,9 +223,19 @@ namespace KlayGE
 
 	private:
 		class Impl;
-		std::unique_ptr<Impl> pimpl_;
+		struct ImplDeleter
+		{
+			void operator()(Impl* impl) const noexcept;
+		};
+
+		explicit XMLAttribute(std::unique_ptr<Impl, ImplDeleter> impl) noexcept;
+
+		friend class XMLNode;
+
+	private:
+		std::unique_ptr<Impl, ImplDeleter> pimpl_;
 	};
 
-	XMLNode LoadXml(ResIdentifier& source);
+	XMLNode LoadXml(ResIdentifier& source, XMLDomMode mode = XMLDomMode::Arena);
 	void SaveXml(XMLNode const& node, std::ostream& os);
 } // namespace KlayGE
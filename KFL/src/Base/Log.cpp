@@ -41,15 +41,44 @@
 #include <android/log.h>
 #include <cstring>
 #else
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
 #endif
 
 #include <KFL/Log.hpp>
 
+// Records below this severity are dropped without being formatted. 0 for debug, 1 for info, 2 for warn, 3 for error.
+#ifndef KLAYGE_LOG_MIN_SEVERITY
+#ifdef KLAYGE_DEBUG
+#define KLAYGE_LOG_MIN_SEVERITY 0
+#else
+#define KLAYGE_LOG_MIN_SEVERITY 1
+#endif
+#endif
+
 namespace
 {
 	using namespace KlayGE;
 
+	enum class LogSeverity
+	{
+		Debug = 0,
+		Info,
+		Warn,
+		Error
+	};
+
+	constexpr bool LogEnabled(LogSeverity severity)
+	{
+		return static_cast<int>(severity) >= KLAYGE_LOG_MIN_SEVERITY;
+	}
+
 #ifdef KLAYGE_PLATFORM_ANDROID
 	class AndroidLogStreamCallback
 	{
@@ -113,7 +142,7 @@ namespace
 		std::span<std::ostream*> oss_;
 	};
 
-	std::ostream& Log()
+	std::span<std::ostream*> LogSinks()
 	{
 #ifdef KLAYGE_DEBUG
 		static std::ofstream log_file("KlayGE.log");
@@ -126,79 +155,500 @@ namespace
 #endif
 			&std::clog
 		};
-		static CallbackOutputStreamBuf<MultiOStreamsCallback> log_stream_buff((MultiOStreamsCallback(oss)));
+		return oss;
+	}
+
+	std::ostream& Log()
+	{
+		static CallbackOutputStreamBuf<MultiOStreamsCallback> log_stream_buff((MultiOStreamsCallback(LogSinks())));
 		static std::ostream log_stream(&log_stream_buff);
 		return log_stream;
 	}
-#endif
 
-#ifndef KLAYGE_DEBUG
-	class EmptyOStreamsCallback
+	std::atomic<LogMode> log_mode{LogMode::Async};
+
+	// Bounded lock-free queue of finished records, many threads push and only the writer thread pops.
+	// Slots keep their strings, and a push swaps the record with the slot's emptied one, so the buffers get reused.
+	class LogRecordRing final
 	{
-		KLAYGE_NONCOPYABLE(EmptyOStreamsCallback);
+		KLAYGE_NONCOPYABLE(LogRecordRing);
+
+		static uint32_t constexpr CAPACITY = 1024;
+
+		struct Slot
+		{
+			std::atomic<uint64_t> seq;
+			std::string text;
+		};
 
 	public:
-		EmptyOStreamsCallback()
+		LogRecordRing()
+			: slots_(MakeUniquePtr<Slot[]>(CAPACITY))
 		{
+			for (uint32_t i = 0; i < CAPACITY; ++ i)
+			{
+				slots_[i].seq.store(i, std::memory_order_relaxed);
+			}
 		}
-		EmptyOStreamsCallback([[maybe_unused]] EmptyOStreamsCallback&& rhs) noexcept
+
+		bool TryPush(std::string& text)
 		{
+			uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Slot& slot = slots_[pos & (CAPACITY - 1)];
+				int64_t const diff = static_cast<int64_t>(slot.seq.load(std::memory_order_acquire) - pos);
+				if (diff == 0)
+				{
+					if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						slot.text.swap(text);
+						slot.seq.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0)
+				{
+					// Full
+					return false;
+				}
+				else
+				{
+					pos = enqueue_pos_.load(std::memory_order_relaxed);
+				}
+			}
 		}
 
-		std::streambuf::int_type operator()([[maybe_unused]] void const * buff, std::streamsize count)
+		// Only called from the writer thread
+		template <typename Func>
+		bool TryPop(Func&& func)
 		{
-			return static_cast<std::streambuf::int_type>(count);
+			Slot& slot = slots_[dequeue_pos_ & (CAPACITY - 1)];
+			if (slot.seq.load(std::memory_order_acquire) != dequeue_pos_ + 1)
+			{
+				return false;
+			}
+
+			func(slot.text);
+			slot.text.clear();
+			slot.seq.store(dequeue_pos_ + CAPACITY, std::memory_order_release);
+			++ dequeue_pos_;
+			return true;
+		}
+
+		uint64_t NumPushed() const noexcept
+		{
+			return enqueue_pos_.load(std::memory_order_acquire);
+		}
+		uint64_t NumPopped() const noexcept
+		{
+			return dequeue_pos_;
+		}
+
+	private:
+		std::unique_ptr<Slot[]> slots_;
+		alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+		alignas(64) uint64_t dequeue_pos_ = 0;
+	};
+
+	// Set while the writer can take records. Threads logging during shutdown fall back to writing directly.
+	std::atomic<bool> async_log_writer_alive{false};
+	std::atomic<bool> async_log_writer_destroyed{false};
+	// Number of AsyncLogWriterPins. The writer isn't destroyed while any is held.
+	std::atomic<uint32_t> async_log_writer_pins{0};
+
+	std::chrono::steady_clock::time_point LogStartTime()
+	{
+		static std::chrono::steady_clock::time_point const start_time = std::chrono::steady_clock::now();
+		return start_time;
+	}
+
+	class AsyncLogWriter final
+	{
+		KLAYGE_NONCOPYABLE(AsyncLogWriter);
+
+	public:
+		static AsyncLogWriter& Instance()
+		{
+			static AsyncLogWriter writer;
+			return writer;
+		}
+
+		~AsyncLogWriter()
+		{
+			// Threads that saw the writer alive are still pushing to it. The writer thread keeps draining until they are done.
+			async_log_writer_alive.store(false);
+			while (async_log_writer_pins.load() != 0)
+			{
+				std::this_thread::yield();
+			}
+			async_log_writer_destroyed.store(true);
+
+			quit_.store(true);
+			this->WakeUp();
+			thread_.join();
+		}
+
+		void Push(std::string& text)
+		{
+			while (!ring_.TryPush(text))
+			{
+				if (done_.load())
+				{
+					std::clog.write(text.data(), static_cast<std::streamsize>(text.size()));
+					return;
+				}
+
+				// The writer is behind. Wait for it instead of dropping records.
+				this->WakeUp();
+				std::this_thread::yield();
+			}
+
+			if (sleeping_.load())
+			{
+				this->WakeUp();
+			}
+		}
+
+		void Flush()
+		{
+			uint64_t const target = ring_.NumPushed();
+			while ((num_written_.load(std::memory_order_acquire) < target) && !done_.load())
+			{
+				this->WakeUp();
+				std::this_thread::yield();
+			}
+		}
+
+	private:
+		AsyncLogWriter()
+			: sinks_(LogSinks())
+		{
+			thread_ = std::thread([this] { this->Run(); });
+			async_log_writer_alive.store(true);
+		}
+
+		void WakeUp()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			cv_.notify_one();
+		}
+
+		void Run()
+		{
+			for (;;)
+			{
+				bool const quit = quit_.load();
+
+				bool written = false;
+				while (ring_.TryPop(
+					[this](std::string const& text)
+					{
+						for (auto* os : sinks_)
+						{
+							os->write(text.data(), static_cast<std::streamsize>(text.size()));
+						}
+					}))
+				{
+					written = true;
+				}
+				if (written)
+				{
+					for (auto* os : sinks_)
+					{
+						os->flush();
+					}
+					num_written_.store(ring_.NumPopped(), std::memory_order_release);
+				}
+
+				if (ring_.NumPopped() != ring_.NumPushed())
+				{
+					// A record is being pushed right now
+					std::this_thread::yield();
+					continue;
+				}
+				if (quit)
+				{
+					done_.store(true);
+					break;
+				}
+
+				std::unique_lock<std::mutex> lock(mutex_);
+				sleeping_.store(true);
+				if ((ring_.NumPopped() == ring_.NumPushed()) && !quit_.load())
+				{
+					cv_.wait_for(lock, std::chrono::milliseconds(100));
+				}
+				sleeping_.store(false);
+			}
+		}
+
+	private:
+		std::span<std::ostream*> sinks_;
+
+		LogRecordRing ring_;
+		std::atomic<uint64_t> num_written_{0};
+
+		std::thread thread_;
+		std::atomic<bool> quit_{false};
+		std::atomic<bool> done_{false};
+		std::atomic<bool> sleeping_{false};
+		std::mutex mutex_;
+		std::condition_variable cv_;
+	};
+
+	// Keeps the writer from being destroyed between checking that it's alive and using it
+	class AsyncLogWriterPin final
+	{
+		KLAYGE_NONCOPYABLE(AsyncLogWriterPin);
+
+	public:
+		AsyncLogWriterPin()
+		{
+			async_log_writer_pins.fetch_add(1);
+			if (async_log_writer_alive.load())
+			{
+				writer_ = &AsyncLogWriter::Instance();
+			}
 		}
+
+		~AsyncLogWriterPin()
+		{
+			async_log_writer_pins.fetch_sub(1);
+		}
+
+		// nullptr if the writer is gone, or going
+		AsyncLogWriter* Writer() const noexcept
+		{
+			return writer_;
+		}
+
+	private:
+		AsyncLogWriter* writer_ = nullptr;
 	};
 
+	class AsyncLogRecordStreamBuf;
+	thread_local AsyncLogRecordStreamBuf* this_thread_record_stream_buff = nullptr;
+
+	// Formats records of the calling thread into its own buffer. A record ends at a flush, e.g. std::endl, and is then
+	// handed over to the writer thread.
+	class AsyncLogRecordStreamBuf final : public std::streambuf
+	{
+		KLAYGE_NONCOPYABLE(AsyncLogRecordStreamBuf);
+
+	public:
+		AsyncLogRecordStreamBuf()
+		{
+			static std::atomic<uint32_t> next_thread_id{0};
+			thread_id_ = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+			this_thread_record_stream_buff = this;
+		}
+
+		~AsyncLogRecordStreamBuf() override
+		{
+			this->Submit();
+			this_thread_record_stream_buff = nullptr;
+		}
+
+		void Begin(LogSeverity severity)
+		{
+			// Several LogXXX() calls without a flush in between continue the same record. It's submitted with the highest
+			// severity of them, so an error in it isn't held back.
+			if (!record_.empty())
+			{
+				severity_ = std::max(severity_, severity);
+				return;
+			}
+
+			severity_ = severity;
+
+			static char const * const severity_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+			double const time = std::chrono::duration<double>(std::chrono::steady_clock::now() - LogStartTime()).count();
+			char prefix[64];
+			int const len = std::snprintf(prefix, sizeof(prefix), "[%10.3f] [T%u] (%s) KlayGE: ", time, thread_id_,
+				severity_names[static_cast<int>(severity)]);
+			record_.append(prefix, static_cast<size_t>(len));
+		}
+
+	protected:
+		std::streamsize xsputn(char_type const * s, std::streamsize count) override
+		{
+			record_.append(s, static_cast<size_t>(count));
+			return count;
+		}
+
+		int_type overflow(int_type ch = traits_type::eof()) override
+		{
+			if (!traits_type::eq_int_type(ch, traits_type::eof()))
+			{
+				record_.push_back(traits_type::to_char_type(ch));
+			}
+			return traits_type::not_eof(ch);
+		}
+
+		int sync() override
+		{
+			this->Submit();
+			return 0;
+		}
+
+	private:
+		void Submit()
+		{
+			if (record_.empty())
+			{
+				return;
+			}
+
+			AsyncLogWriterPin pin;
+			if (auto* writer = pin.Writer())
+			{
+				writer->Push(record_);
+				if (severity_ == LogSeverity::Error)
+				{
+					// Errors are often followed by a crash. Make sure they get out.
+					writer->Flush();
+				}
+			}
+			else
+			{
+				std::clog.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+			}
+			record_.clear();
+		}
+
+	private:
+		std::string record_;
+		LogSeverity severity_ = LogSeverity::Info;
+		uint32_t thread_id_;
+	};
+
+	std::ostream& AsyncLog(LogSeverity severity)
+	{
+		// Starts the writer before any record, so it outlives the per-thread streams of the main thread. Only touched once,
+		// later calls can't race with its destruction.
+		LogStartTime();
+		[[maybe_unused]] static bool const writer_started = (AsyncLogWriter::Instance(), true);
+
+		thread_local AsyncLogRecordStreamBuf record_stream_buff;
+		thread_local std::ostream record_stream(&record_stream_buff);
+		record_stream_buff.Begin(severity);
+		return record_stream;
+	}
+
+	std::ostream& Log(LogSeverity severity)
+	{
+		if ((log_mode.load(std::memory_order_relaxed) == LogMode::Async) && !async_log_writer_destroyed.load(std::memory_order_relaxed))
+		{
+			return AsyncLog(severity);
+		}
+		else
+		{
+			static char const * const prefixes[] = { "(DEBUG) KlayGE: ", "(INFO) KlayGE: ", "(WARN) KlayGE: ", "(ERROR) KlayGE: " };
+			return Log() << prefixes[static_cast<int>(severity)];
+		}
+	}
+#endif
+
+	// Has no streambuf, so it stays in bad state and skips all formatting
 	std::ostream& EmptyLog()
 	{
-		static CallbackOutputStreamBuf<EmptyOStreamsCallback> empty_stream_buff((EmptyOStreamsCallback()));
-		static std::ostream empty_stream(&empty_stream_buff);
+		thread_local std::ostream empty_stream(nullptr);
 		return empty_stream;
 	}
-#endif
 }
 
 namespace KlayGE
 {
 	std::ostream& LogDebug()
 	{
-#ifdef KLAYGE_DEBUG
+		if constexpr (LogEnabled(LogSeverity::Debug))
+		{
 #ifdef KLAYGE_PLATFORM_ANDROID
-		return AndroidLog<ANDROID_LOG_DEBUG>();
-#else
-		return Log() << "(DEBUG) KlayGE: ";
-#endif
+			return AndroidLog<ANDROID_LOG_DEBUG>();
 #else
-		return EmptyLog();
+			return Log(LogSeverity::Debug);
 #endif
+		}
+		else
+		{
+			return EmptyLog();
+		}
 	}
 
 	std::ostream& LogInfo()
 	{
+		if constexpr (LogEnabled(LogSeverity::Info))
+		{
 #ifdef KLAYGE_PLATFORM_ANDROID
-		return AndroidLog<ANDROID_LOG_INFO>();
+			return AndroidLog<ANDROID_LOG_INFO>();
 #else
-		return Log() << "(INFO) KlayGE: ";
+			return Log(LogSeverity::Info);
 #endif
+		}
+		else
+		{
+			return EmptyLog();
+		}
 	}
 
 	std::ostream& LogWarn()
 	{
+		if constexpr (LogEnabled(LogSeverity::Warn))
+		{
 #ifdef KLAYGE_PLATFORM_ANDROID
-		return AndroidLog<ANDROID_LOG_WARN>();
+			return AndroidLog<ANDROID_LOG_WARN>();
 #else
-		return Log() << "(WARN) KlayGE: ";
+			return Log(LogSeverity::Warn);
 #endif
+		}
+		else
+		{
+			return EmptyLog();
+		}
 	}
 
 	std::ostream& LogError()
 	{
+		if constexpr (LogEnabled(LogSeverity::Error))
+		{
 #ifdef KLAYGE_PLATFORM_ANDROID
-		return AndroidLog<ANDROID_LOG_ERROR>();
+			return AndroidLog<ANDROID_LOG_ERROR>();
 #else
-		return Log() << "(ERROR) KlayGE: ";
+			return Log(LogSeverity::Error);
+#endif
+		}
+		else
+		{
+			return EmptyLog();
+		}
+	}
+
+	void SetLogMode([[maybe_unused]] LogMode mode)
+	{
+#ifndef KLAYGE_PLATFORM_ANDROID
+		if (log_mode.exchange(mode) != mode)
+		{
+			FlushLog();
+		}
+#endif
+	}
+
+	void FlushLog()
+	{
+#ifndef KLAYGE_PLATFORM_ANDROID
+		// A record the calling thread left unfinished would otherwise wait for its next async record
+		if (this_thread_record_stream_buff != nullptr)
+		{
+			this_thread_record_stream_buff->pubsync();
+		}
+
+		AsyncLogWriterPin pin;
+		if (auto* writer = pin.Writer())
+		{
+			writer->Flush();
+		}
+		Log().flush();
 #endif
 	}
 }
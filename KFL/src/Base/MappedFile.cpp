@@ -0,0 +1,129 @@
+/**
+ * @file MappedFile.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KFL/KFL.hpp>
+
+#include <limits>
+
+#ifdef KLAYGE_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <KFL/MappedFile.hpp>
+
+namespace KlayGE
+{
+	MappedFile::MappedFile() noexcept
+		: data_(nullptr), size_(0)
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		this->Unmap();
+	}
+
+	bool MappedFile::Map(std::string const & file_name)
+	{
+		this->Unmap();
+
+		// Empty files can't be mapped. The handles are closed right after mapping, the view keeps the file alive.
+#ifdef KLAYGE_PLATFORM_WINDOWS
+#ifdef KLAYGE_PLATFORM_WINDOWS_DESKTOP
+		HANDLE file = ::CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER file_size;
+		if (::GetFileSizeEx(file, &file_size) && (file_size.QuadPart > 0)
+			&& (static_cast<uint64_t>(file_size.QuadPart) <= std::numeric_limits<size_t>::max()))
+		{
+			HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping != nullptr)
+			{
+				data_ = static_cast<uint8_t const *>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				if (data_ != nullptr)
+				{
+					size_ = static_cast<size_t>(file_size.QuadPart);
+				}
+				::CloseHandle(mapping);
+			}
+		}
+		::CloseHandle(file);
+#else
+		KFL_UNUSED(file_name);
+#endif
+#else
+		int const fd = ::open(file_name.c_str(), O_RDONLY);
+		if (fd == -1)
+		{
+			return false;
+		}
+
+		struct stat file_stat;
+		if ((::fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0)
+			&& (static_cast<uint64_t>(file_stat.st_size) <= std::numeric_limits<size_t>::max()))
+		{
+			size_t const size = static_cast<size_t>(file_stat.st_size);
+			void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED)
+			{
+				data_ = static_cast<uint8_t const *>(p);
+				size_ = size;
+			}
+		}
+		::close(fd);
+#endif
+
+		return (data_ != nullptr);
+	}
+
+	void MappedFile::Unmap()
+	{
+		if (data_)
+		{
+#ifdef KLAYGE_PLATFORM_WINDOWS
+			::UnmapViewOfFile(data_);
+#else
+			::munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+			data_ = nullptr;
+			size_ = 0;
+		}
+	}
+}
@@ -34,7 +34,10 @@
 #include <KFL/StringUtil.hpp>
 #include <KFL/Util.hpp>
 
+#include <algorithm>
+#include <cstddef>
 #include <iterator>
+#include <new>
 #include <string>
 #ifdef KLAYGE_CXX17_LIBRARY_CHARCONV_SUPPORT
 #include <charconv>
@@ -90,46 +93,40 @@ namespace
 		return ret;
 	}
 
-	XMLNode CreateXmlNodeFromRapidXmlNode(rapidxml::xml_node<char> const& node)
+	XMLNodeType ToXmlNodeType(rapidxml::node_type type)
 	{
-		XMLNodeType type;
-		switch (node.type())
+		switch (type)
 		{
 		case rapidxml::node_document:
-			type = XMLNodeType::Document;
-			break;
+			return XMLNodeType::Document;
 
 		case rapidxml::node_element:
-			type = XMLNodeType::Element;
-			break;
+			return XMLNodeType::Element;
 
 		case rapidxml::node_data:
-			type = XMLNodeType::Data;
-			break;
+			return XMLNodeType::Data;
 
 		case rapidxml::node_cdata:
-			type = XMLNodeType::CData;
-			break;
+			return XMLNodeType::CData;
 
 		case rapidxml::node_comment:
-			type = XMLNodeType::Comment;
-			break;
+			return XMLNodeType::Comment;
 
 		case rapidxml::node_declaration:
-			type = XMLNodeType::Declaration;
-			break;
+			return XMLNodeType::Declaration;
 
 		case rapidxml::node_doctype:
-			type = XMLNodeType::Doctype;
-			break;
+			return XMLNodeType::Doctype;
 
 		case rapidxml::node_pi:
 		default:
-			type = XMLNodeType::PI;
-			break;
+			return XMLNodeType::PI;
 		}
+	}
 
-		XMLNode ret(type, std::string_view(node.name(), node.name_size()));
+	XMLNode CreateXmlNodeFromRapidXmlNode(rapidxml::xml_node<char> const& node)
+	{
+		XMLNode ret(ToXmlNodeType(node.type()), std::string_view(node.name(), node.name_size()));
 		ret.Value(std::string_view(node.value(), node.value_size()));
 
 		for (auto* child = node.first_node(); child; child = child->next_sibling())
@@ -202,7 +199,7 @@ namespace
 		return ret;
 	}
 
-	bool TryConvertStringToValue(std::string const& value_str, int32_t& val)
+	bool TryConvertStringToValue(std::string_view value_str, int32_t& val)
 	{
 #ifdef KLAYGE_CXX17_LIBRARY_CHARCONV_SUPPORT
 		char const* str = value_str.data();
@@ -211,7 +208,7 @@ namespace
 #else
 		try
 		{
-			val = std::stol(value_str);
+			val = std::stol(std::string(value_str));
 			return true;
 		}
 		catch (...)
@@ -221,7 +218,7 @@ namespace
 #endif
 	}
 
-	bool TryConvertStringToValue(std::string const& value_str, uint32_t& val)
+	bool TryConvertStringToValue(std::string_view value_str, uint32_t& val)
 	{
 #ifdef KLAYGE_CXX17_LIBRARY_CHARCONV_SUPPORT
 		char const* str = value_str.data();
@@ -230,7 +227,7 @@ namespace
 #else
 		try
 		{
-			val = std::stoul(value_str);
+			val = std::stoul(std::string(value_str));
 			return true;
 		}
 		catch (...)
@@ -240,7 +237,7 @@ namespace
 #endif
 	}
 
-	bool TryConvertStringToValue(std::string const& value_str, float& val)
+	bool TryConvertStringToValue(std::string_view value_str, float& val)
 	{
 #ifdef KLAYGE_CXX17_LIBRARY_CHARCONV_FP_SUPPORT
 		char const* str = value_str.data();
@@ -249,7 +246,7 @@ namespace
 #else
 		try
 		{
-			val = std::stof(value_str);
+			val = std::stof(std::string(value_str));
 			return true;
 		}
 		catch (...)
@@ -259,9 +256,9 @@ namespace
 #endif
 	}
 
-	bool TryConvertStringToValue(std::string const& value_str, bool& val)
+	bool TryConvertStringToValue(std::string_view value_str, bool& val)
 	{
-		std::string lower_value_str = value_str;
+		std::string lower_value_str(value_str);
 		StringUtil::ToLower(lower_value_str);
 		if ((lower_value_str == "true") || (lower_value_str == "1"))
 		{
@@ -282,13 +279,194 @@ namespace
 
 namespace KlayGE
 {
+	// Source text and bump-pointer arena of a document loaded with XMLDomMode::Arena
+	class XMLDocumentStorage final
+	{
+		KLAYGE_NONCOPYABLE(XMLDocumentStorage);
+
+		static size_t constexpr MIN_BLOCK_SIZE = 64 * 1024;
+
+	public:
+		XMLDocumentStorage(std::unique_ptr<char[]> source, size_t source_size)
+			: source_(std::move(source)), source_size_(source_size)
+		{
+		}
+
+		char* Source() noexcept
+		{
+			return source_.get();
+		}
+
+		void* Allocate(size_t size, size_t alignment)
+		{
+			size_t padding = (alignment - reinterpret_cast<uintptr_t>(cur_) % alignment) % alignment;
+			if (padding + size > remaining_)
+			{
+				// Nodes take roughly as much memory as the text they come from
+				size_t const block_size = std::max({MIN_BLOCK_SIZE, source_size_, size + alignment});
+				blocks_.push_back(MakeUniquePtr<std::byte[]>(block_size));
+				cur_ = blocks_.back().get();
+				remaining_ = block_size;
+				padding = (alignment - reinterpret_cast<uintptr_t>(cur_) % alignment) % alignment;
+			}
+
+			void* ret = cur_ + padding;
+			cur_ += padding + size;
+			remaining_ -= padding + size;
+			return ret;
+		}
+
+	private:
+		std::unique_ptr<char[]> source_;
+		size_t source_size_;
+
+		std::vector<std::unique_ptr<std::byte[]>> blocks_;
+		std::byte* cur_ = nullptr;
+		size_t remaining_ = 0;
+	};
+
+	// Allocates from a document's arena, or from the heap if there is no document. Copies always go to the heap.
+	template <typename T>
+	class XMLArenaAllocator
+	{
+		template <typename U>
+		friend class XMLArenaAllocator;
+
+	public:
+		using value_type = T;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		XMLArenaAllocator() noexcept = default;
+		explicit XMLArenaAllocator(XMLDocumentStorage* storage) noexcept : storage_(storage)
+		{
+		}
+		template <typename U>
+		XMLArenaAllocator(XMLArenaAllocator<U> const& rhs) noexcept : storage_(rhs.storage_)
+		{
+		}
+
+		T* allocate(size_t n)
+		{
+			if (storage_)
+			{
+				return static_cast<T*>(storage_->Allocate(n * sizeof(T), alignof(T)));
+			}
+			else
+			{
+				return std::allocator<T>().allocate(n);
+			}
+		}
+
+		void deallocate(T* p, size_t n) noexcept
+		{
+			// Arena memory goes away with the whole document
+			if (!storage_)
+			{
+				std::allocator<T>().deallocate(p, n);
+			}
+		}
+
+		XMLArenaAllocator select_on_container_copy_construction() const noexcept
+		{
+			return XMLArenaAllocator();
+		}
+
+		template <typename U>
+		bool operator==(XMLArenaAllocator<U> const& rhs) const noexcept
+		{
+			return storage_ == rhs.storage_;
+		}
+		template <typename U>
+		bool operator!=(XMLArenaAllocator<U> const& rhs) const noexcept
+		{
+			return storage_ != rhs.storage_;
+		}
+
+	private:
+		XMLDocumentStorage* storage_ = nullptr;
+	};
+
+	// A name or a value. Points into the document's source text, or into its own copy after being set.
+	// The node or attribute holding it keeps the document alive.
+	class XMLString final
+	{
+	public:
+		XMLString() noexcept = default;
+		explicit XMLString(std::string_view str) : owned_(str), view_(owned_)
+		{
+		}
+		XMLString(XMLString const& rhs) : owned_(rhs.owned_), view_(rhs.view_)
+		{
+			if (rhs.IsOwned())
+			{
+				view_ = owned_;
+			}
+		}
+
+		XMLString& operator=(XMLString const& rhs) = delete;
+
+		static XMLString Borrow(std::string_view str) noexcept
+		{
+			XMLString ret;
+			ret.view_ = str;
+			return ret;
+		}
+
+		XMLString& operator=(std::string_view str)
+		{
+			owned_ = str;
+			view_ = owned_;
+			return *this;
+		}
+
+		std::string_view View() const noexcept
+		{
+			return view_;
+		}
+
+	private:
+		bool IsOwned() const noexcept
+		{
+			return view_.data() == owned_.data();
+		}
+
+	private:
+		std::string owned_;
+		std::string_view view_;
+	};
+
 	class XMLNode::Impl final
 	{
 	public:
-		explicit Impl(XMLNodeType type, std::string_view name) noexcept : type_(type), name_(std::move(name))
+		explicit Impl(XMLNodeType type, std::string_view name) : type_(type), name_(name)
+		{
+		}
+		Impl(XMLNodeType type, std::string_view name, std::string_view value, std::shared_ptr<XMLDocumentStorage> const& storage)
+			: storage_(storage), type_(type), name_(XMLString::Borrow(name)), value_(XMLString::Borrow(value)),
+				children_(XMLArenaAllocator<XMLNode>(storage.get())), attrs_(XMLArenaAllocator<XMLAttribute>(storage.get())),
+				in_arena_(true)
+		{
+		}
+		Impl(Impl const& rhs)
+			: storage_(rhs.storage_), parent_(rhs.parent_), type_(rhs.type_), name_(rhs.name_), value_(rhs.value_),
+				children_(rhs.children_), attrs_(rhs.attrs_)
 		{
 		}
 
+		Impl& operator=(Impl const& rhs) = delete;
+
+		static XMLNode CreateFromRapidXmlNode(rapidxml::xml_node<char> const& node, std::shared_ptr<XMLDocumentStorage> const& storage);
+
+		bool InArena() const noexcept
+		{
+			return in_arena_;
+		}
+		std::shared_ptr<XMLDocumentStorage> ReleaseStorage() noexcept
+		{
+			return std::move(storage_);
+		}
+
 		void UpdateParent(XMLNode& new_parent)
 		{
 			for (auto& child : children_)
@@ -303,11 +481,11 @@ namespace KlayGE
 
 		std::string_view Name() const noexcept
 		{
-			return name_;
+			return name_.View();
 		}
 		void Name(std::string_view name) noexcept
 		{
-			name_ = std::move(name);
+			name_ = name;
 		}
 
 		XMLNodeType Type() const noexcept
@@ -623,34 +801,90 @@ namespace KlayGE
 			attrs_.clear();
 		}
 
-		std::string const& ValueString() const
+		std::string_view ValueString() const noexcept
 		{
-			return value_;
+			return value_.View();
 		}
 
 		void Value(std::string_view value)
 		{
-			value_ = std::move(value);
+			value_ = value;
 		}
 
 	private:
+		// Keeps the source text and the arena alive, for arena nodes and their copies
+		std::shared_ptr<XMLDocumentStorage> storage_;
+
 		XMLNode* parent_{};
 
 		XMLNodeType type_;
-		std::string name_;
-		std::string value_;
+		XMLString name_;
+		XMLString value_;
 
-		std::vector<XMLNode> children_;
-		std::vector<XMLAttribute> attrs_;
+		std::vector<XMLNode, XMLArenaAllocator<XMLNode>> children_;
+		std::vector<XMLAttribute, XMLArenaAllocator<XMLAttribute>> attrs_;
+
+		bool in_arena_ = false;
 	};
 
-	XMLNode::XMLNode(XMLNodeType type, std::string_view name) : pimpl_(MakeUniquePtr<Impl>(type, std::move(name)))
+	void XMLNode::ImplDeleter::operator()(Impl* impl) const noexcept
+	{
+		if (impl->InArena())
+		{
+			// The arena might go away with the last reference, which must outlive the destructor
+			auto const storage = impl->ReleaseStorage();
+			impl->~Impl();
+		}
+		else
+		{
+			delete impl;
+		}
+	}
+
+	XMLNode::XMLNode(XMLNodeType type, std::string_view name) : pimpl_(new Impl(type, std::move(name)))
 	{
 	}
 
-	XMLNode::XMLNode(XMLNode const& rhs)
+	XMLNode::XMLNode(std::unique_ptr<Impl, ImplDeleter> impl) noexcept : pimpl_(std::move(impl))
+	{
+		pimpl_->UpdateParent(*this);
+	}
+
+	XMLNode XMLNode::Impl::CreateFromRapidXmlNode(rapidxml::xml_node<char> const& node, std::shared_ptr<XMLDocumentStorage> const& storage)
+	{
+		auto* impl = new (storage->Allocate(sizeof(Impl), alignof(Impl))) Impl(ToXmlNodeType(node.type()),
+			std::string_view(node.name(), node.name_size()), std::string_view(node.value(), node.value_size()), storage);
+		XMLNode ret{std::unique_ptr<Impl, ImplDeleter>(impl)};
+
+		uint32_t num_children = 0;
+		for (auto* child = node.first_node(); child; child = child->next_sibling())
+		{
+			++ num_children;
+		}
+		uint32_t num_attrs = 0;
+		for (auto* attr = node.first_attribute(); attr; attr = attr->next_attribute())
+		{
+			++ num_attrs;
+		}
+
+		impl->children_.reserve(num_children);
+		for (auto* child = node.first_node(); child; child = child->next_sibling())
+		{
+			impl->children_.emplace_back(CreateFromRapidXmlNode(*child, storage));
+		}
+		impl->attrs_.reserve(num_attrs);
+		for (auto* attr = node.first_attribute(); attr; attr = attr->next_attribute())
+		{
+			impl->attrs_.emplace_back(MakeArenaAttrib(
+				std::string_view(attr->name(), attr->name_size()), std::string_view(attr->value(), attr->value_size()), storage));
+		}
+		impl->UpdateParent(ret);
+
+		return ret;
+	}
+
+	XMLNode::XMLNode(XMLNode const& rhs) : pimpl_(new Impl(*rhs.pimpl_))
 	{
-		pimpl_ = MakeUniquePtr<Impl>(*rhs.pimpl_);
 		pimpl_->UpdateParent(*this);
 	}
 
@@ -665,7 +899,7 @@ namespace KlayGE
 	{
 		if (this != &rhs)
 		{
-			pimpl_ = MakeUniquePtr<Impl>(*rhs.pimpl_);
+			pimpl_.reset(new Impl(*rhs.pimpl_));
 			pimpl_->UpdateParent(*this);
 		}
 		return *this;
@@ -1056,17 +1290,35 @@ namespace KlayGE
 	{
 	public:
 		explicit Impl(std::string_view name)
-			: name_(std::move(name))
+			: name_(name)
+		{
+		}
+		Impl(std::string_view name, std::string_view value, std::shared_ptr<XMLDocumentStorage> const& storage)
+			: storage_(storage), name_(XMLString::Borrow(name)), value_(XMLString::Borrow(value)), in_arena_(true)
 		{
 		}
+		Impl(Impl const& rhs) : storage_(rhs.storage_), parent_(rhs.parent_), name_(rhs.name_), value_(rhs.value_)
+		{
+		}
+
+		Impl& operator=(Impl const& rhs) = delete;
+
+		bool InArena() const noexcept
+		{
+			return in_arena_;
+		}
+		std::shared_ptr<XMLDocumentStorage> ReleaseStorage() noexcept
+		{
+			return std::move(storage_);
+		}
 
 		std::string_view Name() const noexcept
 		{
-			return name_;
+			return name_.View();
 		}
 		void Name(std::string_view name) noexcept
 		{
-			name_ = std::move(name);
+			name_ = name;
 		}
 
 		XMLNode* Parent() noexcept
@@ -1078,56 +1330,85 @@ namespace KlayGE
 			parent_ = parent;
 		}
 
-		std::string const& ValueString() const
+		std::string_view ValueString() const noexcept
 		{
-			return value_;
+			return value_.View();
 		}
 
 		void Value(std::string_view value)
 		{
-			value_ = std::move(value);
+			value_ = value;
 		}
 
 	private:
+		std::shared_ptr<XMLDocumentStorage> storage_;
+
 		XMLNode* parent_{};
 
-		std::string name_;
-		std::string value_;
+		XMLString name_;
+		XMLString value_;
+
+		bool in_arena_ = false;
 	};
 
+	void XMLAttribute::ImplDeleter::operator()(Impl* impl) const noexcept
+	{
+		if (impl->InArena())
+		{
+			auto const storage = impl->ReleaseStorage();
+			impl->~Impl();
+		}
+		else
+		{
+			delete impl;
+		}
+	}
+
 
 	XMLAttribute::XMLAttribute(std::string_view name)
-		: pimpl_(MakeUniquePtr<Impl>(std::move(name)))
+		: pimpl_(new Impl(std::move(name)))
 	{
 	}
 	XMLAttribute::XMLAttribute(std::string_view name, bool value)
-		: pimpl_(MakeUniquePtr<Impl>(std::move(name)))
+		: pimpl_(new Impl(std::move(name)))
 	{
 		this->Value(value);
 	}
 	XMLAttribute::XMLAttribute(std::string_view name, int32_t value)
-		: pimpl_(MakeUniquePtr<Impl>(std::move(name)))
+		: pimpl_(new Impl(std::move(name)))
 	{
 		this->Value(value);
 	}
 	XMLAttribute::XMLAttribute(std::string_view name, uint32_t value)
-		: pimpl_(MakeUniquePtr<Impl>(std::move(name)))
+		: pimpl_(new Impl(std::move(name)))
 	{
 		this->Value(value);
 	}
 	XMLAttribute::XMLAttribute(std::string_view name, float value)
-		: pimpl_(MakeUniquePtr<Impl>(std::move(name)))
+		: pimpl_(new Impl(std::move(name)))
 	{
 		this->Value(value);
 	}
 	XMLAttribute::XMLAttribute(std::string_view name, std::string_view value)
-		: pimpl_(MakeUniquePtr<Impl>(std::move(name)))
+		: pimpl_(new Impl(std::move(name)))
 	{
 		pimpl_->Value(std::move(value));
 	}
 
+	XMLAttribute::XMLAttribute(std::unique_ptr<Impl, ImplDeleter> impl) noexcept : pimpl_(std::move(impl))
+	{
+	}
+
+	XMLAttribute XMLNode::MakeArenaAttrib(
+		std::string_view name, std::string_view value, std::shared_ptr<XMLDocumentStorage> const& storage)
+	{
+		auto* impl = new (storage->Allocate(sizeof(XMLAttribute::Impl), alignof(XMLAttribute::Impl)))
+			XMLAttribute::Impl(name, value, storage);
+		return XMLAttribute(std::unique_ptr<XMLAttribute::Impl, XMLAttribute::ImplDeleter>(impl));
+	}
+
 	XMLAttribute::XMLAttribute(XMLAttribute const& rhs)
-		: pimpl_(MakeUniquePtr<Impl>(*rhs.pimpl_))
+		: pimpl_(new Impl(*rhs.pimpl_))
 	{
 	}
 
@@ -1139,7 +1420,7 @@ namespace KlayGE
 	{
 		if (this != &rhs)
 		{
-			pimpl_ = MakeUniquePtr<Impl>(*rhs.pimpl_);
+			pimpl_.reset(new Impl(*rhs.pimpl_));
 		}
 		return *this;
 	}
@@ -1270,7 +1551,7 @@ namespace KlayGE
 	}
 
 
-	XMLNode LoadXml(ResIdentifier& source)
+	XMLNode LoadXml(ResIdentifier& source, XMLDomMode mode)
 	{
 		source.seekg(0, std::ios_base::end);
 		size_t const len = static_cast<size_t>(source.tellg());
@@ -1280,9 +1561,18 @@ namespace KlayGE
 		xml_src[len] = 0;
 
 		rapidxml::xml_document<char> doc;
-		doc.parse<0>(xml_src.get());
-
-		return CreateXmlNodeFromRapidXmlNode(*doc.first_node());
+		if (mode == XMLDomMode::Copy)
+		{
+			doc.parse<0>(xml_src.get());
+			return CreateXmlNodeFromRapidXmlNode(*doc.first_node());
+		}
+		else
+		{
+			// rapidxml parses in situ, so names and values can stay in the source buffer
+			auto storage = MakeSharedPtr<XMLDocumentStorage>(std::move(xml_src), len);
+			doc.parse<0>(storage->Source());
+			return XMLNode::Impl::CreateFromRapidXmlNode(*doc.first_node(), storage);
+		}
 	}
 
 	void SaveXml(XMLNode const& node, std::ostream& os)
@@ -29,12 +29,33 @@
  */
 
 #include <KFL/KFL.hpp>
+#include <KFL/CXX20/bit.hpp>
 #include <KFL/SIMDMath.hpp>
 
+#include <functional>
+
 #ifdef SIMD_MATH_SSE
 	#include <emmintrin.h>
 #endif
 
+#if !defined(SIMD_MATH_SSE)
+namespace
+{
+	using namespace KlayGE;
+
+	template <typename Pred>
+	SIMDVectorF4 CompareGeneral(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs, Pred pred)
+	{
+		SIMDVectorF4 ret;
+		for (size_t i = 0; i < 4; ++ i)
+		{
+			ret.Vec()[i] = std::bit_cast<float>(pred(lhs.Vec()[i], rhs.Vec()[i]) ? 0xFFFFFFFFU : 0U);
+		}
+		return ret;
+	}
+}
+#endif
+
 namespace KlayGE
 {
 	namespace SIMDMathLib
@@ -351,6 +372,18 @@ namespace KlayGE
 #endif
 		}
 
+		void StoreVector4(float* fs, SIMDVectorF4 const & v)
+		{
+#if defined(SIMD_MATH_SSE)
+			_mm_store_ps(&fs[0], v.Vec());
+#else
+			for (size_t i = 0; i < 4; ++ i)
+			{
+				fs[i] = v.Vec()[i];
+			}
+#endif
+		}
+
 		SIMDVectorF4 SetVector(float x, float y, float z, float w)
 		{
 			SIMDVectorF4 ret;
@@ -559,6 +592,66 @@ namespace KlayGE
 			}
 		}
 
+		SIMDVectorF4 Less(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs)
+		{
+#if defined(SIMD_MATH_SSE)
+			SIMDVectorF4 ret;
+			ret.Vec() = _mm_cmplt_ps(lhs.Vec(), rhs.Vec());
+			return ret;
+#else
+			return CompareGeneral(lhs, rhs, std::less<float>());
+#endif
+		}
+
+		SIMDVectorF4 LessEqual(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs)
+		{
+#if defined(SIMD_MATH_SSE)
+			SIMDVectorF4 ret;
+			ret.Vec() = _mm_cmple_ps(lhs.Vec(), rhs.Vec());
+			return ret;
+#else
+			return CompareGeneral(lhs, rhs, std::less_equal<float>());
+#endif
+		}
+
+		SIMDVectorF4 Greater(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs)
+		{
+#if defined(SIMD_MATH_SSE)
+			SIMDVectorF4 ret;
+			ret.Vec() = _mm_cmpgt_ps(lhs.Vec(), rhs.Vec());
+			return ret;
+#else
+			return CompareGeneral(lhs, rhs, std::greater<float>());
+#endif
+		}
+
+		SIMDVectorF4 GreaterEqual(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs)
+		{
+#if defined(SIMD_MATH_SSE)
+			SIMDVectorF4 ret;
+			ret.Vec() = _mm_cmpge_ps(lhs.Vec(), rhs.Vec());
+			return ret;
+#else
+			return CompareGeneral(lhs, rhs, std::greater_equal<float>());
+#endif
+		}
+
+		SIMDVectorF4 Select(SIMDVectorF4 const & mask, SIMDVectorF4 const & if_true, SIMDVectorF4 const & if_false)
+		{
+			SIMDVectorF4 ret;
+#if defined(SIMD_MATH_SSE)
+			ret.Vec() = _mm_or_ps(_mm_and_ps(mask.Vec(), if_true.Vec()), _mm_andnot_ps(mask.Vec(), if_false.Vec()));
+#else
+			for (size_t i = 0; i < 4; ++ i)
+			{
+				uint32_t const m = std::bit_cast<uint32_t>(mask.Vec()[i]);
+				ret.Vec()[i] = std::bit_cast<float>((m & std::bit_cast<uint32_t>(if_true.Vec()[i]))
+					| (~m & std::bit_cast<uint32_t>(if_false.Vec()[i])));
+			}
+#endif
+			return ret;
+		}
+
 		// 2D Vector
 		///////////////////////////////////////////////////////////////////////////////
 		SIMDVectorF4 CrossVector2(SIMDVectorF4 const & lhs, SIMDVectorF4 const & rhs)
@@ -2169,5 +2262,62 @@ namespace KlayGE
 		{
 			return lhs * rhs;
 		}
+
+		// Bound
+		///////////////////////////////////////////////////////////////////////////////
+		void IntersectAABBFrustum(BoundOverlap results[4], SIMDVectorF4 const & min_x, SIMDVectorF4 const & min_y,
+			SIMDVectorF4 const & min_z, SIMDVectorF4 const & max_x, SIMDVectorF4 const & max_y, SIMDVectorF4 const & max_z,
+			Frustum const & frustum)
+		{
+			uint32_t outside = 0;
+			uint32_t intersect = 0;
+			for (int i = 0; i < 6; ++ i)
+			{
+				Plane const & plane = frustum.FrustumPlane(i);
+
+				// v1 is diagonally opposed to v0
+				SIMDVectorF4 const & v0_x = (plane.a() < 0) ? min_x : max_x;
+				SIMDVectorF4 const & v0_y = (plane.b() < 0) ? min_y : max_y;
+				SIMDVectorF4 const & v0_z = (plane.c() < 0) ? min_z : max_z;
+				SIMDVectorF4 const & v1_x = (plane.a() < 0) ? max_x : min_x;
+				SIMDVectorF4 const & v1_y = (plane.b() < 0) ? max_y : min_y;
+				SIMDVectorF4 const & v1_z = (plane.c() < 0) ? max_z : min_z;
+
+#if defined(SIMD_MATH_SSE)
+				__m128 const a = _mm_set1_ps(plane.a());
+				__m128 const b = _mm_set1_ps(plane.b());
+				__m128 const c = _mm_set1_ps(plane.c());
+				__m128 const d = _mm_set1_ps(plane.d());
+				__m128 const dist0 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, v0_x.Vec()), _mm_mul_ps(b, v0_y.Vec())),
+					_mm_mul_ps(c, v0_z.Vec())), d);
+				__m128 const dist1 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, v1_x.Vec()), _mm_mul_ps(b, v1_y.Vec())),
+					_mm_mul_ps(c, v1_z.Vec())), d);
+
+				__m128 const zero = _mm_setzero_ps();
+				outside |= _mm_movemask_ps(_mm_cmplt_ps(dist0, zero));
+				intersect |= _mm_movemask_ps(_mm_cmplt_ps(dist1, zero));
+#else
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					float const dist0 = plane.a() * v0_x.Vec()[j] + plane.b() * v0_y.Vec()[j] + plane.c() * v0_z.Vec()[j] + plane.d();
+					float const dist1 = plane.a() * v1_x.Vec()[j] + plane.b() * v1_y.Vec()[j] + plane.c() * v1_z.Vec()[j] + plane.d();
+					outside |= (dist0 < 0) ? (1U << j) : 0;
+					intersect |= (dist1 < 0) ? (1U << j) : 0;
+				}
+#endif
+			}
+
+			for (uint32_t j = 0; j < 4; ++ j)
+			{
+				if (outside & (1U << j))
+				{
+					results[j] = BoundOverlap::No;
+				}
+				else
+				{
+					results[j] = (intersect & (1U << j)) ? BoundOverlap::Partial : BoundOverlap::Yes;
+				}
+			}
+		}
 	}
 }
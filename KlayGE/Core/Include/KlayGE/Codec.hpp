@@ -0,0 +1,71 @@
+/**
+ * @file Codec.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_CODEC_HPP
+#define KLAYGE_CORE_CODEC_HPP
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <KFL/CXX20/span.hpp>
+#include <KFL/Noncopyable.hpp>
+
+namespace KlayGE
+{
+	// Stored as a byte in file headers. Don't reorder.
+	enum class CodecType : uint8_t
+	{
+		LZMA,
+		LZ4,
+
+		NumTypes
+	};
+
+	// Lossless compression of a whole buffer. LZMA gives smaller files, LZ4 decodes an order of magnitude faster.
+	class KLAYGE_CORE_API Codec
+	{
+		KLAYGE_NONCOPYABLE(Codec);
+
+	public:
+		Codec() noexcept;
+		virtual ~Codec() noexcept;
+
+		virtual CodecType Type() const noexcept = 0;
+
+		virtual void Encode(std::vector<uint8_t>& output, std::span<uint8_t const> input) = 0;
+		virtual void Decode(void* output, std::span<uint8_t const> input, uint64_t original_len) = 0;
+	};
+
+	KLAYGE_CORE_API std::unique_ptr<Codec> MakeCodec(CodecType type);
+}
+
+#endif		// KLAYGE_CORE_CODEC_HPP
@@ -0,0 +1,103 @@
+/**
+ * @file ConstantBufferRing.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_CONSTANT_BUFFER_RING_HPP
+#define KLAYGE_CORE_CONSTANT_BUFFER_RING_HPP
+
+#pragma once
+
+#include <KFL/Noncopyable.hpp>
+
+#include <vector>
+
+namespace KlayGE
+{
+	// Versions of constant buffer contents, sub-allocated from one buffer. A version is made at most once per frame
+	// for each constant buffer, and is bound by its offset. Everything allocated in a frame is freed a few OnPresent later.
+	class KLAYGE_CORE_API ConstantBufferRing final
+	{
+		KLAYGE_NONCOPYABLE(ConstantBufferRing);
+
+	public:
+		struct Stats
+		{
+			uint32_t capacity;
+			// The most bytes in use at once
+			uint32_t high_water_mark;
+			// Allocs that found no room, because the frames in flight hold the whole ring
+			uint32_t num_full;
+		};
+
+	public:
+		ConstantBufferRing(uint32_t size_in_byte, uint32_t alignment, uint32_t num_frames_in_flight = 3);
+
+		// Copies the data to the ring, at an offset with the alignment. Returns false if there is no room.
+		bool Alloc(uint32_t size_in_byte, void const * data, uint32_t& offset);
+		// Uploads the allocs since the last call in one go. It has to be called before they are used by a draw.
+		void EnsureDataReady();
+		void OnPresent();
+
+		// Allocs of this frame are valid until the next OnPresent
+		uint32_t FrameId() const noexcept
+		{
+			return frame_id_;
+		}
+
+		GraphicsBufferPtr const & GetBuffer() const noexcept
+		{
+			return buffer_;
+		}
+
+		Stats GetStats() const noexcept;
+		void ResetStats() noexcept;
+
+	private:
+		uint32_t capacity_;
+		uint32_t alignment_;
+
+		GraphicsBufferPtr buffer_;
+		// Allocs are written here, and uploaded by EnsureDataReady
+		std::vector<uint8_t> simulate_buffer_;
+
+		// Positions only go forward, the offset in the buffer is position % capacity_
+		uint64_t head_ = 0;
+		uint64_t tail_ = 0;
+		uint64_t uploaded_ = 0;
+		// Head at each of the last num_frames_in_flight OnPresent. The oldest becomes the tail.
+		std::vector<uint64_t> frame_fences_;
+		uint32_t fence_index_ = 0;
+		uint32_t frame_id_ = 0;
+
+		uint32_t high_water_mark_ = 0;
+		uint32_t num_full_ = 0;
+	};
+}
+
+#endif // KLAYGE_CORE_CONSTANT_BUFFER_RING_HPP
@@ -0,0 +1,110 @@
+/**
+ * @file DatagramIO.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_DATAGRAM_IO_HPP
+#define KLAYGE_CORE_DATAGRAM_IO_HPP
+
+#pragma once
+
+#include <KFL/CXX20/span.hpp>
+#include <KFL/Noncopyable.hpp>
+
+#include <memory>
+#include <vector>
+
+#include <KlayGE/Socket.hpp>
+
+namespace KlayGE
+{
+	// Fixed-size datagram buffers, allocated once up front. Not thread safe.
+	class KLAYGE_CORE_API DatagramBufferPool final
+	{
+		KLAYGE_NONCOPYABLE(DatagramBufferPool);
+
+	public:
+		DatagramBufferPool(uint32_t buffer_size, uint32_t num_buffers);
+
+		uint32_t BufferSize() const noexcept
+		{
+			return buffer_size_;
+		}
+		uint32_t NumFreeBuffers() const noexcept
+		{
+			return static_cast<uint32_t>(free_buffers_.size());
+		}
+
+		// Returns nullptr if all buffers are in use
+		char* Allocate() noexcept;
+		void Free(char* buffer) noexcept;
+
+	private:
+		uint32_t buffer_size_;
+		std::unique_ptr<char[]> storage_;
+		std::vector<char*> free_buffers_;
+	};
+
+	struct Datagram
+	{
+		char* data;
+		uint32_t size;
+		sockaddr_in addr;
+	};
+
+	// Drives a UDP socket by readiness instead of blocking calls, epoll on Linux and Android, IOCP on Windows, poll elsewhere.
+	// Datagrams are received and sent in batches, recvmmsg/sendmmsg where available. All buffers come from the pool.
+	class KLAYGE_CORE_API DatagramIO final
+	{
+		KLAYGE_NONCOPYABLE(DatagramIO);
+
+	public:
+		static uint32_t constexpr MAX_BATCH = 64;
+
+		DatagramIO(Socket& socket, DatagramBufferPool& pool);
+		~DatagramIO() noexcept;
+
+		// Waits up to timeout_ms for the socket to be readable, and receives up to received.size() datagrams.
+		// Each received buffer has to go back through Release.
+		uint32_t Receive(std::span<Datagram> received, uint32_t timeout_ms);
+		void Release(Datagram const & datagram) noexcept;
+
+		// Returns nullptr if the pool is exhausted. Call Flush to get some buffers back.
+		char* AllocateSendBuffer() noexcept;
+		// Takes over the buffer. It goes out with the next Flush, to the connected peer if there is no address.
+		void QueueSend(char* data, uint32_t size, sockaddr_in const & to);
+		void QueueSend(char* data, uint32_t size);
+		void Flush();
+
+	private:
+		class Impl;
+		std::unique_ptr<Impl> pimpl_;
+	};
+}
+
+#endif		// KLAYGE_CORE_DATAGRAM_IO_HPP
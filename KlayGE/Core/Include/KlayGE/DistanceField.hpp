@@ -37,11 +37,31 @@
 
 namespace KlayGE
 {
+	// Working memory of ComputeDistance. Keep one per thread to avoid allocations when computing many distance fields.
+	struct DistanceFieldScratch
+	{
+		std::vector<float> aa_data;
+		std::vector<float2> grad_data;
+		std::vector<int32_t> outside_site_y;
+		std::vector<int32_t> inside_site_y;
+		std::vector<int2> outside_nearest_site;
+		std::vector<int2> inside_nearest_site;
+		std::vector<float> inside_dist;
+	};
+
 	template <typename T>
 	KLAYGE_CORE_API void Downsample2x(std::vector<T> const & input_data, uint32_t input_width, uint32_t input_height,
 		std::vector<T>& output_data);
 
+	// Signed distance field at half of the input resolution, with a linear time transform.
+	// Large images are processed on the thread pool.
+	KLAYGE_CORE_API void ComputeDistance(std::vector<float> const & aa_2x_data, uint32_t input_width, uint32_t input_height,
+		std::vector<float>& dist_data);
 	KLAYGE_CORE_API void ComputeDistance(std::vector<float> const & aa_2x_data, uint32_t input_width, uint32_t input_height,
+		std::vector<float>& dist_data, DistanceFieldScratch& scratch);
+
+	// The iterative anti-aliased Euclidean distance transform. Much slower, kept as a reference.
+	KLAYGE_CORE_API void ComputeDistanceReference(std::vector<float> const & aa_2x_data, uint32_t input_width, uint32_t input_height,
 		std::vector<float>& dist_data);
 }
 
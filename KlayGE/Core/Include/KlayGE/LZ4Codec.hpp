@@ -0,0 +1,57 @@
+/**
+ * @file LZ4Codec.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_LZ4_CODEC_HPP
+#define KLAYGE_CORE_LZ4_CODEC_HPP
+
+#pragma once
+
+#include <KlayGE/Codec.hpp>
+
+namespace KlayGE
+{
+	// Produces and consumes raw LZ4 blocks. Greedy matching, so the ratio is close to LZ4's fast mode.
+	class KLAYGE_CORE_API LZ4Codec final : public Codec
+	{
+	public:
+		LZ4Codec() noexcept;
+		~LZ4Codec() noexcept override;
+
+		CodecType Type() const noexcept override
+		{
+			return CodecType::LZ4;
+		}
+
+		void Encode(std::vector<uint8_t>& output, std::span<uint8_t const> input) override;
+		void Decode(void* output, std::span<uint8_t const> input, uint64_t original_len) override;
+	};
+}
+
+#endif		// KLAYGE_CORE_LZ4_CODEC_HPP
@@ -36,27 +36,31 @@
 #include <KFL/CXX20/span.hpp>
 #include <KFL/Noncopyable.hpp>
 #include <KFL/ResIdentifier.hpp>
+#include <KlayGE/Codec.hpp>
 
 namespace KlayGE
 {
-	class KLAYGE_CORE_API LZMACodec final
+	class KLAYGE_CORE_API LZMACodec final : public Codec
 	{
-		KLAYGE_NONCOPYABLE(LZMACodec);
-
 	public:
 		LZMACodec() noexcept;
-		~LZMACodec() noexcept;
+		~LZMACodec() noexcept override;
+
+		CodecType Type() const noexcept override
+		{
+			return CodecType::LZMA;
+		}
 
 		uint64_t Encode(std::ostream& os, ResIdentifierPtr const & res, uint64_t len);
 		uint64_t Encode(std::ostream& os, std::span<uint8_t const> input);
 		void Encode(std::vector<uint8_t>& output, ResIdentifierPtr const & res, uint64_t len);
-		void Encode(std::vector<uint8_t>& output, std::span<uint8_t const> input);
+		void Encode(std::vector<uint8_t>& output, std::span<uint8_t const> input) override;
 
 		uint64_t Decode(std::ostream& os, ResIdentifierPtr const & res, uint64_t len, uint64_t original_len);
 		uint64_t Decode(std::ostream& os, std::span<uint8_t const> input, uint64_t original_len);
 		void Decode(std::vector<uint8_t>& output, ResIdentifierPtr const & res, uint64_t len, uint64_t original_len);
 		void Decode(std::vector<uint8_t>& output, std::span<uint8_t const> input, uint64_t original_len);
-		void Decode(void* output, std::span<uint8_t const> input, uint64_t original_len);
+		void Decode(void* output, std::span<uint8_t const> input, uint64_t original_len) override;
 	};
 }
 
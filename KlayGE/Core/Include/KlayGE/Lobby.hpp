@@ -19,9 +19,11 @@
 #pragma once
 
 #include <vector>
-#include <list>
+#include <unordered_map>
 
+#include <KFL/CXX20/span.hpp>
 #include <KFL/Noncopyable.hpp>
+#include <KlayGE/DatagramIO.hpp>
 #include <KlayGE/Socket.hpp>
 
 namespace KlayGE
@@ -56,7 +58,16 @@ namespace KlayGE
 
 		uint32_t		time;
 
-		std::list<std::vector<char>> msgs;
+		// Buffers from the lobby's pool
+		std::vector<std::span<char>> msgs;
+	};
+
+	enum class LobbyIOMode
+	{
+		// One blocking receive per datagram, and one send per reply
+		Blocking,
+		// Waits for the socket to be readable, receives and replies in batches
+		EventDriven
 	};
 
 	class KLAYGE_CORE_API Lobby final
@@ -70,7 +81,11 @@ namespace KlayGE
 		Lobby();
 		~Lobby();
 
-		void Create(std::string const & Name, char maxPlayers, uint16_t port, Processor const & pro);
+		// Binds the socket ahead of Create. With a port of 0, SockAddr() has the one the system picked afterwards.
+		void Bind(uint16_t port);
+		// Runs until an empty datagram arrives. Binds the socket to the port first, unless Bind was called.
+		void Create(std::string const & Name, char maxPlayers, uint16_t port, Processor const & pro,
+			LobbyIOMode mode = LobbyIOMode::Blocking);
 		void Close();
 
 		void LobbyName(std::string const & Name);
@@ -93,6 +108,9 @@ namespace KlayGE
 			{ return this->sockAddr_; }
 
 	private:
+		void RunEventDriven(Processor const & pro);
+		void Dispatch(char* revBuf, char* sendBuf, int& numSend, sockaddr_in& from, Processor const & pro);
+
 		void OnJoin(char* revbuf, char* sendbuf, int& sendnum, sockaddr_in& From, Processor const & pro);
 		void OnQuit(PlayerAddrsIter iter, char* sendbuf, int& sendnum, Processor const & pro);
 
@@ -100,10 +118,16 @@ namespace KlayGE
 		void OnNop(PlayerAddrsIter iter);
 
 		PlayerAddrsIter ID(sockaddr_in const & Addr);
+		void FreePlayer(PlayerAddrsIter iter);
+		void SweepTimedOutPlayers();
 
 	private:
 		Socket			socket_;
 		PlayerAddrs		players_;
+		// Address to index in players_
+		std::unordered_map<uint64_t, uint32_t> player_indices_;
+
+		DatagramBufferPool buffer_pool_;
 
 		sockaddr_in		sockAddr_;
 
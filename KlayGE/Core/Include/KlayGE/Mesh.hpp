@@ -31,6 +31,7 @@
 #include <KlayGE/RenderLayout.hpp>
 #include <KFL/Math.hpp>
 #include <KFL/Noncopyable.hpp>
+#include <KlayGE/Codec.hpp>
 #include <KlayGE/SceneNode.hpp>
 #include <KlayGE/SceneComponent.hpp>
 
@@ -441,9 +442,11 @@ namespace KlayGE
 		std::function<void(RenderModel&)> OnFinishLoading = nullptr,
 		std::function<RenderModelPtr(std::wstring_view, uint32_t)> CreateModelFactoryFunc = CreateModelFactory<RenderModel>,
 		std::function<StaticMeshPtr(std::wstring_view)> CreateMeshFactoryFunc = CreateMeshFactory<StaticMesh>);
-	KLAYGE_CORE_API RenderModelPtr LoadSoftwareModel(std::string_view model_name);
+	// Without animations, a skinned model is loaded as a static one in its bind pose, e.g. for previews
+	KLAYGE_CORE_API RenderModelPtr LoadSoftwareModel(std::string_view model_name, bool load_animations = true);
 
-	KLAYGE_CORE_API void SaveModel(RenderModel const & model, std::string_view model_name);
+	// LZMA gives the smallest files, LZ4 the fastest loading
+	KLAYGE_CORE_API void SaveModel(RenderModel const & model, std::string_view model_name, CodecType codec_type = CodecType::LZMA);
 
 
 	class KLAYGE_CORE_API RenderableLightSourceProxy : public StaticMesh
@@ -33,8 +33,13 @@
 
 #pragma once
 
+#include <list>
+#include <mutex>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include <KFL/CXX20/span.hpp>
 #include <KFL/ResIdentifier.hpp>
 
 struct IInArchive;
@@ -49,14 +54,48 @@ namespace KlayGE
 
 		bool Locate(std::string_view extract_file_path);
 		ResIdentifierPtr Extract(std::string_view extract_file_path, std::string_view res_name);
+		// Decodes all the files in one pass over the archive. Missing files get null.
+		std::vector<ResIdentifierPtr> ExtractMany(
+			std::span<std::string_view const> extract_file_paths, std::span<std::string_view const> res_names);
 
 		ResIdentifier* ArchiveStream() const
 		{
 			return archive_is_.get();
 		}
 
+		// Decoded solid blocks are kept for the following files in them, up to this number of bytes
+		void SolidBlockCacheBudget(uint64_t budget);
+		uint64_t SolidBlockCacheBudget() const;
+		// Passes over the archive so far. Files served from the block cache don't add to it.
+		uint32_t NumDecodePasses() const;
+
+	private:
+		struct ItemInfo
+		{
+			uint32_t block;
+			uint64_t size;
+		};
+
+		struct BlockInfo
+		{
+			std::vector<uint32_t> items;
+			uint64_t size = 0;
+		};
+
+		struct CachedBlock
+		{
+			uint32_t block;
+			uint64_t size;
+			std::unordered_map<uint32_t, std::shared_ptr<std::string>> items;
+		};
+
 	private:
-		uint32_t Find(std::string_view extract_file_path);
+		void BuildIndex();
+		uint32_t Find(std::string_view extract_file_path) const;
+		std::vector<std::shared_ptr<std::string>> Decode(std::span<uint32_t const> indices);
+		std::shared_ptr<std::string> FindInCache(uint32_t index);
+		void EvictBlocks();
+		ResIdentifierPtr MakeResIdentifier(uint32_t index, std::string_view res_name, std::shared_ptr<std::string> const & data);
 
 	private:
 		ResIdentifierPtr archive_is_;
@@ -65,6 +104,17 @@ namespace KlayGE
 		std::string password_;
 
 		uint32_t num_items_;
+
+		// Lower case paths with '/' to item indices, built once on open
+		std::unordered_map<std::string, uint32_t> path_index_;
+		std::vector<ItemInfo> items_;
+		std::unordered_map<uint32_t, BlockInfo> blocks_;
+
+		std::mutex extract_mutex_;
+		std::list<CachedBlock> block_cache_;
+		uint64_t block_cache_size_ = 0;
+		uint64_t block_cache_budget_ = 64 * 1024 * 1024;
+		uint32_t num_decode_passes_ = 0;
 	};
 
 	using PackagePtr = std::shared_ptr<Package>;
@@ -33,6 +33,8 @@
 
 #pragma once
 
+#include <KFL/AlignedAllocator.hpp>
+#include <KFL/CXX20/span.hpp>
 #include <KFL/Math.hpp>
 #include <KFL/Noncopyable.hpp>
 #include <KlayGE/SceneNode.hpp>
@@ -63,6 +65,68 @@ namespace KlayGE
 		float init_life;
 	};
 
+	// Particles in SoA layout. The arrays are 16-byte aligned and padded to a multiple of 4 with dead particles,
+	// so updaters can process 4 particles at a time with SIMDVectorF4.
+	struct ParticleStore
+	{
+		using FloatArray = std::vector<float, aligned_allocator<float, 16>>;
+
+		FloatArray pos_x;
+		FloatArray pos_y;
+		FloatArray pos_z;
+		FloatArray vel_x;
+		FloatArray vel_y;
+		FloatArray vel_z;
+		FloatArray life;
+		FloatArray spin;
+		FloatArray size;
+		FloatArray alpha;
+		FloatArray init_life;
+
+		uint32_t Size() const
+		{
+			return static_cast<uint32_t>(life.size());
+		}
+
+		void Resize(uint32_t num_particles)
+		{
+			uint32_t const padded_num_particles = (num_particles + 3) & ~3U;
+			for (auto* arr : {&pos_x, &pos_y, &pos_z, &vel_x, &vel_y, &vel_z, &life, &spin, &size, &alpha})
+			{
+				arr->assign(padded_num_particles, 0.0f);
+			}
+			init_life.assign(padded_num_particles, 1.0f);
+		}
+
+		Particle Get(uint32_t index) const
+		{
+			Particle par;
+			par.pos = float3(pos_x[index], pos_y[index], pos_z[index]);
+			par.vel = float3(vel_x[index], vel_y[index], vel_z[index]);
+			par.life = life[index];
+			par.spin = spin[index];
+			par.size = size[index];
+			par.alpha = alpha[index];
+			par.init_life = init_life[index];
+			return par;
+		}
+
+		void Set(uint32_t index, Particle const & par)
+		{
+			pos_x[index] = par.pos.x();
+			pos_y[index] = par.pos.y();
+			pos_z[index] = par.pos.z();
+			vel_x[index] = par.vel.x();
+			vel_y[index] = par.vel.y();
+			vel_z[index] = par.vel.z();
+			life[index] = par.life;
+			spin[index] = par.spin;
+			size[index] = par.size;
+			alpha[index] = par.alpha;
+			init_life[index] = par.init_life;
+		}
+	};
+
 	class KLAYGE_CORE_API ParticleEmitter
 	{
 		KLAYGE_NONCOPYABLE(ParticleEmitter);
@@ -188,6 +252,8 @@ namespace KlayGE
 
 		uint32_t Update(float elapsed_time);
 		virtual void Emit(Particle& par) = 0;
+		// Emits new particles into the given slots. The default calls Emit(Particle&) on each of them.
+		virtual void Emit(ParticleStore& particles, std::span<uint32_t const> indices);
 
 	protected:
 		void DoClone(ParticleEmitterPtr const & rhs);
@@ -224,8 +290,18 @@ namespace KlayGE
 		virtual ParticleUpdaterPtr Clone() = 0;
 
 		virtual void Update(Particle& par, float elapse_time) = 0;
+		// Updates the alive particles in [begin, end), where both are multiples of 4. The default calls
+		// Update(Particle&, float) on each alive particle.
+		virtual void Update(ParticleStore& particles, uint32_t begin, uint32_t end, float elapse_time);
 		virtual void SnapParams() = 0;
 
+		// Whether the batched Update can be called from several threads at once on disjoint ranges. The particle system
+		// updates on the thread pool only if all its updaters allow it. false by default, a subclass's Update doesn't have to.
+		virtual bool ThreadSafe() const
+		{
+			return false;
+		}
+
 	protected:
 		void DoClone(ParticleUpdaterPtr const & rhs);
 
@@ -301,19 +377,19 @@ namespace KlayGE
 
 		uint32_t NumParticles() const
 		{
-			return static_cast<uint32_t>(particles_.size());
+			return num_particles_;
 		}
 		uint32_t NumActiveParticles() const;
 		uint32_t GetActiveParticleIndex(uint32_t i) const;
-		Particle const & GetParticle(uint32_t i) const
+		Particle GetParticle(uint32_t i) const
 		{
-			BOOST_ASSERT(i < particles_.size());
-			return particles_[i];
+			BOOST_ASSERT(i < num_particles_);
+			return particles_.Get(i);
 		}
-		Particle& GetParticle(uint32_t i)
+		void SetParticle(uint32_t i, Particle const & par)
 		{
-			BOOST_ASSERT(i < particles_.size());
-			return particles_[i];
+			BOOST_ASSERT(i < num_particles_);
+			particles_.Set(i, par);
 		}
 		void ClearParticles();
 
@@ -351,8 +427,16 @@ namespace KlayGE
 		std::vector<ParticleEmitterPtr> emitters_;
 		std::vector<ParticleUpdaterPtr> updaters_;
 
-		std::vector<Particle> particles_;
+		ParticleStore particles_;
+		uint32_t num_particles_;
+		std::vector<uint32_t> free_particles_;
 		std::vector<std::pair<uint32_t, float>> actived_particles_;
+		std::vector<std::vector<std::pair<uint32_t, float>>> range_actived_particles_;
+		std::vector<float> particle_depths_;
+		std::vector<uint8_t> particle_in_order_;
+		std::vector<std::pair<uint32_t, float>> sorted_particles_;
+		std::vector<std::pair<uint32_t, float>> new_particles_;
+		std::vector<std::pair<uint32_t, float>> sort_scratch_;
 		mutable std::mutex actived_particles_mutex_;
 
 		float gravity_;
@@ -384,9 +468,10 @@ namespace KlayGE
 		virtual ParticleEmitterPtr Clone() override;
 
 		virtual void Emit(Particle& par) override;
+		void Emit(ParticleStore& particles, std::span<uint32_t const> indices) override;
 
 	private:
-		float RandomGen();
+		void Emit(Particle& par, std::ranlux24_base& gen, std::uniform_real_distribution<float>& random_dis);
 
 	private:
 		std::ranlux24_base gen_;
@@ -430,8 +515,15 @@ namespace KlayGE
 		}
 
 		void Update(Particle& par, float elapse_time) override;
+		void Update(ParticleStore& particles, uint32_t begin, uint32_t end, float elapse_time) override;
 		void SnapParams() override;
 
+		// Only reads the params snapped for this frame
+		bool ThreadSafe() const override
+		{
+			return true;
+		}
+
 	private:
 		std::mutex update_mutex_;
 
@@ -78,6 +78,32 @@ namespace KlayGE
 		bool dirty_ = false;
 	};
 
+	// Sums up a value, such as bytes uploaded, over a frame
+	class KLAYGE_CORE_API PerfCounter final
+	{
+		KLAYGE_NONCOPYABLE(PerfCounter);
+
+	public:
+		PerfCounter();
+
+		void Add(uint64_t value) noexcept
+		{
+			sum_ += value;
+		}
+
+		void CollectData() noexcept;
+
+		// The sum of the last collected frame
+		uint64_t Value() const noexcept
+		{
+			return value_;
+		}
+
+	private:
+		uint64_t sum_ = 0;
+		uint64_t value_ = 0;
+	};
+
 	class KLAYGE_CORE_API PerfProfiler final
 	{
 		friend class Context;
@@ -92,6 +118,7 @@ namespace KlayGE
 		void Resume();
 
 		PerfRegion* CreatePerfRegion(int category, std::string const& name);
+		PerfCounter* CreatePerfCounter(int category, std::string const& name);
 		void CollectData();
 
 		void ExportToCSV(std::string const& file_name) const;
@@ -18,11 +18,12 @@
 
 #pragma once
 
-#include <list>
 #include <vector>
 
+#include <KFL/CXX20/span.hpp>
 #include <KFL/Noncopyable.hpp>
 #include <KFL/Thread.hpp>
+#include <KlayGE/DatagramIO.hpp>
 #include <KlayGE/Socket.hpp>
 
 namespace KlayGE
@@ -66,7 +67,9 @@ namespace KlayGE
 		std::future<void>	receiveThread_;
 		bool			receiveLoop_;
 
-		std::list<std::vector<char>> sendQueue_;
+		DatagramBufferPool buffer_pool_;
+		// Buffers from buffer_pool_
+		std::vector<std::span<char>> sendQueue_;
 	};
 }
 
@@ -97,6 +97,8 @@ namespace KlayGE
 		uint8_t max_simultaneous_uavs;
 		uint8_t max_vertex_streams;
 		uint8_t max_texture_anisotropy;
+		// Alignment of the offset a constant buffer is bound at. 0 means constant buffers can only be bound as a whole.
+		uint32_t cbuffer_offset_alignment;
 
 		bool is_tbdr : 1;
 
@@ -112,6 +114,8 @@ namespace KlayGE
 		bool pack_to_rgba_required : 1;
 		bool draw_indirect_support : 1;
 		bool no_overwrite_support : 1;
+		// UpdateSubresource on a constant buffer writes only the given range
+		bool partial_cbuffer_update_support : 1;
 		bool full_npot_texture_support : 1;
 		bool render_to_texture_array_support : 1;
 		bool explicit_multi_sample_support : 1;
@@ -57,6 +57,7 @@
 #include <KFL/CXX20/span.hpp>
 
 #include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
@@ -534,15 +535,16 @@ namespace KlayGE
 			return r2t.t;
 		}
 
-		void Dirty(bool dirty) noexcept
-		{
-			dirty_ = dirty;
-		}
+		// Marks the whole buffer
+		void Dirty(bool dirty) noexcept;
 		bool Dirty() const noexcept
 		{
-			return dirty_;
+			return num_dirty_ranges_ > 0;
 		}
+		// Marks only the bytes that changed. Overlapping and adjacent ranges are merged.
+		void DirtyRange(uint32_t offset, uint32_t size) noexcept;
 
+		// Uploads the dirty ranges, or makes a new version in the ring of the render engine if there is one
 		void Update();
 		GraphicsBufferPtr const& HWBuff() const noexcept
 		{
@@ -550,6 +552,16 @@ namespace KlayGE
 		}
 		void BindHWBuff(GraphicsBufferPtr const & buff);
 
+		// Where the contents are after Update. It's either the HW buffer at 0, or a version in the ring.
+		GraphicsBufferPtr const& BoundBuff() const noexcept
+		{
+			return bound_buff_;
+		}
+		uint32_t BoundOffset() const noexcept
+		{
+			return bound_offset_;
+		}
+
 	private:
 		void RebindParameters(RenderEffectConstantBuffer& dst_cbuffer, RenderEffect& dst_effect);
 
@@ -571,7 +583,20 @@ namespace KlayGE
 
 		GraphicsBufferPtr hw_buff_;
 		std::vector<uint8_t> buff_;
-		bool dirty_ = true;
+
+		struct ByteRange
+		{
+			uint32_t begin;
+			uint32_t end;
+		};
+		// Sorted and disjoint. Past the limit, one range covers them all.
+		static constexpr uint32_t MAX_DIRTY_RANGES = 4;
+		std::array<ByteRange, MAX_DIRTY_RANGES> dirty_ranges_;
+		uint32_t num_dirty_ranges_ = 0;
+
+		GraphicsBufferPtr bound_buff_;
+		uint32_t bound_offset_ = 0;
+		uint32_t ring_frame_id_ = 0xFFFFFFFFU;
 	};
 
 	class KLAYGE_CORE_API RenderEffectParameter final
@@ -706,6 +731,22 @@ namespace KlayGE
 	{
 		KLAYGE_NONCOPYABLE(RenderEffect);
 
+	public:
+#if KLAYGE_IS_DEV_PLATFORM
+		// A shader stage to compile. Every shader desc gets one, from the pass that owns it.
+		struct ShaderCompileJob
+		{
+			RenderTechnique const* tech;
+			RenderPass const* pass;
+			ShaderStage stage;
+			ShaderStageObject* stage_obj;
+			std::array<uint32_t, NumShaderStages> const* shader_desc_ids;
+
+			// What the stage depends on in the pass, for the ShaderCache. The backend, source and macros are added when it's compiled.
+			std::string cache_key;
+		};
+#endif
+
 	public:
 		RenderEffect();
 
@@ -798,7 +839,6 @@ namespace KlayGE
 
 #if KLAYGE_IS_DEV_PLATFORM
 		void PreprocessIncludes(XMLNode& root, std::vector<std::string>& include_names);
-		void RecursiveIncludeNode(XMLNode const& root, std::vector<std::string>& include_names) const;
 
 		XMLNode ResolveInheritTechNode(XMLNode& root, XMLNode const* tech_node);
 		void ResolveOverrideTechs(XMLNode& root);
@@ -806,7 +846,13 @@ namespace KlayGE
 		void Load(XMLNode const& root);
 #endif
 
+		void BuildParameterIndices();
+		void BuildTechniqueIndex();
+
 	private:
+		// Sorted (hash, index) pairs. Entries with the same hash keep their order in the source.
+		using HashIndex = std::vector<std::pair<size_t, uint32_t>>;
+
 		struct Immutable final
 		{
 			KLAYGE_NONCOPYABLE(Immutable);
@@ -816,7 +862,8 @@ namespace KlayGE
 			std::string res_name;
 			size_t res_name_hash;
 #if KLAYGE_IS_DEV_PLATFORM
-			uint64_t timestamp;
+			// Every source file and include with its timestamp, stored in the .kfx to check it without parsing
+			std::vector<std::pair<std::string, uint64_t>> source_timestamps;
 
 			std::string kfx_name;
 			bool need_compile;
@@ -826,6 +873,11 @@ namespace KlayGE
 
 			std::vector<RenderTechnique> techniques;
 
+			// Shared by clones, since they have the same parameters in the same order
+			HashIndex param_name_index;
+			HashIndex param_semantic_index;
+			HashIndex technique_name_index;
+
 			std::vector<std::pair<std::string, std::string>> macros;
 			std::vector<RenderShaderFragment> shader_frags;
 #if KLAYGE_IS_DEV_PLATFORM
@@ -857,7 +909,7 @@ namespace KlayGE
 
 #if KLAYGE_IS_DEV_PLATFORM
 		void Load(RenderEffect& effect, XMLNode const& node, uint32_t tech_index);
-		void CompileShaders(RenderEffect& effect, uint32_t tech_index);
+		void CompileShaders(RenderEffect& effect, uint32_t tech_index, std::vector<RenderEffect::ShaderCompileJob>& jobs);
 #endif
 		void CreateHwShaders(RenderEffect& effect, uint32_t tech_index);
 
@@ -950,7 +1002,8 @@ namespace KlayGE
 #if KLAYGE_IS_DEV_PLATFORM
 		void Load(RenderEffect& effect, XMLNode const& node, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
 		void Load(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
-		void CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index);
+		void CompileShaders(
+			RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, std::vector<RenderEffect::ShaderCompileJob>& jobs);
 #endif
 		void CreateHwShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index);
 
@@ -77,6 +77,7 @@
 #include <KlayGE/RenderDeviceCaps.hpp>
 #include <KlayGE/RenderSettings.hpp>
 #include <KlayGE/Mipmapper.hpp>
+#include <KlayGE/ConstantBufferRing.hpp>
 #include <KFL/Color.hpp>
 
 #include <memory>
@@ -130,6 +131,24 @@ namespace KlayGE
 		uint32_t NumDrawsJustCalled();
 		uint32_t NumDispatchesJustCalled();
 
+		// Counts an upload to a constant buffer, for the profiler
+		void CBufferUploaded([[maybe_unused]] uint32_t num_bytes) noexcept
+		{
+#ifndef KLAYGE_SHIP
+			if (cbuffer_upload_bytes_perf_ != nullptr)
+			{
+				cbuffer_upload_bytes_perf_->Add(num_bytes);
+				cbuffer_uploads_perf_->Add(1);
+			}
+#endif
+		}
+
+		// Null unless constant buffers are uploaded to a ring
+		ConstantBufferRing* CBufferRing() const noexcept
+		{
+			return cbuffer_ring_.get();
+		}
+
 		void CreateRenderWindow(std::string const & name, RenderSettings& settings);
 		void DestroyRenderWindow();
 
@@ -416,8 +435,13 @@ namespace KlayGE
 		PerfRegion* resize_pp_perf_;
 		PerfRegion* hdr_display_pp_perf_;
 		PerfRegion* stereoscopic_pp_perf_;
+
+		PerfCounter* cbuffer_upload_bytes_perf_ = nullptr;
+		PerfCounter* cbuffer_uploads_perf_ = nullptr;
 #endif
 
+		std::unique_ptr<ConstantBufferRing> cbuffer_ring_;
+
 		mutable RenderMaterialPtr default_material_;
 		mutable std::unique_ptr<PredefinedMaterialCBuffer> predefined_material_cb_;
 		mutable std::unique_ptr<PredefinedMeshCBuffer> predefined_mesh_cb_;
@@ -79,6 +79,8 @@ namespace KlayGE
 		std::vector<std::pair<std::string, std::string>> options;
 
 		bool debug_context = false;
+		// Upload constant buffers to a per-frame ring, and bind them by offset. Only on devices that support it.
+		bool cbuffer_upload_ring = false;
 	};
 }
 
@@ -60,6 +60,8 @@ namespace KlayGE
 
 		virtual bool HasSubThreadStage() const = 0;
 
+		// Hash of the fields Match compares. Two descs that Match must have the same Hash.
+		virtual size_t Hash() const = 0;
 		virtual bool Match(ResLoadingDesc const & rhs) const = 0;
 		virtual void CopyDataFrom(ResLoadingDesc const & rhs) = 0;
 		virtual std::shared_ptr<void> CloneResourceFrom(std::shared_ptr<void> const & resource) = 0;
@@ -96,7 +98,11 @@ namespace KlayGE
 		std::string AbsPath(std::string_view path);
 
 		std::shared_ptr<void> SyncQuery(ResLoadingDescPtr const & res_desc);
-		std::shared_ptr<void> ASyncQuery(ResLoadingDescPtr const & res_desc);
+		// Resources with higher priorities are loaded and finished first, for example the negative distance to the camera,
+		//  or a large value for UI.
+		std::shared_ptr<void> ASyncQuery(ResLoadingDescPtr const & res_desc, float priority = 0);
+		// Drops an ASyncQuery that hasn't been finished by Update. Returns false if res_desc isn't loading.
+		bool CancelASyncQuery(ResLoadingDescPtr const & res_desc);
 		void Unload(std::shared_ptr<void> const & res);
 
 		template <typename T>
@@ -106,9 +112,9 @@ namespace KlayGE
 		}
 
 		template <typename T>
-		std::shared_ptr<T> ASyncQueryT(ResLoadingDescPtr const & res_desc)
+		std::shared_ptr<T> ASyncQueryT(ResLoadingDescPtr const & res_desc, float priority = 0)
 		{
-			return std::static_pointer_cast<T>(this->ASyncQuery(res_desc));
+			return std::static_pointer_cast<T>(this->ASyncQuery(res_desc, priority));
 		}
 
 		template <typename T>
@@ -117,9 +123,16 @@ namespace KlayGE
 			this->Unload(std::static_pointer_cast<void>(res));
 		}
 
+		// Milliseconds each Update may spend on the main thread stage of finished async loads. At least one load is finished
+		//  per Update. 0, the default, means no limit.
+		void MainThreadStageBudget(float ms);
+		float MainThreadStageBudget() const noexcept;
+
 		void Update();
 
 		uint32_t NumLoadingResources() const noexcept;
+		// The async loads whose sub thread stage is done, waiting for Update to finish them
+		uint32_t NumReadyResources() const;
 
 	private:
 		void Init(ThreadPool& tp);
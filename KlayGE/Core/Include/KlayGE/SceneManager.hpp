@@ -118,6 +118,14 @@ namespace KlayGE
 
 		BoundOverlap VisibleTestFromParent(SceneNode const & node, uint32_t camera_index);
 
+		// Tests the world space bounds of the visible cullable nodes in all_scene_nodes_ against the frustums of
+		// non-omni-directional cameras. Nodes are packed 4 at a time in SoA and tested with SIMD, split across the thread pool.
+		void FrustumTestSceneNodes();
+		BoundOverlap SceneNodeFrustumOverlap(size_t node_index, uint32_t camera_index) const
+		{
+			return scene_node_frustum_overlaps_[camera_index * scene_node_bounds_.size() * 4 + node_index];
+		}
+
 	protected:
 		std::vector<CameraPtr> frame_cameras_;
 		std::vector<Frustum const*> camera_frustums_;
@@ -142,6 +150,21 @@ namespace KlayGE
 		uint32_t urt_;
 
 		std::vector<std::pair<RenderTechnique const *, std::vector<Renderable*>>> render_queue_;
+		std::vector<std::pair<float, uint32_t>> min_depths_;
+		std::vector<std::pair<float, uint32_t>> depth_sort_scratch_;
+		std::vector<Renderable*> sorted_items_;
+
+		struct alignas(16) SceneNodeBounds4
+		{
+			float min_x[4];
+			float min_y[4];
+			float min_z[4];
+			float max_x[4];
+			float max_y[4];
+			float max_z[4];
+		};
+		std::vector<SceneNodeBounds4> scene_node_bounds_;
+		std::vector<BoundOverlap> scene_node_frustum_overlaps_;
 
 		uint32_t num_objects_rendered_;
 		uint32_t num_renderables_rendered_;
@@ -0,0 +1,111 @@
+/**
+ * @file ShaderCache.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_SHADER_CACHE_HPP
+#define KLAYGE_CORE_SHADER_CACHE_HPP
+
+#pragma once
+
+#include <KFL/CXX20/span.hpp>
+#include <KFL/Noncopyable.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace KlayGE
+{
+	// Compiled shader stages on disk, one file per key. A key spells out everything the compiled stage depends on, so effects,
+	// runs and processes that compile the same shader share the file. Files are named by the hash of the key, and keep the key to
+	// tell collisions apart.
+	// Files are written to a temporary name and renamed, so readers in other processes see either a whole file or none. When the
+	// cache grows over its size limit, the files used least recently are removed.
+	class KLAYGE_CORE_API ShaderCache final
+	{
+		KLAYGE_NONCOPYABLE(ShaderCache);
+
+	public:
+		struct Stats
+		{
+			uint32_t num_hits;
+			uint32_t num_misses;
+			uint32_t num_stores;
+			uint32_t num_evictions;
+		};
+
+	public:
+		ShaderCache(std::string_view dir, uint64_t max_size);
+
+		// In ResLoader's local folder
+		static ShaderCache& Instance();
+
+		bool Load(std::string_view key, std::vector<uint8_t>& data);
+		void Store(std::string_view key, std::span<uint8_t const> data);
+
+		// Removes the least recently used files until the cache is well under its limit
+		void Trim();
+
+		std::filesystem::path const& Directory() const noexcept
+		{
+			return dir_;
+		}
+		uint64_t MaxSize() const noexcept
+		{
+			return max_size_;
+		}
+
+		Stats GetStats() const noexcept;
+		void ResetStats() noexcept;
+
+	private:
+		std::filesystem::path EntryPath(std::string_view key) const;
+
+	private:
+		std::filesystem::path dir_;
+		uint64_t max_size_;
+
+		// Make the temporary file names unique among processes and threads
+		uint32_t const temp_tag_;
+		std::atomic<uint32_t> next_temp_id_{0};
+
+		std::mutex trim_mutex_;
+		std::atomic<uint64_t> stored_size_since_trim_{0};
+
+		std::atomic<uint32_t> num_hits_{0};
+		std::atomic<uint32_t> num_misses_{0};
+		std::atomic<uint32_t> num_stores_{0};
+		std::atomic<uint32_t> num_evictions_{0};
+	};
+} // namespace KlayGE
+
+#endif // KLAYGE_CORE_SHADER_CACHE_HPP
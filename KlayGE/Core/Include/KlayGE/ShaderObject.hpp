@@ -125,6 +125,9 @@ namespace KlayGE
 			return is_validate_;
 		}
 
+		// What CompileShader reads from the effect source: the stage's preprocessed source and every macro it's compiled with
+		std::string SourceCacheKey(RenderEffect const& effect, RenderTechnique const& tech, RenderPass const& pass) const;
+
 		// Pixel shader only
 		virtual bool HasDiscard() const noexcept
 		{
@@ -156,6 +159,8 @@ namespace KlayGE
 			char const* shader_profile, uint32_t flags, void** reflector, bool strip);
 
 		virtual std::string_view GetShaderProfile(RenderEffect const& effect, uint32_t shader_desc_id) const = 0;
+		// The backend's own macros for CompileToDXBC. Some depend on the device caps.
+		virtual std::vector<std::pair<char const*, char const*>> ApiSpecialMacros() const = 0;
 
 		virtual void StageSpecificStreamIn([[maybe_unused]] ResIdentifier& res)
 		{
@@ -99,6 +99,11 @@ namespace KlayGE
 		void TimeOut(uint32_t microSecs);
 		uint32_t TimeOut();
 
+		SOCKET NativeHandle() const noexcept
+		{
+			return socket_;
+		}
+
 	private:
 		SOCKET		socket_;
 	};
@@ -35,6 +35,7 @@
 
 #include <array>
 #include <memory>
+#include <vector>
 
 #include <KFL/Noncopyable.hpp>
 #include <KFL/Operators.hpp>
@@ -42,6 +43,8 @@
 
 namespace KlayGE
 {
+	class ThreadPool;
+
 	enum TexCompressionMethod
 	{
 		TCM_Speed,
@@ -69,9 +72,19 @@ namespace KlayGE
 		TexCompression() noexcept;
 		virtual ~TexCompression() noexcept;
 
+		// Creates a new codec of the same type, with the settings of its public setters copied (BC7 preset, ETC1 effort).
+		//  Encoders keep per-block scratch state in the codec, so every worker in the parallel paths needs its own instance.
+		virtual std::unique_ptr<TexCompression> Clone() const = 0;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) = 0;
 		virtual void DecodeBlock(void* output, void const * input) = 0;
 
+		// Encodes num_blocks blocks stored one after another in input. The default calls EncodeBlock on each of them.
+		//  Codecs with batch kernels override it to encode several blocks per call.
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method);
+
+		// Spreads the block rows across the engine's thread pool. Every block is encoded on its own, so the output doesn't depend
+		//  on the number of threads.
 		virtual void EncodeMem(uint32_t width, uint32_t height, 
 			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
 			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
@@ -80,9 +93,28 @@ namespace KlayGE
 			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
 			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch);
 
+		// Splits the image into bands of block rows and processes them on up to num_threads workers in tp.
+		//  The output doesn't depend on num_threads. 1 encodes or decodes on the calling thread.
+		void EncodeMemParallel(uint32_t width, uint32_t height,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			TexCompressionMethod method, ThreadPool& tp, uint32_t num_threads);
+		void DecodeMemParallel(uint32_t width, uint32_t height,
+			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+			ThreadPool& tp, uint32_t num_threads);
+
 		virtual void EncodeTex(TexturePtr const & out_tex, TexturePtr const & in_tex, TexCompressionMethod method);
 		virtual void DecodeTex(TexturePtr const & out_tex, TexturePtr const & in_tex);
 
+	private:
+		void EncodeRows(uint32_t width, uint32_t height, uint32_t y_begin, uint32_t y_end,
+			void* output, uint32_t out_row_pitch, void const * input, uint32_t in_row_pitch,
+			TexCompressionMethod method, std::vector<uint8_t>& uncompressed);
+		void DecodeRows(uint32_t width, uint32_t height, uint32_t y_begin, uint32_t y_end,
+			void* output, uint32_t out_row_pitch, void const * input, uint32_t in_row_pitch,
+			std::vector<uint8_t>& uncompressed);
+
 	protected:
 		ElementFormat compression_format_;
 	};
@@ -34,6 +34,7 @@
 #pragma once
 
 #include <cstring>
+#include <random>
 
 #include <KlayGE/TexCompression.hpp>
 
@@ -79,17 +80,28 @@ namespace KlayGE
 	public:
 		TexCompressionBC1();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method) override;
 
 		void EncodeBC1Internal(BC1Block& bc1, ARGBColor32 const * argb, bool alpha, TexCompressionMethod method) const;
+		// Same as calling EncodeBC1Internal on num_blocks consecutive blocks, but runs several blocks at once in SIMD lanes
+		void EncodeBC1Batch(BC1Block* bc1, ARGBColor32 const * argb, bool const * alpha, uint32_t num_blocks,
+			TexCompressionMethod method) const;
 
 	private:
+		void EncodeBC1Lanes(BC1Block* bc1, ARGBColor32 const * argb, bool const * alpha, uint32_t num_blocks,
+			TexCompressionMethod method) const;
 		ARGBColor32 RGB565To888(uint16_t rgb) const;
 		uint16_t RGB888To565(ARGBColor32 const & rgb) const;
+		void MatchColorsSetup(ARGBColor32 const & min_clr, ARGBColor32 const & max_clr, bool alpha, int dir[3], int points[3]) const;
 		uint32_t MatchColorsBlock(ARGBColor32 const * argb, ARGBColor32 const & min_clr, ARGBColor32 const & max_clr, bool alpha) const;
 		void OptimizeColorsBlock(ARGBColor32 const * argb, ARGBColor32& min_clr, ARGBColor32& max_clr, TexCompressionMethod method) const;
 		bool RefineBlock(ARGBColor32 const * argb, ARGBColor32& min_clr, ARGBColor32& max_clr, uint32_t mask) const;
+		void ConstantColorBlock(ARGBColor32 const & clr, bool alpha, uint16_t& max16, uint16_t& min16, uint32_t& mask) const;
+		void PackBC1Block(BC1Block& bc1, uint16_t max16, uint16_t min16, uint32_t mask, bool alpha) const;
 	};
 
 	class KLAYGE_CORE_API TexCompressionBC2 final : public TexCompression
@@ -97,6 +109,8 @@ namespace KlayGE
 	public:
 		TexCompressionBC2();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
@@ -109,8 +123,17 @@ namespace KlayGE
 	public:
 		TexCompressionBC4();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method) override;
+
+		// Same as calling EncodeBlock on num_blocks consecutive blocks, but runs several blocks at once in SIMD lanes
+		void EncodeBC4Batch(BC4Block* bc4, uint8_t const * r, uint32_t num_blocks) const;
+
+	private:
+		void EncodeBC4Lanes(BC4Block* bc4, uint8_t const * r, uint32_t num_blocks) const;
 	};
 
 	class KLAYGE_CORE_API TexCompressionBC3 final : public TexCompression
@@ -118,8 +141,11 @@ namespace KlayGE
 	public:
 		TexCompressionBC3();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method) override;
 
 	private:
 		TexCompressionBC1 bc1_codec_;
@@ -131,8 +157,11 @@ namespace KlayGE
 	public:
 		TexCompressionBC5();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method) override;
 
 	private:
 		TexCompressionBC4 bc4_codec_;
@@ -143,6 +172,8 @@ namespace KlayGE
 	public:
 		TexCompressionBC6U();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
@@ -204,6 +235,8 @@ namespace KlayGE
 	public:
 		TexCompressionBC6S();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
@@ -211,6 +244,17 @@ namespace KlayGE
 		TexCompressionBC6U bc6u_codec_;
 	};
 
+	// Speed/quality trade-offs of the BC7 encoder. BC7P_ByMethod derives the search from the TexCompressionMethod
+	//  passed to EncodeBlock, the other presets ignore the method.
+	enum BC7Preset
+	{
+		BC7P_ByMethod,
+		BC7P_UltraFast,
+		BC7P_Fast,
+		BC7P_Basic,
+		BC7P_Slow
+	};
+
 	class KLAYGE_CORE_API TexCompressionBC7 final : public TexCompression
 	{
 		static uint32_t const BC7_MAX_REGIONS = 3;
@@ -269,9 +313,20 @@ namespace KlayGE
 	public:
 		TexCompressionBC7();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		void Preset(BC7Preset preset)
+		{
+			preset_ = preset;
+		}
+		BC7Preset Preset() const
+		{
+			return preset_;
+		}
+
 	private:
 		void PackBC7UniformBlock(void* output, ARGBColor32 const & pixel);
 		void PackBC7Block(int mode, CompressParams& params, void* output);
@@ -305,10 +360,14 @@ namespace KlayGE
 			size_t wc, size_t wa, size_t wc_prec, size_t wa_prec) const;
 
 	private:
+		BC7Preset preset_;
+
 		int sa_steps_;
 		TexCompressionErrorMetric error_metric_;
 		int rotate_mode_;
 		int index_mode_;
+		bool search_rotations_;
+		mutable std::minstd_rand rand_gen_;
 
 		static ModeInfo const mode_info_[];
 	};
@@ -110,6 +110,9 @@ namespace KlayGE
 
 			ARGBColor32 base_color5_;
 			bool constrain_against_base_color5_;
+
+			// Solve stops scanning once a solution's error is no larger than this
+			uint64_t early_out_error_;
 		};
 
 		struct Results
@@ -128,9 +131,19 @@ namespace KlayGE
 	public:
 		TexCompressionETC1();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+		// Effort in [0, 100]. Below 100 the search stops as soon as a block is within an error budget that grows as the effort drops.
+		//  100, the default, always runs the full search.
+		void Effort(uint32_t effort);
+		uint32_t Effort() const
+		{
+			return effort_;
+		}
+
 		uint64_t EncodeETC1BlockInternal(ETC1Block& output, ARGBColor32 const * argb, TexCompressionMethod method);
 		void DecodeETCIndividualModeInternal(ARGBColor32* argb, ETC1Block const & etc1) const;
 		void DecodeETCDifferentialModeInternal(ARGBColor32* argb, ETC1Block const & etc1, bool alpha) const;
@@ -171,6 +184,8 @@ namespace KlayGE
 		};
 
 	private:
+		uint64_t EarlyOutPixelError() const;
+
 		uint32_t ETC1DecodeValue(uint32_t diff, uint32_t inten, uint32_t selector, uint32_t packed_c) const;
 
 		uint64_t PackETC1UniformBlock(ETC1Block& block, ARGBColor32 const * argb) const;
@@ -183,6 +198,8 @@ namespace KlayGE
 		bool EvaluateSolutionFast(ETC1SolutionCoordinates const & coords, PotentialSolution& trial_solution, PotentialSolution& best_solution);
 
 	private:
+		uint32_t effort_;
+
 		Params const * params_;
 		Results* result_;
 
@@ -205,6 +222,8 @@ namespace KlayGE
 	public:
 		TexCompressionETC2RGB8();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
@@ -221,6 +240,8 @@ namespace KlayGE
 	public:
 		TexCompressionETC2RGB8A1();
 
+		virtual std::unique_ptr<TexCompression> Clone() const override;
+
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
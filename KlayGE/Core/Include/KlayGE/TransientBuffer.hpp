@@ -33,8 +33,10 @@
 
 #pragma once
 
-#include <vector>
+#include <atomic>
 #include <list>
+#include <mutex>
+#include <vector>
 
 #include <KFL/Noncopyable.hpp>
 
@@ -79,13 +81,32 @@ namespace KlayGE
 			BF_Index
 		};
 
+		enum AllocMode
+		{
+			// First fit from a free list. Allocs are freed by Dealloc, from a single thread.
+			AM_FreeList,
+			// Bump allocation in a ring, from any number of threads. Everything allocated in a frame is freed
+			// a few OnPresent later, so Dealloc does nothing.
+			AM_Ring
+		};
+
+		struct Stats
+		{
+			uint32_t capacity;
+			// The most bytes in use at once
+			uint32_t high_water_mark;
+			// Allocs that found no room and had to grow the buffer. In ring mode, it's when the ring wraps onto frames still in flight.
+			uint32_t num_wrap_stalls;
+		};
+
 	public:
-		TransientBuffer(uint32_t size_in_byte, BindFlag bind_flag);
+		TransientBuffer(uint32_t size_in_byte, BindFlag bind_flag, AllocMode alloc_mode = AM_FreeList);
 
 		// Allocate a sub space from transient buffer
 		SubAlloc Alloc(uint32_t size_in_byte, void const * data);
 		// Knowtify transient buffer that this alloc is unused and will be freed at the end of the frame.
 		void Dealloc(SubAlloc const & alloc);
+		// In ring mode, allocs of the frame must be done before these two are called
 		void EnsureDataReady();
 		// Do with retired frames
 		void OnPresent();
@@ -95,14 +116,27 @@ namespace KlayGE
 			return buffer_;
 		}
 
+		AllocMode GetAllocMode() const
+		{
+			return alloc_mode_;
+		}
+
+		Stats GetStats() const;
+		void ResetStats();
+
 	private:
 		GraphicsBufferPtr DoCreateBuffer(BindFlag bind_flag, uint32_t size_in_byte);
 		// Free the sub alloc and return the space allocated back to transient buffer.
 		void DoFree(SubAlloc const & alloc);
 
+		SubAlloc RingAlloc(uint32_t size_in_byte, void const * data);
+		void GrowRing(uint32_t size_in_byte, uint32_t seen_capacity);
+		void UpdateHighWaterMark(uint32_t used);
+
 	private:
 		bool use_no_overwrite_;
 		uint32_t num_pre_frames_;
+		AllocMode alloc_mode_;
 
 		GraphicsBufferPtr buffer_;
 		std::list<SubAlloc> free_list_;
@@ -112,6 +146,25 @@ namespace KlayGE
 		std::vector<uint8_t> simulate_buffer_;
 		uint32_t valid_min_;
 		uint32_t valid_max_;
+		uint32_t used_size_ = 0;
+
+		// Ring mode. Positions only go forward, the offset in the buffer is position % ring_capacity_.
+		// Allocs write to simulate_buffer_, which is uploaded by EnsureDataReady.
+		uint32_t ring_capacity_ = 0;
+		std::atomic<uint64_t> ring_head_{0};
+		std::atomic<uint64_t> ring_tail_{0};
+		uint64_t ring_uploaded_ = 0;
+		// Head at each of the last num_pre_frames_ OnPresent. The oldest becomes the tail.
+		std::vector<uint64_t> ring_frame_fences_;
+		uint32_t ring_fence_index_ = 0;
+
+		// Growing the ring waits for the allocs that are writing to finish, and holds back the new ones
+		std::atomic<uint32_t> ring_num_writers_{0};
+		std::atomic<bool> ring_growing_{false};
+		std::mutex ring_grow_mutex_;
+
+		std::atomic<uint32_t> high_water_mark_{0};
+		std::atomic<uint32_t> num_wrap_stalls_{0};
 	};
 }
 
@@ -304,6 +304,7 @@ namespace KlayGE
 			uint32_t display_max_luminance = 100;
 			std::vector<std::pair<std::string, std::string>> graphics_options;
 			bool debug_context = false;
+			bool cbuffer_upload_ring = false;
 			bool perf_profiler = false;
 			bool location_sensor = false;
 
@@ -586,6 +587,14 @@ namespace KlayGE
 				{
 					debug_context = attr->ValueBool();
 				}
+
+				if (XMLNode const* cbuffer_upload_ring_node = graphics_node->FirstNode("cbuffer_upload_ring"))
+				{
+					if (XMLAttribute const* attr = cbuffer_upload_ring_node->Attrib("value"))
+					{
+						cbuffer_upload_ring = attr->ValueBool();
+					}
+				}
 			}
 
 			std::span<char const*> const available_rfs = available_rfs_array;
@@ -656,6 +665,7 @@ namespace KlayGE
 			cfg_.graphics_cfg.display_max_luminance = display_max_luminance;
 			cfg_.graphics_cfg.options = std::move(graphics_options);
 			cfg_.graphics_cfg.debug_context = debug_context;
+			cfg_.graphics_cfg.cbuffer_upload_ring = cbuffer_upload_ring;
 
 			cfg_.deferred_rendering = false;
 			cfg_.perf_profiler = perf_profiler;
@@ -882,6 +892,12 @@ namespace KlayGE
 						debug_context_node.AppendAttrib(XMLAttribute("value", static_cast<uint32_t>(cfg_.graphics_cfg.debug_context)));
 						graphics_node.AppendNode(std::move(debug_context_node));
 					}
+					{
+						XMLNode cbuffer_upload_ring_node(XMLNodeType::Element, "cbuffer_upload_ring");
+						cbuffer_upload_ring_node.AppendAttrib(
+							XMLAttribute("value", static_cast<uint32_t>(cfg_.graphics_cfg.cbuffer_upload_ring)));
+						graphics_node.AppendNode(std::move(cbuffer_upload_ring_node));
+					}
 				}
 				root.AppendNode(std::move(graphics_node));
 			}
@@ -89,6 +89,15 @@ namespace KlayGE
 	}
 
 
+	PerfCounter::PerfCounter() = default;
+
+	void PerfCounter::CollectData() noexcept
+	{
+		value_ = sum_;
+		sum_ = 0;
+	}
+
+
 	class PerfProfiler::Impl final
 	{
 		KLAYGE_NONCOPYABLE(Impl);
@@ -110,6 +119,13 @@ namespace KlayGE
 			perf_regions_.emplace_back(PerfInfo{category, name, std::move(perf_region), {}});
 			return ret;
 		}
+		PerfCounter* CreatePerfCounter(int category, std::string const& name)
+		{
+			auto perf_counter = MakeUniquePtr<PerfCounter>();
+			auto* ret = perf_counter.get();
+			perf_counters_.emplace_back(CounterInfo{category, name, std::move(perf_counter), {}});
+			return ret;
+		}
 		void CollectData()
 		{
 			if (Context::Instance().Config().perf_profiler)
@@ -123,6 +139,12 @@ namespace KlayGE
 						region.frames.emplace_back(FramePerfInfo{frame_id_, perf_region.CpuTime(), perf_region.GpuTime()});
 					}
 				}
+				for (auto& counter : perf_counters_)
+				{
+					auto& perf_counter = *counter.perf_counter;
+					perf_counter.CollectData();
+					counter.frames.emplace_back(FrameCounterInfo{frame_id_, perf_counter.Value()});
+				}
 
 				++frame_id_;
 			}
@@ -149,6 +171,21 @@ namespace KlayGE
 				}
 
 				ofs << '\n';
+
+				if (!perf_counters_.empty())
+				{
+					ofs << "Frame" << ',' << "Category" << ',' << "Name" << ',' << "Value\n";
+
+					for (auto const& counter : perf_counters_)
+					{
+						for (auto const& frame : counter.frames)
+						{
+							ofs << frame.frame_id << ',' << counter.category << ',' << counter.name << ',' << frame.value << '\n';
+						}
+					}
+
+					ofs << '\n';
+				}
 			}
 		}
 
@@ -168,7 +205,22 @@ namespace KlayGE
 			std::vector<FramePerfInfo> frames;
 		};
 
+		struct FrameCounterInfo
+		{
+			uint32_t frame_id;
+			uint64_t value;
+		};
+
+		struct CounterInfo
+		{
+			int category;
+			std::string name;
+			std::unique_ptr<PerfCounter> perf_counter;
+			std::vector<FrameCounterInfo> frames;
+		};
+
 		std::vector<PerfInfo> perf_regions_;
+		std::vector<CounterInfo> perf_counters_;
 		uint32_t frame_id_ = 0;
 	};
 
@@ -205,6 +257,11 @@ namespace KlayGE
 		return pimpl_->CreatePerfRegion(category, name);
 	}
 
+	PerfCounter* PerfProfiler::CreatePerfCounter(int category, std::string const& name)
+	{
+		return pimpl_->CreatePerfCounter(category, name);
+	}
+
 	void PerfProfiler::CollectData()
 	{
 		pimpl_->CollectData();
@@ -30,16 +30,22 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/MappedFile.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/Package.hpp>
 
 #if defined KLAYGE_PLATFORM_LINUX
 #include <cstring>
 #endif
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <istream>
+#include <queue>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #if defined KLAYGE_PLATFORM_WINDOWS_DESKTOP
@@ -76,7 +82,9 @@ namespace uwp
 #include <CoreFoundation/CoreFoundation.h>
 #endif
 
+#include <KFL/CpuInfo.hpp>
 #include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
 #include <KlayGE/ResLoader.hpp>
 
 #if defined(KLAYGE_PLATFORM_ANDROID)
@@ -113,6 +121,38 @@ namespace KlayGE
 	{
 		KLAYGE_NONCOPYABLE(Impl);
 
+		enum class LoadingStatus
+		{
+			Loading,
+			Processing,
+			Complete,
+			Canceled
+		};
+		using LoadingStatusPtr = std::shared_ptr<std::atomic<LoadingStatus>>;
+
+		struct LoadingResource
+		{
+			ResLoadingDescPtr res_desc;
+			LoadingStatusPtr status;
+			float priority;
+			uint64_t order;
+		};
+
+		// Makes the loading queue pop the highest priority first, and the earliest request among equal priorities
+		struct LoadingResourceLess
+		{
+			bool operator()(LoadingResource const& lhs, LoadingResource const& rhs) const noexcept
+			{
+				return (lhs.priority < rhs.priority) || ((lhs.priority == rhs.priority) && (lhs.order > rhs.order));
+			}
+		};
+
+		static constexpr uint32_t MAX_NUM_LOADING_THREADS = 4;
+
+		// A mapping costs a few system calls and a page fault per page. For small files, like the XML and scripts, reading them
+		//  is cheaper, and there is little to save by not copying.
+		static constexpr uint64_t MIN_MAPPED_FILE_SIZE = 64 * 1024;
+
 	public:
 		explicit Impl(ThreadPool& tp)
 		{
@@ -207,19 +247,25 @@ namespace KlayGE
 #endif
 #endif
 
-			loading_thread_ = tp.QueueThread([this] { this->LoadingThreadFunc(); });
+			// Each worker does both the I/O and the decoding of a resource, so keep some cores for the rest of the engine
+			uint32_t const num_loading_threads = std::clamp(CpuInfo().NumHWThreads() / 2, 1U, MAX_NUM_LOADING_THREADS);
+			for (uint32_t i = 0; i < num_loading_threads; ++i)
+			{
+				loading_threads_.push_back(tp.QueueThread([this] { this->LoadingThreadFunc(); }));
+			}
 		}
 		~Impl()
 		{
-			quit_ = true;
-
 			{
-				std::unique_lock<std::mutex> lock(loading_res_queue_mutex_, std::try_to_lock);
-				non_empty_loading_res_queue_ = true;
-				loading_res_queue_cv_.notify_one();
+				std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+				quit_ = true;
 			}
+			loading_res_queue_cv_.notify_all();
 
-			loading_thread_.wait();
+			for (auto& loading_thread : loading_threads_)
+			{
+				loading_thread.wait();
+			}
 		}
 
 		void Suspend()
@@ -321,8 +367,8 @@ namespace KlayGE
 						if (!package)
 						{
 							uint64_t const timestamp = std::filesystem::last_write_time(package_path).time_since_epoch().count();
-							auto package_res = MakeSharedPtr<ResIdentifier>(
-								package_path, timestamp, MakeSharedPtr<std::ifstream>(package_path.c_str(), std::ios_base::binary));
+							// Archives are read-only, and 7z seeks around in them a lot, so they are mapped whatever their size
+							auto package_res = OpenFile(package_path, package_path, timestamp, 0);
 
 							package = MakeSharedPtr<Package>(package_res, password);
 						}
@@ -379,8 +425,7 @@ namespace KlayGE
 			{
 				FILESYSTEM_NS::path res_path(res_name);
 				uint64_t const timestamp = FILESYSTEM_NS::last_write_time(res_path).time_since_epoch().count();
-				return MakeSharedPtr<ResIdentifier>(name, timestamp,
-					MakeSharedPtr<std::ifstream>(res_name.c_str(), std::ios_base::binary));
+				return OpenFile(name, res_name, timestamp);
 			}
 #else
 			{
@@ -395,8 +440,7 @@ namespace KlayGE
 						if (std::filesystem::exists(res_path))
 						{
 							uint64_t const timestamp = std::filesystem::last_write_time(res_path).time_since_epoch().count();
-							return MakeSharedPtr<ResIdentifier>(
-								name, timestamp, MakeSharedPtr<std::ifstream>(res_name.c_str(), std::ios_base::binary));
+							return OpenFile(name, res_name, timestamp);
 						}
 						else
 						{
@@ -562,33 +606,38 @@ namespace KlayGE
 			}
 			else
 			{
-				std::shared_ptr<volatile LoadingStatus> async_is_done;
-				bool found = false;
-				{
-					std::lock_guard<std::mutex> lock(loading_mutex_);
+				LoadingStatusPtr async_is_done;
+				bool const found = this->FindMatchLoadingResource(res_desc, async_is_done);
 
-					for (auto const& lrq : loading_res_)
+				bool sub_thread_stage = res_desc->HasSubThreadStage();
+				if (found)
+				{
+					// Takes the load over only if no worker has started it. Otherwise waits for the worker's sub thread stage.
+					LoadingStatus expected = LoadingStatus::Loading;
+					if (!async_is_done->compare_exchange_strong(expected, LoadingStatus::Complete))
 					{
-						if (lrq.first->Match(*res_desc))
+						while (LoadingStatus::Processing == expected)
 						{
-							res_desc->CopyDataFrom(*lrq.first);
-							async_is_done = lrq.second;
-							found = true;
-							break;
+							std::this_thread::yield();
+							expected = *async_is_done;
 						}
-					}
-				}
 
-				if (found)
-				{
-					*async_is_done = LoadingStatus::Complete;
+						if (LoadingStatus::Complete == expected)
+						{
+							sub_thread_stage = false;
+						}
+						else
+						{
+							*async_is_done = LoadingStatus::Complete;
+						}
+					}
 				}
 				else
 				{
 					res = res_desc->CreateResource();
 				}
 
-				if (res_desc->HasSubThreadStage())
+				if (sub_thread_stage)
 				{
 					res_desc->SubThreadStage();
 				}
@@ -600,7 +649,7 @@ namespace KlayGE
 
 			return res;
 		}
-		std::shared_ptr<void> ASyncQuery(ResLoadingDescPtr const& res_desc)
+		std::shared_ptr<void> ASyncQuery(ResLoadingDescPtr const& res_desc, float priority)
 		{
 			this->RemoveUnrefResources();
 
@@ -623,22 +672,8 @@ namespace KlayGE
 			}
 			else
 			{
-				std::shared_ptr<volatile LoadingStatus> async_is_done;
-				bool found = false;
-				{
-					std::lock_guard<std::mutex> lock(loading_mutex_);
-
-					for (auto const& lrq : loading_res_)
-					{
-						if (lrq.first->Match(*res_desc))
-						{
-							res_desc->CopyDataFrom(*lrq.first);
-							async_is_done = lrq.second;
-							found = true;
-							break;
-						}
-					}
-				}
+				LoadingStatusPtr async_is_done;
+				bool const found = this->FindMatchLoadingResource(res_desc, async_is_done);
 
 				if (found)
 				{
@@ -646,8 +681,7 @@ namespace KlayGE
 
 					if (!res_desc->StateLess())
 					{
-						std::lock_guard<std::mutex> lock(loading_mutex_);
-						loading_res_.emplace_back(res_desc, async_is_done);
+						this->AddLoadingResource(res_desc, async_is_done, priority);
 					}
 				}
 				else
@@ -656,18 +690,14 @@ namespace KlayGE
 					{
 						res = res_desc->CreateResource();
 
-						async_is_done = MakeSharedPtr<LoadingStatus>(LoadingStatus::Loading);
+						async_is_done = MakeSharedPtr<std::atomic<LoadingStatus>>(LoadingStatus::Loading);
 
+						LoadingResource const lr = this->AddLoadingResource(res_desc, async_is_done, priority);
 						{
-							std::lock_guard<std::mutex> lock(loading_mutex_);
-							loading_res_.emplace_back(res_desc, async_is_done);
-						}
-						{
-							std::unique_lock<std::mutex> lock(loading_res_queue_mutex_, std::try_to_lock);
-							loading_res_queue_.emplace_back(res_desc, async_is_done);
-							non_empty_loading_res_queue_ = true;
-							loading_res_queue_cv_.notify_one();
+							std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+							loading_res_queue_.push(lr);
 						}
+						loading_res_queue_cv_.notify_one();
 					}
 					else
 					{
@@ -683,9 +713,10 @@ namespace KlayGE
 		{
 			std::lock_guard<std::mutex> lock(loaded_mutex_);
 
+			// Resources aren't indexed by address. Unloading is rare enough to afford a full scan.
 			for (auto iter = loaded_res_.begin(); iter != loaded_res_.end(); ++iter)
 			{
-				if (res == iter->second.lock())
+				if (res == iter->second.second.lock())
 				{
 					loaded_res_.erase(iter);
 					break;
@@ -693,19 +724,62 @@ namespace KlayGE
 			}
 		}
 
+		bool CancelASyncQuery(ResLoadingDescPtr const& res_desc)
+		{
+			std::lock_guard<std::mutex> lock(loading_mutex_);
+
+			auto iter = std::find_if(loading_res_.begin(), loading_res_.end(),
+				[&res_desc](LoadingResource const& lr) { return lr.res_desc == res_desc; });
+			if (iter == loading_res_.end())
+			{
+				return false;
+			}
+
+			// Other queries of the same resource wait on the same load. Only the last one stops it.
+			bool const shared = std::any_of(loading_res_.begin(), loading_res_.end(),
+				[&iter](LoadingResource const& lr) { return (lr.status == iter->status) && (lr.res_desc != iter->res_desc); });
+			if (!shared)
+			{
+				LoadingStatus expected = LoadingStatus::Loading;
+				iter->status->compare_exchange_strong(expected, LoadingStatus::Canceled);
+			}
+
+			this->EraseLoadingResourceLocked(iter);
+			return true;
+		}
+
+		void MainThreadStageBudget(float ms)
+		{
+			main_thread_stage_budget_ = ms;
+		}
+		float MainThreadStageBudget() const noexcept
+		{
+			return main_thread_stage_budget_;
+		}
+
 		void Update()
 		{
-			std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> tmp_loading_res;
+			std::vector<LoadingResource> tmp_loading_res;
 			{
 				std::lock_guard<std::mutex> lock(loading_mutex_);
 				tmp_loading_res = loading_res_;
 			}
+			std::stable_sort(tmp_loading_res.begin(), tmp_loading_res.end(),
+				[](LoadingResource const& lhs, LoadingResource const& rhs) { return lhs.priority > rhs.priority; });
 
+			Timer timer;
+			std::vector<ResLoadingDesc const*> finished;
 			for (auto& lrq : tmp_loading_res)
 			{
-				if (LoadingStatus::Complete == *lrq.second)
+				if (LoadingStatus::Complete == *lrq.status)
 				{
-					ResLoadingDescPtr const& res_desc = lrq.first;
+					// At least one resource finishes per frame, so loading can't stall on a tight budget
+					if ((main_thread_stage_budget_ > 0) && !finished.empty() && (timer.elapsed() * 1000 >= main_thread_stage_budget_))
+					{
+						break;
+					}
+
+					ResLoadingDescPtr const& res_desc = lrq.res_desc;
 
 					std::shared_ptr<void> res;
 					std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc);
@@ -726,23 +800,22 @@ namespace KlayGE
 						res = res_desc->Resource();
 						this->AddLoadedResource(res_desc, res);
 					}
-				}
-			}
-			for (auto& lrq : tmp_loading_res)
-			{
-				if (LoadingStatus::Complete == *lrq.second)
-				{
-					*lrq.second = LoadingStatus::CanBeRemoved;
+
+					finished.push_back(res_desc.get());
 				}
 			}
 
+			if (!finished.empty())
 			{
+				std::sort(finished.begin(), finished.end());
+
 				std::lock_guard<std::mutex> lock(loading_mutex_);
 				for (auto iter = loading_res_.begin(); iter != loading_res_.end();)
 				{
-					if (LoadingStatus::CanBeRemoved == *(iter->second))
+					// Entries that got canceled during the loop are already gone
+					if (std::binary_search(finished.begin(), finished.end(), iter->res_desc.get()))
 					{
-						iter = loading_res_.erase(iter);
+						iter = this->EraseLoadingResourceLocked(iter);
 					}
 					else
 					{
@@ -756,6 +829,12 @@ namespace KlayGE
 		{
 			return static_cast<uint32_t>(loading_res_.size());
 		}
+		uint32_t NumReadyResources() const
+		{
+			std::lock_guard<std::mutex> lock(loading_mutex_);
+			return static_cast<uint32_t>(std::count_if(loading_res_.begin(), loading_res_.end(),
+				[](LoadingResource const& lr) { return LoadingStatus::Complete == *lr.status; }));
+		}
 
 	private:
 		std::filesystem::path RealPath(std::string_view path)
@@ -858,36 +937,76 @@ namespace KlayGE
 			}
 		}
 
+		// Files of at least min_mapped_size bytes are mapped into memory, so loaders can use the content in place. Smaller ones,
+		//  and files that can't be mapped, are read through a file stream.
+		static ResIdentifierPtr OpenFile(std::string_view name, std::string const& res_name, uint64_t timestamp,
+			uint64_t min_mapped_size = MIN_MAPPED_FILE_SIZE)
+		{
+			std::error_code ec;
+			uint64_t const file_size = std::filesystem::file_size(res_name, ec);
+			if (!ec && (file_size >= min_mapped_size))
+			{
+				auto mapped_file = MakeSharedPtr<MappedFile>();
+				if (mapped_file->Map(res_name))
+				{
+					return MakeSharedPtr<ResIdentifier>(name, timestamp, mapped_file->Data(), mapped_file);
+				}
+			}
+
+			return MakeSharedPtr<ResIdentifier>(name, timestamp, MakeSharedPtr<std::ifstream>(res_name.c_str(), std::ios_base::binary));
+		}
+
+		static size_t ResKey(ResLoadingDesc const& res_desc)
+		{
+			size_t seed = res_desc.Hash();
+			HashCombine(seed, res_desc.Type());
+			return seed;
+		}
+
 		void AddLoadedResource(ResLoadingDescPtr const& res_desc, std::shared_ptr<void> const& res)
 		{
+			size_t const key = ResKey(*res_desc);
+
 			std::lock_guard<std::mutex> lock(loaded_mutex_);
 
-			bool found = false;
-			for (auto& c_desc : loaded_res_)
+			auto const range = loaded_res_.equal_range(key);
+			for (auto iter = range.first; iter != range.second; ++iter)
 			{
-				if (c_desc.first == res_desc)
+				if (iter->second.first == res_desc)
 				{
-					c_desc.second = std::weak_ptr<void>(res);
-					found = true;
-					break;
+					iter->second.second = std::weak_ptr<void>(res);
+					return;
 				}
 			}
-			if (!found)
-			{
-				loaded_res_.emplace_back(res_desc, std::weak_ptr<void>(res));
-			}
+
+			loaded_res_.emplace(key, std::make_pair(res_desc, std::weak_ptr<void>(res)));
 		}
 		std::shared_ptr<void> FindMatchLoadedResource(ResLoadingDescPtr const& res_desc)
 		{
+			size_t const key = ResKey(*res_desc);
+
 			std::lock_guard<std::mutex> lock(loaded_mutex_);
 
 			std::shared_ptr<void> loaded_res;
-			for (auto const& lr : loaded_res_)
+			auto range = loaded_res_.equal_range(key);
+			for (auto iter = range.first; iter != range.second;)
 			{
-				if (lr.first->Match(*res_desc))
+				if (iter->second.second.expired())
 				{
-					loaded_res = lr.second.lock();
-					break;
+					// Expired entries found on the way are dropped here, the rest are left for RemoveUnrefResources.
+					iter = loaded_res_.erase(iter);
+				}
+				else
+				{
+					if (iter->second.first->Match(*res_desc))
+					{
+						loaded_res = iter->second.second.lock();
+						if (loaded_res)
+						{
+							break;
+						}
+					}
+					++iter;
 				}
 			}
 			return loaded_res;
@@ -896,43 +1015,95 @@ namespace KlayGE
 		{
 			std::lock_guard<std::mutex> lock(loaded_mutex_);
 
+			// Sweeping only when the table has doubled since the last sweep keeps the cost per query constant on average.
+			if (loaded_res_.size() < next_unref_sweep_size_)
+			{
+				return;
+			}
+
 			for (auto iter = loaded_res_.begin(); iter != loaded_res_.end();)
 			{
-				if (iter->second.lock())
+				if (iter->second.second.expired())
 				{
-					++iter;
+					iter = loaded_res_.erase(iter);
 				}
 				else
 				{
-					iter = loaded_res_.erase(iter);
+					++iter;
 				}
 			}
+
+			next_unref_sweep_size_ = std::max(loaded_res_.size() * 2, MIN_UNREF_SWEEP_SIZE);
 		}
 
-		void LoadingThreadFunc()
+		LoadingResource AddLoadingResource(ResLoadingDescPtr const& res_desc, LoadingStatusPtr const& async_is_done, float priority)
 		{
-			while (!quit_)
-			{
-				std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_queue_copy;
+			std::lock_guard<std::mutex> lock(loading_mutex_);
 
+			loading_res_.push_back(LoadingResource{res_desc, async_is_done, priority, next_loading_order_});
+			++next_loading_order_;
+			loading_res_index_.emplace(ResKey(*res_desc), loading_res_.back());
+			return loading_res_.back();
+		}
+		std::vector<LoadingResource>::iterator EraseLoadingResourceLocked(std::vector<LoadingResource>::iterator iter)
+		{
+			auto const range = loading_res_index_.equal_range(ResKey(*iter->res_desc));
+			for (auto index_iter = range.first; index_iter != range.second; ++index_iter)
+			{
+				if (index_iter->second.res_desc == iter->res_desc)
 				{
-					std::unique_lock<std::mutex> lock(loading_res_queue_mutex_);
-					loading_res_queue_cv_.wait(lock, [this] { return non_empty_loading_res_queue_; });
+					loading_res_index_.erase(index_iter);
+					break;
+				}
+			}
+
+			return loading_res_.erase(iter);
+		}
+		bool FindMatchLoadingResource(ResLoadingDescPtr const& res_desc, LoadingStatusPtr& async_is_done)
+		{
+			size_t const key = ResKey(*res_desc);
 
-					loading_res_queue_copy.swap(loading_res_queue_);
-					non_empty_loading_res_queue_ = false;
+			std::lock_guard<std::mutex> lock(loading_mutex_);
+
+			auto const range = loading_res_index_.equal_range(key);
+			for (auto iter = range.first; iter != range.second; ++iter)
+			{
+				if (iter->second.res_desc->Match(*res_desc))
+				{
+					res_desc->CopyDataFrom(*iter->second.res_desc);
+					async_is_done = iter->second.status;
+					return true;
 				}
+			}
+			return false;
+		}
 
-				for (auto& res_pair : loading_res_queue_copy)
+		void LoadingThreadFunc()
+		{
+			for (;;)
+			{
+				LoadingResource lr;
 				{
-					if (LoadingStatus::Loading == *res_pair.second)
+					std::unique_lock<std::mutex> lock(loading_res_queue_mutex_);
+					loading_res_queue_cv_.wait(lock, [this] { return quit_ || !loading_res_queue_.empty(); });
+					if (quit_)
 					{
-						res_pair.first->SubThreadStage();
-						*res_pair.second = LoadingStatus::Complete;
+						break;
 					}
+
+					lr = loading_res_queue_.top();
+					loading_res_queue_.pop();
 				}
 
-				Sleep(10);
+				// Canceled, or taken over by a SyncQuery, while it was in the queue
+				LoadingStatus expected = LoadingStatus::Loading;
+				if (lr.status->compare_exchange_strong(expected, LoadingStatus::Processing))
+				{
+					lr.res_desc->SubThreadStage();
+
+					expected = LoadingStatus::Processing;
+					lr.status->compare_exchange_strong(expected, LoadingStatus::Complete);
+				}
 			}
 		}
 
@@ -989,13 +1160,6 @@ namespace KlayGE
 #endif
 
 	private:
-		enum class LoadingStatus
-		{
-			Loading,
-			Complete,
-			CanBeRemoved
-		};
-
 		std::string exe_path_;
 		std::string local_path_;
 
@@ -1009,18 +1173,24 @@ namespace KlayGE
 		std::vector<PathInfo> paths_;
 		std::mutex paths_mutex_;
 
+		// Both are keyed by ResKey. Descs with the same key still have to pass Match.
+		static constexpr size_t MIN_UNREF_SWEEP_SIZE = 1024;
 		std::mutex loaded_mutex_;
-		std::mutex loading_mutex_;
-		std::vector<std::pair<ResLoadingDescPtr, std::weak_ptr<void>>> loaded_res_;
-		std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_;
+		mutable std::mutex loading_mutex_;
+		std::unordered_multimap<size_t, std::pair<ResLoadingDescPtr, std::weak_ptr<void>>> loaded_res_;
+		size_t next_unref_sweep_size_ = MIN_UNREF_SWEEP_SIZE;
+		std::vector<LoadingResource> loading_res_;
+		std::unordered_multimap<size_t, LoadingResource> loading_res_index_;
+		uint64_t next_loading_order_ = 0;
 
-		bool non_empty_loading_res_queue_ = false;
 		std::condition_variable loading_res_queue_cv_;
 		std::mutex loading_res_queue_mutex_;
-		std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_queue_;
+		std::priority_queue<LoadingResource, std::vector<LoadingResource>, LoadingResourceLess> loading_res_queue_;
+		bool quit_ = false;
+
+		std::vector<std::future<void>> loading_threads_;
 
-		std::future<void> loading_thread_;
-		volatile bool quit_{false};
+		float main_thread_stage_budget_ = 0;
 	};
 
 	ResLoadingDesc::ResLoadingDesc() noexcept = default;
@@ -1109,9 +1279,14 @@ namespace KlayGE
 		return pimpl_->SyncQuery(res_desc);
 	}
 
-	std::shared_ptr<void> ResLoader::ASyncQuery(ResLoadingDescPtr const & res_desc)
+	std::shared_ptr<void> ResLoader::ASyncQuery(ResLoadingDescPtr const & res_desc, float priority)
+	{
+		return pimpl_->ASyncQuery(res_desc, priority);
+	}
+
+	bool ResLoader::CancelASyncQuery(ResLoadingDescPtr const & res_desc)
 	{
-		return pimpl_->ASyncQuery(res_desc);
+		return pimpl_->CancelASyncQuery(res_desc);
 	}
 
 	void ResLoader::Unload(std::shared_ptr<void> const & res)
@@ -1119,6 +1294,16 @@ namespace KlayGE
 		pimpl_->Unload(res);
 	}
 
+	void ResLoader::MainThreadStageBudget(float ms)
+	{
+		pimpl_->MainThreadStageBudget(ms);
+	}
+
+	float ResLoader::MainThreadStageBudget() const noexcept
+	{
+		return pimpl_->MainThreadStageBudget();
+	}
+
 	void ResLoader::Update()
 	{
 		pimpl_->Update();
@@ -1128,4 +1313,9 @@ namespace KlayGE
 	{
 		return pimpl_->NumLoadingResources();
 	}
+
+	uint32_t ResLoader::NumReadyResources() const
+	{
+		return pimpl_->NumReadyResources();
+	}
 }
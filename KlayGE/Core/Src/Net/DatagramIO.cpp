@@ -0,0 +1,548 @@
+/**
+ * @file DatagramIO.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/ErrorHandling.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <KlayGE/Socket.hpp>
+#if defined(KLAYGE_PLATFORM_WINDOWS)
+#include <mstcpip.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#if defined(KLAYGE_PLATFORM_LINUX) || defined(KLAYGE_PLATFORM_ANDROID)
+#define KLAYGE_DATAGRAM_IO_EPOLL
+#include <sys/epoll.h>
+#endif
+#endif
+
+#include <KlayGE/DatagramIO.hpp>
+
+namespace KlayGE
+{
+	DatagramBufferPool::DatagramBufferPool(uint32_t buffer_size, uint32_t num_buffers)
+		: buffer_size_(buffer_size), storage_(MakeUniquePtr<char[]>(static_cast<size_t>(buffer_size) * num_buffers))
+	{
+		free_buffers_.resize(num_buffers);
+		for (uint32_t i = 0; i < num_buffers; ++ i)
+		{
+			free_buffers_[i] = &storage_[static_cast<size_t>(num_buffers - 1 - i) * buffer_size];
+		}
+	}
+
+	char* DatagramBufferPool::Allocate() noexcept
+	{
+		if (free_buffers_.empty())
+		{
+			return nullptr;
+		}
+
+		char* ret = free_buffers_.back();
+		free_buffers_.pop_back();
+		return ret;
+	}
+
+	void DatagramBufferPool::Free(char* buffer) noexcept
+	{
+		BOOST_ASSERT(buffer != nullptr);
+		free_buffers_.push_back(buffer);
+	}
+
+
+	struct QueuedDatagram
+	{
+		char* data;
+		uint32_t size;
+		bool has_addr;
+		sockaddr_in addr;
+	};
+
+#if defined(KLAYGE_PLATFORM_WINDOWS)
+	class DatagramIO::Impl final
+	{
+		KLAYGE_NONCOPYABLE(Impl);
+
+		static uint32_t constexpr NUM_PENDING_RECEIVES = 16;
+
+		struct IoOp
+		{
+			OVERLAPPED overlapped;
+			WSABUF wsa_buf;
+			char* buffer;
+			sockaddr_in addr;
+			INT addr_len;
+			bool is_send;
+		};
+
+	public:
+		Impl(Socket& socket, DatagramBufferPool& pool)
+			: socket_(socket.NativeHandle()), pool_(pool)
+		{
+			iocp_ = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+			Verify(iocp_ != nullptr);
+			Verify(::CreateIoCompletionPort(reinterpret_cast<HANDLE>(socket_), iocp_, 0, 0) == iocp_);
+
+			// Otherwise an ICMP port unreachable from one peer fails the next receive
+			BOOL report_conn_reset = FALSE;
+			DWORD bytes_returned;
+			::WSAIoctl(socket_, SIO_UDP_CONNRESET, &report_conn_reset, sizeof(report_conn_reset), nullptr, 0, &bytes_returned,
+				nullptr, nullptr);
+
+			this->PostReceives();
+		}
+
+		~Impl() noexcept
+		{
+			// The kernel owns the ops and their buffers until their completions are dequeued, canceled ones too
+			::CancelIoEx(reinterpret_cast<HANDLE>(socket_), nullptr);
+			while ((num_pending_receives_ != 0) || (num_pending_sends_ != 0))
+			{
+				if (!this->Drain(INFINITE))
+				{
+					// Leaks the ops rather than have the kernel write into freed memory
+					for (auto& op : ops_)
+					{
+						static_cast<void>(op.release());
+					}
+					break;
+				}
+			}
+
+			for (auto const & datagram : completed_receives_)
+			{
+				pool_.Free(datagram.data);
+			}
+			for (auto const & datagram : queued_sends_)
+			{
+				pool_.Free(datagram.data);
+			}
+
+			::CloseHandle(iocp_);
+		}
+
+		DatagramBufferPool& Pool() noexcept
+		{
+			return pool_;
+		}
+
+		uint32_t Receive(std::span<Datagram> received, uint32_t timeout_ms)
+		{
+			this->PostReceives();
+			if (completed_receives_.empty())
+			{
+				this->Drain(timeout_ms);
+			}
+
+			uint32_t const num = static_cast<uint32_t>(std::min(received.size(), completed_receives_.size()));
+			std::copy(completed_receives_.begin(), completed_receives_.begin() + num, received.begin());
+			completed_receives_.erase(completed_receives_.begin(), completed_receives_.begin() + num);
+
+			this->PostReceives();
+			return num;
+		}
+
+		void QueueSend(char* data, uint32_t size, sockaddr_in const * to)
+		{
+			queued_sends_.push_back({data, size, to != nullptr, to ? *to : sockaddr_in{}});
+		}
+
+		void Flush()
+		{
+			for (auto const & datagram : queued_sends_)
+			{
+				IoOp* op = this->AllocateOp();
+				op->is_send = true;
+				op->buffer = datagram.data;
+				op->wsa_buf.buf = datagram.data;
+				op->wsa_buf.len = datagram.size;
+				op->addr = datagram.addr;
+
+				int const ret = ::WSASendTo(socket_, &op->wsa_buf, 1, nullptr, 0,
+					datagram.has_addr ? reinterpret_cast<sockaddr const *>(&op->addr) : nullptr,
+					datagram.has_addr ? static_cast<int>(sizeof(op->addr)) : 0, &op->overlapped, nullptr);
+				if ((ret == SOCKET_ERROR) && (::WSAGetLastError() != WSA_IO_PENDING))
+				{
+					// Dropped, like any other lost datagram
+					pool_.Free(op->buffer);
+					free_ops_.push_back(op);
+				}
+				else
+				{
+					++ num_pending_sends_;
+				}
+			}
+			queued_sends_.clear();
+
+			// Gets the buffers of finished sends back
+			this->Drain(0);
+		}
+
+	private:
+		IoOp* AllocateOp()
+		{
+			if (free_ops_.empty())
+			{
+				ops_.push_back(MakeUniquePtr<IoOp>());
+				free_ops_.push_back(ops_.back().get());
+			}
+
+			IoOp* op = free_ops_.back();
+			free_ops_.pop_back();
+			std::memset(&op->overlapped, 0, sizeof(op->overlapped));
+			return op;
+		}
+
+		void PostReceives()
+		{
+			while (num_pending_receives_ < NUM_PENDING_RECEIVES)
+			{
+				char* buffer = pool_.Allocate();
+				if (buffer == nullptr)
+				{
+					break;
+				}
+
+				IoOp* op = this->AllocateOp();
+				op->is_send = false;
+				op->buffer = buffer;
+				op->wsa_buf.buf = buffer;
+				op->wsa_buf.len = pool_.BufferSize();
+				op->addr_len = sizeof(op->addr);
+
+				DWORD flags = 0;
+				int const ret = ::WSARecvFrom(socket_, &op->wsa_buf, 1, nullptr, &flags, reinterpret_cast<sockaddr*>(&op->addr),
+					&op->addr_len, &op->overlapped, nullptr);
+				if ((ret == SOCKET_ERROR) && (::WSAGetLastError() != WSA_IO_PENDING))
+				{
+					pool_.Free(buffer);
+					free_ops_.push_back(op);
+					break;
+				}
+
+				++ num_pending_receives_;
+			}
+		}
+
+		// Returns false if no completion came in time
+		bool Drain(uint32_t timeout_ms)
+		{
+			OVERLAPPED_ENTRY entries[MAX_BATCH];
+			ULONG num_entries = 0;
+			if (!::GetQueuedCompletionStatusEx(iocp_, entries, MAX_BATCH, &num_entries, timeout_ms, FALSE))
+			{
+				return false;
+			}
+
+			for (ULONG i = 0; i < num_entries; ++ i)
+			{
+				IoOp* op = CONTAINING_RECORD(entries[i].lpOverlapped, IoOp, overlapped);
+				bool const succeeded = (entries[i].Internal == 0);
+				if (op->is_send)
+				{
+					pool_.Free(op->buffer);
+					-- num_pending_sends_;
+				}
+				else
+				{
+					if (succeeded)
+					{
+						completed_receives_.push_back({op->buffer, entries[i].dwNumberOfBytesTransferred, op->addr});
+					}
+					else
+					{
+						pool_.Free(op->buffer);
+					}
+					-- num_pending_receives_;
+				}
+				free_ops_.push_back(op);
+			}
+
+			return true;
+		}
+
+	private:
+		SOCKET socket_;
+		DatagramBufferPool& pool_;
+		HANDLE iocp_;
+
+		std::vector<std::unique_ptr<IoOp>> ops_;
+		std::vector<IoOp*> free_ops_;
+		uint32_t num_pending_receives_ = 0;
+		uint32_t num_pending_sends_ = 0;
+
+		std::vector<Datagram> completed_receives_;
+		std::vector<QueuedDatagram> queued_sends_;
+	};
+#else
+	class DatagramIO::Impl final
+	{
+		KLAYGE_NONCOPYABLE(Impl);
+
+	public:
+		Impl(Socket& socket, DatagramBufferPool& pool)
+			: socket_(socket.NativeHandle()), pool_(pool)
+		{
+#ifdef KLAYGE_DATAGRAM_IO_EPOLL
+			epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+			Verify(epoll_fd_ != -1);
+
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.fd = socket_;
+			Verify(::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_, &event) == 0);
+#endif
+		}
+
+		~Impl() noexcept
+		{
+			for (auto const & datagram : queued_sends_)
+			{
+				pool_.Free(datagram.data);
+			}
+
+#ifdef KLAYGE_DATAGRAM_IO_EPOLL
+			::close(epoll_fd_);
+#endif
+		}
+
+		DatagramBufferPool& Pool() noexcept
+		{
+			return pool_;
+		}
+
+		uint32_t Receive(std::span<Datagram> received, uint32_t timeout_ms)
+		{
+			uint32_t num = this->ReceiveAvailable(received);
+			if ((num == 0) && this->WaitReadable(timeout_ms))
+			{
+				num = this->ReceiveAvailable(received);
+			}
+			return num;
+		}
+
+		void QueueSend(char* data, uint32_t size, sockaddr_in const * to)
+		{
+			queued_sends_.push_back({data, size, to != nullptr, to ? *to : sockaddr_in{}});
+		}
+
+		void Flush()
+		{
+			size_t sent = 0;
+			while (sent < queued_sends_.size())
+			{
+				int const ret = this->SendBatch(std::span(queued_sends_).subspan(sent));
+				if (ret > 0)
+				{
+					sent += ret;
+				}
+				else if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				{
+					pollfd pfd{socket_, POLLOUT, 0};
+					if (::poll(&pfd, 1, 100) <= 0)
+					{
+						// Still full. Drop the rest, like any other lost datagrams.
+						break;
+					}
+				}
+				else
+				{
+					// Dropped, like any other lost datagram
+					++ sent;
+				}
+			}
+
+			for (auto const & datagram : queued_sends_)
+			{
+				pool_.Free(datagram.data);
+			}
+			queued_sends_.clear();
+		}
+
+	private:
+		bool WaitReadable(uint32_t timeout_ms)
+		{
+#ifdef KLAYGE_DATAGRAM_IO_EPOLL
+			epoll_event event;
+			return ::epoll_wait(epoll_fd_, &event, 1, static_cast<int>(timeout_ms)) > 0;
+#else
+			pollfd pfd{socket_, POLLIN, 0};
+			return ::poll(&pfd, 1, static_cast<int>(timeout_ms)) > 0;
+#endif
+		}
+
+		uint32_t ReceiveAvailable(std::span<Datagram> received)
+		{
+			uint32_t const max_num = static_cast<uint32_t>(std::min<size_t>(received.size(), MAX_BATCH));
+
+#ifdef KLAYGE_DATAGRAM_IO_EPOLL
+			mmsghdr msgs[MAX_BATCH];
+			iovec iovs[MAX_BATCH];
+			uint32_t num_buffers = 0;
+			for (; num_buffers < max_num; ++ num_buffers)
+			{
+				char* buffer = pool_.Allocate();
+				if (buffer == nullptr)
+				{
+					break;
+				}
+
+				received[num_buffers].data = buffer;
+				iovs[num_buffers].iov_base = buffer;
+				iovs[num_buffers].iov_len = pool_.BufferSize();
+
+				std::memset(&msgs[num_buffers], 0, sizeof(msgs[num_buffers]));
+				msgs[num_buffers].msg_hdr.msg_name = &received[num_buffers].addr;
+				msgs[num_buffers].msg_hdr.msg_namelen = sizeof(received[num_buffers].addr);
+				msgs[num_buffers].msg_hdr.msg_iov = &iovs[num_buffers];
+				msgs[num_buffers].msg_hdr.msg_iovlen = 1;
+			}
+
+			int const ret = (num_buffers > 0) ? ::recvmmsg(socket_, msgs, num_buffers, MSG_DONTWAIT, nullptr) : 0;
+			uint32_t const num = static_cast<uint32_t>(std::max(ret, 0));
+			for (uint32_t i = 0; i < num; ++ i)
+			{
+				received[i].size = msgs[i].msg_len;
+			}
+			for (uint32_t i = num; i < num_buffers; ++ i)
+			{
+				pool_.Free(received[i].data);
+			}
+			return num;
+#else
+			uint32_t num = 0;
+			while (num < max_num)
+			{
+				char* buffer = pool_.Allocate();
+				if (buffer == nullptr)
+				{
+					break;
+				}
+
+				socklen_t addr_len = sizeof(received[num].addr);
+				auto const ret = ::recvfrom(socket_, buffer, pool_.BufferSize(), MSG_DONTWAIT,
+					reinterpret_cast<sockaddr*>(&received[num].addr), &addr_len);
+				if (ret < 0)
+				{
+					pool_.Free(buffer);
+					break;
+				}
+
+				received[num].data = buffer;
+				received[num].size = static_cast<uint32_t>(ret);
+				++ num;
+			}
+			return num;
+#endif
+		}
+
+		// Returns the number of datagrams sent, or -1 with errno set if none could be
+		int SendBatch(std::span<QueuedDatagram> datagrams)
+		{
+#ifdef KLAYGE_DATAGRAM_IO_EPOLL
+			mmsghdr msgs[MAX_BATCH];
+			iovec iovs[MAX_BATCH];
+			uint32_t const num = static_cast<uint32_t>(std::min<size_t>(datagrams.size(), MAX_BATCH));
+			for (uint32_t i = 0; i < num; ++ i)
+			{
+				iovs[i].iov_base = datagrams[i].data;
+				iovs[i].iov_len = datagrams[i].size;
+
+				std::memset(&msgs[i], 0, sizeof(msgs[i]));
+				if (datagrams[i].has_addr)
+				{
+					msgs[i].msg_hdr.msg_name = &datagrams[i].addr;
+					msgs[i].msg_hdr.msg_namelen = sizeof(datagrams[i].addr);
+				}
+				msgs[i].msg_hdr.msg_iov = &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			return ::sendmmsg(socket_, msgs, num, MSG_DONTWAIT);
+#else
+			auto const& datagram = datagrams[0];
+			auto const ret = ::sendto(socket_, datagram.data, datagram.size, MSG_DONTWAIT,
+				datagram.has_addr ? reinterpret_cast<sockaddr const *>(&datagram.addr) : nullptr,
+				datagram.has_addr ? sizeof(datagram.addr) : 0);
+			return (ret < 0) ? -1 : 1;
+#endif
+		}
+
+	private:
+		SOCKET socket_;
+		DatagramBufferPool& pool_;
+#ifdef KLAYGE_DATAGRAM_IO_EPOLL
+		int epoll_fd_;
+#endif
+
+		std::vector<QueuedDatagram> queued_sends_;
+	};
+#endif
+
+	DatagramIO::DatagramIO(Socket& socket, DatagramBufferPool& pool)
+		: pimpl_(MakeUniquePtr<Impl>(socket, pool))
+	{
+	}
+
+	DatagramIO::~DatagramIO() noexcept = default;
+
+	uint32_t DatagramIO::Receive(std::span<Datagram> received, uint32_t timeout_ms)
+	{
+		return pimpl_->Receive(received, timeout_ms);
+	}
+
+	void DatagramIO::Release(Datagram const & datagram) noexcept
+	{
+		pimpl_->Pool().Free(datagram.data);
+	}
+
+	char* DatagramIO::AllocateSendBuffer() noexcept
+	{
+		return pimpl_->Pool().Allocate();
+	}
+
+	void DatagramIO::QueueSend(char* data, uint32_t size, sockaddr_in const & to)
+	{
+		pimpl_->QueueSend(data, size, &to);
+	}
+
+	void DatagramIO::QueueSend(char* data, uint32_t size)
+	{
+		pimpl_->QueueSend(data, size, nullptr);
+	}
+
+	void DatagramIO::Flush()
+	{
+		pimpl_->Flush();
+	}
+}
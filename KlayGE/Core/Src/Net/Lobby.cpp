@@ -14,12 +14,24 @@
 #include <KlayGE/Player.hpp>
 
 #include <algorithm>
+#include <array>
 #include <ctime>
 #include <cstring>
 
 #include <KlayGE/NetMsg.hpp>
 #include <KlayGE/Lobby.hpp>
 
+namespace
+{
+	uint32_t constexpr NUM_LOBBY_BUFFERS = 1024;
+	uint32_t constexpr EVENT_LOOP_TICK = 100;
+
+	uint64_t AddrKey(sockaddr_in const & addr)
+	{
+		return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+	}
+}
+
 namespace KlayGE
 {
 	Processor::Processor() noexcept = default;
@@ -28,8 +40,10 @@ namespace KlayGE
 	// 캯
 	/////////////////////////////////////////////////////////////////////////////////
 	Lobby::Lobby()
+		: buffer_pool_(Max_Buffer, NUM_LOBBY_BUFFERS)
 	{
 		this->socket_.Create(SOCK_DGRAM);
+		std::memset(&sockAddr_, 0, sizeof(sockAddr_));
 	}
 
 	// 
@@ -41,26 +55,50 @@ namespace KlayGE
 
 	Lobby::PlayerAddrsIter Lobby::ID(sockaddr_in const & addr)
 	{
-		for (auto iter = players_.begin(); iter != players_.end(); ++ iter)
+		auto iter = player_indices_.find(AddrKey(addr));
+		if (iter != player_indices_.end())
 		{
-			if (0 == std::memcmp(&addr, &(iter->second.addr), sizeof(addr)))
-			{
-				return iter;
-			}
+			return players_.begin() + iter->second;
 		}
 
 		return players_.end();
 	}
 
+	void Lobby::FreePlayer(PlayerAddrsIter iter)
+	{
+		auto index_iter = player_indices_.find(AddrKey(iter->second.addr));
+		if ((index_iter != player_indices_.end()) && (players_.begin() + index_iter->second == iter))
+		{
+			player_indices_.erase(index_iter);
+		}
+
+		for (auto const & msg : iter->second.msgs)
+		{
+			buffer_pool_.Free(msg.data());
+		}
+		iter->second.msgs.clear();
+
+		iter->first = 0;
+	}
+
 	// Ϸ
 	/////////////////////////////////////////////////////////////////////////////////
-	void Lobby::Create(std::string const & Name, char maxPlayers, uint16_t port, Processor const & pro)
+	void Lobby::Create(std::string const & Name, char maxPlayers, uint16_t port, Processor const & pro, LobbyIOMode mode)
 	{
 		this->LobbyName(Name);
 
 		this->MaxPlayers(maxPlayers);
 
-		this->socket_.Bind(TransAddr("", port));
+		if (0 == sockAddr_.sin_port)
+		{
+			this->Bind(port);
+		}
+
+		if (mode == LobbyIOMode::EventDriven)
+		{
+			this->RunEventDriven(pro);
+			return;
+		}
 
 		sockaddr_in from;
 		char revBuf[Max_Buffer];
@@ -73,33 +111,7 @@ namespace KlayGE
 				break;
 			}
 
-			// ÿϢǰ涼1ֽڵϢ
-			char* revPtr(&revBuf[1]);
-			char* sendPtr(&sendBuf[1]);
-			sendBuf[0] = revBuf[0];
-
-			switch (revBuf[0])
-			{
-			case MSG_JOIN:
-				this->OnJoin(revPtr, sendPtr, numSend, from, pro);
-				break;
-
-			case MSG_QUIT:
-				this->OnQuit(this->ID(from), sendPtr, numSend, pro);
-				break;
-
-			case MSG_GETLOBBYINFO:
-				this->OnGetLobbyInfo(sendPtr, numSend, pro);
-				break;
-
-			case MSG_NOP:
-				this->OnNop(this->ID(from));
-				break;
-
-			default:
-				pro.OnDefault(revBuf, sizeof(revBuf), sendBuf, numSend, from);
-				break;
-			}
+			this->Dispatch(revBuf, sendBuf, numSend, from, pro);
 
 			if (numSend != 0)
 			{
@@ -112,22 +124,136 @@ namespace KlayGE
 				auto const & msgs = player.second.msgs;
 				for (auto const & msg : msgs)
 				{
-					socket_.SendTo(&msg[0], static_cast<int>(msg.size()), player.second.addr);
+					socket_.SendTo(msg.data(), static_cast<int>(msg.size()), player.second.addr);
 				}
 			}
 
-			// Ƿûʱ
-			for (auto iter = players_.begin(); iter != players_.end();)
+			this->SweepTimedOutPlayers();
+		}
+	}
+
+	void Lobby::Bind(uint16_t port)
+	{
+		this->socket_.Bind(TransAddr("", port));
+
+		socklen_t len = sizeof(sockAddr_);
+		this->socket_.SockName(sockAddr_, len);
+	}
+
+	void Lobby::RunEventDriven(Processor const & pro)
+	{
+		DatagramIO io(socket_, buffer_pool_);
+
+		auto allocate_send_buffer = [&io]
+		{
+			char* buff = io.AllocateSendBuffer();
+			if (buff == nullptr)
 			{
-				// 20
-				if (std::time(nullptr) - iter->second.time >= 20 * 1000)
+				// Sending returns the buffers
+				io.Flush();
+				buff = io.AllocateSendBuffer();
+			}
+			return buff;
+		};
+
+		std::array<Datagram, DatagramIO::MAX_BATCH> received;
+		std::time_t last_sweep_time = std::time(nullptr);
+		bool quit = false;
+		while (!quit)
+		{
+			uint32_t const num_received = io.Receive(received, EVENT_LOOP_TICK);
+			for (uint32_t i = 0; i < num_received; ++ i)
+			{
+				auto& datagram = received[i];
+				if (datagram.size == 0)
 				{
-					iter = players_.erase(iter);
+					quit = true;
 				}
-				else
+				else if (char* send_buff = allocate_send_buffer())
 				{
-					++ iter;
+					int num_send = 0;
+					this->Dispatch(datagram.data, send_buff, num_send, datagram.addr, pro);
+					if (num_send != 0)
+					{
+						io.QueueSend(send_buff, num_send + 1, datagram.addr);
+					}
+					else
+					{
+						buffer_pool_.Free(send_buff);
+					}
 				}
+				io.Release(datagram);
+			}
+
+			// Once per batch, not once per datagram
+			if (num_received != 0)
+			{
+				for (auto const & player : players_)
+				{
+					for (auto const & msg : player.second.msgs)
+					{
+						if (char* send_buff = allocate_send_buffer())
+						{
+							std::memcpy(send_buff, msg.data(), msg.size());
+							io.QueueSend(send_buff, static_cast<uint32_t>(msg.size()), player.second.addr);
+						}
+					}
+				}
+			}
+
+			io.Flush();
+
+			std::time_t const now = std::time(nullptr);
+			if (now != last_sweep_time)
+			{
+				this->SweepTimedOutPlayers();
+				last_sweep_time = now;
+			}
+		}
+	}
+
+	void Lobby::Dispatch(char* revBuf, char* sendBuf, int& numSend, sockaddr_in& from, Processor const & pro)
+	{
+		numSend = 0;
+
+		// ÿϢǰ涼1ֽڵϢ
+		char* revPtr(&revBuf[1]);
+		char* sendPtr(&sendBuf[1]);
+		sendBuf[0] = revBuf[0];
+
+		switch (revBuf[0])
+		{
+		case MSG_JOIN:
+			this->OnJoin(revPtr, sendPtr, numSend, from, pro);
+			break;
+
+		case MSG_QUIT:
+			this->OnQuit(this->ID(from), sendPtr, numSend, pro);
+			break;
+
+		case MSG_GETLOBBYINFO:
+			this->OnGetLobbyInfo(sendPtr, numSend, pro);
+			break;
+
+		case MSG_NOP:
+			this->OnNop(this->ID(from));
+			break;
+
+		default:
+			pro.OnDefault(revBuf, Max_Buffer, sendBuf, numSend, from);
+			break;
+		}
+	}
+
+	void Lobby::SweepTimedOutPlayers()
+	{
+		// Ƿûʱ
+		for (auto iter = players_.begin(); iter != players_.end(); ++ iter)
+		{
+			// 20
+			if ((iter->first != 0) && (std::time(nullptr) - iter->second.time >= 20 * 1000))
+			{
+				this->FreePlayer(iter);
 			}
 		}
 	}
@@ -165,6 +291,16 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void Lobby::MaxPlayers(char maxPlayers)
 	{
+		for (auto& player : players_)
+		{
+			for (auto const & msg : player.second.msgs)
+			{
+				buffer_pool_.Free(msg.data());
+			}
+			player.second.msgs.clear();
+		}
+		player_indices_.clear();
+
 		players_.resize(maxPlayers);
 		PlayerAddrs(players_).swap(players_);
 
@@ -224,6 +360,8 @@ namespace KlayGE
 				iter->first			= id;
 				iter->second.name	= name;
 				iter->second.addr	= from;
+				iter->second.time	= static_cast<uint32_t>(std::time(nullptr));
+				player_indices_[AddrKey(from)] = static_cast<uint32_t>(iter - players_.begin());
 
 				pro.OnJoin(iter->first);
 				break;
@@ -252,7 +390,7 @@ namespace KlayGE
 		if (iter != this->players_.end())
 		{
 			pro.OnQuit(iter->first);
-			iter->first = 0;
+			this->FreePlayer(iter);
 			sendBuf[0] = 0;
 		}
 		else
@@ -16,7 +16,10 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KlayGE/Lobby.hpp>
 
+#include <KFL/Timer.hpp>
+
 #include <algorithm>
+#include <array>
 #include <ctime>
 #include <cstring>
 
@@ -25,6 +28,10 @@
 
 namespace
 {
+	uint32_t constexpr NUM_PLAYER_BUFFERS = 256;
+	uint32_t constexpr RECEIVE_TIMEOUT = 100;
+	double constexpr RESEND_INTERVAL = 0.2;
+
 	class ReceiveThreadFunc
 	{
 	public:
@@ -45,6 +52,7 @@ namespace KlayGE
 	// 캯
 	/////////////////////////////////////////////////////////////////////////////////
 	Player::Player()
+		: buffer_pool_(Max_Buffer, NUM_PLAYER_BUFFERS)
 	{
 	}
 
@@ -59,54 +67,76 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void Player::ReceiveFunc()
 	{
-		static time_t lastTime = std::time(nullptr);
+		DatagramIO io(socket_, buffer_pool_);
 
+		std::time_t last_nop_time = std::time(nullptr);
+		Timer resend_timer;
+		std::array<Datagram, DatagramIO::MAX_BATCH> received;
 		for (;;)
 		{
-			if (std::time(nullptr) - lastTime >= 10 * 1000)
+			if (std::time(nullptr) - last_nop_time >= 10 * 1000)
 			{
-				char msg(MSG_NOP);
-				socket_.Send(&msg, sizeof(msg));
-				lastTime = std::time(nullptr);
+				if (char* buff = io.AllocateSendBuffer())
+				{
+					buff[0] = MSG_NOP;
+					io.QueueSend(buff, 1);
+				}
+				last_nop_time = std::time(nullptr);
 			}
 
-			if (!sendQueue_.empty())
+			// Unacknowledged messages go out again at an interval, not on every wake up
+			if (!sendQueue_.empty() && (resend_timer.elapsed() >= RESEND_INTERVAL))
 			{
 				// ͶϢ
 				for (auto const & msg : sendQueue_)
 				{
-					socket_.Send(&msg[0], static_cast<int>(msg.size()));
+					if (char* buff = io.AllocateSendBuffer())
+					{
+						std::memcpy(buff, msg.data(), msg.size());
+						io.QueueSend(buff, static_cast<uint32_t>(msg.size()));
+					}
 				}
+				resend_timer.restart();
 			}
+			io.Flush();
 
-			char revBuf[Max_Buffer];
-			memset(revBuf, 0, sizeof(revBuf));
-			if (socket_.Receive(revBuf, sizeof(revBuf)) != -1)
+			bool quit = false;
+			uint32_t const num_received = io.Receive(received, RECEIVE_TIMEOUT);
+			for (uint32_t i = 0; i < num_received; ++ i)
 			{
+				auto const & datagram = received[i];
+
+				char header[5] = {};
+				std::memcpy(header, datagram.data, std::min<size_t>(datagram.size, sizeof(header)));
 				uint32_t ID;
-				std::memcpy(&ID, &revBuf[1], 4);
+				std::memcpy(&ID, &header[1], 4);
 
 				// ɾѷ͵Ϣ
-				for (auto iter = sendQueue_.begin(); iter != sendQueue_.end();)
-				{
-					std::vector<char>& msg = *iter;
-
-					uint32_t sendID;
-					std::memcpy(&sendID, &msg[1], 4);
-					if (sendID == ID)
+				auto iter = std::remove_if(sendQueue_.begin(), sendQueue_.end(),
+					[this, ID](std::span<char> msg)
 					{
-						iter = sendQueue_.erase(iter);
-					}
-					else
-					{
-						++ iter;
-					}
-				}
-
-				if (MSG_QUIT == revBuf[0])
+						uint32_t sendID;
+						std::memcpy(&sendID, &msg[1], 4);
+						if (sendID == ID)
+						{
+							buffer_pool_.Free(msg.data());
+							return true;
+						}
+						return false;
+					});
+				sendQueue_.erase(iter, sendQueue_.end());
+
+				if (MSG_QUIT == header[0])
 				{
-					break;
+					quit = true;
 				}
+
+				io.Release(datagram);
+			}
+
+			if (quit)
+			{
+				break;
 			}
 		}
 	}
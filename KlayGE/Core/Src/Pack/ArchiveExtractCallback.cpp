@@ -45,6 +45,13 @@ namespace KlayGE
 	{
 		Convert(password_, pw);
 	}
+
+	ArchiveExtractCallback::ArchiveExtractCallback(
+		std::string_view pw, std::unordered_map<uint32_t, com_ptr<ISequentialOutStream>> out_file_streams) noexcept
+		: password_is_defined_(!pw.empty()), out_file_streams_(std::move(out_file_streams))
+	{
+		Convert(password_, pw);
+	}
 	
 	ArchiveExtractCallback::~ArchiveExtractCallback() noexcept = default;
 
@@ -95,7 +102,7 @@ namespace KlayGE
 		return S_OK;
 	}
 
-	STDMETHODIMP ArchiveExtractCallback::GetStream([[maybe_unused]] UInt32 index, ISequentialOutStream** out_stream, Int32 ask_extract_mode) noexcept
+	STDMETHODIMP ArchiveExtractCallback::GetStream(UInt32 index, ISequentialOutStream** out_stream, Int32 ask_extract_mode) noexcept
 	{
 		enum
 		{
@@ -104,14 +111,23 @@ namespace KlayGE
 			kSkip,
 		};
 
+		*out_stream = nullptr;
 		if (kExtract == ask_extract_mode)
 		{
-			out_file_stream_->AddRef();
-			*out_stream = out_file_stream_.get();
-		}
-		else
-		{
-			*out_stream = nullptr;
+			ISequentialOutStream* stream = out_file_stream_.get();
+			if (!stream)
+			{
+				auto iter = out_file_streams_.find(index);
+				if (iter != out_file_streams_.end())
+				{
+					stream = iter->second.get();
+				}
+			}
+			if (stream)
+			{
+				stream->AddRef();
+				*out_stream = stream;
+			}
 		}
 		return S_OK;
 	}
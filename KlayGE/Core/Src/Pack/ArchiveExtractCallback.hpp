@@ -35,6 +35,7 @@
 
 #include <atomic>
 #include <string>
+#include <unordered_map>
 
 #include <CPP/7zip/Archive/IArchive.h>
 #include <CPP/7zip/IPassword.h>
@@ -68,6 +69,8 @@ namespace KlayGE
 
 	public:
 		ArchiveExtractCallback(std::string_view pw, ISequentialOutStream* out_file_stream) noexcept;
+		// One stream per item, for extracting several items in one pass
+		ArchiveExtractCallback(std::string_view pw, std::unordered_map<uint32_t, com_ptr<ISequentialOutStream>> out_file_streams) noexcept;
 		virtual ~ArchiveExtractCallback() noexcept;
 
 	private:
@@ -77,6 +80,7 @@ namespace KlayGE
 		std::wstring password_;
 
 		com_ptr<ISequentialOutStream> out_file_stream_;
+		std::unordered_map<uint32_t, com_ptr<ISequentialOutStream>> out_file_streams_;
 	};
 }
 
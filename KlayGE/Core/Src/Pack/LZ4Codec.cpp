@@ -0,0 +1,237 @@
+/**
+ * @file LZ4Codec.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/ErrorHandling.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <KlayGE/LZ4Codec.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	// Limits of the LZ4 block format
+	uint32_t constexpr MIN_MATCH = 4;
+	uint32_t constexpr LAST_LITERALS = 5;
+	uint32_t constexpr MF_LIMIT = 12;
+	uint32_t constexpr MAX_DISTANCE = 65535;
+
+	uint32_t constexpr HASH_LOG = 16;
+
+	uint32_t Read32(uint8_t const * p)
+	{
+		uint32_t ret;
+		std::memcpy(&ret, p, sizeof(ret));
+		return ret;
+	}
+
+	uint32_t HashSequence(uint32_t seq)
+	{
+		return (seq * 2654435761U) >> (32 - HASH_LOG);
+	}
+
+	uint8_t* WriteLength(uint8_t* op, size_t len)
+	{
+		for (; len >= 255; len -= 255)
+		{
+			*op = 255;
+			++ op;
+		}
+		*op = static_cast<uint8_t>(len);
+		return op + 1;
+	}
+
+	uint8_t* WriteLiterals(uint8_t* op, uint8_t const * literals, size_t num_literals, uint32_t match_token)
+	{
+		*op = static_cast<uint8_t>((std::min<size_t>(num_literals, 15) << 4) | match_token);
+		++ op;
+		if (num_literals >= 15)
+		{
+			op = WriteLength(op, num_literals - 15);
+		}
+		std::memcpy(op, literals, num_literals);
+		return op + num_literals;
+	}
+
+	size_t ReadLength(uint8_t const *& ip, uint8_t const * ip_end)
+	{
+		size_t len = 0;
+		uint8_t b;
+		do
+		{
+			Verify(ip < ip_end);
+			b = *ip;
+			++ ip;
+			len += b;
+		} while (b == 255);
+		return len;
+	}
+}
+
+namespace KlayGE
+{
+	LZ4Codec::LZ4Codec() noexcept = default;
+	LZ4Codec::~LZ4Codec() noexcept = default;
+
+	void LZ4Codec::Encode(std::vector<uint8_t>& output, std::span<uint8_t const> input)
+	{
+		size_t const size = input.size();
+		output.resize(size + size / 255 + 16);
+
+		uint8_t const * src = input.data();
+		uint8_t* op = output.data();
+		size_t anchor = 0;
+
+		if (size > MF_LIMIT)
+		{
+			std::vector<uint32_t> hash_table(1U << HASH_LOG, 0);
+
+			size_t const match_limit = size - LAST_LITERALS;
+			size_t const mf_limit = size - MF_LIMIT;
+			size_t pos = 0;
+			while (pos <= mf_limit)
+			{
+				uint32_t const seq = Read32(src + pos);
+				uint32_t& entry = hash_table[HashSequence(seq)];
+				size_t cand = entry;
+				entry = static_cast<uint32_t>(pos);
+
+				if ((cand < pos) && (pos - cand <= MAX_DISTANCE) && (Read32(src + cand) == seq))
+				{
+					while ((pos > anchor) && (cand > 0) && (src[pos - 1] == src[cand - 1]))
+					{
+						-- pos;
+						-- cand;
+					}
+
+					size_t match_len = MIN_MATCH;
+					while ((pos + match_len < match_limit) && (src[pos + match_len] == src[cand + match_len]))
+					{
+						++ match_len;
+					}
+
+					size_t const extra_match_len = match_len - MIN_MATCH;
+					op = WriteLiterals(op, src + anchor, pos - anchor, static_cast<uint32_t>(std::min<size_t>(extra_match_len, 15)));
+
+					uint16_t const offset = static_cast<uint16_t>(pos - cand);
+					op[0] = static_cast<uint8_t>(offset & 0xFF);
+					op[1] = static_cast<uint8_t>(offset >> 8);
+					op += 2;
+
+					if (extra_match_len >= 15)
+					{
+						op = WriteLength(op, extra_match_len - 15);
+					}
+
+					pos += match_len;
+					anchor = pos;
+				}
+				else
+				{
+					// Steps faster through data that doesn't compress
+					pos += 1 + ((pos - anchor) >> 6);
+				}
+			}
+		}
+
+		op = WriteLiterals(op, src + anchor, size - anchor, 0);
+		output.resize(op - output.data());
+	}
+
+	void LZ4Codec::Decode(void* output, std::span<uint8_t const> input, uint64_t original_len)
+	{
+		uint8_t const * ip = input.data();
+		uint8_t const * const ip_end = ip + input.size();
+		uint8_t* const op_begin = static_cast<uint8_t*>(output);
+		uint8_t* op = op_begin;
+		uint8_t* const op_end = op + original_len;
+
+		while (ip < ip_end)
+		{
+			uint32_t const token = *ip;
+			++ ip;
+
+			size_t num_literals = token >> 4;
+			if (num_literals == 15)
+			{
+				num_literals += ReadLength(ip, ip_end);
+			}
+			Verify((num_literals <= static_cast<size_t>(ip_end - ip)) && (num_literals <= static_cast<size_t>(op_end - op)));
+			std::memcpy(op, ip, num_literals);
+			ip += num_literals;
+			op += num_literals;
+
+			if (ip == ip_end)
+			{
+				// The last sequence has only literals
+				break;
+			}
+
+			Verify(ip_end - ip >= 2);
+			size_t const offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+
+			size_t match_len = token & 0xF;
+			if (match_len == 15)
+			{
+				match_len += ReadLength(ip, ip_end);
+			}
+			match_len += MIN_MATCH;
+			Verify((offset != 0) && (offset <= static_cast<size_t>(op - op_begin)) && (match_len <= static_cast<size_t>(op_end - op)));
+
+			uint8_t const * match = op - offset;
+			if (offset >= match_len)
+			{
+				std::memcpy(op, match, match_len);
+			}
+			else if (offset >= 8)
+			{
+				// Overlapping, but each 8-byte step only reads what's already written
+				for (size_t i = 0; i < match_len; i += 8)
+				{
+					std::memcpy(op + i, match + i, std::min<size_t>(8, match_len - i));
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < match_len; ++ i)
+				{
+					op[i] = match[i];
+				}
+			}
+			op += match_len;
+		}
+
+		Verify(op == op_end);
+	}
+}
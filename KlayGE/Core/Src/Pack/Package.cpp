@@ -175,6 +175,8 @@ namespace KlayGE
 		TIFHR(archive->GetNumberOfItems(&num_items_));
 
 		archive_ = std::shared_ptr<IInArchive>(archive.detach(), std::mem_fn(&IInArchive::Release));
+
+		this->BuildIndex();
 	}
 
 	bool Package::Locate(std::string_view extract_file_path)
@@ -188,37 +190,70 @@ namespace KlayGE
 		uint32_t real_index = this->Find(extract_file_path);
 		if (real_index != 0xFFFFFFFF)
 		{
-			auto decoded_file = MakeSharedPtr<std::stringstream>();
-			com_ptr<IOutStream> out_stream(new OutStream(decoded_file), false);
-			com_ptr<IArchiveExtractCallback> ecb(new ArchiveExtractCallback(password_, out_stream.get()), false);
-			TIFHR(archive_->Extract(&real_index, 1, false, ecb.get()));
+			auto const decoded = this->Decode(std::span<uint32_t const>(&real_index, 1));
+			return this->MakeResIdentifier(real_index, res_name, decoded[0]);
+		}
+		return ResIdentifierPtr();
+	}
 
-			PROPVARIANT prop;
-			prop.vt = VT_EMPTY;
-			TIFHR(archive_->GetProperty(real_index, kpidMTime, &prop));
-			uint64_t mtime;
-			if (prop.vt == VT_FILETIME)
+	std::vector<ResIdentifierPtr> Package::ExtractMany(
+		std::span<std::string_view const> extract_file_paths, std::span<std::string_view const> res_names)
+	{
+		BOOST_ASSERT(extract_file_paths.size() == res_names.size());
+
+		std::vector<uint32_t> real_indices(extract_file_paths.size());
+		std::vector<uint32_t> found_indices;
+		for (size_t i = 0; i < extract_file_paths.size(); ++ i)
+		{
+			real_indices[i] = this->Find(extract_file_paths[i]);
+			if (real_indices[i] != 0xFFFFFFFF)
 			{
-				mtime = (static_cast<uint64_t>(prop.filetime.dwHighDateTime) << 32)
-					+ prop.filetime.dwLowDateTime;
-				mtime -= 116444736000000000ULL;
+				found_indices.push_back(real_indices[i]);
 			}
-			else
+		}
+
+		auto const decoded = this->Decode(found_indices);
+
+		std::vector<ResIdentifierPtr> ret(extract_file_paths.size());
+		auto decoded_iter = decoded.begin();
+		for (size_t i = 0; i < extract_file_paths.size(); ++ i)
+		{
+			if (real_indices[i] != 0xFFFFFFFF)
 			{
-				mtime = archive_is_->Timestamp();
+				ret[i] = this->MakeResIdentifier(real_indices[i], res_names[i], *decoded_iter);
+				++ decoded_iter;
 			}
-
-			return MakeSharedPtr<ResIdentifier>(res_name, mtime, decoded_file);
 		}
-		return ResIdentifierPtr();
+		return ret;
 	}
 
-	uint32_t Package::Find(std::string_view extract_file_path)
+	void Package::SolidBlockCacheBudget(uint64_t budget)
 	{
-		uint32_t real_index = 0xFFFFFFFF;
+		std::lock_guard<std::mutex> lock(extract_mutex_);
 
+		block_cache_budget_ = budget;
+		this->EvictBlocks();
+	}
+
+	uint64_t Package::SolidBlockCacheBudget() const
+	{
+		return block_cache_budget_;
+	}
+
+	uint32_t Package::NumDecodePasses() const
+	{
+		return num_decode_passes_;
+	}
+
+	void Package::BuildIndex()
+	{
+		items_.resize(num_items_);
 		for (uint32_t i = 0; i < num_items_; ++ i)
 		{
+			ItemInfo& item = items_[i];
+			item.block = 0xFFFFFFFF;
+			item.size = 0;
+
 			bool is_folder = true;
 			TIFHR(IsArchiveItemFolder(archive_.get(), i, is_folder));
 			if (!is_folder)
@@ -226,14 +261,44 @@ namespace KlayGE
 				std::string file_path;
 				TIFHR(GetArchiveItemPath(archive_.get(), i, file_path));
 				std::replace(file_path.begin(), file_path.end(), '\\', '/');
-				if (!StringUtil::CaseInsensitiveLexicographicalCompare(extract_file_path, file_path) &&
-					!StringUtil::CaseInsensitiveLexicographicalCompare(file_path, extract_file_path))
+				StringUtil::ToLower(file_path);
+
+				// The first item of a path wins, as in a linear search
+				path_index_.emplace(std::move(file_path), i);
+
+				PROPVARIANT prop;
+				prop.vt = VT_EMPTY;
+				TIFHR(archive_->GetProperty(i, kpidSize, &prop));
+				if (prop.vt == VT_UI8)
 				{
-					real_index = i;
-					break;
+					item.size = prop.uhVal.QuadPart;
+				}
+
+				prop.vt = VT_EMPTY;
+				TIFHR(archive_->GetProperty(i, kpidBlock, &prop));
+				if (prop.vt == VT_UI4)
+				{
+					item.block = prop.ulVal;
+
+					BlockInfo& block = blocks_[item.block];
+					block.items.push_back(i);
+					block.size += item.size;
 				}
 			}
 		}
+	}
+
+	uint32_t Package::Find(std::string_view extract_file_path) const
+	{
+		uint32_t real_index = 0xFFFFFFFF;
+
+		std::string file_path(extract_file_path);
+		StringUtil::ToLower(file_path);
+		auto const iter = path_index_.find(file_path);
+		if (iter != path_index_.end())
+		{
+			real_index = iter->second;
+		}
 		if (real_index != 0xFFFFFFFF)
 		{
 			PROPVARIANT prop;
@@ -259,4 +324,143 @@ namespace KlayGE
 
 		return real_index;
 	}
+
+	std::vector<std::shared_ptr<std::string>> Package::Decode(std::span<uint32_t const> indices)
+	{
+		std::lock_guard<std::mutex> lock(extract_mutex_);
+
+		std::vector<std::shared_ptr<std::string>> ret(indices.size());
+
+		// A file in a solid block can't be decoded without the ones before it, so small enough
+		// blocks are decoded as a whole and kept for the other files in them
+		std::vector<uint32_t> decode_indices;
+		std::vector<uint32_t> blocks_to_cache;
+		for (size_t i = 0; i < indices.size(); ++ i)
+		{
+			uint32_t const index = indices[i];
+			ret[i] = this->FindInCache(index);
+			if (!ret[i])
+			{
+				uint32_t const block = items_[index].block;
+				auto const iter = (block != 0xFFFFFFFF) ? blocks_.find(block) : blocks_.end();
+				if ((iter != blocks_.end()) && (iter->second.items.size() > 1) && (iter->second.size <= block_cache_budget_))
+				{
+					if (std::find(blocks_to_cache.begin(), blocks_to_cache.end(), block) == blocks_to_cache.end())
+					{
+						blocks_to_cache.push_back(block);
+						decode_indices.insert(decode_indices.end(), iter->second.items.begin(), iter->second.items.end());
+					}
+				}
+				else
+				{
+					decode_indices.push_back(index);
+				}
+			}
+		}
+
+		if (!decode_indices.empty())
+		{
+			std::sort(decode_indices.begin(), decode_indices.end());
+			decode_indices.erase(std::unique(decode_indices.begin(), decode_indices.end()), decode_indices.end());
+
+			std::unordered_map<uint32_t, std::shared_ptr<std::ostringstream>> decoded_files;
+			std::unordered_map<uint32_t, com_ptr<ISequentialOutStream>> out_streams;
+			for (uint32_t index : decode_indices)
+			{
+				auto decoded_file = MakeSharedPtr<std::ostringstream>();
+				out_streams.emplace(index, com_ptr<ISequentialOutStream>(new OutStream(decoded_file), false));
+				decoded_files.emplace(index, std::move(decoded_file));
+			}
+
+			// All of them in one pass
+			com_ptr<IArchiveExtractCallback> ecb(new ArchiveExtractCallback(password_, std::move(out_streams)), false);
+			TIFHR(archive_->Extract(decode_indices.data(), static_cast<UInt32>(decode_indices.size()), false, ecb.get()));
+			++ num_decode_passes_;
+
+			std::unordered_map<uint32_t, std::shared_ptr<std::string>> decoded;
+			for (auto& decoded_file : decoded_files)
+			{
+				decoded.emplace(decoded_file.first, MakeSharedPtr<std::string>(std::move(*decoded_file.second).str()));
+			}
+
+			for (size_t i = 0; i < indices.size(); ++ i)
+			{
+				if (!ret[i])
+				{
+					ret[i] = decoded[indices[i]];
+				}
+			}
+
+			for (uint32_t block : blocks_to_cache)
+			{
+				CachedBlock cached_block;
+				cached_block.block = block;
+				cached_block.size = 0;
+				for (uint32_t index : blocks_[block].items)
+				{
+					auto const& data = decoded[index];
+					cached_block.size += data->size();
+					cached_block.items.emplace(index, data);
+				}
+
+				block_cache_size_ += cached_block.size;
+				block_cache_.push_front(std::move(cached_block));
+			}
+			this->EvictBlocks();
+		}
+
+		return ret;
+	}
+
+	std::shared_ptr<std::string> Package::FindInCache(uint32_t index)
+	{
+		uint32_t const block = items_[index].block;
+		if (block != 0xFFFFFFFF)
+		{
+			for (auto iter = block_cache_.begin(); iter != block_cache_.end(); ++ iter)
+			{
+				if (iter->block == block)
+				{
+					// Most recently used goes first
+					block_cache_.splice(block_cache_.begin(), block_cache_, iter);
+
+					auto const item_iter = iter->items.find(index);
+					BOOST_ASSERT(item_iter != iter->items.end());
+					return item_iter->second;
+				}
+			}
+		}
+		return std::shared_ptr<std::string>();
+	}
+
+	void Package::EvictBlocks()
+	{
+		while (!block_cache_.empty() && (block_cache_size_ > block_cache_budget_))
+		{
+			block_cache_size_ -= block_cache_.back().size;
+			block_cache_.pop_back();
+		}
+	}
+
+	ResIdentifierPtr Package::MakeResIdentifier(uint32_t index, std::string_view res_name, std::shared_ptr<std::string> const & data)
+	{
+		PROPVARIANT prop;
+		prop.vt = VT_EMPTY;
+		TIFHR(archive_->GetProperty(index, kpidMTime, &prop));
+		uint64_t mtime;
+		if (prop.vt == VT_FILETIME)
+		{
+			mtime = (static_cast<uint64_t>(prop.filetime.dwHighDateTime) << 32)
+				+ prop.filetime.dwLowDateTime;
+			mtime -= 116444736000000000ULL;
+		}
+		else
+		{
+			mtime = archive_is_->Timestamp();
+		}
+
+		// The decoded data is shared with the block cache, not copied
+		return MakeSharedPtr<ResIdentifier>(
+			res_name, mtime, std::span(reinterpret_cast<uint8_t const*>(data->data()), data->size()), data);
+	}
 }
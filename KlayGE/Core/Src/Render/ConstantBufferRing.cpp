@@ -0,0 +1,129 @@
+/**
+ * @file ConstantBufferRing.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/RenderEngine.hpp>
+#include <KlayGE/RenderFactory.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <KlayGE/ConstantBufferRing.hpp>
+
+namespace KlayGE
+{
+	ConstantBufferRing::ConstantBufferRing(uint32_t size_in_byte, uint32_t alignment, uint32_t num_frames_in_flight)
+		: alignment_(std::max(alignment, 1U))
+	{
+		BOOST_ASSERT(num_frames_in_flight > 0);
+
+		capacity_ = (size_in_byte + alignment_ - 1) / alignment_ * alignment_;
+		simulate_buffer_.resize(capacity_);
+		frame_fences_.assign(num_frames_in_flight, 0);
+
+		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+		buffer_ = rf.MakeConstantBuffer(BU_Dynamic, 0, capacity_, nullptr);
+	}
+
+	bool ConstantBufferRing::Alloc(uint32_t size_in_byte, void const * data, uint32_t& offset)
+	{
+		// An alloc never straddles the end of the ring. It starts over at the beginning instead.
+		uint64_t start = (head_ + alignment_ - 1) / alignment_ * alignment_;
+		uint64_t const start_offset = start % capacity_;
+		if (start_offset + size_in_byte > capacity_)
+		{
+			start += capacity_ - start_offset;
+		}
+		uint64_t const end = start + size_in_byte;
+
+		if (end - tail_ > capacity_)
+		{
+			++ num_full_;
+			return false;
+		}
+
+		offset = static_cast<uint32_t>(start % capacity_);
+		memcpy(&simulate_buffer_[offset], data, size_in_byte);
+		head_ = end;
+		high_water_mark_ = std::max(high_water_mark_, static_cast<uint32_t>(head_ - tail_));
+
+		return true;
+	}
+
+	void ConstantBufferRing::EnsureDataReady()
+	{
+		// Allocs that were freed before being uploaded weren't used by any draw
+		uint64_t const begin = std::max(uploaded_, tail_);
+		if (head_ > begin)
+		{
+			uint32_t const begin_offset = static_cast<uint32_t>(begin % capacity_);
+			uint32_t const length = static_cast<uint32_t>(head_ - begin);
+			uint32_t const first_length = std::min(length, capacity_ - begin_offset);
+
+			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+			buffer_->UpdateSubresource(begin_offset, first_length, &simulate_buffer_[begin_offset]);
+			re.CBufferUploaded(first_length);
+			if (length > first_length)
+			{
+				buffer_->UpdateSubresource(0, length - first_length, &simulate_buffer_[0]);
+				re.CBufferUploaded(length - first_length);
+			}
+
+			uploaded_ = head_;
+		}
+	}
+
+	void ConstantBufferRing::OnPresent()
+	{
+		// Space allocated num_frames_in_flight frames ago isn't used by the GPU any more
+		tail_ = frame_fences_[fence_index_];
+		frame_fences_[fence_index_] = head_;
+		fence_index_ = (fence_index_ + 1) % static_cast<uint32_t>(frame_fences_.size());
+
+		++ frame_id_;
+	}
+
+	ConstantBufferRing::Stats ConstantBufferRing::GetStats() const noexcept
+	{
+		Stats stats;
+		stats.capacity = capacity_;
+		stats.high_water_mark = high_water_mark_;
+		stats.num_full = num_full_;
+		return stats;
+	}
+
+	void ConstantBufferRing::ResetStats() noexcept
+	{
+		high_water_mark_ = 0;
+		num_full_ = 0;
+	}
+}
@@ -29,12 +29,22 @@
  */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KlayGE/Context.hpp>
+#include <KFL/Thread.hpp>
+
+#include <future>
+
 #include <KlayGE/DistanceField.hpp>
 
 namespace
 {
 	using namespace KlayGE;
 
+	// Below this many output pixels, a distance field is computed on the calling thread
+	uint32_t const PARALLEL_DISTANCE_THRESHOLD = 256 * 256;
+	// Rows or columns processed by one thread pool task
+	uint32_t const LINES_PER_TASK = 64;
+
 	float EdgeDistance(float2 const & grad, float val)
 	{
 		float df;
@@ -211,6 +221,236 @@ namespace
 			}
 		}
 	}
+
+	// Runs func(begin, end) on chunks of [0, num), on the thread pool if parallel
+	template <typename Func>
+	void ForEachChunk(uint32_t num, uint32_t chunk_size, bool parallel, Func const & func)
+	{
+		if (parallel && (num > chunk_size))
+		{
+			auto& tp = Context::Instance().ThreadPoolInstance();
+			std::vector<std::future<void>> joiners;
+			for (uint32_t begin = chunk_size; begin < num; begin += chunk_size)
+			{
+				joiners.push_back(tp.QueueThread([&func, begin, num, chunk_size] { func(begin, std::min(begin + chunk_size, num)); }));
+			}
+			func(0, chunk_size);
+			for (auto& joiner : joiners)
+			{
+				joiner.wait();
+			}
+		}
+		else
+		{
+			func(0, num);
+		}
+	}
+
+	// Gradient of the 2x image, as ComputeGradient
+	float2 Gradient2x(std::vector<float> const & img, int w, int h, int x, int y)
+	{
+		int const addr = y * w + x;
+		if ((x > 0) && (x < w - 1) && (y > 0) && (y < h - 1) && (img[addr] > 0) && (img[addr] < 1))
+		{
+			float const s0 = -img[addr - w - 1] + img[addr + w + 1];
+			float const s1 = -img[addr + w - 1] + img[addr - w + 1];
+			return MathLib::normalize(
+				float2(s0 + s1 - SQRT2 * (img[addr - 1] - img[addr + 1]), s0 - s1 - SQRT2 * (img[addr - w] - img[addr + w])));
+		}
+		else
+		{
+			return float2(0, 0);
+		}
+	}
+
+	// Downsamples the coverage and its gradient in one pass, without a full resolution gradient buffer
+	void DownsampleWithGradient(std::vector<float> const & aa_2x_data, int w_2x, int h_2x, uint32_t begin_y, uint32_t end_y,
+		std::vector<float>& aa_data, std::vector<float2>& grad_data)
+	{
+		int const w = w_2x / 2;
+		for (uint32_t y = begin_y; y < end_y; ++ y)
+		{
+			int const y0 = y * 2;
+			int const y1 = y0 + 1;
+			for (int x = 0; x < w; ++ x)
+			{
+				int const x0 = x * 2;
+				int const x1 = x0 + 1;
+				aa_data[y * w + x] = (aa_2x_data[y0 * w_2x + x0] + aa_2x_data[y0 * w_2x + x1]
+					+ aa_2x_data[y1 * w_2x + x0] + aa_2x_data[y1 * w_2x + x1]) * 0.25f;
+				grad_data[y * w + x] = (Gradient2x(aa_2x_data, w_2x, h_2x, x0, y0) + Gradient2x(aa_2x_data, w_2x, h_2x, x1, y0)
+					+ Gradient2x(aa_2x_data, w_2x, h_2x, x0, y1) + Gradient2x(aa_2x_data, w_2x, h_2x, x1, y1)) * 0.25f;
+			}
+		}
+	}
+
+	// First pass of the separable transform. For each pixel, finds the row of the nearest site in its column, or -1.
+	// The sites of the outside distance are the covered pixels, the ones of the inside distance are the not fully covered pixels.
+	void NearestSiteInColumns(std::vector<float> const & aa_data, int width, int height, uint32_t begin_x, uint32_t end_x,
+		bool inside, std::vector<int32_t>& site_y)
+	{
+		for (uint32_t x = begin_x; x < end_x; ++ x)
+		{
+			int32_t last = -1;
+			for (int y = 0; y < height; ++ y)
+			{
+				float const val = aa_data[y * width + x];
+				if (inside ? (val < 1) : (val > 0))
+				{
+					last = y;
+				}
+				site_y[y * width + x] = last;
+			}
+
+			last = -1;
+			for (int y = height - 1; y >= 0; -- y)
+			{
+				int32_t& site = site_y[y * width + x];
+				if (site == y)
+				{
+					last = y;
+				}
+				else if ((last >= 0) && ((site < 0) || (last - y < y - site)))
+				{
+					site = last;
+				}
+			}
+		}
+	}
+
+	// Second pass, per row. The lower envelope of the parabolas from the column pass gives the nearest site of each pixel.
+	void NearestSiteInRows(int width, uint32_t begin_y, uint32_t end_y, std::vector<int32_t> const & site_y,
+		std::vector<int2>& nearest_site, std::vector<int32_t>& envelope_x, std::vector<float>& envelope_z)
+	{
+		envelope_x.resize(width);
+		envelope_z.resize(width + 1);
+		for (uint32_t y = begin_y; y < end_y; ++ y)
+		{
+			int32_t const * row_site_y = &site_y[y * width];
+			auto parabola = [row_site_y, y](int32_t q)
+			{
+				float const dy = static_cast<float>(row_site_y[q] - static_cast<int32_t>(y));
+				return dy * dy + static_cast<float>(q * q);
+			};
+
+			int k = -1;
+			for (int32_t q = 0; q < width; ++ q)
+			{
+				if (row_site_y[q] < 0)
+				{
+					continue;
+				}
+
+				float s = -1e20f;
+				while (k >= 0)
+				{
+					s = (parabola(q) - parabola(envelope_x[k])) / (2.0f * (q - envelope_x[k]));
+					if (s > envelope_z[k])
+					{
+						break;
+					}
+					-- k;
+				}
+				++ k;
+				envelope_x[k] = q;
+				envelope_z[k] = (k == 0) ? -1e20f : s;
+				envelope_z[k + 1] = 1e20f;
+			}
+
+			int2* row_nearest_site = &nearest_site[y * width];
+			if (k < 0)
+			{
+				std::fill(row_nearest_site, row_nearest_site + width, int2(-1, -1));
+				continue;
+			}
+
+			k = 0;
+			for (int32_t x = 0; x < width; ++ x)
+			{
+				while (envelope_z[k + 1] < x)
+				{
+					++ k;
+				}
+
+				int32_t const site_x = envelope_x[k];
+				row_nearest_site[x] = int2(site_x, row_site_y[site_x]);
+			}
+		}
+	}
+
+	// The nearest site isn't always the one with the shortest anti-aliased distance, since a site with little coverage
+	// has its edge further away. One round of picking the best site among the neighbors' ones fixes nearly all of that.
+	void AADistanceInRows(std::vector<float> const & aa_data, std::vector<float2> const & grad_data, int width, int height,
+		uint32_t begin_y, uint32_t end_y, bool inside, std::vector<int2> const & nearest_site, std::vector<float>& dist)
+	{
+		for (uint32_t y = begin_y; y < end_y; ++ y)
+		{
+			for (int x = 0; x < width; ++ x)
+			{
+				int const addr = y * width + x;
+
+				// Fully covered pixels are sites of their own, at distance 0
+				if ((nearest_site[addr] == int2(x, y)) && ((inside ? 1 - aa_data[addr] : aa_data[addr]) >= 1))
+				{
+					dist[addr] = 0;
+					continue;
+				}
+
+				// Neighbors mostly share their sites, each one is evaluated once
+				int2 tested_sites[9];
+				uint32_t num_tested_sites = 0;
+
+				float best = 1e10f;
+				for (int dy = -1; dy <= 1; ++ dy)
+				{
+					int const ny = static_cast<int>(y) + dy;
+					if ((ny < 0) || (ny >= height))
+					{
+						continue;
+					}
+					for (int dx = -1; dx <= 1; ++ dx)
+					{
+						int const nx = x + dx;
+						if ((nx < 0) || (nx >= width))
+						{
+							continue;
+						}
+
+						int2 const site = nearest_site[ny * width + nx];
+						if ((site.x() < 0) || (std::find(tested_sites, tested_sites + num_tested_sites, site) != tested_sites + num_tested_sites))
+						{
+							continue;
+						}
+						tested_sites[num_tested_sites] = site;
+						++ num_tested_sites;
+
+						int const site_addr = site.y() * width + site.x();
+						float const val = MathLib::clamp(inside ? 1 - aa_data[site_addr] : aa_data[site_addr], 0.0f, 1.0f);
+
+						float2 const offset(static_cast<float>(x - site.x()), static_cast<float>(static_cast<int>(y) - site.y()));
+						float d;
+						if ((offset.x() == 0) && (offset.y() == 0))
+						{
+							if (val >= 1)
+							{
+								d = 0;
+							}
+							else
+							{
+								d = EdgeDistance(inside ? -grad_data[site_addr] : grad_data[site_addr], val);
+							}
+						}
+						else
+						{
+							d = MathLib::length(offset) + EdgeDistance(offset, val);
+						}
+						best = std::min(best, d);
+					}
+				}
+				dist[addr] = best;
+			}
+		}
+	}
 } // namespace
 
 namespace KlayGE
@@ -243,6 +483,66 @@ namespace KlayGE
 
 	void ComputeDistance(std::vector<float> const & aa_2x_data, uint32_t input_width, uint32_t input_height,
 		std::vector<float>& dist_data)
+	{
+		DistanceFieldScratch scratch;
+		ComputeDistance(aa_2x_data, input_width, input_height, dist_data, scratch);
+	}
+
+	void ComputeDistance(std::vector<float> const & aa_2x_data, uint32_t input_width, uint32_t input_height,
+		std::vector<float>& dist_data, DistanceFieldScratch& scratch)
+	{
+		BOOST_ASSERT((input_width & 0x1) == 0);
+		BOOST_ASSERT((input_height & 0x1) == 0);
+
+		uint32_t const width = input_width / 2;
+		uint32_t const height = input_height / 2;
+		uint32_t const num_pixels = width * height;
+		bool const parallel = num_pixels >= PARALLEL_DISTANCE_THRESHOLD;
+
+		scratch.aa_data.resize(num_pixels);
+		scratch.grad_data.resize(num_pixels);
+		scratch.outside_site_y.resize(num_pixels);
+		scratch.inside_site_y.resize(num_pixels);
+		scratch.outside_nearest_site.resize(num_pixels);
+		scratch.inside_nearest_site.resize(num_pixels);
+		scratch.inside_dist.resize(num_pixels);
+		dist_data.resize(num_pixels);
+
+		ForEachChunk(height, LINES_PER_TASK, parallel, [&](uint32_t begin, uint32_t end)
+			{
+				DownsampleWithGradient(aa_2x_data, input_width, input_height, begin, end, scratch.aa_data, scratch.grad_data);
+			});
+
+		ForEachChunk(width, LINES_PER_TASK, parallel, [&](uint32_t begin, uint32_t end)
+			{
+				NearestSiteInColumns(scratch.aa_data, width, height, begin, end, false, scratch.outside_site_y);
+				NearestSiteInColumns(scratch.aa_data, width, height, begin, end, true, scratch.inside_site_y);
+			});
+
+		ForEachChunk(height, LINES_PER_TASK, parallel, [&](uint32_t begin, uint32_t end)
+			{
+				std::vector<int32_t> envelope_x;
+				std::vector<float> envelope_z;
+				NearestSiteInRows(width, begin, end, scratch.outside_site_y, scratch.outside_nearest_site, envelope_x, envelope_z);
+				NearestSiteInRows(width, begin, end, scratch.inside_site_y, scratch.inside_nearest_site, envelope_x, envelope_z);
+			});
+
+		ForEachChunk(height, LINES_PER_TASK, parallel, [&](uint32_t begin, uint32_t end)
+			{
+				// The outside distance goes to dist_data first
+				AADistanceInRows(scratch.aa_data, scratch.grad_data, width, height, begin, end, false, scratch.outside_nearest_site,
+					dist_data);
+				AADistanceInRows(scratch.aa_data, scratch.grad_data, width, height, begin, end, true, scratch.inside_nearest_site,
+					scratch.inside_dist);
+				for (uint32_t i = begin * width; i < end * width; ++ i)
+				{
+					dist_data[i] = std::max(scratch.inside_dist[i], 0.0f) - std::max(dist_data[i], 0.0f);
+				}
+			});
+	}
+
+	void ComputeDistanceReference(std::vector<float> const & aa_2x_data, uint32_t input_width, uint32_t input_height,
+		std::vector<float>& dist_data)
 	{
 		BOOST_ASSERT((input_width & 0x1) == 0);
 		BOOST_ASSERT((input_height & 0x1) == 0);
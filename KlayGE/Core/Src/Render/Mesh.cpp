@@ -21,6 +21,7 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/CXX20/span.hpp>
+#include <KFL/CXX23/utility.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Log.hpp>
 #include <KFL/Math.hpp>
@@ -31,27 +32,61 @@
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/App3D.hpp>
 #include <KlayGE/Camera.hpp>
-#include <KlayGE/LZMACodec.hpp>
+#include <KlayGE/Codec.hpp>
 #include <KlayGE/Light.hpp>
 #include <KlayGE/RenderMaterial.hpp>
 #include <KlayGE/DevHelper.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/Thread.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
 #include <KlayGE/SceneManager.hpp>
 
 #include <algorithm>
+#include <array>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <limits>
 #include <sstream>
 #include <cstring>
 
+#include <nonstd/scope.hpp>
+
 #include <KlayGE/Mesh.hpp>
 
 namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const MODEL_BIN_VERSION = 19;
+	uint32_t const MODEL_BIN_VERSION = 21;
+
+	// A .model_bin is made of independently compressed chunks, so they can be decoded in parallel or skipped.
+	// All chunks use the codec recorded in the header.
+	enum class ModelChunkType : uint32_t
+	{
+		Materials,
+		Meshes,
+		VertexStream,
+		Indices,
+		Nodes,
+		Joints,
+		KeyFrames,
+		BBKeyFrames,
+		Animations,
+
+		NumTypes
+	};
+	uint32_t constexpr NumModelChunkTypes = std::to_underlying(ModelChunkType::NumTypes);
+
+	struct ModelChunkEntry
+	{
+		uint32_t type;
+		uint32_t index;
+		uint64_t offset; // From the beginning of the file
+		uint64_t len;
+		uint64_t original_len;
+	};
+	static_assert(sizeof(ModelChunkEntry) == 32);
 
 	class RenderModelLoadingDesc : public ResLoadingDesc
 	{
@@ -135,6 +170,11 @@ namespace
 			return true;
 		}
 
+		size_t Hash() const override
+		{
+			return HashValue(model_desc_.res_name);
+		}
+
 		bool Match([[maybe_unused]] ResLoadingDesc const & rhs) const override
 		{
 			return false;
@@ -1069,7 +1109,7 @@ namespace KlayGE
 		}
 	}
 
-	RenderModelPtr LoadSoftwareModel(std::string_view model_name)
+	RenderModelPtr LoadSoftwareModel(std::string_view model_name, bool load_animations)
 	{
 		char const * JIT_EXT_NAME = ".model_bin";
 
@@ -1168,38 +1208,144 @@ namespace KlayGE
 		ver = LE2Native(ver);
 		BOOST_ASSERT(MODEL_BIN_VERSION == ver);
 
-		std::shared_ptr<std::stringstream> ss = MakeSharedPtr<std::stringstream>();
-
-		uint64_t original_len, len;
-		runtime_file->read(&original_len, sizeof(original_len));
-		original_len = LE2Native(original_len);
-		runtime_file->read(&len, sizeof(len));
-		len = LE2Native(len);
-
-		LZMACodec lzma;
-		lzma.Decode(*ss, runtime_file, len, original_len);
-
-		ResIdentifierPtr decoded = MakeSharedPtr<ResIdentifier>(runtime_file->ResName(), runtime_file->Timestamp(), ss);
+		uint8_t codec_type;
+		runtime_file->read(&codec_type, sizeof(codec_type));
+		Verify(codec_type < std::to_underlying(CodecType::NumTypes));
 
 		uint32_t num_mtls;
-		decoded->read(&num_mtls, sizeof(num_mtls));
+		runtime_file->read(&num_mtls, sizeof(num_mtls));
 		num_mtls = LE2Native(num_mtls);
 		uint32_t num_meshes;
-		decoded->read(&num_meshes, sizeof(num_meshes));
+		runtime_file->read(&num_meshes, sizeof(num_meshes));
 		num_meshes = LE2Native(num_meshes);
 		uint32_t num_nodes;
-		decoded->read(&num_nodes, sizeof(num_nodes));
+		runtime_file->read(&num_nodes, sizeof(num_nodes));
 		num_nodes = LE2Native(num_nodes);
 		uint32_t num_joints;
-		decoded->read(&num_joints, sizeof(num_joints));
+		runtime_file->read(&num_joints, sizeof(num_joints));
 		num_joints = LE2Native(num_joints);
 		uint32_t num_kfs;
-		decoded->read(&num_kfs, sizeof(num_kfs));
+		runtime_file->read(&num_kfs, sizeof(num_kfs));
 		num_kfs = LE2Native(num_kfs);
 		uint32_t num_animations;
-		decoded->read(&num_animations, sizeof(num_animations));
+		runtime_file->read(&num_animations, sizeof(num_animations));
 		num_animations = LE2Native(num_animations);
 
+		uint32_t num_chunks;
+		runtime_file->read(&num_chunks, sizeof(num_chunks));
+		num_chunks = LE2Native(num_chunks);
+		std::vector<ModelChunkEntry> chunks(num_chunks);
+		runtime_file->read(chunks.data(), chunks.size() * sizeof(chunks[0]));
+		for (auto& chunk : chunks)
+		{
+			chunk.type = LE2Native(chunk.type);
+			chunk.index = LE2Native(chunk.index);
+			chunk.offset = LE2Native(chunk.offset);
+			chunk.len = LE2Native(chunk.len);
+			chunk.original_len = LE2Native(chunk.original_len);
+		}
+
+		if (!load_animations)
+		{
+			num_kfs = 0;
+			num_animations = 0;
+		}
+
+		std::vector<uint8_t> file_data;
+		std::span<uint8_t const> all_data = runtime_file->Data();
+		if (all_data.empty())
+		{
+			runtime_file->seekg(0, std::ios_base::end);
+			file_data.resize(static_cast<size_t>(runtime_file->tellg()));
+			runtime_file->seekg(0, std::ios_base::beg);
+			runtime_file->read(file_data.data(), file_data.size());
+			all_data = file_data;
+		}
+
+		uint32_t num_vertex_streams = 0;
+		for (auto const& chunk : chunks)
+		{
+			// A truncated or damaged file has to fail here, not in the decoders
+			Verify((chunk.offset <= all_data.size()) && (chunk.len <= all_data.size() - chunk.offset));
+			Verify(chunk.original_len <= std::numeric_limits<size_t>::max());
+			if (static_cast<ModelChunkType>(chunk.type) == ModelChunkType::VertexStream)
+			{
+				// Every vertex stream has its own chunk
+				Verify(chunk.index < num_chunks);
+				num_vertex_streams = std::max(num_vertex_streams, chunk.index + 1);
+			}
+		}
+		merged_buff.resize(num_vertex_streams);
+
+		// Vertex streams and indices are decoded on the thread pool right into the buffers' init data, together with the key frames.
+		// The small chunks are decoded here meanwhile.
+		std::array<std::vector<uint8_t>, NumModelChunkTypes> decoded_chunks;
+		std::vector<std::future<void>> joiners;
+		// The decoders write to merged_buff and read all_data. They have to be done before an exception leaves here.
+		auto wait_for_joiners = nonstd::make_scope_exit([&joiners]
+			{
+				for (auto& joiner : joiners)
+				{
+					if (joiner.valid())
+					{
+						joiner.wait();
+					}
+				}
+			});
+		auto& tp = context.ThreadPoolInstance();
+		for (auto const& chunk : chunks)
+		{
+			auto const type = static_cast<ModelChunkType>(chunk.type);
+			if ((chunk.type >= NumModelChunkTypes) || (chunk.original_len == 0)
+				|| ((num_kfs == 0) && ((type == ModelChunkType::KeyFrames) || (type == ModelChunkType::BBKeyFrames)
+					|| (type == ModelChunkType::Animations))))
+			{
+				continue;
+			}
+
+			std::vector<uint8_t>* output;
+			switch (type)
+			{
+			case ModelChunkType::VertexStream:
+				output = &merged_buff[chunk.index];
+				break;
+
+			case ModelChunkType::Indices:
+				output = &merged_indices;
+				break;
+
+			default:
+				output = &decoded_chunks[chunk.type];
+				break;
+			}
+			// Two chunks decoding into the same output would race
+			Verify(output->empty());
+			output->resize(static_cast<size_t>(chunk.original_len));
+
+			auto const input = all_data.subspan(static_cast<size_t>(chunk.offset), static_cast<size_t>(chunk.len));
+			auto decode = [output, input, original_len = chunk.original_len, codec_type]
+			{
+				auto codec = MakeCodec(static_cast<CodecType>(codec_type));
+				codec->Decode(output->data(), input, original_len);
+			};
+			if ((type == ModelChunkType::VertexStream) || (type == ModelChunkType::Indices) || (type == ModelChunkType::KeyFrames)
+				|| (type == ModelChunkType::BBKeyFrames))
+			{
+				joiners.push_back(tp.QueueThread(decode));
+			}
+			else
+			{
+				decode();
+			}
+		}
+
+		auto chunk_res = [&runtime_file, &decoded_chunks](ModelChunkType type)
+		{
+			return MakeSharedPtr<ResIdentifier>(runtime_file->ResName(), runtime_file->Timestamp(),
+				MakeSpan(decoded_chunks[std::to_underlying(type)]), std::shared_ptr<void>());
+		};
+
+		ResIdentifierPtr decoded = chunk_res(ModelChunkType::Materials);
 		mtls.resize(num_mtls);
 		for (uint32_t mtl_index = 0; mtl_index < num_mtls; ++ mtl_index)
 		{
@@ -1302,6 +1448,8 @@ namespace KlayGE
 			mtl->LoadTextureSlots();
 		}
 
+		decoded = chunk_res(ModelChunkType::Meshes);
+
 		uint32_t num_merged_ves;
 		decoded->read(&num_merged_ves, sizeof(num_merged_ves));
 		num_merged_ves = LE2Native(num_merged_ves);
@@ -1322,16 +1470,9 @@ namespace KlayGE
 		all_num_indices = LE2Native(all_num_indices);
 		decoded->read(&all_is_index_16_bit, sizeof(all_is_index_16_bit));
 
-		int const index_elem_size = all_is_index_16_bit ? 2 : 4;
-
-		merged_buff.resize(merged_ves.size());
-		for (size_t i = 0; i < merged_buff.size(); ++ i)
-		{
-			merged_buff[i].resize(all_num_vertices * merged_ves[i].element_size());
-			decoded->read(&merged_buff[i][0], merged_buff[i].size() * sizeof(merged_buff[i][0]));
-		}
-		merged_indices.resize(all_num_indices * index_elem_size);
-		decoded->read(&merged_indices[0], merged_indices.size() * sizeof(merged_indices[0]));
+		BOOST_ASSERT(merged_buff.size() == merged_ves.size());
+		BOOST_ASSERT(merged_buff.empty() || (merged_buff[0].size() == all_num_vertices * merged_ves[0].element_size()));
+		BOOST_ASSERT(merged_indices.size() == all_num_indices * (all_is_index_16_bit ? 2U : 4U));
 
 		mesh_names.resize(num_meshes);
 		mtl_ids.resize(num_meshes);
@@ -1389,6 +1530,8 @@ namespace KlayGE
 			}
 		}
 
+		decoded = chunk_res(ModelChunkType::Nodes);
+
 		nodes.resize(num_nodes);
 		for (auto& node : nodes)
 		{
@@ -1437,6 +1580,8 @@ namespace KlayGE
 			node.node->TransformToParent(xform_to_parent);
 		}
 
+		decoded = chunk_res(ModelChunkType::Joints);
+
 		joints.resize(num_joints);
 		for (uint32_t joint_index = 0; joint_index < num_joints; ++ joint_index)
 		{
@@ -1494,8 +1639,19 @@ namespace KlayGE
 			joint.InverseOriginParams(inverse_origin_real, inverse_origin_dual, inverse_origin_scale);
 		}
 
+		for (auto& joiner : joiners)
+		{
+			joiner.wait();
+		}
+		for (auto& joiner : joiners)
+		{
+			joiner.get();
+		}
+
 		if (num_kfs > 0)
 		{
+			decoded = chunk_res(ModelChunkType::KeyFrames);
+
 			decoded->read(&num_frames, sizeof(num_frames));
 			num_frames = LE2Native(num_frames);
 			decoded->read(&frame_rate, sizeof(frame_rate));
@@ -1544,6 +1700,8 @@ namespace KlayGE
 				}
 			}
 
+			decoded = chunk_res(ModelChunkType::BBKeyFrames);
+
 			frame_pos_bbs.resize(num_meshes);
 			for (uint32_t mesh_index = 0; mesh_index < num_meshes; ++ mesh_index)
 			{
@@ -1575,6 +1733,8 @@ namespace KlayGE
 
 			if (num_animations > 0)
 			{
+				decoded = chunk_res(ModelChunkType::Animations);
+
 				animations = MakeSharedPtr<std::vector<Animation>>(num_animations);
 				for (uint32_t animation_index = 0; animation_index < num_animations; ++animation_index)
 				{
@@ -1782,9 +1942,7 @@ namespace
 		std::vector<AABBox> const & pos_bbs, std::vector<AABBox> const & tc_bbs,
 		std::vector<uint32_t> const & mesh_num_vertices, std::vector<uint32_t> const & mesh_base_vertices,
 		std::vector<uint32_t> const & mesh_num_indices, std::vector<uint32_t> const & mesh_start_indices,
-		std::vector<VertexElement> const & merged_ves,
-		std::vector<std::vector<uint8_t>> const & merged_vertices, std::vector<uint8_t> const & merged_indices,
-		char is_index_16_bit, std::ostream& os)
+		std::vector<VertexElement> const & merged_ves, char is_index_16_bit, std::ostream& os)
 	{
 		uint32_t num_merged_ves = Native2LE(static_cast<uint32_t>(merged_ves.size()));
 		os.write(reinterpret_cast<char*>(&num_merged_ves), sizeof(num_merged_ves));
@@ -1802,12 +1960,6 @@ namespace
 		os.write(reinterpret_cast<char*>(&num_indices), sizeof(num_indices));
 		os.write(&is_index_16_bit, sizeof(is_index_16_bit));
 
-		for (size_t i = 0; i < merged_vertices.size(); ++ i)
-		{
-			os.write(reinterpret_cast<char const *>(&merged_vertices[i][0]), merged_vertices[i].size() * sizeof(merged_vertices[i][0]));
-		}
-		os.write(reinterpret_cast<char const *>(&merged_indices[0]), merged_indices.size() * sizeof(merged_indices[0]));
-
 		uint32_t mesh_lod_index = 0;
 		for (uint32_t mesh_index = 0; mesh_index < mesh_names.size(); ++ mesh_index)
 		{
@@ -2068,59 +2220,106 @@ namespace
 		std::vector<SceneNode const *> const & nodes, std::vector<Renderable const *> const & renderables,
 		std::vector<JointComponent const*> const & joints, std::shared_ptr<std::vector<Animation>> const & animations,
 		std::shared_ptr<std::vector<KeyFrameSet>> const & kfs, uint32_t num_frames, uint32_t frame_rate,
-		std::vector<std::shared_ptr<AABBKeyFrameSet>> const & frame_pos_bbs)
+		std::vector<std::shared_ptr<AABBKeyFrameSet>> const & frame_pos_bbs, CodecType codec_type)
 	{
-		std::ostringstream ss;
-
-		{
-			uint32_t num_mtls = Native2LE(static_cast<uint32_t>(mtls.size()));
-			ss.write(reinterpret_cast<char*>(&num_mtls), sizeof(num_mtls));
-
-			uint32_t num_meshes = Native2LE(static_cast<uint32_t>(pos_bbs.size()));
-			ss.write(reinterpret_cast<char*>(&num_meshes), sizeof(num_meshes));
-
-			uint32_t num_nodes = Native2LE(static_cast<uint32_t>(nodes.size()));
-			ss.write(reinterpret_cast<char*>(&num_nodes), sizeof(num_nodes));
-
-			uint32_t num_joints = Native2LE(static_cast<uint32_t>(joints.size()));
-			ss.write(reinterpret_cast<char*>(&num_joints), sizeof(num_joints));
-
-			uint32_t num_kfs = Native2LE(kfs ? static_cast<uint32_t>(kfs->size()) : 0);
-			ss.write(reinterpret_cast<char*>(&num_kfs), sizeof(num_kfs));
-
-			uint32_t num_animations = Native2LE(animations ? std::max(static_cast<uint32_t>(animations->size()), 1U) : 0);
-			ss.write(reinterpret_cast<char*>(&num_animations), sizeof(num_animations));
-		}
+		std::array<std::ostringstream, NumModelChunkTypes> meta_streams;
 
 		if (!mtls.empty())
 		{
-			WriteMaterialsChunk(mtls, ss);
+			WriteMaterialsChunk(mtls, meta_streams[std::to_underlying(ModelChunkType::Materials)]);
 		}
 
 		if (!mesh_names.empty())
 		{
 			WriteMeshesChunk(mesh_names, mtl_ids, mesh_lods, pos_bbs, tc_bbs,
 				mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices,
-				merged_ves, merged_buffs, merged_indices, all_is_index_16_bit, ss);
+				merged_ves, all_is_index_16_bit, meta_streams[std::to_underlying(ModelChunkType::Meshes)]);
 		}
 
 		if (!nodes.empty())
 		{
-			WriteNodesChunk(nodes, renderables, joints, ss);
+			WriteNodesChunk(nodes, renderables, joints, meta_streams[std::to_underlying(ModelChunkType::Nodes)]);
 		}
 
 		if (!joints.empty())
 		{
-			WriteBonesChunk(joints, ss);
+			WriteBonesChunk(joints, meta_streams[std::to_underlying(ModelChunkType::Joints)]);
 		}
 
 		if (kfs && !kfs->empty())
 		{
-			WriteKeyFramesChunk(num_frames, frame_rate, *kfs, ss);
+			WriteKeyFramesChunk(num_frames, frame_rate, *kfs, meta_streams[std::to_underlying(ModelChunkType::KeyFrames)]);
 
-			WriteBBKeyFramesChunk(frame_pos_bbs, ss);
+			WriteBBKeyFramesChunk(frame_pos_bbs, meta_streams[std::to_underlying(ModelChunkType::BBKeyFrames)]);
 
-			WriteAnimationsChunk(*animations, ss);
+			WriteAnimationsChunk(*animations, meta_streams[std::to_underlying(ModelChunkType::Animations)]);
+		}
+
+		std::array<std::string, NumModelChunkTypes> meta_chunks;
+		for (uint32_t i = 0; i < NumModelChunkTypes; ++ i)
+		{
+			meta_chunks[i] = meta_streams[i].str();
+		}
+
+		std::vector<ModelChunkEntry> chunks;
+		std::vector<std::span<uint8_t const>> chunk_inputs;
+		auto add_chunk = [&chunks, &chunk_inputs](ModelChunkType type, uint32_t index, std::span<uint8_t const> input)
+		{
+			if (!input.empty())
+			{
+				chunks.push_back(ModelChunkEntry{std::to_underlying(type), index, 0, 0, input.size()});
+				chunk_inputs.push_back(input);
+			}
+		};
+		for (uint32_t i = 0; i < NumModelChunkTypes; ++ i)
+		{
+			auto const type = static_cast<ModelChunkType>(i);
+			if (type == ModelChunkType::VertexStream)
+			{
+				for (uint32_t j = 0; j < merged_buffs.size(); ++ j)
+				{
+					add_chunk(type, j, merged_buffs[j]);
+				}
+			}
+			else if (type == ModelChunkType::Indices)
+			{
+				add_chunk(type, 0, merged_indices);
+			}
+			else
+			{
+				add_chunk(type, 0, MakeSpan(reinterpret_cast<uint8_t const *>(meta_chunks[i].data()), meta_chunks[i].size()));
+			}
+		}
+
+		std::vector<std::vector<uint8_t>> encoded_chunks(chunks.size());
+		{
+			auto& tp = Context::Instance().ThreadPoolInstance();
+			std::vector<std::future<void>> joiners(chunks.size());
+			for (size_t i = 0; i < chunks.size(); ++ i)
+			{
+				joiners[i] = tp.QueueThread(
+					[&encoded_chunks, &chunk_inputs, codec_type, i]
+					{
+						auto codec = MakeCodec(codec_type);
+						codec->Encode(encoded_chunks[i], chunk_inputs[i]);
+					});
+			}
+			for (auto& joiner : joiners)
+			{
+				joiner.wait();
+			}
+			for (auto& joiner : joiners)
+			{
+				joiner.get();
+			}
+		}
+
+		uint64_t offset = sizeof(uint32_t) * 9 + sizeof(uint8_t) + chunks.size() * sizeof(ModelChunkEntry);
+		for (size_t i = 0; i < chunks.size(); ++ i)
+		{
+			chunks[i].offset = offset;
+			chunks[i].len = encoded_chunks[i].size();
+			offset += chunks[i].len;
 		}
 
 		std::ofstream ofs(jit_name.c_str(), std::ios_base::binary);
@@ -2131,26 +2330,51 @@ namespace
 		uint32_t ver = Native2LE(MODEL_BIN_VERSION);
 		ofs.write(reinterpret_cast<char*>(&ver), sizeof(ver));
 
-		auto const & ss_str = ss.str();
-		uint64_t original_len = Native2LE(static_cast<uint64_t>(ss_str.size()));
-		ofs.write(reinterpret_cast<char*>(&original_len), sizeof(original_len));
+		uint8_t const codec = static_cast<uint8_t>(codec_type);
+		ofs.write(reinterpret_cast<char const *>(&codec), sizeof(codec));
 
-		std::ofstream::pos_type p = ofs.tellp();
-		uint64_t len = 0;
-		ofs.write(reinterpret_cast<char*>(&len), sizeof(len));
+		{
+			uint32_t num_mtls = Native2LE(static_cast<uint32_t>(mtls.size()));
+			ofs.write(reinterpret_cast<char*>(&num_mtls), sizeof(num_mtls));
+
+			uint32_t num_meshes = Native2LE(static_cast<uint32_t>(pos_bbs.size()));
+			ofs.write(reinterpret_cast<char*>(&num_meshes), sizeof(num_meshes));
+
+			uint32_t num_nodes = Native2LE(static_cast<uint32_t>(nodes.size()));
+			ofs.write(reinterpret_cast<char*>(&num_nodes), sizeof(num_nodes));
+
+			uint32_t num_joints = Native2LE(static_cast<uint32_t>(joints.size()));
+			ofs.write(reinterpret_cast<char*>(&num_joints), sizeof(num_joints));
+
+			uint32_t num_kfs = Native2LE(kfs ? static_cast<uint32_t>(kfs->size()) : 0);
+			ofs.write(reinterpret_cast<char*>(&num_kfs), sizeof(num_kfs));
+
+			uint32_t num_animations = Native2LE(animations ? std::max(static_cast<uint32_t>(animations->size()), 1U) : 0);
+			ofs.write(reinterpret_cast<char*>(&num_animations), sizeof(num_animations));
+		}
 
-		LZMACodec lzma;
-		len = lzma.Encode(ofs, MakeSpan(reinterpret_cast<uint8_t const *>(ss_str.c_str()), ss_str.size()));
+		uint32_t num_chunks = Native2LE(static_cast<uint32_t>(chunks.size()));
+		ofs.write(reinterpret_cast<char*>(&num_chunks), sizeof(num_chunks));
+		for (auto chunk : chunks)
+		{
+			chunk.type = Native2LE(chunk.type);
+			chunk.index = Native2LE(chunk.index);
+			chunk.offset = Native2LE(chunk.offset);
+			chunk.len = Native2LE(chunk.len);
+			chunk.original_len = Native2LE(chunk.original_len);
+			ofs.write(reinterpret_cast<char*>(&chunk), sizeof(chunk));
+		}
 
-		ofs.seekp(p, std::ios_base::beg);
-		len = Native2LE(len);
-		ofs.write(reinterpret_cast<char*>(&len), sizeof(len));
+		for (auto const& encoded : encoded_chunks)
+		{
+			ofs.write(reinterpret_cast<char const *>(encoded.data()), encoded.size());
+		}
 	}
 } // namespace
 
 namespace KlayGE
 {
-	void SaveModel(RenderModel const & model, std::string_view model_name)
+	void SaveModel(RenderModel const & model, std::string_view model_name, CodecType codec_type)
 	{
 		std::filesystem::path output_path(model_name);
 		auto const output_ext = output_path.extension().string();
@@ -2324,7 +2548,7 @@ namespace KlayGE
 			mesh_names, mtl_ids, mesh_lods, pos_bbs, tc_bbs,
 			mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices,
 			nodes, renderables,
-			joints, animations, kfs, num_frame, frame_rate, frame_pos_bbs);
+			joints, animations, kfs, num_frame, frame_rate, frame_pos_bbs, codec_type);
 
 #if KLAYGE_IS_DEV_PLATFORM
 		if (need_conversion)
@@ -45,8 +45,13 @@
 #include <KFL/XMLDom.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/SIMDMath.hpp>
+#include <KFL/Sort.hpp>
+#include <KFL/Thread.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <future>
 #include <string>
 
 #include <KlayGE/ParticleSystem.hpp>
@@ -57,6 +62,51 @@ namespace
 
 	uint32_t const NUM_PARTICLES = 4096;
 
+	// Particles updated or emitted by one thread pool task. A multiple of 4.
+	uint32_t const PARTICLES_PER_TASK = 8192;
+
+	// A polyline with the slope of each segment precomputed, evaluated 4 particles at a time
+	class SIMDPolyline
+	{
+	public:
+		explicit SIMDPolyline(std::vector<float2> const & ctrl_pts)
+			: last_y_(SIMDMathLib::SetVector(ctrl_pts.back().y()))
+		{
+			segments_.reserve(ctrl_pts.size() - 1);
+			for (size_t i = ctrl_pts.size() - 1; i > 0; -- i)
+			{
+				float2 const & prev = ctrl_pts[i - 1];
+				float2 const & next = ctrl_pts[i];
+				segments_.push_back({SIMDMathLib::SetVector(next.x()), SIMDMathLib::SetVector(prev.x()),
+					SIMDMathLib::SetVector(prev.y()), SIMDMathLib::SetVector((next.y() - prev.y()) / (next.x() - prev.x()))});
+			}
+		}
+
+		SIMDVectorF4 Evaluate(SIMDVectorF4 const & x) const
+		{
+			SIMDVectorF4 ret = last_y_;
+			// Segments are stored backward, so the first control point not before x wins
+			for (auto const & seg : segments_)
+			{
+				SIMDVectorF4 const value = seg.prev_y + (x - seg.prev_x) * seg.slope;
+				ret = SIMDMathLib::Select(SIMDMathLib::GreaterEqual(seg.next_x, x), value, ret);
+			}
+			return ret;
+		}
+
+	private:
+		struct Segment
+		{
+			SIMDVectorF4 next_x;
+			SIMDVectorF4 prev_x;
+			SIMDVectorF4 prev_y;
+			SIMDVectorF4 slope;
+		};
+
+		SIMDVectorF4 last_y_;
+		std::vector<Segment, aligned_allocator<Segment, 16>> segments_;
+	};
+
 	class ParticleSystemLoadingDesc : public ResLoadingDesc
 	{
 	private:
@@ -324,6 +374,11 @@ namespace
 			return true;
 		}
 
+		size_t Hash() const override
+		{
+			return HashValue(ps_desc_.res_name);
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -541,6 +596,16 @@ namespace KlayGE
 		return static_cast<uint32_t>(elapsed_time * emit_freq_ + 0.5f);
 	}
 
+	void ParticleEmitter::Emit(ParticleStore& particles, std::span<uint32_t const> indices)
+	{
+		for (uint32_t index : indices)
+		{
+			Particle par;
+			this->Emit(par);
+			particles.Set(index, par);
+		}
+	}
+
 	void ParticleEmitter::DoClone(ParticleEmitterPtr const & rhs)
 	{
 		rhs->ps_ = ps_;
@@ -570,6 +635,19 @@ namespace KlayGE
 
 	ParticleUpdater::~ParticleUpdater() noexcept = default;
 
+	void ParticleUpdater::Update(ParticleStore& particles, uint32_t begin, uint32_t end, float elapse_time)
+	{
+		for (uint32_t i = begin; i < end; ++ i)
+		{
+			if (particles.life[i] > 0)
+			{
+				Particle par = particles.Get(i);
+				this->Update(par, elapse_time);
+				particles.Set(i, par);
+			}
+		}
+	}
+
 	void ParticleUpdater::DoClone(ParticleUpdaterPtr const & rhs)
 	{
 		rhs->ps_ = ps_;
@@ -578,11 +656,17 @@ namespace KlayGE
 
 	ParticleSystem::ParticleSystem(uint32_t max_num_particles, bool sort_particles)
 		: root_node_(MakeSharedPtr<SceneNode>(L"ParticleSystemRootNode", SceneNode::SOA_Moveable | SceneNode::SOA_NotCastShadow)),
-			particles_(max_num_particles),
+			num_particles_(max_num_particles),
 			gravity_(0.5f), force_(0, 0, 0), media_density_(0.0f),
 			sort_particles_(sort_particles)
 	{
+		particles_.Resize(max_num_particles);
 		this->ClearParticles();
+		if (sort_particles_)
+		{
+			particle_depths_.resize(particles_.Size());
+			particle_in_order_.resize(particles_.Size(), 0);
+		}
 
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		gs_support_ = rf.RenderEngineInstance().DeviceCaps().gs_support;
@@ -723,102 +807,185 @@ namespace KlayGE
 
 	void ParticleSystem::ClearParticles()
 	{
-		for (auto& particle : particles_)
-		{
-			particle.life = 0;
-		}
+		std::fill(particles_.life.begin(), particles_.life.end(), 0.0f);
 	}
 
 	void ParticleSystem::UpdateParticlesNoLock(float elapsed_time)
 	{
-		auto emitter_iter = emitters_.begin();
-		uint32_t new_particle = (*emitter_iter)->Update(elapsed_time);
-
 		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 		auto const& camera = *re.DefaultFrameBuffer()->Viewport()->Camera();
 		float4x4 const& view_mat = camera.ViewMatrix();
 
-		actived_particles_.clear();
-
-		float3 min_bb(+1e10f, +1e10f, +1e10f);
-		float3 max_bb(-1e10f, -1e10f, -1e10f);
-
 		for (auto const & updater : updaters_)
 		{
 			updater->SnapParams();
 		}
 
-		for (uint32_t i = 0; i < particles_.size(); ++ i)
+		// Dead particles are reused by the emitters in order. New ones get their first update in this frame too.
+		free_particles_.clear();
+		for (uint32_t i = 0; i < num_particles_; ++ i)
+		{
+			if (particles_.life[i] <= 0)
+			{
+				free_particles_.push_back(i);
+			}
+		}
+		uint32_t num_emitted = 0;
+		for (auto const & emitter : emitters_)
+		{
+			uint32_t const num_new_particles =
+				std::min(emitter->Update(elapsed_time), static_cast<uint32_t>(free_particles_.size()) - num_emitted);
+			emitter->Emit(particles_, std::span<uint32_t const>(free_particles_).subspan(num_emitted, num_new_particles));
+			num_emitted += num_new_particles;
+		}
+
+		// The ranges are always gathered in parallel, but updated in parallel only if every updater allows it
+		bool const parallel_update = std::all_of(updaters_.begin(), updaters_.end(),
+			[](ParticleUpdaterPtr const & updater) { return updater->ThreadSafe(); });
+		if (!parallel_update)
 		{
-			Particle& particle = particles_[i];
+			for (auto const & updater : updaters_)
+			{
+				updater->Update(particles_, 0, particles_.Size(), elapsed_time);
+			}
+		}
 
-			if (particle.life > 0)
+		uint32_t const num_ranges = (particles_.Size() + PARTICLES_PER_TASK - 1) / PARTICLES_PER_TASK;
+		range_actived_particles_.resize(num_ranges);
+		std::vector<AABBox> range_bbs(num_ranges);
+
+		auto update_range = [this, elapsed_time, &view_mat, &range_bbs, parallel_update](uint32_t range_index)
+		{
+			uint32_t const begin = range_index * PARTICLES_PER_TASK;
+			uint32_t const end = std::min(begin + PARTICLES_PER_TASK, particles_.Size());
+			if (parallel_update)
 			{
 				for (auto const & updater : updaters_)
 				{
-					updater->Update(particle, elapsed_time);
+					updater->Update(particles_, begin, end, elapsed_time);
 				}
 			}
-			else
+
+			float4 const z_col = view_mat.Col(2);
+			float4 const w_col = view_mat.Col(3);
+
+			float3 min_bb(+1e10f, +1e10f, +1e10f);
+			float3 max_bb(-1e10f, -1e10f, -1e10f);
+
+			auto& actived_particles = range_actived_particles_[range_index];
+			actived_particles.clear();
+			for (uint32_t i = begin; i < std::min(end, num_particles_); ++ i)
 			{
-				if (new_particle > 0)
+				if (particles_.life[i] > 0)
 				{
-					(*emitter_iter)->Emit(particle);
-					for (auto const & updater : updaters_)
+					float3 const pos(particles_.pos_x[i], particles_.pos_y[i], particles_.pos_z[i]);
+
+					float depth_es;
+					if (sort_particles_)
 					{
-						updater->Update(particle, 0);
+						float4 const pos4(pos.x(), pos.y(), pos.z(), 1);
+						depth_es = MathLib::dot(pos4, z_col) / MathLib::dot(pos4, w_col);
+						particle_depths_[i] = depth_es;
 					}
-					-- new_particle;
-				}
-				else
-				{
-					if (emitter_iter != emitters_.end())
+					else
 					{
-						++ emitter_iter;
-						if (emitter_iter != emitters_.end())
-						{
-							new_particle = (*emitter_iter)->Update(elapsed_time);
-						}
+						depth_es = 0;
 					}
+
+					actived_particles.emplace_back(i, depth_es);
+
+					min_bb = MathLib::minimize(min_bb, pos);
+					max_bb = MathLib::maximize(max_bb, pos);
 				}
 			}
 
-			if (particle.life > 0)
+			range_bbs[range_index] = AABBox(min_bb, max_bb);
+		};
+
+		if (num_ranges > 1)
+		{
+			auto& tp = Context::Instance().ThreadPoolInstance();
+			std::vector<std::future<void>> joiners;
+			for (uint32_t i = 1; i < num_ranges; ++ i)
+			{
+				joiners.push_back(tp.QueueThread([&update_range, i] { update_range(i); }));
+			}
+			update_range(0);
+			for (auto& joiner : joiners)
 			{
-				float3 const & pos = particle.pos;
+				joiner.wait();
+			}
+		}
+		else if (num_ranges == 1)
+		{
+			update_range(0);
+		}
 
-				float depth_es;
-				if (sort_particles_)
-				{
-					float4 const pos4(pos.x(), pos.y(), pos.z(), 1);
-					float4 const z_row = view_mat.Col(2);
-					float4 const w_row = view_mat.Col(3);
+		float3 min_bb(+1e10f, +1e10f, +1e10f);
+		float3 max_bb(-1e10f, -1e10f, -1e10f);
+		for (uint32_t i = 0; i < num_ranges; ++ i)
+		{
+			min_bb = MathLib::minimize(min_bb, range_bbs[i].Min());
+			max_bb = MathLib::maximize(max_bb, range_bbs[i].Max());
+		}
 
-					depth_es = MathLib::dot(pos4, z_row) / MathLib::dot(pos4, w_row);
+		if (sort_particles_)
+		{
+			// Starts from last frame's order, which is nearly sorted when the camera and particles move a little.
+			// Particles still alive keep their place. New ones are sorted on their own and merged in, they would
+			// push the insertion pass of IncrementalSort over its budget.
+			sorted_particles_.clear();
+			new_particles_.clear();
+			for (auto const & par : actived_particles_)
+			{
+				if (particles_.life[par.first] > 0)
+				{
+					sorted_particles_.emplace_back(par.first, particle_depths_[par.first]);
+					particle_in_order_[par.first] = 1;
 				}
-				else
+			}
+			for (uint32_t i = 0; i < num_ranges; ++ i)
+			{
+				for (auto const & par : range_actived_particles_[i])
 				{
-					depth_es = 0;
+					if (particle_in_order_[par.first])
+					{
+						particle_in_order_[par.first] = 0;
+					}
+					else
+					{
+						new_particles_.push_back(par);
+					}
 				}
+			}
 
-				actived_particles_.emplace_back(i, depth_es);
+			// Back to front
+			auto const back_to_front_key = [](std::pair<uint32_t, float> const & par)
+			{
+				return -par.second;
+			};
+			IncrementalSort(std::span(sorted_particles_), sort_scratch_, back_to_front_key);
+			RadixSort(std::span(new_particles_), sort_scratch_, back_to_front_key);
 
-				min_bb = MathLib::minimize(min_bb, pos);
-				max_bb = MathLib::maximize(min_bb, pos);
-			}
+			actived_particles_.resize(sorted_particles_.size() + new_particles_.size());
+			std::merge(sorted_particles_.begin(), sorted_particles_.end(), new_particles_.begin(), new_particles_.end(),
+				actived_particles_.begin(),
+				[](std::pair<uint32_t, float> const & lhs, std::pair<uint32_t, float> const & rhs)
+				{
+					return lhs.second > rhs.second;
+				});
 		}
-
-		if (!actived_particles_.empty())
+		else
 		{
-			if (sort_particles_)
+			actived_particles_.clear();
+			for (uint32_t i = 0; i < num_ranges; ++ i)
 			{
-				std::sort(actived_particles_.begin(), actived_particles_.end(),
-					[](std::pair<uint32_t, float> const & lhs, std::pair<uint32_t, float> const & rhs)
-					{
-						return lhs.second > rhs.second;
-					});
+				actived_particles_.insert(actived_particles_.end(), range_actived_particles_[i].begin(), range_actived_particles_[i].end());
 			}
+		}
 
+		if (!actived_particles_.empty())
+		{
 			checked_cast<RenderParticles&>(*render_particles_).PosBound(AABBox(min_bb, max_bb));
 		}
 	}
@@ -874,13 +1041,19 @@ namespace KlayGE
 				ParticleInstance* instance_data = mapper.Pointer<ParticleInstance>();
 				for (uint32_t i = 0; i < num_active_particles; ++ i, ++ instance_data)
 				{
-					Particle const & par = particles_[actived_particles_[i].first];
-					instance_data->pos = par.pos;
-					instance_data->life = par.life;
-					instance_data->spin = par.spin;
-					instance_data->size = par.size;
-					instance_data->life_factor = (par.init_life - par.life) / par.init_life;
-					instance_data->alpha = par.alpha;
+					// Fills a whole instance at a time. The mapped memory is write-only.
+					uint32_t const index = actived_particles_[i].first;
+					float const life = particles_.life[index];
+					float const init_life = particles_.init_life[index];
+
+					ParticleInstance instance;
+					instance.pos = float3(particles_.pos_x[index], particles_.pos_y[index], particles_.pos_z[index]);
+					instance.life = life;
+					instance.spin = particles_.spin[index];
+					instance.size = particles_.size[index];
+					instance.life_factor = (init_life - life) / init_life;
+					instance.alpha = particles_.alpha[index];
+					*instance_data = instance;
 				}
 			}
 		}
@@ -1083,28 +1256,67 @@ namespace KlayGE
 
 	void PointParticleEmitter::Emit(Particle& par)
 	{
-		par.pos.x() = MathLib::lerp(min_pos_.x(), max_pos_.x(), this->RandomGen());
-		par.pos.y() = MathLib::lerp(min_pos_.y(), max_pos_.y(), this->RandomGen());
-		par.pos.z() = MathLib::lerp(min_pos_.z(), max_pos_.z(), this->RandomGen());
+		this->Emit(par, gen_, random_dis_);
+	}
+
+	void PointParticleEmitter::Emit(ParticleStore& particles, std::span<uint32_t const> indices)
+	{
+		uint32_t const num_particles = static_cast<uint32_t>(indices.size());
+		if (num_particles <= PARTICLES_PER_TASK)
+		{
+			ParticleEmitter::Emit(particles, indices);
+		}
+		else
+		{
+			// Every task has its own generator, seeded from ours, so the results don't depend on the scheduling
+			auto& tp = Context::Instance().ThreadPoolInstance();
+			std::vector<std::future<void>> joiners;
+			for (uint32_t begin = 0; begin < num_particles; begin += PARTICLES_PER_TASK)
+			{
+				uint32_t const end = std::min(begin + PARTICLES_PER_TASK, num_particles);
+				joiners.push_back(tp.QueueThread([this, &particles, indices, begin, end, seed = gen_()]
+					{
+						std::ranlux24_base gen(seed);
+						std::uniform_real_distribution<float> random_dis(0, 1);
+						for (uint32_t i = begin; i < end; ++ i)
+						{
+							Particle par;
+							this->Emit(par, gen, random_dis);
+							particles.Set(indices[i], par);
+						}
+					}));
+			}
+			for (auto& joiner : joiners)
+			{
+				joiner.wait();
+			}
+		}
+	}
+
+	void PointParticleEmitter::Emit(Particle& par, std::ranlux24_base& gen, std::uniform_real_distribution<float>& random_dis)
+	{
+		auto random_gen = [&gen, &random_dis]
+		{
+			return MathLib::clamp(random_dis(gen), 0.0f, 1.0f);
+		};
+
+		par.pos.x() = MathLib::lerp(min_pos_.x(), max_pos_.x(), random_gen());
+		par.pos.y() = MathLib::lerp(min_pos_.y(), max_pos_.y(), random_gen());
+		par.pos.z() = MathLib::lerp(min_pos_.z(), max_pos_.z(), random_gen());
 		par.pos = MathLib::transform_coord(par.pos, model_mat_);
-		float theta = (this->RandomGen() * 2 - 1) * PI;
-		float phi = this->RandomGen() * emit_angle_ / 2;
-		float velocity = MathLib::lerp(min_vel_, max_vel_, this->RandomGen());
+		float theta = (random_gen() * 2 - 1) * PI;
+		float phi = random_gen() * emit_angle_ / 2;
+		float velocity = MathLib::lerp(min_vel_, max_vel_, random_gen());
 		float vx = cos(theta) * sin(phi);
 		float vz = sin(theta) * sin(phi);
 		float vy = cos(phi);
 		par.vel = MathLib::transform_normal(float3(vx, vy, vz) * velocity, model_mat_);
-		par.life = MathLib::lerp(min_life_, max_life_, this->RandomGen());
-		par.spin = MathLib::lerp(min_spin_, max_spin_, this->RandomGen());
-		par.size = MathLib::lerp(min_size_, max_size_, this->RandomGen());
+		par.life = MathLib::lerp(min_life_, max_life_, random_gen());
+		par.spin = MathLib::lerp(min_spin_, max_spin_, random_gen());
+		par.size = MathLib::lerp(min_size_, max_size_, random_gen());
 		par.init_life = par.life;
 	}
 
-	float PointParticleEmitter::RandomGen()
-	{
-		return MathLib::clamp(random_dis_(gen_), 0.0f, 1.0f);
-	}
-
 
 	PolylineParticleUpdater::PolylineParticleUpdater(ParticleSystemPtr const& ps)
 		: ParticleUpdater(ps)
@@ -1182,6 +1394,71 @@ namespace KlayGE
 		par.alpha = cur_alpha;
 	}
 
+	void PolylineParticleUpdater::Update(ParticleStore& particles, uint32_t begin, uint32_t end, float elapse_time)
+	{
+		BOOST_ASSERT(!this_frame_size_over_life_.empty());
+		BOOST_ASSERT(!this_frame_mass_over_life_.empty());
+		BOOST_ASSERT(!this_frame_opacity_over_life_.empty());
+		BOOST_ASSERT((begin % 4 == 0) && (end % 4 == 0));
+
+		ParticleSystemPtr ps = ps_.lock();
+		float const gravity = ps->Gravity();
+		float3 const force = ps->Force();
+		float const buoyancy_scale = 4.0f / 3 * PI * ps->MediaDensity() * gravity;
+
+		SIMDPolyline const size_over_life(this_frame_size_over_life_);
+		SIMDPolyline const mass_over_life(this_frame_mass_over_life_);
+		SIMDPolyline const opacity_over_life(this_frame_opacity_over_life_);
+
+		SIMDVectorF4 const zero = SIMDVectorF4::Zero();
+		for (uint32_t i = begin; i < end; i += 4)
+		{
+			SIMDVectorF4 const life = SIMDMathLib::LoadVector4(&particles.life[i]);
+			SIMDVectorF4 const alive = SIMDMathLib::Greater(life, zero);
+
+			SIMDVectorF4 const init_life = SIMDMathLib::LoadVector4(&particles.init_life[i]);
+			SIMDVectorF4 const pos = (init_life - life) / init_life;
+
+			SIMDVectorF4 const cur_size = size_over_life.Evaluate(pos);
+			SIMDVectorF4 const cur_mass = mass_over_life.Evaluate(pos);
+			SIMDVectorF4 const cur_alpha = opacity_over_life.Evaluate(pos);
+
+			SIMDVectorF4 const buoyancy = cur_size * cur_size * cur_size * buoyancy_scale;
+			SIMDVectorF4 const accel_x = SIMDMathLib::SetVector(force.x()) / cur_mass;
+			SIMDVectorF4 const accel_y = (buoyancy + force.y()) / cur_mass - gravity;
+			SIMDVectorF4 const accel_z = SIMDMathLib::SetVector(force.z()) / cur_mass;
+
+			auto update = [i, &alive](ParticleStore::FloatArray& arr, SIMDVectorF4 const & old_value, SIMDVectorF4 const & new_value)
+			{
+				SIMDMathLib::StoreVector4(&arr[i], SIMDMathLib::Select(alive, new_value, old_value));
+			};
+
+			SIMDVectorF4 const vel_x = SIMDMathLib::LoadVector4(&particles.vel_x[i]);
+			SIMDVectorF4 const vel_y = SIMDMathLib::LoadVector4(&particles.vel_y[i]);
+			SIMDVectorF4 const vel_z = SIMDMathLib::LoadVector4(&particles.vel_z[i]);
+			SIMDVectorF4 const new_vel_x = vel_x + accel_x * elapse_time;
+			SIMDVectorF4 const new_vel_y = vel_y + accel_y * elapse_time;
+			SIMDVectorF4 const new_vel_z = vel_z + accel_z * elapse_time;
+			update(particles.vel_x, vel_x, new_vel_x);
+			update(particles.vel_y, vel_y, new_vel_y);
+			update(particles.vel_z, vel_z, new_vel_z);
+
+			SIMDVectorF4 const pos_x = SIMDMathLib::LoadVector4(&particles.pos_x[i]);
+			SIMDVectorF4 const pos_y = SIMDMathLib::LoadVector4(&particles.pos_y[i]);
+			SIMDVectorF4 const pos_z = SIMDMathLib::LoadVector4(&particles.pos_z[i]);
+			update(particles.pos_x, pos_x, pos_x + new_vel_x * elapse_time);
+			update(particles.pos_y, pos_y, pos_y + new_vel_y * elapse_time);
+			update(particles.pos_z, pos_z, pos_z + new_vel_z * elapse_time);
+
+			update(particles.life, life, life - elapse_time);
+
+			SIMDVectorF4 const spin = SIMDMathLib::LoadVector4(&particles.spin[i]);
+			update(particles.spin, spin, spin + 0.001f);
+			update(particles.size, SIMDMathLib::LoadVector4(&particles.size[i]), cur_size);
+			update(particles.alpha, SIMDMathLib::LoadVector4(&particles.alpha[i]), cur_alpha);
+		}
+	}
+
 	void PolylineParticleUpdater::SnapParams()
 	{
 		std::lock_guard<std::mutex> lock(update_mutex_);
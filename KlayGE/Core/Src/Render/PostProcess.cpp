@@ -183,6 +183,13 @@ namespace
 			return true;
 		}
 
+		size_t Hash() const override
+		{
+			size_t seed = HashValue(pp_desc_.res_name);
+			HashCombine(seed, HashValue(pp_desc_.pp_name));
+			return seed;
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -47,10 +47,15 @@
 #include <KlayGE/KlayGE.hpp>
 
 #include <KFL/CXX20/format.hpp>
+#include <KFL/CXX20/span.hpp>
 #include <KFL/CXX23/utility.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KFL/CustomizedStreamBuf.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Log.hpp>
 #include <KFL/StringUtil.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/Context.hpp>
@@ -58,6 +63,7 @@
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderStateObject.hpp>
 #include <KlayGE/RenderView.hpp>
+#include <KlayGE/ShaderCache.hpp>
 #include <KlayGE/ShaderObject.hpp>
 #include <KlayGE/Texture.hpp>
 #include <KFL/XMLDom.hpp>
@@ -66,9 +72,13 @@
 #ifdef KLAYGE_CXX17_LIBRARY_CHARCONV_SUPPORT
 #include <charconv>
 #endif
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iterator>
 #include <mutex>
 #include <string>
@@ -82,7 +92,7 @@ namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const KFX_VERSION = 0x0151;
+	uint32_t const KFX_VERSION = 0x0152;
 
 #if KLAYGE_IS_DEV_PLATFORM
 	std::unique_ptr<RenderVariable> LoadVariable(
@@ -548,7 +558,7 @@ namespace
 				if (val_in_cbuff != value)
 				{
 					val_in_cbuff = value;
-					cbuff->Dirty(true);
+					cbuff->DirtyRange(cbuff_desc.offset, static_cast<uint32_t>(sizeof(T)));
 				}
 			}
 			else
@@ -1714,7 +1724,10 @@ namespace
 					dst += dst_cbuff_desc.stride;
 				}
 
-				concrete.CBuffer()->Dirty(true);
+				if (size_ > 0)
+				{
+					concrete.CBuffer()->DirtyRange(dst_cbuff_desc.offset, (size_ - 1) * dst_cbuff_desc.stride + static_cast<uint32_t>(sizeof(T)));
+				}
 			}
 			else
 			{
@@ -1745,7 +1758,10 @@ namespace
 					dst += cbuff_desc.stride;
 				}
 
-				this->CBuffer()->Dirty(true);
+				if (size_ > 0)
+				{
+					this->CBuffer()->DirtyRange(cbuff_desc.offset, (size_ - 1) * cbuff_desc.stride + static_cast<uint32_t>(sizeof(T)));
+				}
 			}
 			else
 			{
@@ -1875,7 +1891,10 @@ namespace
 					dst += cbuff_desc.stride;
 				}
 
-				this->CBuffer()->Dirty(true);
+				if (size_ > 0)
+				{
+					this->CBuffer()->DirtyRange(cbuff_desc.offset, (size_ - 1) * cbuff_desc.stride + static_cast<uint32_t>(sizeof(uint32_t)));
+				}
 			}
 			else
 			{
@@ -3000,7 +3019,7 @@ namespace
 
 				memcpy(dst, src, size_ * sizeof(float4x4));
 
-				ret->CBuffer()->Dirty(true);
+				ret->CBuffer()->DirtyRange(dst_cbuff_desc.offset, size_ * static_cast<uint32_t>(sizeof(float4x4)));
 			}
 			else
 			{
@@ -3106,7 +3125,7 @@ namespace
 					++dst;
 				}
 
-				this->CBuffer()->Dirty(true);
+				this->CBuffer()->DirtyRange(cbuff_desc.offset, size_ * static_cast<uint32_t>(sizeof(float4x4)));
 			}
 			else
 			{
@@ -4035,6 +4054,82 @@ namespace
 		ver = ShaderModel(static_cast<uint8_t>(major_ver), static_cast<uint8_t>(minor_ver));
 	}
 #endif
+
+	template <typename T, typename HashFunc>
+	std::vector<std::pair<size_t, uint32_t>> BuildHashIndex(std::span<T const> items, HashFunc const& hash_func)
+	{
+		std::vector<std::pair<size_t, uint32_t>> index(items.size());
+		for (uint32_t i = 0; i < items.size(); ++ i)
+		{
+			index[i] = {hash_func(items[i]), i};
+		}
+		std::sort(index.begin(), index.end());
+		return index;
+	}
+
+	// Returns the first item with the hash, the same one as a linear scan would.
+	// An index that doesn't cover all items yet, when looking up during loading, falls back to the scan.
+	template <typename T, typename HashFunc>
+	T* FindByHash(std::vector<std::pair<size_t, uint32_t>> const& index, std::span<T> items, size_t hash,
+		HashFunc const& hash_func) noexcept
+	{
+		if (index.size() == items.size())
+		{
+			auto const iter = std::lower_bound(index.begin(), index.end(), hash,
+				[](std::pair<size_t, uint32_t> const& lhs, size_t rhs) { return lhs.first < rhs; });
+			if ((iter != index.end()) && (iter->first == hash))
+			{
+				return &items[iter->second];
+			}
+		}
+		else
+		{
+			for (auto& item : items)
+			{
+				if (hash_func(item) == hash)
+				{
+					return &item;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	size_t ParamNameHash(RenderEffectParameter const& param) noexcept
+	{
+		return param.NameHash();
+	}
+
+	size_t ParamSemanticHash(RenderEffectParameter const& param) noexcept
+	{
+		return param.SemanticHash();
+	}
+
+	size_t TechniqueNameHash(RenderTechnique const& tech) noexcept
+	{
+		return tech.NameHash();
+	}
+
+#if KLAYGE_IS_DEV_PLATFORM
+	// What a compiled stage depends on in the descs of a pass. All stages are in, since the GL backends look at them.
+	// The source and macros are added by the stage when it's compiled.
+	std::string ShaderCacheKey(
+		RenderEffect const& effect, std::array<uint32_t, NumShaderStages> const& shader_desc_ids, uint32_t stage_index)
+	{
+		std::string key = std::format("\n{}", stage_index);
+		for (uint32_t const id : shader_desc_ids)
+		{
+			auto const& sd = effect.GetShaderDesc(id);
+			key += std::format("\n{} {}", sd.profile, sd.func_name);
+			for (auto const& decl : sd.so_decl)
+			{
+				key += std::format(" {}.{}.{}.{}.{}", std::to_underlying(decl.usage), decl.usage_index, decl.start_component,
+					decl.component_count, decl.slot);
+			}
+		}
+		return key;
+	}
+#endif
 }
 
 namespace KlayGE
@@ -4106,6 +4201,16 @@ namespace KlayGE
 			return true;
 		}
 
+		size_t Hash() const override
+		{
+			size_t seed = 0;
+			for (auto const & name : effect_desc_.res_name)
+			{
+				HashCombine(seed, HashValue(name));
+			}
+			return seed;
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -4343,28 +4448,6 @@ namespace KlayGE
 
 		immutable_->res_name = (first_fxml_directory / (connected_name + ".fxml")).string();
 		immutable_->res_name_hash = HashValue(immutable_->res_name);
-#if KLAYGE_IS_DEV_PLATFORM
-		for (auto const& name : names)
-		{
-			immutable_->timestamp = 0;
-
-			ResIdentifierPtr source = res_loader.Open(name);
-			if (source)
-			{
-				immutable_->timestamp = std::max(immutable_->timestamp, source->Timestamp());
-
-				XMLNode root = LoadXml(*source);
-
-				std::vector<std::string> include_names;
-				this->RecursiveIncludeNode(root, include_names);
-
-				for (auto const& include_name : include_names)
-				{
-					immutable_->timestamp = std::max(immutable_->timestamp, res_loader.Timestamp(include_name));
-				}
-			}
-		}
-#endif
 
 #if KLAYGE_IS_DEV_PLATFORM
 		immutable_->need_compile = false;
@@ -4382,6 +4465,9 @@ namespace KlayGE
 			immutable_->shader_frags.clear();
 			immutable_->hlsl_shader.clear();
 			immutable_->techniques.clear();
+			immutable_->param_name_index.clear();
+			immutable_->param_semantic_index.clear();
+			immutable_->technique_name_index.clear();
 			immutable_->shader_graph_nodes.clear();
 
 			immutable_->shader_descs.resize(1);
@@ -4414,6 +4500,16 @@ namespace KlayGE
 
 				this->Load(root);
 
+				immutable_->source_timestamps.clear();
+				for (auto const& name : names)
+				{
+					immutable_->source_timestamps.emplace_back(name, res_loader.Timestamp(name));
+				}
+				for (auto const& include_name : include_names)
+				{
+					immutable_->source_timestamps.emplace_back(include_name, res_loader.Timestamp(include_name));
+				}
+
 				immutable_->kfx_name = kfx_name;
 				immutable_->need_compile = true;
 			}
@@ -4426,15 +4522,131 @@ namespace KlayGE
 	{
 		if (immutable_->need_compile)
 		{
+			Timer timer;
+
+			std::vector<ShaderCompileJob> jobs;
 			uint32_t tech_index = 0;
 			for (auto& tech : immutable_->techniques)
 			{
-				tech.CompileShaders(*this, tech_index);
+				tech.CompileShaders(*this, tech_index, jobs);
 				++tech_index;
 			}
 
+			// Domain stages read the tessellation parameters from their hull stages, so they go after all the others
+			auto const domain_iter = std::stable_partition(
+				jobs.begin(), jobs.end(), [](ShaderCompileJob const& job) { return job.stage != ShaderStage::Domain; });
+			uint32_t const num_jobs[] = {static_cast<uint32_t>(domain_iter - jobs.begin()), static_cast<uint32_t>(jobs.end() - domain_iter)};
+
+			// Stages compiled from the same source for the same backend are the same, whichever effect or process compiles them
+			RenderEngine const& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+			std::string const backend_cache_key = std::format(
+				"{:x} {:x} {:x} {}", KFX_VERSION, re.NativeShaderFourCC(), re.NativeShaderVersion(), re.NativeShaderPlatformName());
+			ShaderCache& shader_cache = ShaderCache::Instance();
+
+			uint32_t const num_threads = std::clamp(CpuInfo().NumHWThreads(), 1U, std::max(num_jobs[0], 1U));
+			std::vector<double> job_times(jobs.size());
+			std::atomic<uint32_t> num_cached_jobs(0);
+			uint32_t job_start = 0;
+			for (uint32_t const num_wave_jobs : num_jobs)
+			{
+				std::atomic<uint32_t> next_job(job_start);
+				uint32_t const job_end = job_start + num_wave_jobs;
+				auto worker = [this, &jobs, &job_times, &next_job, job_end, &backend_cache_key, &shader_cache, &num_cached_jobs]
+					{
+						std::vector<uint8_t> cached;
+						std::vector<char> compiled;
+						for (uint32_t i = next_job.fetch_add(1); i < job_end; i = next_job.fetch_add(1))
+						{
+							auto const& job = jobs[i];
+							Timer job_timer;
+							std::string const cache_key =
+								backend_cache_key + job.cache_key + job.stage_obj->SourceCacheKey(*this, *job.tech, *job.pass);
+							if (shader_cache.Load(cache_key, cached))
+							{
+								ResIdentifier res(immutable_->res_name, 0, cached, nullptr);
+								job.stage_obj->StreamIn(*this, *job.shader_desc_ids, res);
+								++num_cached_jobs;
+							}
+							else
+							{
+								job.stage_obj->CompileShader(*this, *job.tech, *job.pass, *job.shader_desc_ids);
+
+								// Failures aren't cached, so their errors show up again
+								if (job.stage_obj->Validate())
+								{
+									compiled.clear();
+									{
+										VectorOutputStreamBuf compiled_buff(compiled);
+										std::ostream os(&compiled_buff);
+										job.stage_obj->StreamOut(os);
+									}
+									shader_cache.Store(cache_key,
+										std::span(reinterpret_cast<uint8_t const*>(compiled.data()), compiled.size()));
+								}
+							}
+							job_times[i] = job_timer.elapsed();
+						}
+					};
+
+				uint32_t const num_wave_threads = std::min(num_threads, num_wave_jobs);
+				std::vector<std::future<void>> joiners(num_wave_threads > 1 ? num_wave_threads - 1 : 0);
+				ThreadPool& tp = Context::Instance().ThreadPoolInstance();
+				for (auto& joiner : joiners)
+				{
+					joiner = tp.QueueThread(worker);
+				}
+				std::exception_ptr worker_exception;
+				try
+				{
+					worker();
+				}
+				catch (...)
+				{
+					worker_exception = std::current_exception();
+				}
+				for (auto& joiner : joiners)
+				{
+					joiner.wait();
+				}
+				if (worker_exception)
+				{
+					std::rethrow_exception(worker_exception);
+				}
+				for (auto& joiner : joiners)
+				{
+					joiner.get();
+				}
+
+				job_start = job_end;
+			}
+
+			// The stages are compiled in any order, but written in the order of techniques and passes
 			std::ofstream ofs(immutable_->kfx_name.c_str(), std::ios_base::binary | std::ios_base::out);
 			this->StreamOut(ofs);
+
+			std::array<double, NumShaderStages> stage_times{};
+			std::array<uint32_t, NumShaderStages> stage_jobs{};
+			for (size_t i = 0; i < jobs.size(); ++i)
+			{
+				uint32_t const stage_index = std::to_underlying(jobs[i].stage);
+				stage_times[stage_index] += job_times[i];
+				++stage_jobs[stage_index];
+			}
+
+			static char const* const stage_names[] = {"VS", "PS", "GS", "CS", "HS", "DS"};
+			static_assert(std::size(stage_names) == NumShaderStages);
+
+			std::string report = std::format("Compiled {} in {:.1f} ms on {} threads, {} unique shader stages, {} from the cache.",
+				immutable_->res_name, timer.elapsed() * 1000, num_threads, jobs.size(), num_cached_jobs.load());
+			for (uint32_t stage_index = 0; stage_index < NumShaderStages; ++stage_index)
+			{
+				if (stage_jobs[stage_index] > 0)
+				{
+					report += std::format(
+						" {}: {} in {:.1f} ms.", stage_names[stage_index], stage_jobs[stage_index], stage_times[stage_index] * 1000);
+				}
+			}
+			LogInfo() << report << std::endl;
 		}
 	}
 #endif
@@ -4512,56 +4724,36 @@ namespace KlayGE
 		return hw_res_ready_;
 	}
 
+	void RenderEffect::BuildParameterIndices()
+	{
+		immutable_->param_name_index = BuildHashIndex(std::span<RenderEffectParameter const>(params_), ParamNameHash);
+		immutable_->param_semantic_index = BuildHashIndex(std::span<RenderEffectParameter const>(params_), ParamSemanticHash);
+	}
+
+	void RenderEffect::BuildTechniqueIndex()
+	{
+		immutable_->technique_name_index =
+			BuildHashIndex(std::span<RenderTechnique const>(immutable_->techniques), TechniqueNameHash);
+	}
+
 	RenderEffectParameter* RenderEffect::ParameterBySemantic(std::string_view semantic) noexcept
 	{
-		size_t const semantic_hash = HashValue(std::move(semantic));
-		for (auto& param : params_)
-		{
-			if (semantic_hash == param.SemanticHash())
-			{
-				return &param;
-			}
-		}
-		return nullptr;
+		return FindByHash(immutable_->param_semantic_index, std::span(params_), HashValue(std::move(semantic)), ParamSemanticHash);
 	}
 
 	RenderEffectParameter const* RenderEffect::ParameterBySemantic(std::string_view semantic) const noexcept
 	{
-		size_t const semantic_hash = HashValue(std::move(semantic));
-		for (auto const& param : params_)
-		{
-			if (semantic_hash == param.SemanticHash())
-			{
-				return &param;
-			}
-		}
-		return nullptr;
+		return FindByHash(immutable_->param_semantic_index, std::span(params_), HashValue(std::move(semantic)), ParamSemanticHash);
 	}
 
 	RenderEffectParameter* RenderEffect::ParameterByName(std::string_view name) noexcept
 	{
-		size_t const name_hash = HashValue(std::move(name));
-		for (auto& param : params_)
-		{
-			if (name_hash == param.NameHash())
-			{
-				return &param;
-			}
-		}
-		return nullptr;
+		return FindByHash(immutable_->param_name_index, std::span(params_), HashValue(std::move(name)), ParamNameHash);
 	}
 
 	RenderEffectParameter const* RenderEffect::ParameterByName(std::string_view name) const noexcept
 	{
-		size_t const name_hash = HashValue(std::move(name));
-		for (auto const& param : params_)
-		{
-			if (name_hash == param.NameHash())
-			{
-				return &param;
-			}
-		}
-		return nullptr;
+		return FindByHash(immutable_->param_name_index, std::span(params_), HashValue(std::move(name)), ParamNameHash);
 	}
 
 	RenderEffectParameter* RenderEffect::ParameterByIndex(uint32_t n) noexcept
@@ -4654,15 +4846,8 @@ namespace KlayGE
 
 	RenderTechnique* RenderEffect::TechniqueByName(std::string_view name) const noexcept
 	{
-		size_t const name_hash = HashValue(std::move(name));
-		for (auto& tech : immutable_->techniques)
-		{
-			if (name_hash == tech.NameHash())
-			{
-				return &tech;
-			}
-		}
-		return nullptr;
+		return FindByHash(immutable_->technique_name_index, std::span(immutable_->techniques), HashValue(std::move(name)),
+			TechniqueNameHash);
 	}
 
 	RenderTechnique* RenderEffect::TechniqueByIndex(uint32_t n) const noexcept
@@ -4755,36 +4940,6 @@ namespace KlayGE
 		}
 	}
 
-	void RenderEffect::RecursiveIncludeNode(XMLNode const& root, std::vector<std::string>& include_names) const
-	{
-		auto& res_loader = Context::Instance().ResLoaderInstance();
-		for (XMLNode const* node = root.FirstNode("include"); node; node = node->NextSibling("include"))
-		{
-			XMLAttribute const* attr = node->Attrib("name");
-			BOOST_ASSERT(attr);
-
-			std::string_view const include_name = attr->ValueString();
-
-			XMLNode include_root = LoadXml(*res_loader.Open(include_name));
-			this->RecursiveIncludeNode(include_root, include_names);
-
-			bool found = false;
-			for (size_t i = 0; i < include_names.size(); ++ i)
-			{
-				if (include_name == include_names[i])
-				{
-					found = true;
-					break;
-				}
-			}
-
-			if (!found)
-			{
-				include_names.emplace_back(include_name);
-			}
-		}
-	}
-
 	XMLNode RenderEffect::ResolveInheritTechNode(XMLNode& root, XMLNode const* tech_node)
 	{
 		auto inherit_attr = tech_node->Attrib("inherit");
@@ -4992,6 +5147,7 @@ namespace KlayGE
 			auto& param = params_.emplace_back();
 			param.Load(*this, node);
 		}
+		this->BuildParameterIndices();
 
 		for (XMLNode const* shader_graph_nodes_node = root.FirstNode("shader_graph_nodes"); shader_graph_nodes_node;
 			 shader_graph_nodes_node = shader_graph_nodes_node->NextSibling("shader_graph_nodes"))
@@ -5036,6 +5192,7 @@ namespace KlayGE
 			auto& tech = immutable_->techniques.emplace_back();
 			tech.Load(*this, *node, index);
 		}
+		this->BuildTechniqueIndex();
 	}
 #endif
 
@@ -5071,12 +5228,23 @@ namespace KlayGE
 			if ((re.NativeShaderFourCC() == shader_fourcc) && (re.NativeShaderVersion() == shader_ver)
 				&& (re.NativeShaderPlatformName() == shader_platform_name))
 			{
-				uint64_t timestamp;
-				source.read(&timestamp, sizeof(timestamp));
+				// Only the timestamps are checked, so an up-to-date .kfx doesn't need any XML parsing
+				bool up_to_date = true;
+				uint16_t num_sources;
+				source.read(&num_sources, sizeof(num_sources));
+				num_sources = LE2Native(num_sources);
+				for (uint32_t i = 0; (i < num_sources) && up_to_date; ++ i)
+				{
+					std::string const source_name = ReadShortString(source);
+					uint64_t timestamp;
+					source.read(&timestamp, sizeof(timestamp));
 #if KLAYGE_IS_DEV_PLATFORM
-				timestamp = LE2Native(timestamp);
-				if (immutable_->timestamp <= timestamp)
+					timestamp = LE2Native(timestamp);
+					up_to_date = (Context::Instance().ResLoaderInstance().Timestamp(source_name) == timestamp);
 #endif
+				}
+
+				if (up_to_date)
 				{
 					immutable_->shader_descs.resize(1);
 
@@ -5124,6 +5292,7 @@ namespace KlayGE
 						{
 							param.StreamIn(*this, source);
 						}
+						this->BuildParameterIndices();
 					}
 					{
 						uint8_t num_shader_graph_nodes;
@@ -5184,6 +5353,7 @@ namespace KlayGE
 						{
 							ret &= immutable_->techniques[i].StreamIn(*this, source, i);
 						}
+						this->BuildTechniqueIndex();
 					}
 				}
 			}
@@ -5213,8 +5383,14 @@ namespace KlayGE
 		os.write(reinterpret_cast<char const *>(&shader_platform_name_len), sizeof(shader_platform_name_len));
 		os.write(&re.NativeShaderPlatformName()[0], shader_platform_name_len);
 
-		uint64_t timestamp = Native2LE(immutable_->timestamp);
-		os.write(reinterpret_cast<char const *>(&timestamp), sizeof(timestamp));
+		uint16_t num_sources = Native2LE(static_cast<uint16_t>(immutable_->source_timestamps.size()));
+		os.write(reinterpret_cast<char const *>(&num_sources), sizeof(num_sources));
+		for (auto const& source_timestamp : immutable_->source_timestamps)
+		{
+			WriteShortString(os, source_timestamp.first);
+			uint64_t timestamp = Native2LE(source_timestamp.second);
+			os.write(reinterpret_cast<char const *>(&timestamp), sizeof(timestamp));
+		}
 
 		{
 			uint16_t num_macros = Native2LE(static_cast<uint16_t>(immutable_->macros.size()));
@@ -5876,7 +6052,7 @@ namespace KlayGE
 		}
 	}
 
-	void RenderTechnique::CompileShaders(RenderEffect& effect, uint32_t tech_index)
+	void RenderTechnique::CompileShaders(RenderEffect& effect, uint32_t tech_index, std::vector<RenderEffect::ShaderCompileJob>& jobs)
 	{
 		RenderEngine& render_eng = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 		const auto& caps = render_eng.DeviceCaps();
@@ -5889,7 +6065,7 @@ namespace KlayGE
 		uint32_t pass_index = 0;
 		for (auto& pass : passes_)
 		{
-			pass->CompileShaders(effect, tech_index, pass_index);
+			pass->CompileShaders(effect, tech_index, pass_index, jobs);
 			++pass_index;
 		}
 	}
@@ -6600,7 +6776,8 @@ namespace KlayGE
 		}
 	}
 
-	void RenderPass::CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index)
+	void RenderPass::CompileShaders(
+		RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, std::vector<RenderEffect::ShaderCompileJob>& jobs)
 	{
 		auto const & shader_obj = this->GetShaderObject(effect);
 		for (uint32_t stage_index = 0; stage_index < NumShaderStages; ++stage_index)
@@ -6609,10 +6786,12 @@ namespace KlayGE
 			if (!sd.func_name.empty())
 			{
 				ShaderStage const stage = static_cast<ShaderStage>(stage_index);
+				// Identical shader descs are merged when loading. Only the pass that added one compiles it, the others share the stage.
 				if (sd.tech_pass_type == (tech_index << 16) + (pass_index << 8) + stage_index)
 				{
-					auto const & tech = *effect.TechniqueByIndex(tech_index);
-					shader_obj->Stage(stage)->CompileShader(effect, tech, *this, shader_desc_ids_);
+					auto const& tech = *effect.TechniqueByIndex(tech_index);
+					jobs.push_back({&tech, this, stage, shader_obj->Stage(stage).get(), &shader_desc_ids_,
+						ShaderCacheKey(effect, shader_desc_ids_, stage_index)});
 				}
 			}
 		}
@@ -6893,6 +7072,7 @@ namespace KlayGE
 
 	RenderEffectConstantBuffer::RenderEffectConstantBuffer(RenderEffect& effect) : effect_(effect)
 	{
+		this->Dirty(true);
 	}
 
 #if KLAYGE_IS_DEV_PLATFORM
@@ -7031,16 +7211,141 @@ namespace KlayGE
 			}
 		}
 
-		dirty_ = true;
+		this->Dirty(true);
+	}
+
+	void RenderEffectConstantBuffer::Dirty(bool dirty) noexcept
+	{
+		if (dirty)
+		{
+			// The end is clamped to the size in Update, so it's still the whole buffer after a resize
+			dirty_ranges_[0] = {0, 0xFFFFFFFFU};
+			num_dirty_ranges_ = 1;
+		}
+		else
+		{
+			num_dirty_ranges_ = 0;
+		}
+	}
+
+	void RenderEffectConstantBuffer::DirtyRange(uint32_t offset, uint32_t size) noexcept
+	{
+		if (size == 0)
+		{
+			return;
+		}
+
+		ByteRange range{offset, offset + size};
+
+		// Ranges in [first, last) overlap or touch the new one, and are merged into it
+		uint32_t first = 0;
+		while ((first < num_dirty_ranges_) && (dirty_ranges_[first].end < range.begin))
+		{
+			++ first;
+		}
+		uint32_t last = first;
+		while ((last < num_dirty_ranges_) && (dirty_ranges_[last].begin <= range.end))
+		{
+			range.begin = std::min(range.begin, dirty_ranges_[last].begin);
+			range.end = std::max(range.end, dirty_ranges_[last].end);
+			++ last;
+		}
+
+		if (first == last)
+		{
+			if (num_dirty_ranges_ == MAX_DIRTY_RANGES)
+			{
+				range.begin = std::min(range.begin, dirty_ranges_[0].begin);
+				range.end = std::max(range.end, dirty_ranges_[num_dirty_ranges_ - 1].end);
+				first = 0;
+				num_dirty_ranges_ = 1;
+			}
+			else
+			{
+				for (uint32_t i = num_dirty_ranges_; i > first; -- i)
+				{
+					dirty_ranges_[i] = dirty_ranges_[i - 1];
+				}
+				++ num_dirty_ranges_;
+			}
+		}
+		else
+		{
+			uint32_t const num_removed = last - first - 1;
+			for (uint32_t i = last; i < num_dirty_ranges_; ++ i)
+			{
+				dirty_ranges_[i - num_removed] = dirty_ranges_[i];
+			}
+			num_dirty_ranges_ -= num_removed;
+		}
+		dirty_ranges_[first] = range;
 	}
 
 	void RenderEffectConstantBuffer::Update()
 	{
-		if (dirty_)
+		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+
+		if (auto* ring = re.CBufferRing(); ring && !buff_.empty())
 		{
-			hw_buff_->UpdateSubresource(0, static_cast<uint32_t>(buff_.size()), &buff_[0]);
+			uint32_t const frame_id = ring->FrameId();
+			// Once the ring is full, the HW buffer is used for the rest of the frame
+			if ((ring_frame_id_ != frame_id) || (bound_buff_ != hw_buff_))
+			{
+				bool const in_ring = (ring_frame_id_ == frame_id) && (bound_buff_ == ring->GetBuffer());
+				if (in_ring && !this->Dirty())
+				{
+					return;
+				}
+
+				// A new version is made at most once per frame, unless the contents change
+				uint32_t offset;
+				if (ring->Alloc(static_cast<uint32_t>(buff_.size()), &buff_[0], offset))
+				{
+					bound_buff_ = ring->GetBuffer();
+					bound_offset_ = offset;
+					ring_frame_id_ = frame_id;
+					this->Dirty(false);
+					return;
+				}
+
+				// The HW buffer isn't up to date if the contents were in the ring
+				if (bound_buff_ != hw_buff_)
+				{
+					this->Dirty(true);
+				}
+				ring_frame_id_ = frame_id;
+			}
+		}
+
+		if (bound_buff_ != hw_buff_)
+		{
+			bound_buff_ = hw_buff_;
+			bound_offset_ = 0;
+		}
+
+		if (this->Dirty())
+		{
+			uint32_t const size = static_cast<uint32_t>(buff_.size());
+			if (re.DeviceCaps().partial_cbuffer_update_support)
+			{
+				for (uint32_t i = 0; i < num_dirty_ranges_; ++ i)
+				{
+					uint32_t const begin = dirty_ranges_[i].begin;
+					uint32_t const end = std::min(dirty_ranges_[i].end, size);
+					if (end > begin)
+					{
+						hw_buff_->UpdateSubresource(begin, end - begin, &buff_[begin]);
+						re.CBufferUploaded(end - begin);
+					}
+				}
+			}
+			else
+			{
+				hw_buff_->UpdateSubresource(0, size, &buff_[0]);
+				re.CBufferUploaded(size);
+			}
 
-			dirty_ = false;
+			this->Dirty(false);
 		}
 	}
 
@@ -118,6 +118,10 @@ namespace KlayGE
 
 	void RenderEngine::EndFrame()
 	{
+		if (cbuffer_ring_)
+		{
+			cbuffer_ring_->OnPresent();
+		}
 	}
 
 	// Ⱦ
@@ -450,6 +454,12 @@ namespace KlayGE
 		this->PaperWhiteNits(settings.paper_white);
 		this->DisplayMaxLuminanceNits(settings.display_max_luminance);
 
+		if (settings.cbuffer_upload_ring && (caps.cbuffer_offset_alignment > 0))
+		{
+			// Room for the constant buffers of the frames in flight
+			cbuffer_ring_ = MakeUniquePtr<ConstantBufferRing>(8 * 1024 * 1024, caps.cbuffer_offset_alignment);
+		}
+
 #ifndef KLAYGE_SHIP
 		PerfProfiler& profiler = context.PerfProfilerInstance();
 		hdr_pp_perf_ = profiler.CreatePerfRegion(0, "HDR PP");
@@ -458,6 +468,9 @@ namespace KlayGE
 		resize_pp_perf_ = profiler.CreatePerfRegion(0, "Resize PP");
 		hdr_display_pp_perf_ = profiler.CreatePerfRegion(0, "HDR display PP");
 		stereoscopic_pp_perf_ = profiler.CreatePerfRegion(0, "Stereoscopic PP");
+
+		cbuffer_upload_bytes_perf_ = profiler.CreatePerfCounter(0, "CBuffer upload bytes");
+		cbuffer_uploads_perf_ = profiler.CreatePerfCounter(0, "CBuffer uploads");
 #endif
 	}
 
@@ -485,6 +498,8 @@ namespace KlayGE
 		skip_hdr_pp_.reset();
 		hdr_pp_.reset();
 
+		cbuffer_ring_.reset();
+
 		screen_frame_buffer_.reset();
 		overlay_frame_buffer_.reset();
 		mono_frame_buffer_.reset();
@@ -1420,6 +1435,8 @@ namespace KlayGE
 
 		mipmapper_.reset();
 
+		cbuffer_ring_.reset();
+
 		cur_frame_buffer_.reset();
 		screen_frame_buffer_.reset();
 		ds_tex_.reset();
@@ -351,6 +351,11 @@ namespace
 			return true;
 		}
 
+		size_t Hash() const override
+		{
+			return HashValue(mtl_desc_.res_name);
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -0,0 +1,253 @@
+/**
+ * @file ShaderCache.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX20/format.hpp>
+#include <KFL/Hash.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/ResLoader.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+
+#include <KlayGE/ShaderCache.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t constexpr SHADER_CACHE_VERSION = 1;
+
+	// A temporary file that old was left by a process that died while writing it
+	auto constexpr STALE_TEMP_AGE = std::chrono::hours(1);
+
+	bool ReadUInt32(std::istream& is, uint32_t& value)
+	{
+		is.read(reinterpret_cast<char*>(&value), sizeof(value));
+		value = LE2Native(value);
+		return static_cast<bool>(is);
+	}
+
+	void WriteUInt32(std::ostream& os, uint32_t value)
+	{
+		value = Native2LE(value);
+		os.write(reinterpret_cast<char const*>(&value), sizeof(value));
+	}
+} // namespace
+
+namespace KlayGE
+{
+	ShaderCache::ShaderCache(std::string_view dir, uint64_t max_size)
+		: dir_(dir), max_size_(max_size), temp_tag_(std::random_device()())
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(dir_, ec);
+
+		this->Trim();
+	}
+
+	ShaderCache& ShaderCache::Instance()
+	{
+		static ShaderCache cache(Context::Instance().ResLoaderInstance().LocalFolder() + "ShaderCache", 256 * 1024 * 1024);
+		return cache;
+	}
+
+	bool ShaderCache::Load(std::string_view key, std::vector<uint8_t>& data)
+	{
+		std::filesystem::path const path = this->EntryPath(key);
+
+		bool hit = false;
+		std::ifstream file(path, std::ios_base::binary);
+		uint32_t fourcc;
+		uint32_t ver;
+		uint32_t key_len;
+		if (ReadUInt32(file, fourcc) && (MakeFourCC<'K', 'S', 'H', 'C'>::value == fourcc) && ReadUInt32(file, ver)
+			&& (SHADER_CACHE_VERSION == ver) && ReadUInt32(file, key_len) && (key.size() == key_len))
+		{
+			std::string stored_key(key_len, '\0');
+			file.read(stored_key.data(), key_len);
+			uint32_t data_len;
+			if (file && (stored_key == key) && ReadUInt32(file, data_len))
+			{
+				// A damaged entry can claim any length. It has to be what's left of the file before anything is allocated.
+				std::streamoff const data_pos = file.tellg();
+				file.seekg(0, std::ios_base::end);
+				std::streamoff const data_end = file.tellg();
+				file.seekg(data_pos);
+				if (file && (data_end - data_pos == static_cast<std::streamoff>(data_len)))
+				{
+					data.resize(data_len);
+					file.read(reinterpret_cast<char*>(data.data()), data_len);
+					hit = file && (file.gcount() == static_cast<std::streamsize>(data_len));
+				}
+			}
+		}
+
+		if (hit)
+		{
+			++num_hits_;
+
+			// The modification time is the last use, for the eviction
+			std::error_code ec;
+			std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+		}
+		else
+		{
+			++num_misses_;
+		}
+		return hit;
+	}
+
+	void ShaderCache::Store(std::string_view key, std::span<uint8_t const> data)
+	{
+		std::filesystem::path const path = this->EntryPath(key);
+		std::filesystem::path temp_path = path;
+		temp_path += std::format(".{:08x}{:08x}.tmp", temp_tag_, next_temp_id_.fetch_add(1));
+
+		std::error_code ec;
+		{
+			std::ofstream file(temp_path, std::ios_base::binary);
+			WriteUInt32(file, MakeFourCC<'K', 'S', 'H', 'C'>::value);
+			WriteUInt32(file, SHADER_CACHE_VERSION);
+			WriteUInt32(file, static_cast<uint32_t>(key.size()));
+			file.write(key.data(), key.size());
+			WriteUInt32(file, static_cast<uint32_t>(data.size()));
+			file.write(reinterpret_cast<char const*>(data.data()), data.size());
+			file.close();
+			if (!file)
+			{
+				std::filesystem::remove(temp_path, ec);
+				return;
+			}
+		}
+
+		// Fails if another process is reading the file on some platforms. What it reads is as good as this one.
+		std::filesystem::rename(temp_path, path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(temp_path, ec);
+			return;
+		}
+
+		++num_stores_;
+
+		uint64_t const size = 4 * sizeof(uint32_t) + key.size() + data.size();
+		if (stored_size_since_trim_.fetch_add(size) + size > max_size_ / 8)
+		{
+			this->Trim();
+		}
+	}
+
+	void ShaderCache::Trim()
+	{
+		std::lock_guard<std::mutex> lock(trim_mutex_);
+
+		stored_size_since_trim_ = 0;
+
+		struct Entry
+		{
+			std::filesystem::file_time_type time;
+			uint64_t size;
+			std::filesystem::path path;
+		};
+		std::vector<Entry> entries;
+		uint64_t total_size = 0;
+
+		// Other processes add and remove files meanwhile, so errors on single files are skipped
+		auto const now = std::filesystem::file_time_type::clock::now();
+		std::error_code ec;
+		for (std::filesystem::directory_iterator iter(dir_, ec), end; !ec && (iter != end); iter.increment(ec))
+		{
+			std::error_code entry_ec;
+			auto const time = iter->last_write_time(entry_ec);
+			uint64_t const size = entry_ec ? 0 : iter->file_size(entry_ec);
+			if (entry_ec)
+			{
+				continue;
+			}
+
+			auto const ext = iter->path().extension();
+			if (ext == ".tmp")
+			{
+				if (now - time > STALE_TEMP_AGE)
+				{
+					std::filesystem::remove(iter->path(), entry_ec);
+				}
+			}
+			else if (ext == ".kshc")
+			{
+				entries.push_back({time, size, iter->path()});
+				total_size += size;
+			}
+		}
+
+		if (total_size > max_size_)
+		{
+			std::sort(entries.begin(), entries.end(), [](Entry const& lhs, Entry const& rhs) { return lhs.time < rhs.time; });
+
+			// Leaves some room, so the next stores don't trim again right away
+			uint64_t const target_size = max_size_ / 4 * 3;
+			for (auto const& entry : entries)
+			{
+				if (total_size <= target_size)
+				{
+					break;
+				}
+
+				if (std::filesystem::remove(entry.path, ec))
+				{
+					++num_evictions_;
+				}
+				total_size -= entry.size;
+			}
+		}
+	}
+
+	ShaderCache::Stats ShaderCache::GetStats() const noexcept
+	{
+		return Stats{num_hits_, num_misses_, num_stores_, num_evictions_};
+	}
+
+	void ShaderCache::ResetStats() noexcept
+	{
+		num_hits_ = 0;
+		num_misses_ = 0;
+		num_stores_ = 0;
+		num_evictions_ = 0;
+	}
+
+	std::filesystem::path ShaderCache::EntryPath(std::string_view key) const
+	{
+		return dir_ / std::format("{:016x}.kshc", static_cast<uint64_t>(HashValue(key)));
+	}
+} // namespace KlayGE
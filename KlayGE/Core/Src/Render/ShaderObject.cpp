@@ -29,10 +29,12 @@
  */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX20/format.hpp>
 #include <KFL/CXX23/utility.hpp>
 #include <KFL/CustomizedStreamBuf.hpp>
 #include <KFL/DllLoader.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KFL/Hash.hpp>
 #include <KFL/com_ptr.hpp>
 #include <KFL/Log.hpp>
 #include <KFL/Util.hpp>
@@ -42,9 +44,11 @@
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/ResLoader.hpp>
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <fstream>
 
@@ -72,6 +76,7 @@ typedef char const * LPCSTR;
 typedef long HRESULT;
 
 #define S_OK                                        0x00000000
+#define E_NOTIMPL                                   static_cast<HRESULT>(0x80004001L)
 
 #define D3DCOMPILE_DEBUG                            0x00000001
 #define D3DCOMPILE_SKIP_VALIDATION                  0x00000002
@@ -151,7 +156,9 @@ namespace
 			}
 			return hr;
 #else
-			std::string mark = std::to_string(reinterpret_cast<uint64_t>(src_data.c_str()));
+			// Stages of an effect are compiled in parallel, from the same source and often with the same entry point
+			static std::atomic<uint32_t> next_compile_id(0);
+			std::string mark = std::to_string(next_compile_id.fetch_add(1));
 			std::string compile_input_file = entry_point + mark + "Input.tmp";
 			std::string compile_output_file = entry_point + mark + "Output.tmp";
 
@@ -189,15 +196,13 @@ namespace
 #ifdef KLAYGE_PLATFORM_WINDOWS
 			ss << d3dcompiler_wrapper_name << ".exe";
 #else
-			static bool first = true;
-			if (first)
-			{
-				ss << KFL_STRINGIZE(WINE_PATH) << "wineserver -p";
-				[[maybe_unused]] int err = system(ss.str().c_str());
-				// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
-				first = false;
-				ss.str(std::string());
-			}
+			static std::once_flag wineserver_flag;
+			std::call_once(wineserver_flag, []
+				{
+					// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
+					std::string const cmd = std::string(KFL_STRINGIZE(WINE_PATH)) + "wineserver -p";
+					[[maybe_unused]] int err = system(cmd.c_str());
+				});
 			d3dcompiler_wrapper_name += ".exe.so";
 			std::string wrapper_path = Context::Instance().ResLoaderInstance().Locate(d3dcompiler_wrapper_name);
 			ss << KFL_STRINGIZE(WINE_PATH) << "wine " << wrapper_path;
@@ -248,6 +253,37 @@ namespace
 #endif
 		}
 
+		HRESULT D3DPreprocess(std::string const & src_data, D3D_SHADER_MACRO const * defines, std::string& preprocessed) const
+		{
+#ifdef CALL_D3DCOMPILER_DIRECTLY
+			if (DynamicD3DPreprocess_ == nullptr)
+			{
+				return E_NOTIMPL;
+			}
+
+			com_ptr<ID3DBlob> text_blob;
+			com_ptr<ID3DBlob> error_msgs_blob;
+			HRESULT hr = DynamicD3DPreprocess_(src_data.c_str(), static_cast<UINT>(src_data.size()),
+				nullptr, defines, nullptr, text_blob.put(), error_msgs_blob.put());
+			if (text_blob)
+			{
+				char const * p = static_cast<char const *>(text_blob->GetBufferPointer());
+				preprocessed.assign(p, p + text_blob->GetBufferSize());
+			}
+			else
+			{
+				preprocessed.clear();
+			}
+			return hr;
+#else
+			// The wrapper only compiles
+			KFL_UNUSED(src_data);
+			KFL_UNUSED(defines);
+			preprocessed.clear();
+			return E_NOTIMPL;
+#endif
+		}
+
 		HRESULT D3DReflect(std::vector<uint8_t> const & shader_code, void** reflector)
 		{
 #ifdef CALL_D3DCOMPILER_DIRECTLY
@@ -289,6 +325,7 @@ namespace
 			mod_d3dcompiler_.Load("d3dcompiler_47.dll");
 
 			DynamicD3DCompile_ = reinterpret_cast<D3DCompileFunc>(mod_d3dcompiler_.GetProcAddress("D3DCompile"));
+			DynamicD3DPreprocess_ = reinterpret_cast<D3DPreprocessFunc>(mod_d3dcompiler_.GetProcAddress("D3DPreprocess"));
 			DynamicD3DReflect_ = reinterpret_cast<D3DReflectFunc>(mod_d3dcompiler_.GetProcAddress("D3DReflect"));
 			DynamicD3DStripShader_ = reinterpret_cast<D3DStripShaderFunc>(mod_d3dcompiler_.GetProcAddress("D3DStripShader"));
 #endif
@@ -299,84 +336,58 @@ namespace
 		typedef HRESULT (WINAPI *D3DCompileFunc)(LPCVOID pSrcData, SIZE_T SrcDataSize, LPCSTR pSourceName,
 			D3D_SHADER_MACRO const * pDefines, ID3DInclude* pInclude, LPCSTR pEntrypoint,
 			LPCSTR pTarget, UINT Flags1, UINT Flags2, ID3DBlob** ppCode, ID3DBlob** ppErrorMsgs);
+		typedef HRESULT (WINAPI *D3DPreprocessFunc)(LPCVOID pSrcData, SIZE_T SrcDataSize, LPCSTR pSourceName,
+			D3D_SHADER_MACRO const * pDefines, ID3DInclude* pInclude, ID3DBlob** ppCodeText, ID3DBlob** ppErrorMsgs);
 		typedef HRESULT (WINAPI *D3DReflectFunc)(LPCVOID pSrcData, SIZE_T SrcDataSize, REFIID pInterface, void** ppReflector);
 		typedef HRESULT (WINAPI *D3DStripShaderFunc)(LPCVOID pShaderBytecode, SIZE_T BytecodeLength, UINT uStripFlags,
 			ID3DBlob** ppStrippedBlob);
 
 		DllLoader mod_d3dcompiler_;
 		D3DCompileFunc DynamicD3DCompile_;
+		D3DPreprocessFunc DynamicD3DPreprocess_;
 		D3DReflectFunc DynamicD3DReflect_;
 		D3DStripShaderFunc DynamicD3DStripShader_;
 #endif
 	};
-}
 
-#endif
-
-namespace KlayGE
-{
-	ShaderStageObject::ShaderStageObject(ShaderStage stage) noexcept : stage_(stage)
-	{
-	}
-
-	ShaderStageObject::~ShaderStageObject() noexcept = default;
-
-#if KLAYGE_IS_DEV_PLATFORM
-	std::vector<uint8_t> ShaderStageObject::CompileToDXBC(ShaderStage stage, RenderEffect const& effect, RenderTechnique const& tech,
-		RenderPass const& pass, std::vector<std::pair<char const*, char const*>> const& api_special_macros, char const* func_name,
-		char const* shader_profile, uint32_t flags, void** reflector, bool strip)
+	// Every macro a stage is compiled with, in the order D3DCompile gets them
+	std::vector<std::pair<std::string, std::string>> StageMacros(ShaderStage stage, RenderTechnique const& tech,
+		RenderPass const& pass, std::vector<std::pair<char const*, char const*>> const& api_special_macros)
 	{
 		RenderEngine const & re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 		RenderDeviceCaps const & caps = re.DeviceCaps();
 
-		std::vector<uint8_t> code;
-
-		std::string const & hlsl_shader_text = effect.HLSLShaderText();
-
-		std::string max_sm_str = std::to_string(caps.max_shader_model.FullVersion());
-		std::string max_tex_array_str = std::to_string(caps.max_texture_array_length);
-		std::string max_tex_depth_str = std::to_string(caps.max_texture_depth);
-		std::string max_tex_units_str = std::to_string(static_cast<int>(caps.max_pixel_texture_units));
-		std::string flipping_str = std::to_string(re.RequiresFlipping() ? -1 : +1);
-		std::string render_to_tex_array_str = std::to_string(caps.render_to_texture_array_support ? 1 : 0);
+		std::vector<std::pair<std::string, std::string>> macros(api_special_macros.begin(), api_special_macros.end());
 
-		std::string err_msg;
-		std::vector<D3D_SHADER_MACRO> macros;
-
-		for (uint32_t i = 0; i < api_special_macros.size(); ++i)
-		{
-			macros.emplace_back(D3D_SHADER_MACRO{api_special_macros[i].first, api_special_macros[i].second});
-		}
-
-		macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_SHADER_MODEL", max_sm_str.c_str()});
-		macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_MAX_TEX_ARRAY_LEN", max_tex_array_str.c_str()});
-		macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_MAX_TEX_DEPTH", max_tex_depth_str.c_str()});
-		macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_MAX_TEX_UNITS", max_tex_units_str.c_str()});
-		macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_FLIPPING", flipping_str.c_str()});
-		macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_RENDER_TO_TEX_ARRAY", render_to_tex_array_str.c_str()});
+		macros.emplace_back("KLAYGE_SHADER_MODEL", std::to_string(caps.max_shader_model.FullVersion()));
+		macros.emplace_back("KLAYGE_MAX_TEX_ARRAY_LEN", std::to_string(caps.max_texture_array_length));
+		macros.emplace_back("KLAYGE_MAX_TEX_DEPTH", std::to_string(caps.max_texture_depth));
+		macros.emplace_back("KLAYGE_MAX_TEX_UNITS", std::to_string(static_cast<int>(caps.max_pixel_texture_units)));
+		macros.emplace_back("KLAYGE_FLIPPING", std::to_string(re.RequiresFlipping() ? -1 : +1));
+		macros.emplace_back("KLAYGE_RENDER_TO_TEX_ARRAY", std::to_string(caps.render_to_texture_array_support ? 1 : 0));
 		if (!caps.fp_color_support)
 		{
-			macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_NO_FP_COLOR", "1"});
+			macros.emplace_back("KLAYGE_NO_FP_COLOR", "1");
 		}
 		if (caps.pack_to_rgba_required)
 		{
-			macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_PACK_TO_RGBA", "1"});
+			macros.emplace_back("KLAYGE_PACK_TO_RGBA", "1");
 		}
 		if (caps.UavFormatSupport(EF_ABGR16F))
 		{
-			macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_TYPED_UAV_SUPPORT", "1"});
+			macros.emplace_back("KLAYGE_TYPED_UAV_SUPPORT", "1");
 		}
 		if (caps.uavs_at_every_stage_support)
 		{
-			macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_UAVS_AT_EVERY_STAGE_SUPPORT", "1"});
+			macros.emplace_back("KLAYGE_UAVS_AT_EVERY_STAGE_SUPPORT", "1");
 		}
 		if (caps.explicit_multi_sample_support)
 		{
-			macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_EXPLICIT_MULTI_SAMPLE_SUPPORT", "1"});
+			macros.emplace_back("KLAYGE_EXPLICIT_MULTI_SAMPLE_SUPPORT", "1");
 		}
 		if (caps.vp_rt_index_at_every_stage_support)
 		{
-			macros.emplace_back(D3D_SHADER_MACRO{"KLAYGE_VP_RT_INDEX_AT_EVERY_STAGE_SUPPORT", "1"});
+			macros.emplace_back("KLAYGE_VP_RT_INDEX_AT_EVERY_STAGE_SUPPORT", "1");
 		}
 		{
 			char const* type_name;
@@ -409,22 +420,57 @@ namespace KlayGE
 			default:
 				KFL_UNREACHABLE("Invalid shader stage");
 			}
-			macros.emplace_back(D3D_SHADER_MACRO{type_name, "1"});
+			macros.emplace_back(type_name, "1");
 		}
 
 		for (uint32_t i = 0; i < tech.NumMacros(); ++i)
 		{
-			std::pair<std::string, std::string> const & name_value = tech.MacroByIndex(i);
-			macros.emplace_back(D3D_SHADER_MACRO{name_value.first.c_str(), name_value.second.c_str()});
+			macros.push_back(tech.MacroByIndex(i));
 		}
 
 		for (uint32_t i = 0; i < pass.NumMacros(); ++i)
 		{
-			std::pair<std::string, std::string> const & name_value = pass.MacroByIndex(i);
-			macros.emplace_back(D3D_SHADER_MACRO{name_value.first.c_str(), name_value.second.c_str()});
+			macros.push_back(pass.MacroByIndex(i));
+		}
+
+		return macros;
+	}
+
+	std::vector<D3D_SHADER_MACRO> ToD3DShaderMacros(std::vector<std::pair<std::string, std::string>> const& macros)
+	{
+		std::vector<D3D_SHADER_MACRO> d3d_macros;
+		d3d_macros.reserve(macros.size() + 1);
+		for (auto const& name_value : macros)
+		{
+			d3d_macros.emplace_back(D3D_SHADER_MACRO{name_value.first.c_str(), name_value.second.c_str()});
 		}
+		d3d_macros.emplace_back(D3D_SHADER_MACRO{nullptr, nullptr});
+		return d3d_macros;
+	}
+}
+
+#endif
+
+namespace KlayGE
+{
+	ShaderStageObject::ShaderStageObject(ShaderStage stage) noexcept : stage_(stage)
+	{
+	}
+
+	ShaderStageObject::~ShaderStageObject() noexcept = default;
 
-		macros.emplace_back(D3D_SHADER_MACRO{nullptr, nullptr});
+#if KLAYGE_IS_DEV_PLATFORM
+	std::vector<uint8_t> ShaderStageObject::CompileToDXBC(ShaderStage stage, RenderEffect const& effect, RenderTechnique const& tech,
+		RenderPass const& pass, std::vector<std::pair<char const*, char const*>> const& api_special_macros, char const* func_name,
+		char const* shader_profile, uint32_t flags, void** reflector, bool strip)
+	{
+		std::vector<uint8_t> code;
+
+		std::string const & hlsl_shader_text = effect.HLSLShaderText();
+
+		std::string err_msg;
+		auto const macro_strs = StageMacros(stage, tech, pass, api_special_macros);
+		std::vector<D3D_SHADER_MACRO> const macros = ToD3DShaderMacros(macro_strs);
 
 		D3DCompilerLoader::Instance().D3DCompile(hlsl_shader_text, &macros[0],
 			func_name, shader_profile,
@@ -546,6 +592,30 @@ namespace KlayGE
 
 		return code;
 	}
+
+	std::string ShaderStageObject::SourceCacheKey(RenderEffect const& effect, RenderTechnique const& tech, RenderPass const& pass) const
+	{
+		auto const macro_strs = StageMacros(stage_, tech, pass, this->ApiSpecialMacros());
+		std::vector<D3D_SHADER_MACRO> const macros = ToD3DShaderMacros(macro_strs);
+
+		std::string key;
+		for (auto const& name_value : macro_strs)
+		{
+			key += std::format("\n{}={}", name_value.first, name_value.second);
+		}
+
+		// Only the code left for this stage after preprocessing goes in, so editing one shader doesn't miss the others.
+		// Without a preprocessor, it's the whole effect's source.
+		std::string preprocessed;
+		std::string_view source = effect.HLSLShaderText();
+		if (D3DCompilerLoader::Instance().D3DPreprocess(effect.HLSLShaderText(), &macros[0], preprocessed) == S_OK)
+		{
+			source = preprocessed;
+		}
+		key += std::format("\n{:016x}", static_cast<uint64_t>(HashValue(source)));
+
+		return key;
+	}
 #endif
 
 
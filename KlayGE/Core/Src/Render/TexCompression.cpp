@@ -33,11 +33,24 @@
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/Texture.hpp>
 
+#include <KFL/CpuInfo.hpp>
+#include <KFL/Thread.hpp>
+
+#include <atomic>
 #include <vector>
 #include <cstring>
 
 #include <KlayGE/TexCompression.hpp>
 
+namespace
+{
+	// Splitting into more bands than workers keeps the load balanced when block costs vary a lot, like in BC7.
+	uint32_t const BANDS_PER_THREAD = 4;
+
+	// Number of horizontally adjacent blocks gathered before one EncodeBlocks call.
+	uint32_t const ENCODE_BATCH_BLOCKS = 8;
+}
+
 namespace KlayGE
 {
 	uint32_t BlockWidth(ElementFormat format)
@@ -278,62 +291,223 @@ namespace KlayGE
 	TexCompression::TexCompression() noexcept = default;
 	TexCompression::~TexCompression() noexcept = default;
 
+	void TexCompression::EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method)
+	{
+		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
+		uint32_t const uncompressed_block_size = BlockWidth(compression_format_) * BlockHeight(compression_format_) * elem_size;
+		uint32_t const block_bytes = BlockBytes(compression_format_);
+
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		for (uint32_t i = 0; i < num_blocks; ++ i)
+		{
+			this->EncodeBlock(dst, src, method);
+			dst += block_bytes;
+			src += uncompressed_block_size;
+		}
+	}
+
 	void TexCompression::EncodeMem(uint32_t width, uint32_t height,
+		void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+		void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+		TexCompressionMethod method)
+	{
+		this->EncodeMemParallel(width, height, output, out_row_pitch, out_slice_pitch, input, in_row_pitch, in_slice_pitch, method,
+			Context::Instance().ThreadPoolInstance(), CpuInfo().NumHWThreads());
+	}
+
+	void TexCompression::DecodeMem(uint32_t width, uint32_t height,
+		void* output, uint32_t out_row_pitch, [[maybe_unused]] uint32_t out_slice_pitch,
+		void const * input, uint32_t in_row_pitch, [[maybe_unused]] uint32_t in_slice_pitch)
+	{
+		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
+		uint32_t const block_width = BlockWidth(compression_format_);
+		uint32_t const block_height = BlockHeight(compression_format_);
+
+		std::vector<uint8_t> uncompressed(block_width * block_height * elem_size);
+		this->DecodeRows(width, height, 0, height, output, out_row_pitch, input, in_row_pitch, uncompressed);
+	}
+
+	void TexCompression::EncodeMemParallel(uint32_t width, uint32_t height,
 		void* output, uint32_t out_row_pitch, [[maybe_unused]] uint32_t out_slice_pitch,
 		void const * input, uint32_t in_row_pitch, [[maybe_unused]] uint32_t in_slice_pitch,
-		TexCompressionMethod method)
+		TexCompressionMethod method, ThreadPool& tp, uint32_t num_threads)
+	{
+		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
+		uint32_t const block_width = BlockWidth(compression_format_);
+		uint32_t const block_height = BlockHeight(compression_format_);
+
+		uint32_t const num_block_rows = (height + block_height - 1) / block_height;
+		uint32_t const num_bands = std::min(num_threads * BANDS_PER_THREAD, num_block_rows);
+		if ((num_threads <= 1) || (num_bands <= 1))
+		{
+			// Not EncodeMem, that forwards back here
+			std::vector<uint8_t> uncompressed(ENCODE_BATCH_BLOCKS * block_width * block_height * elem_size);
+			this->EncodeRows(width, height, 0, height, output, out_row_pitch, input, in_row_pitch, method, uncompressed);
+			return;
+		}
+
+		uint32_t const band_height = (num_block_rows + num_bands - 1) / num_bands * block_height;
+		uint32_t const num_workers = std::min(num_threads, num_bands);
+
+		std::atomic<uint32_t> next_band(0);
+		std::vector<std::future<void>> joiners(num_workers);
+		for (uint32_t i = 0; i < num_workers; ++ i)
+		{
+			joiners[i] = tp.QueueThread(
+				[this, width, height, output, out_row_pitch, input, in_row_pitch, method, elem_size, block_width, block_height,
+					band_height, &next_band]
+				{
+					auto codec = this->Clone();
+					std::vector<uint8_t> uncompressed(ENCODE_BATCH_BLOCKS * block_width * block_height * elem_size);
+					for (;;)
+					{
+						uint32_t const y_begin = next_band.fetch_add(1) * band_height;
+						if (y_begin >= height)
+						{
+							break;
+						}
+
+						codec->EncodeRows(width, height, y_begin, std::min(y_begin + band_height, height),
+							output, out_row_pitch, input, in_row_pitch, method, uncompressed);
+					}
+				});
+		}
+
+		// Every worker has to be done with the locals before an exception from one of them leaves this function
+		for (auto& joiner : joiners)
+		{
+			joiner.wait();
+		}
+		for (auto& joiner : joiners)
+		{
+			joiner.get();
+		}
+	}
+
+	void TexCompression::DecodeMemParallel(uint32_t width, uint32_t height,
+		void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
+		void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
+		ThreadPool& tp, uint32_t num_threads)
+	{
+		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
+		uint32_t const block_width = BlockWidth(compression_format_);
+		uint32_t const block_height = BlockHeight(compression_format_);
+
+		uint32_t const num_block_rows = (height + block_height - 1) / block_height;
+		uint32_t const num_bands = std::min(num_threads * BANDS_PER_THREAD, num_block_rows);
+		if ((num_threads <= 1) || (num_bands <= 1))
+		{
+			this->DecodeMem(width, height, output, out_row_pitch, out_slice_pitch, input, in_row_pitch, in_slice_pitch);
+			return;
+		}
+
+		uint32_t const band_height = (num_block_rows + num_bands - 1) / num_bands * block_height;
+		uint32_t const num_workers = std::min(num_threads, num_bands);
+
+		std::atomic<uint32_t> next_band(0);
+		std::vector<std::future<void>> joiners(num_workers);
+		for (uint32_t i = 0; i < num_workers; ++ i)
+		{
+			joiners[i] = tp.QueueThread(
+				[this, width, height, output, out_row_pitch, input, in_row_pitch, elem_size, block_width, block_height,
+					band_height, &next_band]
+				{
+					auto codec = this->Clone();
+					std::vector<uint8_t> uncompressed(block_width * block_height * elem_size);
+					for (;;)
+					{
+						uint32_t const y_begin = next_band.fetch_add(1) * band_height;
+						if (y_begin >= height)
+						{
+							break;
+						}
+
+						codec->DecodeRows(width, height, y_begin, std::min(y_begin + band_height, height),
+							output, out_row_pitch, input, in_row_pitch, uncompressed);
+					}
+				});
+		}
+
+		// Every worker has to be done with the locals before an exception from one of them leaves this function
+		for (auto& joiner : joiners)
+		{
+			joiner.wait();
+		}
+		for (auto& joiner : joiners)
+		{
+			joiner.get();
+		}
+	}
+
+	void TexCompression::EncodeRows(uint32_t width, uint32_t height, uint32_t y_begin, uint32_t y_end,
+		void* output, uint32_t out_row_pitch, void const * input, uint32_t in_row_pitch,
+		TexCompressionMethod method, std::vector<uint8_t>& uncompressed)
 	{
 		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
 		uint32_t const block_width = BlockWidth(compression_format_);
 		uint32_t const block_height = BlockHeight(compression_format_);
 		uint32_t const block_bytes = BlockBytes(compression_format_);
 
+		uint32_t const uncompressed_block_size = block_width * block_height * elem_size;
+
+		BOOST_ASSERT(y_begin % block_height == 0);
+		BOOST_ASSERT(uncompressed.size() == ENCODE_BATCH_BLOCKS * uncompressed_block_size);
+
 		uint8_t const * src = static_cast<uint8_t const *>(input);
 
-		std::vector<uint8_t> uncompressed(block_width * block_height * elem_size);
-		for (uint32_t y_base = 0; y_base < height; y_base += block_height)
+		uint32_t const num_block_cols = (width + block_width - 1) / block_width;
+		for (uint32_t y_base = y_begin; y_base < y_end; y_base += block_height)
 		{
 			uint8_t* dst = static_cast<uint8_t*>(output) + (y_base / block_height) * out_row_pitch;
 
-			for (uint32_t x_base = 0; x_base < width; x_base += block_width)
+			for (uint32_t bx_base = 0; bx_base < num_block_cols; bx_base += ENCODE_BATCH_BLOCKS)
 			{
-				for (uint32_t y = 0; y < block_height; ++ y)
+				uint32_t const num_blocks = std::min(ENCODE_BATCH_BLOCKS, num_block_cols - bx_base);
+				for (uint32_t i = 0; i < num_blocks; ++ i)
 				{
-					for (uint32_t x = 0; x < block_width; ++ x)
+					uint8_t* block = &uncompressed[i * uncompressed_block_size];
+					uint32_t const x_base = (bx_base + i) * block_width;
+					for (uint32_t y = 0; y < block_height; ++ y)
 					{
-						if ((x_base + x < width) && (y_base + y < height))
-						{
-							memcpy(&uncompressed[(y * block_width + x) * elem_size],
-								&src[(y_base + y) * in_row_pitch + (x_base + x) * elem_size],
-								elem_size);
-						}
-						else
+						for (uint32_t x = 0; x < block_width; ++ x)
 						{
-							memset(&uncompressed[(y * block_width + x) * elem_size],
-								0, elem_size);
+							if ((x_base + x < width) && (y_base + y < height))
+							{
+								memcpy(&block[(y * block_width + x) * elem_size],
+									&src[(y_base + y) * in_row_pitch + (x_base + x) * elem_size],
+									elem_size);
+							}
+							else
+							{
+								memset(&block[(y * block_width + x) * elem_size],
+									0, elem_size);
+							}
 						}
 					}
 				}
 
-				this->EncodeBlock(dst, &uncompressed[0], method);
-				dst += block_bytes;
+				this->EncodeBlocks(dst, &uncompressed[0], num_blocks, method);
+				dst += num_blocks * block_bytes;
 			}
 		}
 	}
 
-	void TexCompression::DecodeMem(uint32_t width, uint32_t height,
-		void* output, uint32_t out_row_pitch, [[maybe_unused]] uint32_t out_slice_pitch,
-		void const * input, uint32_t in_row_pitch, [[maybe_unused]] uint32_t in_slice_pitch)
+	void TexCompression::DecodeRows(uint32_t width, uint32_t height, uint32_t y_begin, uint32_t y_end,
+		void* output, uint32_t out_row_pitch, void const * input, uint32_t in_row_pitch,
+		std::vector<uint8_t>& uncompressed)
 	{
 		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
 		uint32_t const block_width = BlockWidth(compression_format_);
 		uint32_t const block_height = BlockHeight(compression_format_);
 		uint32_t const block_bytes = BlockBytes(compression_format_);
 
+		BOOST_ASSERT(y_begin % block_height == 0);
+		BOOST_ASSERT(uncompressed.size() == block_width * block_height * elem_size);
+
 		uint8_t * dst = static_cast<uint8_t*>(output);
 
-		std::vector<uint8_t> uncompressed(block_width * block_height * elem_size);
-		for (uint32_t y_base = 0; y_base < height; y_base += block_height)
+		for (uint32_t y_base = y_begin; y_base < y_end; y_base += block_height)
 		{
 			uint8_t const * src = static_cast<uint8_t const *>(input) + in_row_pitch * (y_base / block_height);
 
@@ -377,8 +551,9 @@ namespace KlayGE
 
 		Texture::Mapper mapper_src(*uncompressed_tex, 0, 0, TMA_Read_Only, 0, 0, width, height);
 		Texture::Mapper mapper_dst(*out_tex, 0, 0, TMA_Write_Only, 0, 0, width, height);
-		this->EncodeMem(width, height, mapper_dst.Pointer<void>(), mapper_dst.RowPitch(), mapper_dst.SlicePitch(),
-			mapper_src.Pointer<void>(), mapper_src.RowPitch(), mapper_src.SlicePitch(), method);
+		this->EncodeMemParallel(width, height, mapper_dst.Pointer<void>(), mapper_dst.RowPitch(), mapper_dst.SlicePitch(),
+			mapper_src.Pointer<void>(), mapper_src.RowPitch(), mapper_src.SlicePitch(), method,
+			Context::Instance().ThreadPoolInstance(), CpuInfo().NumHWThreads());
 	}
 
 	void TexCompression::DecodeTex(TexturePtr const & out_tex, TexturePtr const & in_tex)
@@ -401,8 +576,9 @@ namespace KlayGE
 		{
 			Texture::Mapper mapper_src(*in_tex, 0, 0, TMA_Read_Only, 0, 0, width, height);
 			Texture::Mapper mapper_dst(*decoded_tex, 0, 0, TMA_Write_Only, 0, 0, width, height);
-			this->DecodeMem(width, height, mapper_dst.Pointer<void>(), mapper_dst.RowPitch(), mapper_dst.SlicePitch(),
-				mapper_src.Pointer<void>(), mapper_src.RowPitch(), mapper_src.SlicePitch());
+			this->DecodeMemParallel(width, height, mapper_dst.Pointer<void>(), mapper_dst.RowPitch(), mapper_dst.SlicePitch(),
+				mapper_src.Pointer<void>(), mapper_src.RowPitch(), mapper_src.SlicePitch(),
+				Context::Instance().ThreadPoolInstance(), CpuInfo().NumHWThreads());
 		}
 
 		if (out_tex->Format() != decoded_fmt)
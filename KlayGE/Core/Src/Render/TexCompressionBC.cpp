@@ -46,6 +46,20 @@
 #include <KlayGE/TexCompressionBC.hpp>
 #include "../Base/TableGen/Tables.hpp"
 
+#if defined(KLAYGE_AVX2_SUPPORT)
+	#define BC_BATCH_AVX2
+	#include <immintrin.h>
+#elif defined(KLAYGE_SSE2_SUPPORT)
+	#define BC_BATCH_SSE2
+	#if defined(KLAYGE_SSE4_1_SUPPORT)
+		#include <smmintrin.h>
+	#else
+		#include <emmintrin.h>
+	#endif
+#else
+	#define BC_BATCH_GENERAL
+#endif
+
 namespace
 {
 	using namespace KlayGE;
@@ -672,8 +686,23 @@ namespace
 		return EstimateNClusterError<4>(metric, c);
 	}
 
-	ShapeSelection BoxSelection(RGBACluster& cluster, TexCompressionErrorMetric metric)
+	// Appends the num_candidates shapes with the smallest estimated error, best first. Ties go to the lower shape index.
+	void AddBestShapes(std::vector<Shape>& shapes, std::array<std::pair<uint64_t, uint32_t>, 64>& shape_errs,
+		uint32_t num_partitions, uint32_t num_candidates)
+	{
+		num_candidates = std::min(num_candidates, static_cast<uint32_t>(shape_errs.size()));
+		std::partial_sort(shape_errs.begin(), shape_errs.begin() + num_candidates, shape_errs.end());
+		for (uint32_t i = 0; i < num_candidates; ++ i)
+		{
+			shapes.push_back({ num_partitions, shape_errs[i].second });
+		}
+	}
+
+	ShapeSelection BoxSelection(RGBACluster& cluster, TexCompressionErrorMetric metric, uint32_t num_candidates,
+		bool three_partitions)
 	{
+		BOOST_ASSERT(num_candidates > 0);
+
 		ShapeSelection result;
 
 		bool opaque = true;
@@ -685,10 +714,7 @@ namespace
 
 		// First we must figure out which shape to use. To do this, simply
 		// see which shape has the smallest sum of minimum bounding spheres.
-		uint64_t best_err = std::numeric_limits<uint64_t>::max();
-
-		result.shapes.resize(1);
-		result.shapes[0].num_partitions = 2;
+		std::array<std::pair<uint64_t, uint32_t>, 64> shape_errs;
 		for (uint32_t i = 0; i < 64; ++ i)
 		{
 			cluster.ShapeIndex(i, 2);
@@ -700,19 +726,17 @@ namespace
 				err += EstimateTwoClusterError(metric, cluster);
 			}
 
-			if (err < best_err)
-			{
-				best_err = err;
-				result.shapes[0].index = i;
-			}
-
 			// If it's small, we'll take it!
 			if (err < 1)
 			{
+				result.shapes.push_back({ 2, i });
 				result.selected_modes = TWO_PARTITION_MODES;
 				return result;
 			}
+
+			shape_errs[i] = std::make_pair(err, i);
 		}
+		AddBestShapes(result.shapes, shape_errs, 2, num_candidates);
 
 		// There are not 3 subset blocks that support alpha, so only check these
 		// if the entire block is opaque.
@@ -726,10 +750,12 @@ namespace
 		// 4 and 5, so just ignore those.
 		result.selected_modes &= ~(BC7BM_Four | BC7BM_Five);
 
-		best_err = std::numeric_limits<uint64_t>::max();
+		if (!three_partitions)
+		{
+			result.selected_modes &= ~THREE_PARTITION_MODES;
+			return result;
+		}
 
-		result.shapes.resize(2);
-		result.shapes[1].num_partitions = 3;
 		for (uint32_t i = 0; i < 64; ++ i)
 		{
 			cluster.ShapeIndex(i, 3);
@@ -741,23 +767,44 @@ namespace
 				err += EstimateThreeClusterError(metric, cluster);
 			}
 
-			if (err < best_err)
-			{
-				best_err = err;
-				result.shapes[1].index = i;
-			}
-
 			// If it's small, we'll take it!
 			if (err < 1)
 			{
+				result.shapes.push_back({ 3, i });
 				result.selected_modes = THREE_PARTITION_MODES;
 				return result;
 			}
+
+			shape_errs[i] = std::make_pair(err, i);
 		}
+		AddBestShapes(result.shapes, shape_errs, 3, num_candidates);
 
 		return result;
 	}
 
+	// How hard TexCompressionBC7 searches for a block
+	struct BC7SearchSettings
+	{
+		int sa_steps;				// Simulated annealing steps of the endpoint refinement
+		uint32_t opaque_modes;		// Modes allowed on opaque blocks
+		uint32_t alpha_modes;		// Modes allowed on blocks with alpha
+		uint32_t shape_candidates;	// Shapes kept per partition count, ranked by the bounding box estimate
+		uint32_t refine_candidates;	// Candidates that get the simulated annealing after a quick pass. 0 refines all of them.
+		bool search_rotations;		// Try the channel rotations and index modes of mode 4 and 5
+	};
+
+	BC7SearchSettings const BC7_PRESET_SETTINGS[] =
+	{
+		// BC7P_UltraFast: one 2-subset mode plus mode 6 on opaque blocks, no refinement
+		{ 0, BC7BM_One | BC7BM_Six, BC7BM_Five | BC7BM_Six, 1, 0, false },
+		// BC7P_Fast
+		{ 0, BC7BM_One | BC7BM_Two | BC7BM_Three | BC7BM_Six, ALPHA_MODES, 1, 0, false },
+		// BC7P_Basic. Mode 7 can't beat mode 3 on opaque blocks.
+		{ 10, 0xFF & ~BC7BM_Seven, ALPHA_MODES, 2, 2, true },
+		// BC7P_Slow
+		{ 50, 0xFF & ~BC7BM_Seven, ALPHA_MODES, 4, 4, true }
+	};
+
 	uint32_t AnchorIndexForSubset(uint32_t partition, uint32_t shape_index, uint32_t num_partitions)
 	{
 		static int const anchor_idx_2[64] =
@@ -837,12 +884,429 @@ namespace
 		}
 	}
 
-	int IntRand()
+	int IntRand(std::minstd_rand& gen)
 	{
-		static thread_local std::mt19937 gen;
 		std::uniform_int_distribution<int> random_dis(0, RAND_MAX);
 		return random_dis(gen);
 	}
+
+	// Pixels with alpha < 0x80 become transparent black in BC1. Returns whether the block has any of them.
+	bool BC1PunchThroughAlpha(ARGBColor32* dst, ARGBColor32 const * argb)
+	{
+		bool alpha = false;
+		for (size_t i = 0; i < 16; ++ i)
+		{
+			if (argb[i].a() < 0x80)
+			{
+				dst[i] = ARGBColor32(0, 0, 0, 0);
+				alpha = true;
+			}
+			else
+			{
+				dst[i] = argb[i];
+			}
+		}
+		return alpha;
+	}
+
+	// Lane primitives of the batch BC1/BC4 kernels. Every lane carries one block, so one call works on NUM_LANES blocks.
+	//  Supporting another instruction set only needs another implementation of this namespace.
+	namespace BatchLanes
+	{
+#if defined(BC_BATCH_AVX2)
+		uint32_t constexpr NUM_LANES = 8;
+
+		using IntLanes = __m256i;
+		using FloatLanes = __m256;
+
+		inline IntLanes LoadI(int32_t const * p)
+		{
+			return _mm256_load_si256(reinterpret_cast<__m256i const *>(p));
+		}
+		inline void StoreI(int32_t* p, IntLanes v)
+		{
+			_mm256_store_si256(reinterpret_cast<__m256i*>(p), v);
+		}
+		inline IntLanes SetI(int32_t v)
+		{
+			return _mm256_set1_epi32(v);
+		}
+		inline IntLanes AddI(IntLanes a, IntLanes b)
+		{
+			return _mm256_add_epi32(a, b);
+		}
+		inline IntLanes SubI(IntLanes a, IntLanes b)
+		{
+			return _mm256_sub_epi32(a, b);
+		}
+		inline IntLanes MulI(IntLanes a, IntLanes b)
+		{
+			return _mm256_mullo_epi32(a, b);
+		}
+		inline IntLanes MinI(IntLanes a, IntLanes b)
+		{
+			return _mm256_min_epi32(a, b);
+		}
+		inline IntLanes MaxI(IntLanes a, IntLanes b)
+		{
+			return _mm256_max_epi32(a, b);
+		}
+		inline IntLanes AndI(IntLanes a, IntLanes b)
+		{
+			return _mm256_and_si256(a, b);
+		}
+		inline IntLanes OrI(IntLanes a, IntLanes b)
+		{
+			return _mm256_or_si256(a, b);
+		}
+		inline IntLanes XorI(IntLanes a, IntLanes b)
+		{
+			return _mm256_xor_si256(a, b);
+		}
+		template <int N>
+		inline IntLanes SllI(IntLanes a)
+		{
+			return _mm256_slli_epi32(a, N);
+		}
+		template <int N>
+		inline IntLanes SraI(IntLanes a)
+		{
+			return _mm256_srai_epi32(a, N);
+		}
+		inline IntLanes CmpGtI(IntLanes a, IntLanes b)
+		{
+			return _mm256_cmpgt_epi32(a, b);
+		}
+		// mask ? a : b
+		inline IntLanes SelectI(IntLanes mask, IntLanes a, IntLanes b)
+		{
+			return _mm256_blendv_epi8(b, a, mask);
+		}
+
+		inline FloatLanes SetF(float v)
+		{
+			return _mm256_set1_ps(v);
+		}
+		inline FloatLanes AddF(FloatLanes a, FloatLanes b)
+		{
+			return _mm256_add_ps(a, b);
+		}
+		inline FloatLanes MulF(FloatLanes a, FloatLanes b)
+		{
+			return _mm256_mul_ps(a, b);
+		}
+		inline FloatLanes DivF(FloatLanes a, FloatLanes b)
+		{
+			return _mm256_div_ps(a, b);
+		}
+		inline FloatLanes MaxF(FloatLanes a, FloatLanes b)
+		{
+			return _mm256_max_ps(a, b);
+		}
+		inline FloatLanes AbsF(FloatLanes a)
+		{
+			return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+		}
+		inline IntLanes CmpLtF(FloatLanes a, FloatLanes b)
+		{
+			return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ));
+		}
+		inline FloatLanes SelectF(IntLanes mask, FloatLanes a, FloatLanes b)
+		{
+			return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask));
+		}
+		inline FloatLanes ToFloat(IntLanes a)
+		{
+			return _mm256_cvtepi32_ps(a);
+		}
+		inline IntLanes ToIntTrunc(FloatLanes a)
+		{
+			return _mm256_cvttps_epi32(a);
+		}
+#elif defined(BC_BATCH_SSE2)
+		uint32_t constexpr NUM_LANES = 4;
+
+		using IntLanes = __m128i;
+		using FloatLanes = __m128;
+
+		inline IntLanes LoadI(int32_t const * p)
+		{
+			return _mm_load_si128(reinterpret_cast<__m128i const *>(p));
+		}
+		inline void StoreI(int32_t* p, IntLanes v)
+		{
+			_mm_store_si128(reinterpret_cast<__m128i*>(p), v);
+		}
+		inline IntLanes SetI(int32_t v)
+		{
+			return _mm_set1_epi32(v);
+		}
+		inline IntLanes AddI(IntLanes a, IntLanes b)
+		{
+			return _mm_add_epi32(a, b);
+		}
+		inline IntLanes SubI(IntLanes a, IntLanes b)
+		{
+			return _mm_sub_epi32(a, b);
+		}
+		inline IntLanes MulI(IntLanes a, IntLanes b)
+		{
+#if defined(KLAYGE_SSE4_1_SUPPORT)
+			return _mm_mullo_epi32(a, b);
+#else
+			__m128i const even = _mm_mul_epu32(a, b);
+			__m128i const odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+			return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+				_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+		}
+		inline IntLanes CmpGtI(IntLanes a, IntLanes b)
+		{
+			return _mm_cmpgt_epi32(a, b);
+		}
+		inline IntLanes AndI(IntLanes a, IntLanes b)
+		{
+			return _mm_and_si128(a, b);
+		}
+		inline IntLanes OrI(IntLanes a, IntLanes b)
+		{
+			return _mm_or_si128(a, b);
+		}
+		inline IntLanes XorI(IntLanes a, IntLanes b)
+		{
+			return _mm_xor_si128(a, b);
+		}
+		template <int N>
+		inline IntLanes SllI(IntLanes a)
+		{
+			return _mm_slli_epi32(a, N);
+		}
+		template <int N>
+		inline IntLanes SraI(IntLanes a)
+		{
+			return _mm_srai_epi32(a, N);
+		}
+		// mask ? a : b
+		inline IntLanes SelectI(IntLanes mask, IntLanes a, IntLanes b)
+		{
+#if defined(KLAYGE_SSE4_1_SUPPORT)
+			return _mm_blendv_epi8(b, a, mask);
+#else
+			return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+#endif
+		}
+		inline IntLanes MinI(IntLanes a, IntLanes b)
+		{
+#if defined(KLAYGE_SSE4_1_SUPPORT)
+			return _mm_min_epi32(a, b);
+#else
+			return SelectI(CmpGtI(a, b), b, a);
+#endif
+		}
+		inline IntLanes MaxI(IntLanes a, IntLanes b)
+		{
+#if defined(KLAYGE_SSE4_1_SUPPORT)
+			return _mm_max_epi32(a, b);
+#else
+			return SelectI(CmpGtI(a, b), a, b);
+#endif
+		}
+
+		inline FloatLanes SetF(float v)
+		{
+			return _mm_set1_ps(v);
+		}
+		inline FloatLanes AddF(FloatLanes a, FloatLanes b)
+		{
+			return _mm_add_ps(a, b);
+		}
+		inline FloatLanes MulF(FloatLanes a, FloatLanes b)
+		{
+			return _mm_mul_ps(a, b);
+		}
+		inline FloatLanes DivF(FloatLanes a, FloatLanes b)
+		{
+			return _mm_div_ps(a, b);
+		}
+		inline FloatLanes MaxF(FloatLanes a, FloatLanes b)
+		{
+			return _mm_max_ps(a, b);
+		}
+		inline FloatLanes AbsF(FloatLanes a)
+		{
+			return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+		}
+		inline IntLanes CmpLtF(FloatLanes a, FloatLanes b)
+		{
+			return _mm_castps_si128(_mm_cmplt_ps(a, b));
+		}
+		inline FloatLanes SelectF(IntLanes mask, FloatLanes a, FloatLanes b)
+		{
+			return _mm_castsi128_ps(SelectI(mask, _mm_castps_si128(a), _mm_castps_si128(b)));
+		}
+		inline FloatLanes ToFloat(IntLanes a)
+		{
+			return _mm_cvtepi32_ps(a);
+		}
+		inline IntLanes ToIntTrunc(FloatLanes a)
+		{
+			return _mm_cvttps_epi32(a);
+		}
+#else
+		uint32_t constexpr NUM_LANES = 4;
+
+		using IntLanes = std::array<int32_t, NUM_LANES>;
+		using FloatLanes = std::array<float, NUM_LANES>;
+
+		template <typename R, typename T, typename F>
+		inline std::array<R, NUM_LANES> PerLane(T const & a, T const & b, F f)
+		{
+			std::array<R, NUM_LANES> ret;
+			for (uint32_t i = 0; i < NUM_LANES; ++ i)
+			{
+				ret[i] = f(a[i], b[i]);
+			}
+			return ret;
+		}
+
+		inline IntLanes LoadI(int32_t const * p)
+		{
+			IntLanes ret;
+			std::memcpy(ret.data(), p, sizeof(ret));
+			return ret;
+		}
+		inline void StoreI(int32_t* p, IntLanes v)
+		{
+			std::memcpy(p, v.data(), sizeof(v));
+		}
+		inline IntLanes SetI(int32_t v)
+		{
+			IntLanes ret;
+			ret.fill(v);
+			return ret;
+		}
+		inline IntLanes AddI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return static_cast<int32_t>(static_cast<uint32_t>(x) + y); });
+		}
+		inline IntLanes SubI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return static_cast<int32_t>(static_cast<uint32_t>(x) - y); });
+		}
+		inline IntLanes MulI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return static_cast<int32_t>(static_cast<uint32_t>(x) * y); });
+		}
+		inline IntLanes MinI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return std::min(x, y); });
+		}
+		inline IntLanes MaxI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return std::max(x, y); });
+		}
+		inline IntLanes AndI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return x & y; });
+		}
+		inline IntLanes OrI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return x | y; });
+		}
+		inline IntLanes XorI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return x ^ y; });
+		}
+		template <int N>
+		inline IntLanes SllI(IntLanes a)
+		{
+			return PerLane<int32_t>(a, a, [](int32_t x, int32_t) { return static_cast<int32_t>(static_cast<uint32_t>(x) << N); });
+		}
+		template <int N>
+		inline IntLanes SraI(IntLanes a)
+		{
+			return PerLane<int32_t>(a, a, [](int32_t x, int32_t) { return x >> N; });
+		}
+		inline IntLanes CmpGtI(IntLanes a, IntLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](int32_t x, int32_t y) { return (x > y) ? -1 : 0; });
+		}
+		// mask ? a : b
+		inline IntLanes SelectI(IntLanes mask, IntLanes a, IntLanes b)
+		{
+			IntLanes ret;
+			for (uint32_t i = 0; i < NUM_LANES; ++ i)
+			{
+				ret[i] = mask[i] ? a[i] : b[i];
+			}
+			return ret;
+		}
+
+		inline FloatLanes SetF(float v)
+		{
+			FloatLanes ret;
+			ret.fill(v);
+			return ret;
+		}
+		inline FloatLanes AddF(FloatLanes a, FloatLanes b)
+		{
+			return PerLane<float>(a, b, [](float x, float y) { return x + y; });
+		}
+		inline FloatLanes MulF(FloatLanes a, FloatLanes b)
+		{
+			return PerLane<float>(a, b, [](float x, float y) { return x * y; });
+		}
+		inline FloatLanes DivF(FloatLanes a, FloatLanes b)
+		{
+			return PerLane<float>(a, b, [](float x, float y) { return x / y; });
+		}
+		inline FloatLanes MaxF(FloatLanes a, FloatLanes b)
+		{
+			return PerLane<float>(a, b, [](float x, float y) { return std::max(x, y); });
+		}
+		inline FloatLanes AbsF(FloatLanes a)
+		{
+			return PerLane<float>(a, a, [](float x, float) { return std::abs(x); });
+		}
+		inline IntLanes CmpLtF(FloatLanes a, FloatLanes b)
+		{
+			return PerLane<int32_t>(a, b, [](float x, float y) { return (x < y) ? -1 : 0; });
+		}
+		inline FloatLanes SelectF(IntLanes mask, FloatLanes a, FloatLanes b)
+		{
+			FloatLanes ret;
+			for (uint32_t i = 0; i < NUM_LANES; ++ i)
+			{
+				ret[i] = mask[i] ? a[i] : b[i];
+			}
+			return ret;
+		}
+		inline FloatLanes ToFloat(IntLanes a)
+		{
+			FloatLanes ret;
+			for (uint32_t i = 0; i < NUM_LANES; ++ i)
+			{
+				ret[i] = static_cast<float>(a[i]);
+			}
+			return ret;
+		}
+		inline IntLanes ToIntTrunc(FloatLanes a)
+		{
+			IntLanes ret;
+			for (uint32_t i = 0; i < NUM_LANES; ++ i)
+			{
+				// Out of range lanes are always masked out by the callers
+				ret[i] = ((a[i] > -2147483648.0f) && (a[i] < 2147483648.0f)) ? static_cast<int32_t>(a[i]) : INT32_MIN;
+			}
+			return ret;
+		}
+#endif
+
+		inline IntLanes CmpLtI(IntLanes a, IntLanes b)
+		{
+			return CmpGtI(b, a);
+		}
+	}
 }
 
 namespace KlayGE
@@ -854,6 +1318,11 @@ namespace KlayGE
 		compression_format_ = EF_BC1;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC1::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC1>();
+	}
+
 	void TexCompressionBC1::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -863,21 +1332,33 @@ namespace KlayGE
 		ARGBColor32 const * argb = static_cast<ARGBColor32 const *>(input);
 
 		std::array<ARGBColor32, 16> tmp_argb;
-		bool alpha = false;
-		for (size_t i = 0; i < tmp_argb.size(); ++ i)
+		bool const alpha = BC1PunchThroughAlpha(&tmp_argb[0], argb);
+
+		this->EncodeBC1Internal(bc1, &tmp_argb[0], alpha, method);
+	}
+
+	void TexCompressionBC1::EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method)
+	{
+		using BatchLanes::NUM_LANES;
+
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		BC1Block* bc1 = static_cast<BC1Block*>(output);
+		ARGBColor32 const * argb = static_cast<ARGBColor32 const *>(input);
+
+		std::array<ARGBColor32, NUM_LANES * 16> tmp_argb;
+		std::array<bool, NUM_LANES> alpha;
+		for (uint32_t base = 0; base < num_blocks; base += NUM_LANES)
 		{
-			if (argb[i].a() < 0x80)
-			{
-				tmp_argb[i] = ARGBColor32(0, 0, 0, 0);
-				alpha = true;
-			}
-			else
+			uint32_t const batch = std::min(NUM_LANES, num_blocks - base);
+			for (uint32_t i = 0; i < batch; ++ i)
 			{
-				tmp_argb[i] = argb[i];
+				alpha[i] = BC1PunchThroughAlpha(&tmp_argb[i * 16], argb + (base + i) * 16);
 			}
-		}
 
-		this->EncodeBC1Internal(bc1, &tmp_argb[0], alpha, method);
+			this->EncodeBC1Lanes(bc1 + base, &tmp_argb[0], &alpha[0], batch, method);
+		}
 	}
 
 	void TexCompressionBC1::DecodeBlock(void* output, void const * input)
@@ -934,9 +1415,9 @@ namespace KlayGE
 		return ((rgb.r() >> 3) << 11) | ((rgb.g() >> 2) << 5) | ((rgb.b() >> 3) << 0);
 	}
 
-	// The color matching function
-	uint32_t TexCompressionBC1::MatchColorsBlock(ARGBColor32 const * argb,
-			ARGBColor32 const & min_clr, ARGBColor32 const & max_clr, bool alpha) const
+	// Projection axis and decision points of the color matching function
+	void TexCompressionBC1::MatchColorsSetup(ARGBColor32 const & min_clr, ARGBColor32 const & max_clr, bool alpha,
+			int dir[3], int points[3]) const
 	{
 		std::array<ARGBColor32, 4> color;
 		color[0] = max_clr;
@@ -953,16 +1434,12 @@ namespace KlayGE
 			color[3].a() = 255;
 		}
 
-		uint32_t mask = 0;
-		int dirr = color[0].r() - color[1].r();
-		int dirg = color[0].g() - color[1].g();
-		int dirb = color[0].b() - color[1].b();
-
-		int dots[16];
-		for (int i = 0; i < 16; ++ i)
-		{
-			dots[i] = argb[i].r() * dirr + argb[i].g() * dirg + argb[i].b() * dirb;
-		}
+		int const dirr = color[0].r() - color[1].r();
+		int const dirg = color[0].g() - color[1].g();
+		int const dirb = color[0].b() - color[1].b();
+		dir[0] = dirr;
+		dir[1] = dirg;
+		dir[2] = dirb;
 
 		if (alpha)
 		{
@@ -972,8 +1449,43 @@ namespace KlayGE
 				stops[i] = color[i].r() * dirr + color[i].g() * dirg + color[i].b() * dirb;
 			}
 
-			int c0_point = (stops[0] + stops[1] * 2) / 3;
-			int c3_point = (stops[0] * 2 + stops[1]) / 3;
+			points[0] = (stops[0] + stops[1] * 2) / 3;
+			points[1] = 0;
+			points[2] = (stops[0] * 2 + stops[1]) / 3;
+		}
+		else
+		{
+			std::array<int, 4> stops;
+			for (int i = 0; i < 4; ++ i)
+			{
+				stops[i] = color[i].r() * dirr + color[i].g() * dirg + color[i].b() * dirb;
+			}
+
+			points[0] = (stops[1] + stops[3]) >> 1;
+			points[1] = (stops[3] + stops[2]) >> 1;
+			points[2] = (stops[2] + stops[0]) >> 1;
+		}
+	}
+
+	// The color matching function
+	uint32_t TexCompressionBC1::MatchColorsBlock(ARGBColor32 const * argb,
+			ARGBColor32 const & min_clr, ARGBColor32 const & max_clr, bool alpha) const
+	{
+		int dir[3];
+		int points[3];
+		this->MatchColorsSetup(min_clr, max_clr, alpha, dir, points);
+
+		uint32_t mask = 0;
+		int dots[16];
+		for (int i = 0; i < 16; ++ i)
+		{
+			dots[i] = argb[i].r() * dir[0] + argb[i].g() * dir[1] + argb[i].b() * dir[2];
+		}
+
+		if (alpha)
+		{
+			int const c0_point = points[0];
+			int const c3_point = points[2];
 
 			for (int i = 15; i >= 0; -- i)
 			{
@@ -992,17 +1504,11 @@ namespace KlayGE
 				}
 			}
 		}
-		else
-		{
-			std::array<int, 4> stops;
-			for (int i = 0; i < 4; ++ i)
-			{
-				stops[i] = color[i].r() * dirr + color[i].g() * dirg + color[i].b() * dirb;
-			}
-
-			int c0_point = (stops[1] + stops[3]) >> 1;
-			int half_point = (stops[3] + stops[2]) >> 1;
-			int c3_point = (stops[2] + stops[0]) >> 1;
+		else
+		{
+			int const c0_point = points[0];
+			int const half_point = points[1];
+			int const c3_point = points[2];
 
 			for (int i = 15; i >= 0; -- i)
 			{
@@ -1281,23 +1787,34 @@ namespace KlayGE
 		}
 		else // constant color
 		{
-			if (alpha && (0 == argb[0].ARGB()))
-			{
-				mask = 0xFFFFFFFF;
-				max16 = min16 = 0;
-			}
-			else
-			{
-				int const r = argb[0].r();
-				int const g = argb[0].g();
-				int const b = argb[0].b();
+			this->ConstantColorBlock(argb[0], alpha, max16, min16, mask);
+		}
 
-				mask = 0xAAAAAAAA;
-				max16 = (O_MATCH5[r][0] << 11) | (O_MATCH6[g][0] << 5) | O_MATCH5[b][0];
-				min16 = (O_MATCH5[r][1] << 11) | (O_MATCH6[g][1] << 5) | O_MATCH5[b][1];
-			}
+		this->PackBC1Block(bc1, max16, min16, mask, alpha);
+	}
+
+	void TexCompressionBC1::ConstantColorBlock(ARGBColor32 const & clr, bool alpha,
+			uint16_t& max16, uint16_t& min16, uint32_t& mask) const
+	{
+		if (alpha && (0 == clr.ARGB()))
+		{
+			mask = 0xFFFFFFFF;
+			max16 = min16 = 0;
+		}
+		else
+		{
+			int const r = clr.r();
+			int const g = clr.g();
+			int const b = clr.b();
+
+			mask = 0xAAAAAAAA;
+			max16 = (O_MATCH5[r][0] << 11) | (O_MATCH6[g][0] << 5) | O_MATCH5[b][0];
+			min16 = (O_MATCH5[r][1] << 11) | (O_MATCH6[g][1] << 5) | O_MATCH5[b][1];
 		}
+	}
 
+	void TexCompressionBC1::PackBC1Block(BC1Block& bc1, uint16_t max16, uint16_t min16, uint32_t mask, bool alpha) const
+	{
 		if (alpha)
 		{
 			if (max16 < min16)
@@ -1335,12 +1852,321 @@ namespace KlayGE
 		std::memcpy(bc1.bitmap, &mask, sizeof(mask));
 	}
 
+	void TexCompressionBC1::EncodeBC1Batch(BC1Block* bc1, ARGBColor32 const * argb, bool const * alpha, uint32_t num_blocks,
+			TexCompressionMethod method) const
+	{
+		using BatchLanes::NUM_LANES;
+
+		for (uint32_t base = 0; base < num_blocks; base += NUM_LANES)
+		{
+			this->EncodeBC1Lanes(bc1 + base, argb + base * 16, alpha + base, std::min(NUM_LANES, num_blocks - base), method);
+		}
+	}
+
+	// Encodes up to NUM_LANES blocks at once with one block per lane. Every block comes out identical to EncodeBC1Internal.
+	//  Endpoint search and color matching run on the lanes, the least squares refinement stays scalar per block.
+	void TexCompressionBC1::EncodeBC1Lanes(BC1Block* bc1, ARGBColor32 const * argb, bool const * alpha, uint32_t num_blocks,
+			TexCompressionMethod method) const
+	{
+		using namespace BatchLanes;
+
+		BOOST_ASSERT(bc1);
+		BOOST_ASSERT(argb);
+		BOOST_ASSERT(alpha);
+		BOOST_ASSERT((num_blocks > 0) && (num_blocks <= NUM_LANES));
+
+		// Transpose the blocks into lanes. Unused lanes repeat the last block.
+		alignas(32) int32_t r[16][NUM_LANES];
+		alignas(32) int32_t g[16][NUM_LANES];
+		alignas(32) int32_t b[16][NUM_LANES];
+		alignas(32) int32_t transparent[16][NUM_LANES];
+		alignas(32) int32_t alpha_lanes[NUM_LANES];
+		std::array<ARGBColor32 const *, NUM_LANES> blocks;
+		std::array<bool, NUM_LANES> constant;
+		for (uint32_t lane = 0; lane < NUM_LANES; ++ lane)
+		{
+			uint32_t const src_block = std::min(lane, num_blocks - 1);
+			ARGBColor32 const * block = argb + src_block * 16;
+			blocks[lane] = block;
+			alpha_lanes[lane] = alpha[src_block] ? -1 : 0;
+			constant[lane] = true;
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				r[i][lane] = block[i].r();
+				g[i][lane] = block[i].g();
+				b[i][lane] = block[i].b();
+				transparent[i][lane] = (0 == block[i].a()) ? -1 : 0;
+				constant[lane] &= (block[i].ARGB() == block[0].ARGB());
+			}
+		}
+
+		// Pick the endpoints, the same way as OptimizeColorsBlock
+		alignas(32) int32_t min_index[NUM_LANES];
+		alignas(32) int32_t max_index[NUM_LANES];
+		if (method != TCM_Quality)
+		{
+			// Evaluated in the same order as MathLib::dot(Color(argb), LUM_WEIGHT)
+			FloatLanes const rcp = SetF(1 / 255.0f);
+			FloatLanes const lum_r = SetF(0.2126f);
+			FloatLanes const lum_g = SetF(0.7152f);
+			FloatLanes const lum_b = SetF(0.0722f);
+			auto luminance = [&](uint32_t i)
+			{
+				FloatLanes const fr = MulF(rcp, ToFloat(LoadI(r[i])));
+				FloatLanes const fg = MulF(rcp, ToFloat(LoadI(g[i])));
+				FloatLanes const fb = MulF(rcp, ToFloat(LoadI(b[i])));
+				return AddF(MulF(fr, lum_r), AddF(MulF(fg, lum_g), MulF(fb, lum_b)));
+			};
+
+			FloatLanes min_lum = luminance(0);
+			FloatLanes max_lum = min_lum;
+			IntLanes min_idx = SetI(0);
+			IntLanes max_idx = min_idx;
+			for (uint32_t i = 1; i < 16; ++ i)
+			{
+				FloatLanes const lum = luminance(i);
+				IntLanes const idx = SetI(i);
+				IntLanes const is_min = CmpLtF(lum, min_lum);
+				IntLanes const is_max = CmpLtF(max_lum, lum);
+				min_lum = SelectF(is_min, lum, min_lum);
+				min_idx = SelectI(is_min, idx, min_idx);
+				max_lum = SelectF(is_max, lum, max_lum);
+				max_idx = SelectI(is_max, idx, max_idx);
+			}
+
+			StoreI(min_index, min_idx);
+			StoreI(max_index, max_idx);
+		}
+		else
+		{
+			static int const ITER_POWER = 4;
+
+			// determine color distribution
+			IntLanes sum_r = LoadI(r[0]);
+			IntLanes sum_g = LoadI(g[0]);
+			IntLanes sum_b = LoadI(b[0]);
+			IntLanes min_r = sum_r, max_r = sum_r;
+			IntLanes min_g = sum_g, max_g = sum_g;
+			IntLanes min_b = sum_b, max_b = sum_b;
+			for (uint32_t i = 1; i < 16; ++ i)
+			{
+				IntLanes const vr = LoadI(r[i]);
+				IntLanes const vg = LoadI(g[i]);
+				IntLanes const vb = LoadI(b[i]);
+				sum_r = AddI(sum_r, vr);
+				sum_g = AddI(sum_g, vg);
+				sum_b = AddI(sum_b, vb);
+				min_r = MinI(min_r, vr);
+				min_g = MinI(min_g, vg);
+				min_b = MinI(min_b, vb);
+				max_r = MaxI(max_r, vr);
+				max_g = MaxI(max_g, vg);
+				max_b = MaxI(max_b, vb);
+			}
+
+			IntLanes const eight = SetI(8);
+			IntLanes const mu_r = SraI<4>(AddI(sum_r, eight));
+			IntLanes const mu_g = SraI<4>(AddI(sum_g, eight));
+			IntLanes const mu_b = SraI<4>(AddI(sum_b, eight));
+
+			// determine covariance matrix
+			IntLanes cov[6];
+			for (int i = 0; i < 6; ++ i)
+			{
+				cov[i] = SetI(0);
+			}
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				IntLanes const dr = SubI(LoadI(r[i]), mu_r);
+				IntLanes const dg = SubI(LoadI(g[i]), mu_g);
+				IntLanes const db = SubI(LoadI(b[i]), mu_b);
+
+				cov[0] = AddI(cov[0], MulI(dr, dr));
+				cov[1] = AddI(cov[1], MulI(dr, dg));
+				cov[2] = AddI(cov[2], MulI(dr, db));
+				cov[3] = AddI(cov[3], MulI(dg, dg));
+				cov[4] = AddI(cov[4], MulI(dg, db));
+				cov[5] = AddI(cov[5], MulI(db, db));
+			}
+
+			// convert covariance matrix to float, find principal axis via power iter
+			FloatLanes covf[6];
+			for (int i = 0; i < 6; ++ i)
+			{
+				covf[i] = DivF(ToFloat(cov[i]), SetF(255.0f));
+			}
+
+			FloatLanes vfr = ToFloat(SubI(max_r, min_r));
+			FloatLanes vfg = ToFloat(SubI(max_g, min_g));
+			FloatLanes vfb = ToFloat(SubI(max_b, min_b));
+			for (int iter = 0; iter < ITER_POWER; ++ iter)
+			{
+				FloatLanes const pr = AddF(AddF(MulF(vfr, covf[0]), MulF(vfg, covf[1])), MulF(vfb, covf[2]));
+				FloatLanes const pg = AddF(AddF(MulF(vfr, covf[1]), MulF(vfg, covf[3])), MulF(vfb, covf[4]));
+				FloatLanes const pb = AddF(AddF(MulF(vfr, covf[2]), MulF(vfg, covf[4])), MulF(vfb, covf[5]));
+
+				vfr = pr;
+				vfg = pg;
+				vfb = pb;
+			}
+
+			FloatLanes const magn = MaxF(MaxF(AbsF(vfr), AbsF(vfg)), AbsF(vfb));
+			IntLanes const too_small = CmpLtF(magn, SetF(4.0f)); // too small, default to luminance
+			FloatLanes const scale = DivF(SetF(512.0f), magn);
+			IntLanes const v_r = SelectI(too_small, SetI(148), ToIntTrunc(MulF(vfr, scale)));
+			IntLanes const v_g = SelectI(too_small, SetI(300), ToIntTrunc(MulF(vfg, scale)));
+			IntLanes const v_b = SelectI(too_small, SetI(58), ToIntTrunc(MulF(vfb, scale)));
+
+			// Pick colors at extreme points
+			IntLanes min_d = SetI(0x7FFFFFFF);
+			IntLanes max_d = SetI(-0x7FFFFFFF);
+			IntLanes min_idx = SetI(0);
+			IntLanes max_idx = min_idx;
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				IntLanes const dot = AddI(AddI(MulI(LoadI(r[i]), v_r), MulI(LoadI(g[i]), v_g)), MulI(LoadI(b[i]), v_b));
+				IntLanes const idx = SetI(i);
+				IntLanes const is_min = CmpLtI(dot, min_d);
+				IntLanes const is_max = CmpGtI(dot, max_d);
+				min_d = SelectI(is_min, dot, min_d);
+				min_idx = SelectI(is_min, idx, min_idx);
+				max_d = SelectI(is_max, dot, max_d);
+				max_idx = SelectI(is_max, idx, max_idx);
+			}
+
+			StoreI(min_index, min_idx);
+			StoreI(max_index, max_idx);
+		}
+
+		// The color matching function on all lanes, driven by the per lane values from MatchColorsSetup
+		alignas(32) int32_t dir[3][NUM_LANES];
+		alignas(32) int32_t points[3][NUM_LANES];
+		alignas(32) int32_t match_mask[NUM_LANES];
+		auto match_colors = [&]
+		{
+			IntLanes const dir_r = LoadI(dir[0]);
+			IntLanes const dir_g = LoadI(dir[1]);
+			IntLanes const dir_b = LoadI(dir[2]);
+			IntLanes const c0_point = LoadI(points[0]);
+			IntLanes const half_point = LoadI(points[1]);
+			IntLanes const c3_point = LoadI(points[2]);
+			IntLanes const has_alpha = LoadI(alpha_lanes);
+			IntLanes const zero = SetI(0);
+			IntLanes const one = SetI(1);
+			IntLanes const two = SetI(2);
+			IntLanes const three = SetI(3);
+
+			IntLanes mask = zero;
+			for (int i = 15; i >= 0; -- i)
+			{
+				IntLanes const dot = AddI(AddI(MulI(LoadI(r[i]), dir_r), MulI(LoadI(g[i]), dir_g)), MulI(LoadI(b[i]), dir_b));
+				IntLanes const below_c0 = CmpLtI(dot, c0_point);
+				IntLanes const below_c3 = CmpLtI(dot, c3_point);
+				IntLanes const opaque_bits = SelectI(CmpLtI(dot, half_point),
+					SelectI(below_c0, one, three), SelectI(below_c3, two, zero));
+				IntLanes const alpha_bits = SelectI(LoadI(transparent[i]),
+					three, SelectI(below_c0, zero, SelectI(below_c3, two, one)));
+				mask = OrI(SllI<2>(mask), SelectI(has_alpha, alpha_bits, opaque_bits));
+			}
+			StoreI(match_mask, mask);
+		};
+
+		std::array<ARGBColor32, NUM_LANES> min_clr;
+		std::array<ARGBColor32, NUM_LANES> max_clr;
+		std::array<uint16_t, NUM_LANES> min16;
+		std::array<uint16_t, NUM_LANES> max16;
+		std::array<uint32_t, NUM_LANES> mask;
+		for (uint32_t lane = 0; lane < NUM_LANES; ++ lane)
+		{
+			min_clr[lane] = blocks[lane][min_index[lane]];
+			max_clr[lane] = blocks[lane][max_index[lane]];
+			max16[lane] = this->RGB888To565(max_clr[lane]);
+			min16[lane] = this->RGB888To565(min_clr[lane]);
+
+			int lane_dir[3];
+			int lane_points[3];
+			this->MatchColorsSetup(min_clr[lane], max_clr[lane], alpha_lanes[lane] != 0, lane_dir, lane_points);
+			for (int i = 0; i < 3; ++ i)
+			{
+				dir[i][lane] = lane_dir[i];
+				points[i][lane] = lane_points[i];
+			}
+		}
+		match_colors();
+
+		std::array<bool, NUM_LANES> refined;
+		bool any_refined = false;
+		for (uint32_t lane = 0; lane < num_blocks; ++ lane)
+		{
+			refined[lane] = false;
+			if (constant[lane])
+			{
+				continue;
+			}
+
+			mask[lane] = (max16[lane] != min16[lane]) ? static_cast<uint32_t>(match_mask[lane]) : 0;
+			if (!alpha[lane] && (method != TCM_Speed))
+			{
+				if (this->RefineBlock(blocks[lane], min_clr[lane], max_clr[lane], mask[lane]))
+				{
+					max16[lane] = this->RGB888To565(max_clr[lane]);
+					min16[lane] = this->RGB888To565(min_clr[lane]);
+					if (max16[lane] != min16[lane])
+					{
+						int lane_dir[3];
+						int lane_points[3];
+						this->MatchColorsSetup(min_clr[lane], max_clr[lane], false, lane_dir, lane_points);
+						for (int i = 0; i < 3; ++ i)
+						{
+							dir[i][lane] = lane_dir[i];
+							points[i][lane] = lane_points[i];
+						}
+
+						refined[lane] = true;
+						any_refined = true;
+					}
+					else
+					{
+						mask[lane] = 0;
+					}
+				}
+			}
+		}
+
+		if (any_refined)
+		{
+			match_colors();
+			for (uint32_t lane = 0; lane < num_blocks; ++ lane)
+			{
+				if (refined[lane])
+				{
+					mask[lane] = static_cast<uint32_t>(match_mask[lane]);
+				}
+			}
+		}
+
+		for (uint32_t lane = 0; lane < num_blocks; ++ lane)
+		{
+			if (constant[lane])
+			{
+				this->ConstantColorBlock(blocks[lane][0], alpha[lane], max16[lane], min16[lane], mask[lane]);
+			}
+
+			this->PackBC1Block(bc1[lane], max16[lane], min16[lane], mask[lane], alpha[lane]);
+		}
+	}
+
 
 	TexCompressionBC2::TexCompressionBC2()
 	{
 		compression_format_ = EF_BC2;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC2::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC2>();
+	}
+
 	void TexCompressionBC2::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1392,6 +2218,11 @@ namespace KlayGE
 		compression_format_ = EF_BC3;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC3::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC3>();
+	}
+
 	void TexCompressionBC3::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1413,6 +2244,41 @@ namespace KlayGE
 		bc4_codec_.EncodeBlock(&bc3.alpha, &alpha[0], method);
 	}
 
+	void TexCompressionBC3::EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method)
+	{
+		using BatchLanes::NUM_LANES;
+
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		BC3Block* bc3 = static_cast<BC3Block*>(output);
+		ARGBColor32 const * argb = static_cast<ARGBColor32 const *>(input);
+
+		std::array<uint8_t, NUM_LANES * 16> alpha;
+		std::array<ARGBColor32, NUM_LANES * 16> xrgb;
+		std::array<bool, NUM_LANES> const no_alpha = {};
+		std::array<BC1Block, NUM_LANES> bc1;
+		std::array<BC4Block, NUM_LANES> bc4;
+		for (uint32_t base = 0; base < num_blocks; base += NUM_LANES)
+		{
+			uint32_t const batch = std::min(NUM_LANES, num_blocks - base);
+			for (uint32_t i = 0; i < batch * 16; ++ i)
+			{
+				xrgb[i] = argb[base * 16 + i];
+				xrgb[i].a() = 255;
+				alpha[i] = static_cast<uint8_t>(argb[base * 16 + i].a());
+			}
+
+			bc1_codec_.EncodeBC1Batch(&bc1[0], &xrgb[0], &no_alpha[0], batch, method);
+			bc4_codec_.EncodeBC4Batch(&bc4[0], &alpha[0], batch);
+			for (uint32_t i = 0; i < batch; ++ i)
+			{
+				bc3[base + i].alpha = bc4[i];
+				bc3[base + i].bc1 = bc1[i];
+			}
+		}
+	}
+
 	void TexCompressionBC3::DecodeBlock(void* output, void const * input)
 	{
 		BOOST_ASSERT(output);
@@ -1438,6 +2304,11 @@ namespace KlayGE
 		compression_format_ = EF_BC4;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC4::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC4>();
+	}
+
 	// Alpha block compression (this is easy for a change)
 	void TexCompressionBC4::EncodeBlock(void* output, void const * input, [[maybe_unused]] TexCompressionMethod method)
 	{
@@ -1494,6 +2365,119 @@ namespace KlayGE
 		}
 	}
 
+	void TexCompressionBC4::EncodeBlocks(void* output, void const * input, uint32_t num_blocks,
+		[[maybe_unused]] TexCompressionMethod method)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		BC4Block* bc4 = static_cast<BC4Block*>(output);
+		uint8_t const * r = static_cast<uint8_t const *>(input);
+
+		this->EncodeBC4Batch(bc4, r, num_blocks);
+	}
+
+	void TexCompressionBC4::EncodeBC4Batch(BC4Block* bc4, uint8_t const * r, uint32_t num_blocks) const
+	{
+		using BatchLanes::NUM_LANES;
+
+		for (uint32_t base = 0; base < num_blocks; base += NUM_LANES)
+		{
+			this->EncodeBC4Lanes(bc4 + base, r + base * 16, std::min(NUM_LANES, num_blocks - base));
+		}
+	}
+
+	// Encodes up to NUM_LANES blocks at once with one block per lane. Every block comes out identical to EncodeBlock.
+	void TexCompressionBC4::EncodeBC4Lanes(BC4Block* bc4, uint8_t const * r, uint32_t num_blocks) const
+	{
+		using namespace BatchLanes;
+
+		BOOST_ASSERT(bc4);
+		BOOST_ASSERT(r);
+		BOOST_ASSERT((num_blocks > 0) && (num_blocks <= NUM_LANES));
+
+		// Transpose the blocks into lanes. Unused lanes repeat the last block.
+		alignas(32) int32_t v[16][NUM_LANES];
+		for (uint32_t lane = 0; lane < NUM_LANES; ++ lane)
+		{
+			uint8_t const * block = r + std::min(lane, num_blocks - 1) * 16;
+			for (uint32_t i = 0; i < 16; ++ i)
+			{
+				v[i][lane] = block[i];
+			}
+		}
+
+		// find min/max color
+		IntLanes min = LoadI(v[0]);
+		IntLanes max = min;
+		for (uint32_t i = 1; i < 16; ++ i)
+		{
+			min = MinI(min, LoadI(v[i]));
+			max = MaxI(max, LoadI(v[i]));
+		}
+
+		// determine bias and emit color indices
+		IntLanes const dist = SubI(max, min);
+		IntLanes const bias = SubI(SubI(SllI<3>(min), min), SraI<1>(dist));
+		IntLanes const dist4 = SllI<2>(dist);
+		IntLanes const dist2 = SllI<1>(dist);
+		IntLanes const zero = SetI(0);
+		IntLanes const one = SetI(1);
+		IntLanes const two = SetI(2);
+		IntLanes const four = SetI(4);
+		IntLanes const seven = SetI(7);
+
+		alignas(32) int32_t ind[16][NUM_LANES];
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			IntLanes const x = LoadI(v[i]);
+			IntLanes a = SubI(SubI(SllI<3>(x), x), bias);
+
+			// select index (hooray for bit magic)
+			IntLanes t = SraI<31>(SubI(dist4, a));
+			IntLanes index = AndI(t, four);
+			a = SubI(a, AndI(dist4, t));
+			t = SraI<31>(SubI(dist2, a));
+			index = AddI(index, AndI(t, two));
+			a = SubI(a, AndI(dist2, t));
+			t = SraI<31>(SubI(dist, a));
+			index = AddI(index, AndI(t, one));
+
+			index = AndI(SubI(zero, index), seven);
+			index = XorI(index, AndI(CmpGtI(two, index), one));
+
+			StoreI(ind[i], index);
+		}
+
+		// 8 indices of 3 bits fill exactly 3 bytes
+		IntLanes bits_lo = zero;
+		IntLanes bits_hi = zero;
+		for (int i = 7; i >= 0; -- i)
+		{
+			bits_lo = OrI(SllI<3>(bits_lo), LoadI(ind[i]));
+			bits_hi = OrI(SllI<3>(bits_hi), LoadI(ind[i + 8]));
+		}
+
+		alignas(32) int32_t mins[NUM_LANES];
+		alignas(32) int32_t maxs[NUM_LANES];
+		alignas(32) int32_t bitmap[2][NUM_LANES];
+		StoreI(mins, min);
+		StoreI(maxs, max);
+		StoreI(bitmap[0], bits_lo);
+		StoreI(bitmap[1], bits_hi);
+		for (uint32_t lane = 0; lane < num_blocks; ++ lane)
+		{
+			bc4[lane].alpha_0 = static_cast<uint8_t>(maxs[lane]);
+			bc4[lane].alpha_1 = static_cast<uint8_t>(mins[lane]);
+			for (int i = 0; i < 2; ++ i)
+			{
+				bc4[lane].bitmap[i * 3 + 0] = static_cast<uint8_t>(bitmap[i][lane] >> 0);
+				bc4[lane].bitmap[i * 3 + 1] = static_cast<uint8_t>(bitmap[i][lane] >> 8);
+				bc4[lane].bitmap[i * 3 + 2] = static_cast<uint8_t>(bitmap[i][lane] >> 16);
+			}
+		}
+	}
+
 	void TexCompressionBC4::DecodeBlock(void* output, void const * input)
 	{
 		BOOST_ASSERT(output);
@@ -1542,6 +2526,11 @@ namespace KlayGE
 		compression_format_ = EF_BC5;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC5::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC5>();
+	}
+
 	void TexCompressionBC5::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1562,6 +2551,40 @@ namespace KlayGE
 		bc4_codec_.EncodeBlock(&bc5.green, &g[0], method);
 	}
 
+	void TexCompressionBC5::EncodeBlocks(void* output, void const * input, uint32_t num_blocks,
+		[[maybe_unused]] TexCompressionMethod method)
+	{
+		using BatchLanes::NUM_LANES;
+
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		BC5Block* bc5 = static_cast<BC5Block*>(output);
+		uint16_t const * gr = static_cast<uint16_t const *>(input);
+
+		std::array<uint8_t, NUM_LANES * 16> r;
+		std::array<uint8_t, NUM_LANES * 16> g;
+		std::array<BC4Block, NUM_LANES> red;
+		std::array<BC4Block, NUM_LANES> green;
+		for (uint32_t base = 0; base < num_blocks; base += NUM_LANES)
+		{
+			uint32_t const batch = std::min(NUM_LANES, num_blocks - base);
+			for (uint32_t i = 0; i < batch * 16; ++ i)
+			{
+				r[i] = gr[base * 16 + i] & 0xFF;
+				g[i] = gr[base * 16 + i] >> 8;
+			}
+
+			bc4_codec_.EncodeBC4Batch(&red[0], &r[0], batch);
+			bc4_codec_.EncodeBC4Batch(&green[0], &g[0], batch);
+			for (uint32_t i = 0; i < batch; ++ i)
+			{
+				bc5[base + i].red = red[i];
+				bc5[base + i].green = green[i];
+			}
+		}
+	}
+
 	void TexCompressionBC5::DecodeBlock(void* output, void const * input)
 	{
 		BOOST_ASSERT(output);
@@ -1842,6 +2865,11 @@ namespace KlayGE
 		compression_format_ = EF_BC6;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC6U::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC6U>();
+	}
+
 	void TexCompressionBC6U::EncodeBlock(
 		[[maybe_unused]] void* output, [[maybe_unused]] void const* input, [[maybe_unused]] TexCompressionMethod method)
 	{
@@ -2090,6 +3118,11 @@ namespace KlayGE
 		compression_format_ = EF_SIGNED_BC6;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC6S::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionBC6S>();
+	}
+
 	void TexCompressionBC6S::EncodeBlock(
 		[[maybe_unused]] void* output, [[maybe_unused]] void const* input, [[maybe_unused]] TexCompressionMethod method)
 	{
@@ -2124,11 +3157,18 @@ namespace KlayGE
 	};
 
 	TexCompressionBC7::TexCompressionBC7()
-		: index_mode_(0)
+		: preset_(BC7P_ByMethod), index_mode_(0), search_rotations_(true)
 	{
 		compression_format_ = EF_BC7;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC7::Clone() const
+	{
+		auto ret = MakeUniquePtr<TexCompressionBC7>();
+		ret->Preset(preset_);
+		return ret;
+	}
+
 	void TexCompressionBC7::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -2153,33 +3193,60 @@ namespace KlayGE
 			return;
 		}
 
+		// Restart the random sequence on every block, so the result doesn't depend on the order blocks are encoded in.
+		// This changes the output of the annealing from before, when one thread_local generator ran on across blocks and
+		// textures. That output depended on whatever the thread had encoded earlier, so it was never reproducible either.
+		rand_gen_.seed();
+
 		TexCompressionErrorMetric metric = TCEM_Uniform;
-		int sa_steps;
-		switch (method)
+		BC7SearchSettings settings;
+		if (BC7P_ByMethod == preset_)
 		{
-		case TCM_Quality:
-			sa_steps = 50;
-			break;
-		case TCM_Balanced:
-			sa_steps = 10;
-			break;
-		case TCM_Speed:
-			sa_steps = 0;
-			break;
+			settings = { 0, 0xFF, 0xFF, 1, 0, true };
+			switch (method)
+			{
+			case TCM_Quality:
+				settings.sa_steps = 50;
+				break;
+			case TCM_Balanced:
+				settings.sa_steps = 10;
+				break;
+			case TCM_Speed:
+				settings.sa_steps = 0;
+				break;
 
-		default:
-			KFL_UNREACHABLE("Invalid compression method");
+			default:
+				KFL_UNREACHABLE("Invalid compression method");
+			}
+		}
+		else
+		{
+			settings = BC7_PRESET_SETTINGS[preset_ - BC7P_UltraFast];
+		}
+		search_rotations_ = settings.search_rotations;
+
+		// Only fully opaque blocks give up the alpha modes, an alpha of 250 still has to survive the encoding
+		bool opaque = true;
+		for (int i = 0; i < 16; ++ i)
+		{
+			opaque = opaque && (argb[i].a() == 255);
 		}
 
 		RGBACluster block_cluster(argb, BlockWidth(EF_BC7) * BlockHeight(EF_BC7), GetPartition);
-		ShapeSelection selection = BoxSelection(block_cluster, metric);
+		ShapeSelection selection = BoxSelection(block_cluster, metric, settings.shape_candidates,
+			(settings.opaque_modes & THREE_PARTITION_MODES) != 0);
 		BOOST_ASSERT(selection.selected_modes > 0);
 
 		uint64_t best_err = std::numeric_limits<uint64_t>::max();
 		uint32_t best_mode = 8;
 		CompressParams best_params;
 
-		uint32_t selected_modes = selection.selected_modes;
+		uint32_t selected_modes = selection.selected_modes & (opaque ? settings.opaque_modes : settings.alpha_modes);
+		if (0 == selected_modes)
+		{
+			// The preset pruned everything BoxSelection picked. Mode 6 handles any block.
+			selected_modes = BC7BM_Six;
+		}
 		size_t num_shape_indices = selection.shapes.size();
 
 		// If we don't have any indices, turn off two and three partition modes,
@@ -2190,10 +3257,24 @@ namespace KlayGE
 			selected_modes &= ~(TWO_PARTITION_MODES | THREE_PARTITION_MODES);
 		}
 
-		for (uint32_t mode = 0; mode < 8; ++ mode)
+		// With refine_candidates, every candidate first gets a quick pass without simulated annealing,
+		// and only the best ones of them are refined.
+		bool const two_pass = (settings.sa_steps > 0) && (settings.refine_candidates > 0);
+		int const first_pass_sa_steps = two_pass ? 0 : settings.sa_steps;
+
+		struct Candidate
+		{
+			uint64_t error;
+			uint32_t mode;
+			uint32_t shape_index;
+		};
+		std::vector<Candidate> candidates;
+
+		for (uint32_t mode = 0; (mode < 8) && (best_err > 0); ++ mode)
 		{
 			if ((selected_modes & (1 << mode)) != 0)
 			{
+				bool single_partition_done = false;
 				for (uint32_t shape_index = 0; shape_index < num_shape_indices; ++ shape_index)
 				{
 					Shape const & shape = selection.shapes[shape_index];
@@ -2201,6 +3282,16 @@ namespace KlayGE
 					uint32_t partitions = mode_info_[mode].partitions;
 					if ((1 == partitions) || (partitions == shape.num_partitions))
 					{
+						// Single partition modes ignore the shape, there is no need to try them more than once
+						if ((1 == partitions) && (settings.shape_candidates > 1))
+						{
+							if (single_partition_done)
+							{
+								continue;
+							}
+							single_partition_done = true;
+						}
+
 						// Block mode zero only has four bits for the partition index,
 						// so if the chosen three-partition shape is not within this range,
 						// then we shouldn't consider using this block mode...
@@ -2209,13 +3300,18 @@ namespace KlayGE
 							block_cluster.ShapeIndex(shape.index, partitions);
 
 							CompressParams params;
-							uint64_t error = this->TryCompress(mode, sa_steps, metric, params, shape.index, block_cluster);
+							uint64_t error = this->TryCompress(mode, first_pass_sa_steps, metric, params, shape.index, block_cluster);
 							if (error < best_err)
 							{
 								best_err = error;
 								best_mode = mode;
 								best_params = params;
 							}
+
+							if (two_pass)
+							{
+								candidates.push_back({ error, mode, shape.index });
+							}
 						}
 					}
 				}
@@ -2223,6 +3319,32 @@ namespace KlayGE
 		}
 		BOOST_ASSERT(best_mode < 8);
 
+		if (two_pass && (best_err > 0))
+		{
+			uint32_t const num_refined = std::min(settings.refine_candidates, static_cast<uint32_t>(candidates.size()));
+			std::partial_sort(candidates.begin(), candidates.begin() + num_refined, candidates.end(),
+				[](Candidate const & lhs, Candidate const & rhs)
+				{
+					return lhs.error < rhs.error;
+				});
+
+			for (uint32_t i = 0; i < num_refined; ++ i)
+			{
+				Candidate const & candidate = candidates[i];
+				block_cluster.ShapeIndex(candidate.shape_index, mode_info_[candidate.mode].partitions);
+
+				CompressParams params;
+				uint64_t error = this->TryCompress(candidate.mode, settings.sa_steps, metric, params, candidate.shape_index,
+					block_cluster);
+				if (error < best_err)
+				{
+					best_err = error;
+					best_mode = candidate.mode;
+					best_params = params;
+				}
+			}
+		}
+
 		index_mode_ = 0;
 		this->PackBC7Block(best_mode, best_params, output);
 	}
@@ -2837,7 +3959,7 @@ namespace KlayGE
 		{
 			float4 const & p = pt ? p1 : p2;
 			float4& np = pt ? np1 : np2;
-			uint32_t const rdir = IntRand() & 0xF;
+			uint32_t const rdir = IntRand(rand_gen_) & 0xF;
 
 			np = p;
 			if (has_pbits)
@@ -2870,7 +3992,7 @@ namespace KlayGE
 		}
 
 		size_t const p = static_cast<size_t>(exp(0.1f * static_cast<int64_t>(old_err - new_err) / temp) * static_cast<float>(RAND_MAX));
-		size_t const r = IntRand();
+		size_t const r = IntRand(rand_gen_);
 
 		return r < p;
 	}
@@ -3541,11 +4663,12 @@ namespace KlayGE
 				uint8_t alpha_indices[BC67_MAX_NUM_DATA_POINTS];
 
 				uint64_t best_err = std::numeric_limits<uint64_t>::max();
-				for (int rot_mode = 0; rot_mode < 4; ++ rot_mode)
+				int const rot_modes = search_rotations_ ? 4 : 1;
+				for (int rot_mode = 0; rot_mode < rot_modes; ++ rot_mode)
 				{
 					rotate_mode_ = rot_mode;
 
-					int const idx_modes = (4 == mode) ? 2 : 1;
+					int const idx_modes = ((4 == mode) && search_rotations_) ? 2 : 1;
 					for (int idx_mode = 0; idx_mode < idx_modes; ++ idx_mode)
 					{
 						index_mode_ = idx_mode;
@@ -34,6 +34,7 @@
 #include <KFL/Color.hpp>
 #include <KlayGE/Texture.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <iterator>
 #include <vector>
@@ -513,7 +514,8 @@ namespace KlayGE
 			use_color4_(false),
 			scan_delta_size_(1),
 			base_color5_(0),
-			constrain_against_base_color5_(false)
+			constrain_against_base_color5_(false),
+			early_out_error_(0)
 	{
 		static int const s_default_scan_delta[] = { 0 };
 		scan_deltas_ = s_default_scan_delta;
@@ -644,12 +646,34 @@ namespace KlayGE
 	{
 		compression_format_ = EF_ETC1;
 
+		effort_ = 100;
+
 		params_ = nullptr;
 		result_ = nullptr;
 		sorted_luma_ptr_ = nullptr;
 		sorted_luma_indices_ = nullptr;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionETC1::Clone() const
+	{
+		auto ret = MakeUniquePtr<TexCompressionETC1>();
+		ret->Effort(effort_);
+		return ret;
+	}
+
+	void TexCompressionETC1::Effort(uint32_t effort)
+	{
+		effort_ = std::min(effort, 100U);
+	}
+
+	// Squared RGB error per pixel that is good enough to stop searching. 0 at full effort, where only an exact match stops early,
+	//  and that doesn't change the result because a later solution has to be strictly better to replace it.
+	uint64_t TexCompressionETC1::EarlyOutPixelError() const
+	{
+		uint32_t const slack = 100 - effort_;
+		return slack * slack * 3 / 400;
+	}
+
 	void TexCompressionETC1::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -685,14 +709,18 @@ namespace KlayGE
 		Results results[3];
 		ARGBColor32 subblock_pixels[8];
 
+		uint64_t const early_out_pixel_error = this->EarlyOutPixelError();
+
 		Params params;
 		params.quality_ = method;
 		params.num_src_pixels_ = 8;
 		params.src_pixels_ = subblock_pixels;
+		params.early_out_error_ = early_out_pixel_error * 8;
 
-		for (uint32_t flip = 0; flip < 2; ++ flip)
+		uint64_t const early_out_block_error = early_out_pixel_error * 16;
+		for (uint32_t flip = 0; (flip < 2) && (best_err > early_out_block_error); ++ flip)
 		{
-			for (uint32_t use_color4 = 0; use_color4 < 2; ++ use_color4)
+			for (uint32_t use_color4 = 0; (use_color4 < 2) && (best_err > early_out_block_error); ++ use_color4)
 			{
 				uint64_t trial_err = 0;
 
@@ -774,7 +802,7 @@ namespace KlayGE
 						// TODO: Fix fairly arbitrary/unrefined thresholds that control how far away to scan for potentially better solutions.
 						uint32_t const refinement_error_thresh0 = 3000;
 						uint32_t const refinement_error_thresh1 = 6000;
-						if (results[subblock].error_ > refinement_error_thresh0)
+						if ((results[subblock].error_ > refinement_error_thresh0) && (results[subblock].error_ > params.early_out_error_))
 						{
 							if (TCM_Balanced == params.quality_)
 							{
@@ -1389,9 +1417,14 @@ namespace KlayGE
 		uint32_t const n = params_->num_src_pixels_;
 		int const scan_delta_size = params_->scan_delta_size_;
 
+		auto const good_enough = [this]
+		{
+			return best_solution_.valid_ && (best_solution_.error_ <= params_->early_out_error_);
+		};
+
 		// Scan through a subset of the 3D lattice centered around the avg block color trying each 3D (555 or 444) lattice point as a potential block color.
 		// Each time a better solution is found try to refine the current solution's block color based of the current selectors and intensity table index.
-		for (int zdi = 0; zdi < scan_delta_size; ++ zdi)
+		for (int zdi = 0; (zdi < scan_delta_size) && !good_enough(); ++ zdi)
 		{
 			int const zd = params_->scan_deltas_[zdi];
 			int const mbb = bb_ + zd;
@@ -1404,7 +1437,7 @@ namespace KlayGE
 				break;
 			}
 
-			for (int ydi = 0; ydi < scan_delta_size; ++ ydi)
+			for (int ydi = 0; (ydi < scan_delta_size) && !good_enough(); ++ ydi)
 			{
 				int const yd = params_->scan_deltas_[ydi];
 				int const mbg = bg_ + yd;
@@ -1417,7 +1450,7 @@ namespace KlayGE
 					break;
 				}
 
-				for (int xdi = 0; xdi < scan_delta_size; ++ xdi)
+				for (int xdi = 0; (xdi < scan_delta_size) && !good_enough(); ++ xdi)
 				{
 					int const xd = params_->scan_deltas_[xdi];
 					int const mbr = br_ + xd;
@@ -1822,6 +1855,11 @@ namespace KlayGE
 		etc1_codec_ = MakeUniquePtr<TexCompressionETC1>();
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionETC2RGB8::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionETC2RGB8>();
+	}
+
 	void TexCompressionETC2RGB8::EncodeBlock(
 		[[maybe_unused]] void* output, [[maybe_unused]] void const* input, [[maybe_unused]] TexCompressionMethod method)
 	{
@@ -2040,6 +2078,11 @@ namespace KlayGE
 		etc2_rgb8_codec_ = MakeUniquePtr<TexCompressionETC2RGB8>();
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionETC2RGB8A1::Clone() const
+	{
+		return MakeUniquePtr<TexCompressionETC2RGB8A1>();
+	}
+
 	void TexCompressionETC2RGB8A1::EncodeBlock(
 		[[maybe_unused]] void* output, [[maybe_unused]] void const* input, [[maybe_unused]] TexCompressionMethod method)
 	{
@@ -27,6 +27,7 @@
 //////////////////////////////////////////////////////////////////////////////////
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/CpuInfo.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Log.hpp>
 #include <KFL/Math.hpp>
@@ -897,12 +898,15 @@ namespace
 			KFL_UNREACHABLE("Invalid compression format");
 		}
 
+		auto& tp = Context::Instance().ThreadPoolInstance();
+		uint32_t const num_threads = CpuInfo().NumHWThreads();
+
 		uint8_t const * src = static_cast<uint8_t const *>(src_data);
 		uint8_t* dst = static_cast<uint8_t*>(dst_data);
 		for (uint32_t z = 0; z < src_depth; ++ z)
 		{
-			codec->EncodeMem(src_width, src_height, dst, dst_row_pitch, dst_slice_pitch,
-				src, src_row_pitch, src_slice_pitch, TCM_Quality);
+			codec->EncodeMemParallel(src_width, src_height, dst, dst_row_pitch, dst_slice_pitch,
+				src, src_row_pitch, src_slice_pitch, TCM_Quality, tp, num_threads);
 
 			src += src_slice_pitch;
 			dst += dst_slice_pitch;
@@ -1057,12 +1061,15 @@ namespace
 		dst_slice_pitch = dst_row_pitch * src_height;
 		dst_data_block.resize(src_depth * dst_slice_pitch);
 
+		auto& tp = Context::Instance().ThreadPoolInstance();
+		uint32_t const num_threads = CpuInfo().NumHWThreads();
+
 		uint8_t const * src = static_cast<uint8_t const *>(src_data);
 		uint8_t* dst = static_cast<uint8_t*>(&dst_data_block[0]);
 		for (uint32_t z = 0; z < src_depth; ++ z)
 		{
-			codec->DecodeMem(src_width, src_height, dst, dst_row_pitch, dst_slice_pitch,
-				src, src_row_pitch, src_slice_pitch);
+			codec->DecodeMemParallel(src_width, src_height, dst, dst_row_pitch, dst_slice_pitch,
+				src, src_row_pitch, src_slice_pitch, tp, num_threads);
 
 			src += src_slice_pitch;
 			dst += dst_slice_pitch;
@@ -1296,6 +1303,13 @@ namespace
 			return true;
 		}
 
+		size_t Hash() const override
+		{
+			size_t seed = HashValue(tex_desc_.res_name);
+			HashCombine(seed, tex_desc_.access_hint);
+			return seed;
+		}
+
 		bool Match(ResLoadingDesc const & rhs) const override
 		{
 			if (this->Type() == rhs.Type())
@@ -2148,7 +2162,27 @@ namespace KlayGE
 			}
 		}
 
+		// Sub-resources of a mapped file are used in place, otherwise they are read into data_block.
+		// base[] holds the offset of each sub-resource in either of them.
+		std::span<uint8_t const> const mapped_data = tex_res->Data();
 		std::vector<size_t> base;
+		auto read_sub_res = [&tex_res, &data_block, &base, mapped_data](size_t index, size_t size)
+		{
+			if (mapped_data.empty())
+			{
+				base[index] = data_block.size();
+				data_block.resize(base[index] + size);
+
+				tex_res->read(&data_block[base[index]], size);
+				BOOST_ASSERT(tex_res->gcount() == static_cast<int64_t>(size));
+			}
+			else
+			{
+				auto const view = tex_res->ReadView(size);
+				BOOST_ASSERT(view.size() == size);
+				base[index] = static_cast<size_t>(view.data() - mapped_data.data());
+			}
+		};
 		switch (type)
 		{
 		case Texture::TT_1D:
@@ -2172,13 +2206,10 @@ namespace KlayGE
 							image_size = (padding ? ((the_width + 3) & ~3) : the_width) * fmt_size;
 						}
 
-						base[index] = data_block.size();
-						data_block.resize(base[index] + image_size);
 						init_data[index].row_pitch = image_size;
 						init_data[index].slice_pitch = image_size;
 
-						tex_res->read(&data_block[base[index]], static_cast<std::streamsize>(image_size));
-						BOOST_ASSERT(tex_res->gcount() == static_cast<int>(image_size));
+						read_sub_res(index, image_size);
 
 						the_width = std::max(the_width / 2, 1U);
 					}
@@ -2202,23 +2233,17 @@ namespace KlayGE
 							uint32_t const block_size = NumFormatBytes(format) * 4;
 							uint32_t image_size = ((the_width + 3) / 4) * ((the_height + 3) / 4) * block_size;
 
-							base[index] = data_block.size();
-							data_block.resize(base[index] + image_size);
 							init_data[index].row_pitch = (the_width + 3) / 4 * block_size;
 							init_data[index].slice_pitch = image_size;
 
-							tex_res->read(&data_block[base[index]], static_cast<std::streamsize>(image_size));
-							BOOST_ASSERT(tex_res->gcount() == static_cast<int>(image_size));
+							read_sub_res(index, image_size);
 						}
 						else
 						{
 							init_data[index].row_pitch = (padding ? ((the_width + 3) & ~3) : the_width) * fmt_size;
 							init_data[index].slice_pitch = init_data[index].row_pitch * the_height;
-							base[index] = data_block.size();
-							data_block.resize(base[index] + init_data[index].slice_pitch);
 
-							tex_res->read(&data_block[base[index]], static_cast<std::streamsize>(init_data[index].slice_pitch));
-							BOOST_ASSERT(tex_res->gcount() == static_cast<int>(init_data[index].slice_pitch));
+							read_sub_res(index, init_data[index].slice_pitch);
 						}
 
 						the_width = std::max(the_width / 2, 1U);
@@ -2245,23 +2270,17 @@ namespace KlayGE
 							uint32_t const block_size = NumFormatBytes(format) * 4;
 							uint32_t image_size = ((the_width + 3) / 4) * ((the_height + 3) / 4) * the_depth * block_size;
 
-							base[index] = data_block.size();
-							data_block.resize(base[index] + image_size);
 							init_data[index].row_pitch = (the_width + 3) / 4 * block_size;
 							init_data[index].slice_pitch = ((the_width + 3) / 4) * ((the_height + 3) / 4) * block_size;
 
-							tex_res->read(&data_block[base[index]], static_cast<std::streamsize>(image_size));
-							BOOST_ASSERT(tex_res->gcount() == static_cast<int>(image_size));
+							read_sub_res(index, image_size);
 						}
 						else
 						{
 							init_data[index].row_pitch = (padding ? ((the_width + 3) & ~3) : the_width) * fmt_size;
 							init_data[index].slice_pitch = init_data[index].row_pitch * the_height;
-							base[index] = data_block.size();
-							data_block.resize(base[index] + init_data[index].slice_pitch * the_depth);
 
-							tex_res->read(&data_block[base[index]], static_cast<std::streamsize>(init_data[index].slice_pitch * the_depth));
-							BOOST_ASSERT(tex_res->gcount() == static_cast<int>(init_data[index].slice_pitch * the_depth));
+							read_sub_res(index, init_data[index].slice_pitch * the_depth);
 						}
 
 						the_width = std::max(the_width / 2, 1U);
@@ -2290,23 +2309,17 @@ namespace KlayGE
 								uint32_t const block_size = NumFormatBytes(format) * 4;
 								uint32_t image_size = ((the_width + 3) / 4) * ((the_height + 3) / 4) * block_size;
 
-								base[index] = data_block.size();
-								data_block.resize(base[index] + image_size);
 								init_data[index].row_pitch = (the_width + 3) / 4 * block_size;
 								init_data[index].slice_pitch = image_size;
 
-								tex_res->read(&data_block[base[index]], static_cast<std::streamsize>(image_size));
-								BOOST_ASSERT(tex_res->gcount() == static_cast<int>(image_size));
+								read_sub_res(index, image_size);
 							}
 							else
 							{
 								init_data[index].row_pitch = (padding ? ((the_width + 3) & ~3) : the_width) * fmt_size;
 								init_data[index].slice_pitch = init_data[index].row_pitch * the_width;
-								base[index] = data_block.size();
-								data_block.resize(base[index] + init_data[index].slice_pitch);
 
-								tex_res->read(&data_block[base[index]], static_cast<std::streamsize>(init_data[index].slice_pitch));
-								BOOST_ASSERT(tex_res->gcount() == static_cast<int>(init_data[index].slice_pitch));
+								read_sub_res(index, init_data[index].slice_pitch);
 							}
 
 							the_width = std::max(the_width / 2, 1U);
@@ -2318,9 +2331,10 @@ namespace KlayGE
 			break;
 		}
 
+		uint8_t const * src_data = mapped_data.empty() ? data_block.data() : mapped_data.data();
 		for (size_t i = 0; i < base.size(); ++ i)
 		{
-			init_data[i].data = &data_block[base[i]];
+			init_data[i].data = src_data + base[i];
 		}
 
 		auto ret = MakeSharedPtr<SoftwareTexture>(type, width, height, depth,
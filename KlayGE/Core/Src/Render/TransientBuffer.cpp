@@ -34,14 +34,16 @@
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/App3D.hpp>
 
+#include <algorithm>
 #include <cstring>
+#include <thread>
 
 #include <KlayGE/TransientBuffer.hpp>
 
 namespace KlayGE
 {
-	TransientBuffer::TransientBuffer(uint32_t size_in_byte, TransientBuffer::BindFlag bind_flag)
-		: bind_flag_(bind_flag)
+	TransientBuffer::TransientBuffer(uint32_t size_in_byte, TransientBuffer::BindFlag bind_flag, TransientBuffer::AllocMode alloc_mode)
+		: alloc_mode_(alloc_mode), bind_flag_(bind_flag)
 	{
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine const & re = rf.RenderEngineInstance();
@@ -61,10 +63,19 @@ namespace KlayGE
 			valid_max_ = 0;
 		}
 
-		free_list_.emplace_back(0, size_in_byte);
+		if (alloc_mode_ == AM_Ring)
+		{
+			ring_capacity_ = size_in_byte;
+			ring_frame_fences_.assign(num_pre_frames_, 0);
+			simulate_buffer_.resize(ring_capacity_);
+		}
+		else
+		{
+			free_list_.emplace_back(0, size_in_byte);
 
-		App3DFramework const & app = Context::Instance().AppInstance();
-		retired_frames_.push_back(RetiredFrame(app.TotalNumFrames() + 1));
+			App3DFramework const & app = Context::Instance().AppInstance();
+			retired_frames_.push_back(RetiredFrame(app.TotalNumFrames() + 1));
+		}
 	}
 
 	GraphicsBufferPtr TransientBuffer::DoCreateBuffer(TransientBuffer::BindFlag bind_flag, uint32_t size_in_byte)
@@ -89,6 +100,11 @@ namespace KlayGE
 
 	SubAlloc TransientBuffer::Alloc(uint32_t size_in_byte, void const * data)
 	{
+		if (alloc_mode_ == AM_Ring)
+		{
+			return this->RingAlloc(size_in_byte, data);
+		}
+
 		SubAlloc ret;
 
 		// Use first fit method to find a free sub alloc
@@ -122,6 +138,7 @@ namespace KlayGE
 			}
 			first_fit_iter = free_list_.end();
 			-- first_fit_iter;
+			++ num_wrap_stalls_;
 			if (use_no_overwrite_)
 			{
 				buffer_->CopyToBuffer(*larger_buffer);
@@ -146,6 +163,9 @@ namespace KlayGE
 			first_fit_iter->offset_ += size_in_byte;
 		}
 
+		used_size_ += size_in_byte;
+		this->UpdateHighWaterMark(used_size_);
+
 		if (use_no_overwrite_)
 		{
 			GraphicsBuffer::Mapper mapper(*buffer_, BA_Write_No_Overwrite);
@@ -162,6 +182,114 @@ namespace KlayGE
 		return ret;
 	}
 
+	SubAlloc TransientBuffer::RingAlloc(uint32_t size_in_byte, void const * data)
+	{
+		for (;;)
+		{
+			// Announces the write before checking for a growth, which waits for the writers that got in first
+			ring_num_writers_.fetch_add(1);
+			if (ring_growing_.load())
+			{
+				ring_num_writers_.fetch_sub(1);
+				std::lock_guard<std::mutex> lock(ring_grow_mutex_);
+				continue;
+			}
+
+			uint64_t const capacity = ring_capacity_;
+			uint64_t pos = ring_head_.load(std::memory_order_relaxed);
+			uint64_t start;
+			uint64_t end;
+			bool fit;
+			for (;;)
+			{
+				// An alloc never straddles the end of the ring. It starts over at the beginning instead.
+				start = pos;
+				uint64_t const offset = pos % capacity;
+				if (offset + size_in_byte > capacity)
+				{
+					start += capacity - offset;
+				}
+				end = start + size_in_byte;
+
+				fit = (end - ring_tail_.load(std::memory_order_acquire) <= capacity);
+				if (!fit || ring_head_.compare_exchange_weak(pos, end, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+
+			if (fit)
+			{
+				uint32_t const offset = static_cast<uint32_t>(start % capacity);
+				memcpy(&simulate_buffer_[offset], data, size_in_byte);
+				this->UpdateHighWaterMark(static_cast<uint32_t>(end - ring_tail_.load(std::memory_order_relaxed)));
+				ring_num_writers_.fetch_sub(1, std::memory_order_release);
+
+				return SubAlloc(offset, size_in_byte);
+			}
+
+			ring_num_writers_.fetch_sub(1);
+			++ num_wrap_stalls_;
+			this->GrowRing(size_in_byte, static_cast<uint32_t>(capacity));
+		}
+	}
+
+	void TransientBuffer::GrowRing(uint32_t size_in_byte, uint32_t seen_capacity)
+	{
+		std::lock_guard<std::mutex> lock(ring_grow_mutex_);
+
+		// Another thread could have grown it already
+		if (ring_capacity_ != seen_capacity)
+		{
+			return;
+		}
+
+		ring_growing_.store(true);
+		while (ring_num_writers_.load() != 0)
+		{
+			std::this_thread::yield();
+		}
+
+		// Like the free list, the new space comes after the old one. The old part keeps the allocs of this frame at their
+		// offsets, and is treated as in flight for the next num_pre_frames_ frames. The GPU buffer is replaced in EnsureDataReady.
+		uint32_t const old_capacity = ring_capacity_;
+		uint32_t const new_capacity = std::max(old_capacity * 2, old_capacity + size_in_byte);
+		simulate_buffer_.resize(new_capacity);
+
+		uint64_t const base = (ring_head_.load() / new_capacity + 1) * new_capacity;
+		ring_tail_.store(base);
+		ring_head_.store(base + old_capacity);
+		ring_uploaded_ = base;
+		std::fill(ring_frame_fences_.begin(), ring_frame_fences_.end(), base);
+		ring_capacity_ = new_capacity;
+
+		ring_growing_.store(false);
+	}
+
+	void TransientBuffer::UpdateHighWaterMark(uint32_t used)
+	{
+		uint32_t high_water_mark = high_water_mark_.load(std::memory_order_relaxed);
+		while ((used > high_water_mark)
+			&& !high_water_mark_.compare_exchange_weak(high_water_mark, used, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	TransientBuffer::Stats TransientBuffer::GetStats() const
+	{
+		Stats stats;
+		stats.capacity = (alloc_mode_ == AM_Ring) ? ring_capacity_ : buffer_->Size();
+		stats.high_water_mark = high_water_mark_.load();
+		stats.num_wrap_stalls = num_wrap_stalls_.load();
+		return stats;
+	}
+
+	void TransientBuffer::ResetStats()
+	{
+		high_water_mark_ = 0;
+		num_wrap_stalls_ = 0;
+	}
+
 	void TransientBuffer::Dealloc(SubAlloc const & alloc)
 	{
 		if ((alloc.length_ > 0) && !retired_frames_.empty())
@@ -185,7 +313,14 @@ namespace KlayGE
 
 	void TransientBuffer::OnPresent()
 	{
-		if (!retired_frames_.empty())
+		if (alloc_mode_ == AM_Ring)
+		{
+			// Space allocated num_pre_frames_ frames ago isn't used by the GPU any more
+			ring_tail_.store(ring_frame_fences_[ring_fence_index_]);
+			ring_frame_fences_[ring_fence_index_] = ring_head_.load();
+			ring_fence_index_ = (ring_fence_index_ + 1) % num_pre_frames_;
+		}
+		else if (!retired_frames_.empty())
 		{
 			App3DFramework const & app = Context::Instance().AppInstance();
 			uint32_t const frame_id = app.TotalNumFrames();
@@ -220,6 +355,8 @@ namespace KlayGE
 
 	void TransientBuffer::DoFree(SubAlloc const & alloc)
 	{
+		used_size_ -= alloc.length_;
+
 		if (free_list_.empty())
 		{
 			free_list_.push_back(alloc);
@@ -283,7 +420,37 @@ namespace KlayGE
 
 	void TransientBuffer::EnsureDataReady()
 	{
-		if (!use_no_overwrite_)
+		if (alloc_mode_ == AM_Ring)
+		{
+			if (buffer_->Size() < ring_capacity_)
+			{
+				buffer_ = this->DoCreateBuffer(bind_flag_, ring_capacity_);
+			}
+
+			// Without no-overwrite, the mapping discards the buffer, so everything in flight has to be uploaded again
+			uint64_t const end = ring_head_.load();
+			uint64_t const begin = use_no_overwrite_ ? ring_uploaded_ : ring_tail_.load();
+			if (end > begin)
+			{
+				GraphicsBuffer::Mapper mapper(*buffer_, use_no_overwrite_ ? BA_Write_No_Overwrite : BA_Write_Only);
+				uint8_t* buffer_data = mapper.Pointer<uint8_t>();
+
+				if (end - begin >= ring_capacity_)
+				{
+					memcpy(buffer_data, &simulate_buffer_[0], ring_capacity_);
+				}
+				else
+				{
+					uint32_t const begin_offset = static_cast<uint32_t>(begin % ring_capacity_);
+					uint32_t const length = static_cast<uint32_t>(end - begin);
+					uint32_t const first_length = std::min(length, ring_capacity_ - begin_offset);
+					memcpy(buffer_data + begin_offset, &simulate_buffer_[begin_offset], first_length);
+					memcpy(buffer_data, &simulate_buffer_[0], length - first_length);
+				}
+			}
+			ring_uploaded_ = end;
+		}
+		else if (!use_no_overwrite_)
 		{
 			GraphicsBuffer::Mapper mapper(*buffer_, BA_Write_Only);
 			memcpy(mapper.Pointer<uint8_t>() + valid_min_, &simulate_buffer_[valid_min_],
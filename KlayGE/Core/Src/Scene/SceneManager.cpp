@@ -39,6 +39,8 @@
 #include <KFL/Util.hpp>
 #include <KlayGE/Context.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/SIMDMath.hpp>
+#include <KFL/Sort.hpp>
 #include <KlayGE/App3D.hpp>
 #include <KlayGE/Window.hpp>
 #include <KlayGE/Viewport.hpp>
@@ -59,6 +61,12 @@
 
 #include <KlayGE/SceneManager.hpp>
 
+namespace
+{
+	// Groups of 4 nodes tested by one thread pool task
+	size_t constexpr FRUSTUM_TEST_GROUPS_PER_TASK = 1024;
+}
+
 namespace KlayGE
 {
 	// 캯
@@ -118,9 +126,11 @@ namespace KlayGE
 		auto const& viewport = *re.CurFrameBuffer()->Viewport();
 		uint32_t const num_cameras = viewport.NumCameras();
 
-		for (auto* sn : all_scene_nodes_)
+		this->FrustumTestSceneNodes();
+
+		for (size_t n = 0; n < all_scene_nodes_.size(); ++ n)
 		{
-			auto& node = *sn;
+			auto& node = *all_scene_nodes_[n];
 			node.FillVisibleMark(BoundOverlap::No);
 			if (node.Visible())
 			{
@@ -152,7 +162,7 @@ namespace KlayGE
 
 							if (!camera.OmniDirectionalMode() && (attr & SceneNode::SOA_Cullable) && (BoundOverlap::Yes == visible))
 							{
-								visible = camera_frustums_[i]->Intersect(node.PosBoundWS());
+								visible = this->SceneNodeFrustumOverlap(n, i);
 							}
 						}
 
@@ -170,6 +180,85 @@ namespace KlayGE
 		}
 	}
 
+	void SceneManager::FrustumTestSceneNodes()
+	{
+		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		auto const& viewport = *re.CurFrameBuffer()->Viewport();
+		uint32_t const num_cameras = viewport.NumCameras();
+
+		size_t const num_groups = (all_scene_nodes_.size() + 3) / 4;
+		scene_node_bounds_.resize(num_groups);
+		scene_node_frustum_overlaps_.resize(num_groups * 4 * num_cameras);
+
+		auto test_groups = [this, &viewport, num_cameras, num_groups](size_t group_begin, size_t group_end)
+		{
+			for (size_t g = group_begin; g < group_end; ++ g)
+			{
+				auto& bounds = scene_node_bounds_[g];
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					size_t const index = g * 4 + j;
+					SceneNode const * node = (index < all_scene_nodes_.size()) ? all_scene_nodes_[index] : nullptr;
+					if ((node != nullptr) && node->Visible() && node->Updated() && (node->Attrib() & SceneNode::SOA_Cullable))
+					{
+						AABBox const & aabb = node->PosBoundWS();
+						bounds.min_x[j] = aabb.Min().x();
+						bounds.min_y[j] = aabb.Min().y();
+						bounds.min_z[j] = aabb.Min().z();
+						bounds.max_x[j] = aabb.Max().x();
+						bounds.max_y[j] = aabb.Max().y();
+						bounds.max_z[j] = aabb.Max().z();
+					}
+					else
+					{
+						// Never looked up, but keeps the lanes free of garbage
+						bounds.min_x[j] = bounds.min_y[j] = bounds.min_z[j] = 0;
+						bounds.max_x[j] = bounds.max_y[j] = bounds.max_z[j] = 0;
+					}
+				}
+			}
+
+			for (uint32_t i = 0; i < num_cameras; ++ i)
+			{
+				if (viewport.Camera(i)->OmniDirectionalMode())
+				{
+					continue;
+				}
+
+				Frustum const & frustum = *camera_frustums_[i];
+				BoundOverlap* overlaps = &scene_node_frustum_overlaps_[i * num_groups * 4];
+				for (size_t g = group_begin; g < group_end; ++ g)
+				{
+					auto const & bounds = scene_node_bounds_[g];
+					SIMDMathLib::IntersectAABBFrustum(&overlaps[g * 4],
+						SIMDMathLib::LoadVector4(bounds.min_x), SIMDMathLib::LoadVector4(bounds.min_y),
+						SIMDMathLib::LoadVector4(bounds.min_z), SIMDMathLib::LoadVector4(bounds.max_x),
+						SIMDMathLib::LoadVector4(bounds.max_y), SIMDMathLib::LoadVector4(bounds.max_z), frustum);
+				}
+			}
+		};
+
+		if (num_groups <= FRUSTUM_TEST_GROUPS_PER_TASK)
+		{
+			test_groups(0, num_groups);
+		}
+		else
+		{
+			auto& tp = Context::Instance().ThreadPoolInstance();
+			std::vector<std::future<void>> joiners;
+			for (size_t begin = FRUSTUM_TEST_GROUPS_PER_TASK; begin < num_groups; begin += FRUSTUM_TEST_GROUPS_PER_TASK)
+			{
+				size_t const end = std::min(begin + FRUSTUM_TEST_GROUPS_PER_TASK, num_groups);
+				joiners.push_back(tp.QueueThread([&test_groups, begin, end] { test_groups(begin, end); }));
+			}
+			test_groups(0, FRUSTUM_TEST_GROUPS_PER_TASK);
+			for (auto& joiner : joiners)
+			{
+				joiner.wait();
+			}
+		}
+	}
+
 	uint32_t SceneManager::NumFrameCameras() const
 	{
 		return static_cast<uint32_t>(frame_cameras_.size());
@@ -634,7 +723,8 @@ namespace KlayGE
 		{
 			if ((viewport.NumCameras() == 1) && !items.first->Transparent() && !items.first->HasDiscard() && (items.second.size() > 1))
 			{
-				std::vector<std::pair<float, uint32_t>> min_depths(items.second.size());
+				auto& min_depths = min_depths_;
+				min_depths.resize(items.second.size());
 				for (size_t j = 0; j < min_depths.size(); ++ j)
 				{
 					Renderable const * renderable = items.second[j];
@@ -657,14 +747,19 @@ namespace KlayGE
 					min_depths[j] = std::make_pair(md, static_cast<uint32_t>(j));
 				}
 
-				std::sort(min_depths.begin(), min_depths.end());
+				// Front to back. Stable, so equal depths keep the queue order.
+				RadixSort(std::span(min_depths), depth_sort_scratch_,
+					[](std::pair<float, uint32_t> const & md)
+					{
+						return md.first;
+					});
 
-				std::vector<Renderable*> sorted_items(min_depths.size());
+				sorted_items_.resize(min_depths.size());
 				for (size_t j = 0; j < min_depths.size(); ++ j)
 				{
-					sorted_items[j] = items.second[min_depths[j].second];
+					sorted_items_[j] = items.second[min_depths[j].second];
 				}
-				items.second.swap(sorted_items);
+				items.second.swap(sorted_items_);
 			}
 
 			for (auto const & item : items.second)
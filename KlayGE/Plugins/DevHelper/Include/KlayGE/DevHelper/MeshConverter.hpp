@@ -35,7 +35,9 @@
 
 #include <KlayGE/Mesh.hpp>
 
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <KlayGE/DevHelper/DevHelper.hpp>
 #include <KlayGE/DevHelper/MeshMetadata.hpp>
@@ -49,6 +51,8 @@ namespace KlayGE
 	{
 	public:
 		RenderModelPtr Load(MeshMetadata const & metadata);
+		// Also lists every file the model was read from, the sidecars of the source format included
+		RenderModelPtr Load(MeshMetadata const & metadata, std::vector<std::string>& dependencies);
 		void Save(RenderModel& model, std::string_view output_name);
 
 		static bool IsSupported(std::string_view input_name);
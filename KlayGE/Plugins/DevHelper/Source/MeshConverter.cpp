@@ -60,6 +60,7 @@
 #pragma clang diagnostic ignored "-Wdeprecated-copy" // Ignore implicit operator= in aiVector3t
 #endif
 #include <assimp/postprocess.h>
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
 #include <assimp/Exporter.hpp>
 #include <assimp/scene.h>
@@ -78,6 +79,29 @@ using namespace KlayGE;
 
 namespace
 {
+	// Records the files an importer reads, like the .bin buffers of a glTF or the .mtl of an OBJ
+	class DependencyRecordingIOSystem final : public Assimp::DefaultIOSystem
+	{
+	public:
+		explicit DependencyRecordingIOSystem(std::vector<std::string>& dependencies)
+			: dependencies_(dependencies)
+		{
+		}
+
+		Assimp::IOStream* Open(char const * file, char const * mode) override
+		{
+			Assimp::IOStream* stream = DefaultIOSystem::Open(file, mode);
+			if ((stream != nullptr) && (std::strchr(mode, 'w') == nullptr))
+			{
+				dependencies_.push_back(std::filesystem::absolute(file).lexically_normal().string());
+			}
+			return stream;
+		}
+
+	private:
+		std::vector<std::string>& dependencies_;
+	};
+
 	float3 Color4ToFloat3(aiColor4D const & c)
 	{
 		float3 v;
@@ -224,7 +248,7 @@ namespace
 	class MeshLoader
 	{
 	public:
-		RenderModelPtr Load(MeshMetadata const & metadata);
+		RenderModelPtr Load(MeshMetadata const & metadata, std::vector<std::string>* dependencies = nullptr);
 		bool IsSupported(std::string_view input_name) const;
 
 	private:
@@ -316,6 +340,8 @@ namespace
 		bool has_texcoord_;
 		bool has_diffuse_;
 		bool has_specular_;
+
+		std::vector<std::string>* dependencies_ = nullptr;
 	};
 
 	class MeshSaver
@@ -1077,6 +1103,10 @@ namespace
 			}
 
 			auto& importer = importers[lod];
+			if (dependencies_ != nullptr)
+			{
+				importer.SetIOHandler(new DependencyRecordingIOSystem(*dependencies_));
+			}
 
 			importer.SetPropertyInteger(AI_CONFIG_IMPORT_TER_MAKE_UVS, 1);
 			importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80);
@@ -3407,7 +3437,7 @@ namespace
 	}
 
 
-	RenderModelPtr MeshLoader::Load(MeshMetadata const & metadata)
+	RenderModelPtr MeshLoader::Load(MeshMetadata const & metadata, std::vector<std::string>* dependencies)
 	{
 		auto& res_loader = Context::Instance().ResLoaderInstance();
 		std::string_view const input_name = metadata.LodFileName(0);
@@ -3418,6 +3448,13 @@ namespace
 			return RenderModelPtr();
 		}
 
+		dependencies_ = dependencies;
+		if (dependencies_ != nullptr)
+		{
+			dependencies_->clear();
+			dependencies_->push_back(std::filesystem::absolute(input_name_str).lexically_normal().string());
+		}
+
 		std::filesystem::path input_path(input_name_str);
 		auto const in_folder = input_path.parent_path().string();
 		bool const in_path = res_loader.IsInPath(in_folder);
@@ -3901,6 +3938,16 @@ namespace KlayGE
 		return ml.Load(metadata);
 	}
 
+	RenderModelPtr MeshConverter::Load(MeshMetadata const & metadata, std::vector<std::string>& dependencies)
+	{
+		MeshLoader ml;
+		auto model = ml.Load(metadata, &dependencies);
+
+		std::sort(dependencies.begin(), dependencies.end());
+		dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+		return model;
+	}
+
 	void MeshConverter::Save(RenderModel& model, std::string_view output_name)
 	{
 		MeshSaver ms;
@@ -926,6 +926,9 @@ namespace KlayGE
 		caps_.independent_blend_support = true;
 		caps_.draw_indirect_support = true;
 		caps_.no_overwrite_support = true;
+		// Binding a constant buffer at an offset needs D3D11.1, and updates go through the whole buffer
+		caps_.partial_cbuffer_update_support = false;
+		caps_.cbuffer_offset_alignment = 0;
 		caps_.full_npot_texture_support = true;
 		caps_.render_to_texture_array_support = true;
 		caps_.explicit_multi_sample_support = true;
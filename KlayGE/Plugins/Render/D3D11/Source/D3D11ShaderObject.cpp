@@ -366,17 +366,13 @@ namespace KlayGE
 
 		if (is_validate_)
 		{
-			std::vector<std::pair<char const*, char const*>> macros;
-			macros.emplace_back("KLAYGE_D3D11", "1");
-			macros.emplace_back("KLAYGE_FRAG_DEPTH", "1");
-
 			uint32_t flags = D3DCOMPILE_ENABLE_STRICTNESS;
 #if !defined(KLAYGE_DEBUG)
 			flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 #endif
 			com_ptr<ID3D11ShaderReflection> reflection;
-			shader_code_ = ShaderStageObject::CompileToDXBC(
-				stage_, effect, tech, pass, macros, sd.func_name.c_str(), shader_profile_.c_str(), flags, reflection.put_void(), true);
+			shader_code_ = ShaderStageObject::CompileToDXBC(stage_, effect, tech, pass, this->ApiSpecialMacros(), sd.func_name.c_str(),
+				shader_profile_.c_str(), flags, reflection.put_void(), true);
 
 			if (!shader_code_.empty())
 			{
@@ -617,6 +613,11 @@ namespace KlayGE
 		return shader_profile;
 	}
 
+	std::vector<std::pair<char const*, char const*>> D3D11ShaderStageObject::ApiSpecialMacros() const
+	{
+		return {{"KLAYGE_D3D11", "1"}, {"KLAYGE_FRAG_DEPTH", "1"}};
+	}
+
 
 	D3D11VertexShaderStageObject::D3D11VertexShaderStageObject() : D3D11ShaderStageObject(ShaderStage::Vertex)
 	{
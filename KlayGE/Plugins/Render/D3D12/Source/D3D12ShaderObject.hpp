@@ -119,6 +119,7 @@ namespace KlayGE
 
 	private:
 		std::string_view GetShaderProfile(RenderEffect const& effect, uint32_t shader_desc_id) const override;
+		std::vector<std::pair<char const*, char const*>> ApiSpecialMacros() const override;
 		void FillCBufferIndices(RenderEffect const& effect);
 
 #if KLAYGE_IS_DEV_PLATFORM
@@ -283,24 +283,13 @@ namespace KlayGE
 
 		if (is_validate_)
 		{
-			std::vector<std::pair<char const*, char const*>> macros;
-			if (as_d3d12_)
-			{
-				macros.emplace_back("KLAYGE_D3D12", "1");
-			}
-			else
-			{
-				macros.emplace_back("KLAYGE_D3D11", "1");
-			}
-			macros.emplace_back("KLAYGE_FRAG_DEPTH", "1");
-
 			uint32_t flags = D3DCOMPILE_ENABLE_STRICTNESS;
 #if !defined(KLAYGE_DEBUG)
 			flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 #endif
 			com_ptr<ID3D11ShaderReflection> reflection;
-			shader_code_ = ShaderStageObject::CompileToDXBC(
-				stage_, effect, tech, pass, macros, sd.func_name.c_str(), shader_profile_.c_str(), flags, reflection.put_void(), true);
+			shader_code_ = ShaderStageObject::CompileToDXBC(stage_, effect, tech, pass, this->ApiSpecialMacros(), sd.func_name.c_str(),
+				shader_profile_.c_str(), flags, reflection.put_void(), true);
 
 			if (!shader_code_.empty())
 			{
@@ -481,6 +470,11 @@ namespace KlayGE
 		return shader_profile;
 	}
 
+	std::vector<std::pair<char const*, char const*>> D3DShaderStageObject::ApiSpecialMacros() const
+	{
+		return {{as_d3d12_ ? "KLAYGE_D3D12" : "KLAYGE_D3D11", "1"}, {"KLAYGE_FRAG_DEPTH", "1"}};
+	}
+
 
 	D3D11VertexShaderStageObject::D3D11VertexShaderStageObject() : D3DShaderStageObject(ShaderStage::Vertex, false)
 	{
@@ -798,46 +792,9 @@ namespace KlayGE
 			if (is_validate_)
 			{
 				std::string err_msg;
-				std::vector<std::pair<char const*, char const*>> macros;
-				macros.emplace_back("KLAYGE_DXBC2GLSL", "1");
-				if (as_gles_)
-				{
-					macros.emplace_back("KLAYGE_OPENGLES", "1");
-					if (!caps.TextureFormatSupport(EF_BC5) || !caps.TextureFormatSupport(EF_BC5_SRGB))
-					{
-						macros.emplace_back("KLAYGE_BC5_AS_AG", "1");
-					}
-					else
-					{
-						macros.emplace_back("KLAYGE_BC5_AS_GA", "1");
-					}
-				}
-				else
-				{
-					macros.emplace_back("KLAYGE_OPENGL", "1");
-					if (!caps.TextureFormatSupport(EF_BC5) || !caps.TextureFormatSupport(EF_BC5_SRGB))
-					{
-						macros.emplace_back("KLAYGE_BC5_AS_AG", "1");
-					}
-				}
-				if (!caps.TextureFormatSupport(EF_BC4) || !caps.TextureFormatSupport(EF_BC4_SRGB))
-				{
-					macros.emplace_back("KLAYGE_BC4_AS_G", "1");
-				}
-				if (as_gles_)
-				{
-					bool frag_depth_support;
-					re.GetCustomAttrib("FRAG_DEPTH_SUPPORT", &frag_depth_support);
-					macros.emplace_back("KLAYGE_FRAG_DEPTH", frag_depth_support ? "1" : "0");
-				}
-				else
-				{
-					macros.emplace_back("KLAYGE_FRAG_DEPTH", "1");
-				}
-
 				uint32_t const flags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_PREFER_FLOW_CONTROL | D3DCOMPILE_SKIP_OPTIMIZATION;
-				std::vector<uint8_t> code = ShaderStageObject::CompileToDXBC(
-					stage_, effect, tech, pass, macros, sd.func_name.c_str(), shader_profile.data(), flags, nullptr, false);
+				std::vector<uint8_t> code = ShaderStageObject::CompileToDXBC(stage_, effect, tech, pass, this->ApiSpecialMacros(),
+					sd.func_name.c_str(), shader_profile.data(), flags, nullptr, false);
 				if (code.empty())
 				{
 					is_validate_ = false;
@@ -1025,6 +982,50 @@ namespace KlayGE
 		return shader_profile;
 	}
 
+	std::vector<std::pair<char const*, char const*>> OGLShaderStageObject::ApiSpecialMacros() const
+	{
+		auto const& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		auto const& caps = re.DeviceCaps();
+
+		std::vector<std::pair<char const*, char const*>> macros;
+		macros.emplace_back("KLAYGE_DXBC2GLSL", "1");
+		if (as_gles_)
+		{
+			macros.emplace_back("KLAYGE_OPENGLES", "1");
+			if (!caps.TextureFormatSupport(EF_BC5) || !caps.TextureFormatSupport(EF_BC5_SRGB))
+			{
+				macros.emplace_back("KLAYGE_BC5_AS_AG", "1");
+			}
+			else
+			{
+				macros.emplace_back("KLAYGE_BC5_AS_GA", "1");
+			}
+		}
+		else
+		{
+			macros.emplace_back("KLAYGE_OPENGL", "1");
+			if (!caps.TextureFormatSupport(EF_BC5) || !caps.TextureFormatSupport(EF_BC5_SRGB))
+			{
+				macros.emplace_back("KLAYGE_BC5_AS_AG", "1");
+			}
+		}
+		if (!caps.TextureFormatSupport(EF_BC4) || !caps.TextureFormatSupport(EF_BC4_SRGB))
+		{
+			macros.emplace_back("KLAYGE_BC4_AS_G", "1");
+		}
+		if (as_gles_)
+		{
+			bool frag_depth_support;
+			re.GetCustomAttrib("FRAG_DEPTH_SUPPORT", &frag_depth_support);
+			macros.emplace_back("KLAYGE_FRAG_DEPTH", frag_depth_support ? "1" : "0");
+		}
+		else
+		{
+			macros.emplace_back("KLAYGE_FRAG_DEPTH", "1");
+		}
+		return macros;
+	}
+
 
 	OGLVertexShaderStageObject::OGLVertexShaderStageObject(bool as_gles)
 		: OGLShaderStageObject(ShaderStage::Vertex, GL_VERTEX_SHADER, as_gles)
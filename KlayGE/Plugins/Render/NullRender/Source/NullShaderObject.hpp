@@ -112,6 +112,7 @@ namespace KlayGE
 
 	private:
 		std::string_view GetShaderProfile(RenderEffect const& effect, uint32_t shader_desc_id) const override;
+		std::vector<std::pair<char const*, char const*>> ApiSpecialMacros() const override;
 		void FillCBufferIndices(RenderEffect const& effect);
 
 #ifdef KLAYGE_PLATFORM_WINDOWS_DESKTOP
@@ -260,6 +261,7 @@ namespace KlayGE
 
 	private:
 		std::string_view GetShaderProfile(RenderEffect const& effect, uint32_t shader_desc_id) const override;
+		std::vector<std::pair<char const*, char const*>> ApiSpecialMacros() const override;
 
 		virtual void StageSpecificAttachShader([[maybe_unused]] DXBC2GLSL::DXBC2GLSL const& dxbc2glsl)
 		{
@@ -496,6 +496,35 @@ namespace KlayGE
 		}
 	}
 
+	void OGLRenderEngine::BindBuffersRange(GLenum target, GLuint first, GLsizei count, GLuint const * buffers,
+		GLintptr const * offsets, GLsizeiptr const * sizes)
+	{
+		if (glloader_GL_VERSION_4_4() || glloader_GL_ARB_multi_bind())
+		{
+			glBindBuffersRange(target, first, count, buffers, offsets, sizes);
+		}
+		else
+		{
+			for (uint32_t i = first; i < first + count; ++ i)
+			{
+				glBindBufferRange(target, i, buffers[i - first], offsets[i - first], sizes[i - first]);
+			}
+			auto iter = binded_buffers_.find(target);
+			if (iter != binded_buffers_.end())
+			{
+				glBindBuffer(target, iter->second);
+			}
+		}
+
+		// The binding points are no longer bound as a whole
+		auto& binded = binded_buffers_with_binding_points_[target];
+		if (first + count > binded.size())
+		{
+			binded.resize(first + count, 0xFFFFFFFF);
+		}
+		std::fill(binded.begin() + first, binded.begin() + first + count, 0xFFFFFFFF);
+	}
+
 	void OGLRenderEngine::DeleteTextures(GLsizei n, GLuint const * textures)
 	{
 		for (GLsizei i = 0; i < n; ++ i)
@@ -1506,6 +1535,9 @@ namespace KlayGE
 		caps_.independent_blend_support = true;
 		caps_.draw_indirect_support = true;
 		caps_.no_overwrite_support = false;
+		caps_.partial_cbuffer_update_support = true;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &temp);
+		caps_.cbuffer_offset_alignment = temp;
 		caps_.full_npot_texture_support = true;
 		if (caps_.max_texture_array_length > 1)
 		{
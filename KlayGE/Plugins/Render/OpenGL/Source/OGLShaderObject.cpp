@@ -485,22 +485,9 @@ namespace KlayGE
 			if (is_validate_)
 			{
 				std::string err_msg;
-				std::vector<std::pair<char const*, char const*>> macros;
-				macros.emplace_back("KLAYGE_DXBC2GLSL", "1");
-				macros.emplace_back("KLAYGE_OPENGL", "1");
-				if (!caps.TextureFormatSupport(EF_BC5) || !caps.TextureFormatSupport(EF_BC5_SRGB))
-				{
-					macros.emplace_back("KLAYGE_BC5_AS_AG", "1");
-				}
-				if (!caps.TextureFormatSupport(EF_BC4) || !caps.TextureFormatSupport(EF_BC4_SRGB))
-				{
-					macros.emplace_back("KLAYGE_BC4_AS_G", "1");
-				}
-				macros.emplace_back("KLAYGE_FRAG_DEPTH", "1");
-
 				uint32_t const flags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_PREFER_FLOW_CONTROL | D3DCOMPILE_SKIP_OPTIMIZATION;
-				std::vector<uint8_t> code = ShaderStageObject::CompileToDXBC(
-					stage_, effect, tech, pass, macros, sd.func_name.c_str(), shader_profile.data(), flags, nullptr, false);
+				std::vector<uint8_t> code = ShaderStageObject::CompileToDXBC(stage_, effect, tech, pass, this->ApiSpecialMacros(),
+					sd.func_name.c_str(), shader_profile.data(), flags, nullptr, false);
 				if (code.empty())
 				{
 					is_validate_ = false;
@@ -698,6 +685,25 @@ namespace KlayGE
 		return shader_profile;
 	}
 
+	std::vector<std::pair<char const*, char const*>> OGLShaderStageObject::ApiSpecialMacros() const
+	{
+		auto const& caps = Context::Instance().RenderFactoryInstance().RenderEngineInstance().DeviceCaps();
+
+		std::vector<std::pair<char const*, char const*>> macros;
+		macros.emplace_back("KLAYGE_DXBC2GLSL", "1");
+		macros.emplace_back("KLAYGE_OPENGL", "1");
+		if (!caps.TextureFormatSupport(EF_BC5) || !caps.TextureFormatSupport(EF_BC5_SRGB))
+		{
+			macros.emplace_back("KLAYGE_BC5_AS_AG", "1");
+		}
+		if (!caps.TextureFormatSupport(EF_BC4) || !caps.TextureFormatSupport(EF_BC4_SRGB))
+		{
+			macros.emplace_back("KLAYGE_BC4_AS_G", "1");
+		}
+		macros.emplace_back("KLAYGE_FRAG_DEPTH", "1");
+		return macros;
+	}
+
 	void OGLShaderStageObject::CreateHwShader(
 		RenderEffect const& effect, std::array<uint32_t, NumShaderStages> const& shader_desc_ids)
 	{
@@ -1546,14 +1552,37 @@ namespace KlayGE
 		{
 			std::vector<GLuint> gl_bind_cbuffs;
 			gl_bind_cbuffs.reserve(all_cbuff_indices_.size());
-			for (auto cb_index : all_cbuff_indices_)
+			if (auto* cbuff_ring = re.CBufferRing())
 			{
-				auto* cbuff = effect.CBufferByIndex(cb_index);
-				cbuff->Update();
-				gl_bind_cbuffs.push_back(checked_cast<OGLGraphicsBuffer&>(*cbuff->HWBuff()).GLvbo());	
+				// Versions in the ring are bound by offset
+				std::vector<GLintptr> gl_bind_offsets;
+				std::vector<GLsizeiptr> gl_bind_sizes;
+				gl_bind_offsets.reserve(all_cbuff_indices_.size());
+				gl_bind_sizes.reserve(all_cbuff_indices_.size());
+				for (auto cb_index : all_cbuff_indices_)
+				{
+					auto* cbuff = effect.CBufferByIndex(cb_index);
+					cbuff->Update();
+					gl_bind_cbuffs.push_back(checked_cast<OGLGraphicsBuffer&>(*cbuff->BoundBuff()).GLvbo());
+					gl_bind_offsets.push_back(cbuff->BoundOffset());
+					gl_bind_sizes.push_back(cbuff->Size());
+				}
+				cbuff_ring->EnsureDataReady();
+
+				re.BindBuffersRange(GL_UNIFORM_BUFFER, 0, static_cast<GLsizei>(gl_bind_cbuffs.size()), gl_bind_cbuffs.data(),
+					gl_bind_offsets.data(), gl_bind_sizes.data());
 			}
+			else
+			{
+				for (auto cb_index : all_cbuff_indices_)
+				{
+					auto* cbuff = effect.CBufferByIndex(cb_index);
+					cbuff->Update();
+					gl_bind_cbuffs.push_back(checked_cast<OGLGraphicsBuffer&>(*cbuff->HWBuff()).GLvbo());
+				}
 
-			re.BindBuffersBase(GL_UNIFORM_BUFFER, 0, static_cast<GLsizei>(gl_bind_cbuffs.size()), gl_bind_cbuffs.data());
+				re.BindBuffersBase(GL_UNIFORM_BUFFER, 0, static_cast<GLsizei>(gl_bind_cbuffs.size()), gl_bind_cbuffs.data());
+			}
 		}
 
 		if (!gl_bind_textures_.empty())
@@ -118,6 +118,7 @@ namespace KlayGE
 
 	private:
 		std::string_view GetShaderProfile(RenderEffect const& effect, uint32_t shader_desc_id) const override;
+		std::vector<std::pair<char const*, char const*>> ApiSpecialMacros() const override;
 
 		virtual void StageSpecificAttachShader([[maybe_unused]] DXBC2GLSL::DXBC2GLSL const& dxbc2glsl)
 		{
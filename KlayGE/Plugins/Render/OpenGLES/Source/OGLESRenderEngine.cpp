@@ -437,6 +437,28 @@ namespace KlayGE
 		}
 	}
 
+	void OGLESRenderEngine::BindBuffersRange(GLenum target, GLuint first, GLsizei count, GLuint const * buffers,
+		GLintptr const * offsets, GLsizeiptr const * sizes)
+	{
+		for (uint32_t i = first; i < first + count; ++ i)
+		{
+			glBindBufferRange(target, i, buffers[i - first], offsets[i - first], sizes[i - first]);
+		}
+		auto iter = binded_buffers_.find(target);
+		if (iter != binded_buffers_.end())
+		{
+			glBindBuffer(target, iter->second);
+		}
+
+		// The binding points are no longer bound as a whole
+		auto& binded = binded_buffers_with_binding_points_[target];
+		if (first + count > binded.size())
+		{
+			binded.resize(first + count, 0xFFFFFFFF);
+		}
+		std::fill(binded.begin() + first, binded.begin() + first + count, 0xFFFFFFFF);
+	}
+
 	void OGLESRenderEngine::DeleteTextures(GLsizei n, GLuint const * textures)
 	{
 		for (GLsizei i = 0; i < n; ++ i)
@@ -1474,6 +1496,9 @@ namespace KlayGE
 			caps_.draw_indirect_support = false;
 		}
 		caps_.no_overwrite_support = false;
+		caps_.partial_cbuffer_update_support = true;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &temp);
+		caps_.cbuffer_offset_alignment = temp;
 		if (this->HackForAndroidEmulator())
 		{
 			caps_.full_npot_texture_support = false;
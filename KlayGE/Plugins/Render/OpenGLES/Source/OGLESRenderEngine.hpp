@@ -64,6 +64,8 @@ namespace KlayGE
 		void BindSamplers(GLuint first, GLsizei count, GLuint const * samplers, bool force = false);
 		void BindBuffer(GLenum target, GLuint buffer, bool force = false);
 		void BindBuffersBase(GLenum target, GLuint first, GLsizei count, GLuint const * buffers, bool force = false);
+		void BindBuffersRange(GLenum target, GLuint first, GLsizei count, GLuint const * buffers, GLintptr const * offsets,
+			GLsizeiptr const * sizes);
 		void DeleteTextures(GLsizei n, GLuint const * buffers);
 		void DeleteSamplers(GLsizei n, GLuint const * samplers);
 		void DeleteBuffers(GLsizei n, GLuint const * buffers);
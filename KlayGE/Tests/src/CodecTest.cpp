@@ -0,0 +1,137 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/Codec.hpp>
+#include <KlayGE/LZ4Codec.hpp>
+#include <KlayGE/LZMACodec.hpp>
+#include <KlayGE/ResLoader.hpp>
+#include <KFL/CXX23/utility.hpp>
+#include <KFL/Timer.hpp>
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+void TestCodecRoundTrip(Codec& codec, std::vector<uint8_t> const & input)
+{
+	std::vector<uint8_t> encoded;
+	codec.Encode(encoded, input);
+
+	std::vector<uint8_t> decoded(input.size());
+	codec.Decode(decoded.data(), encoded, input.size());
+	EXPECT_TRUE(decoded == input);
+}
+
+std::vector<std::vector<uint8_t>> CodecTestInputs()
+{
+	std::vector<std::vector<uint8_t>> inputs;
+	inputs.emplace_back();
+	inputs.push_back({ 1, 2, 3 });
+
+	std::ranlux24_base gen;
+	for (size_t size : { 12U, 13U, 100U, 70000U, 300000U })
+	{
+		std::vector<uint8_t> input(size);
+		for (auto& b : input)
+		{
+			b = static_cast<uint8_t>(gen());
+		}
+		inputs.push_back(input);
+
+		for (auto& b : input)
+		{
+			b = static_cast<uint8_t>(gen() % 4);
+		}
+		inputs.push_back(input);
+
+		// Matches that overlap themselves
+		for (size_t i = 0; i < size; ++ i)
+		{
+			input[i] = static_cast<uint8_t>(i % 5);
+		}
+		inputs.push_back(input);
+
+		std::fill(input.begin(), input.end(), static_cast<uint8_t>(7));
+		inputs.push_back(input);
+	}
+
+	return inputs;
+}
+
+TEST(CodecTest, LZ4RoundTrip)
+{
+	LZ4Codec codec;
+	for (auto const & input : CodecTestInputs())
+	{
+		TestCodecRoundTrip(codec, input);
+	}
+}
+
+TEST(CodecTest, LZMARoundTrip)
+{
+	LZMACodec codec;
+	for (auto const & input : CodecTestInputs())
+	{
+		TestCodecRoundTrip(codec, input);
+	}
+}
+
+TEST(CodecTest, MakeCodec)
+{
+	for (uint32_t i = 0; i < std::to_underlying(CodecType::NumTypes); ++ i)
+	{
+		auto const type = static_cast<CodecType>(i);
+		auto codec = MakeCodec(type);
+		EXPECT_EQ(codec->Type(), type);
+	}
+}
+
+TEST(CodecTest, DISABLED_PerfDecode)
+{
+	auto& res_loader = Context::Instance().ResLoaderInstance();
+	res_loader.AddPath("../../Tests/media/EncodeDecodeTex");
+	res_loader.AddPath("../../Tests/media/MeshConverter");
+
+	for (std::string_view name : { "Lenna.dds", "leaf_v3_green_tex.dds", "anim.glb" })
+	{
+		ResIdentifierPtr res = res_loader.Open(name);
+		EXPECT_TRUE(res);
+		if (!res)
+		{
+			continue;
+		}
+
+		res->seekg(0, std::ios_base::end);
+		std::vector<uint8_t> input(static_cast<size_t>(res->tellg()));
+		res->seekg(0, std::ios_base::beg);
+		res->read(input.data(), input.size());
+
+		for (uint32_t i = 0; i < std::to_underlying(CodecType::NumTypes); ++ i)
+		{
+			auto codec = MakeCodec(static_cast<CodecType>(i));
+
+			std::vector<uint8_t> encoded;
+			Timer timer;
+			codec->Encode(encoded, input);
+			double const encode_time = timer.elapsed();
+
+			uint32_t const num_iterations = 10;
+			std::vector<uint8_t> decoded(input.size());
+			timer.restart();
+			for (uint32_t j = 0; j < num_iterations; ++ j)
+			{
+				codec->Decode(decoded.data(), encoded, input.size());
+			}
+			double const decode_time = timer.elapsed() / num_iterations;
+			EXPECT_TRUE(decoded == input);
+
+			double const mb = input.size() / 1e6;
+			std::cout << name << ' ' << (i == std::to_underlying(CodecType::LZMA) ? "LZMA" : "LZ4") << ": ratio "
+				<< static_cast<double>(encoded.size()) / input.size() << ", encode " << mb / encode_time << " MB/s, decode "
+				<< mb / decode_time << " MB/s" << std::endl;
+		}
+	}
+}
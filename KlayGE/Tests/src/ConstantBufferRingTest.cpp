@@ -0,0 +1,169 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/ConstantBufferRing.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/RenderFactory.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t constexpr ALIGNMENT = 256;
+	uint32_t constexpr NUM_FRAMES_IN_FLIGHT = 3;
+
+	// Sizes of cbuffers like the ones of a camera, a mesh and a material
+	uint32_t CBufferSize(uint32_t index)
+	{
+		uint32_t const sizes[] = { 400, 48, 96, 16, 1040 };
+		return sizes[index % std::size(sizes)];
+	}
+
+	bool NoOverlap(std::vector<std::pair<uint32_t, uint32_t>> allocs, uint32_t capacity)
+	{
+		std::sort(allocs.begin(), allocs.end());
+		for (size_t i = 0; i < allocs.size(); ++ i)
+		{
+			if ((allocs[i].first % ALIGNMENT != 0) || (allocs[i].first + allocs[i].second > capacity))
+			{
+				return false;
+			}
+			if ((i > 0) && (allocs[i - 1].first + allocs[i - 1].second > allocs[i].first))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST(ConstantBufferRingTest, FramesInFlightDontOverlap)
+{
+	uint32_t const num_allocs_per_frame = 64;
+	ConstantBufferRing ring(256 * 1024, ALIGNMENT, NUM_FRAMES_IN_FLIGHT);
+	EXPECT_EQ(ring.GetBuffer()->Size(), 256U * 1024);
+
+	std::vector<uint8_t> data(2048, 0xAB);
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> frames;
+	for (uint32_t frame = 0; frame < 16; ++ frame)
+	{
+		EXPECT_EQ(ring.FrameId(), frame);
+
+		std::vector<std::pair<uint32_t, uint32_t>> allocs;
+		for (uint32_t i = 0; i < num_allocs_per_frame; ++ i)
+		{
+			uint32_t const size = CBufferSize(i);
+			uint32_t offset;
+			EXPECT_TRUE(ring.Alloc(size, data.data(), offset));
+			allocs.emplace_back(offset, size);
+
+			if (i % 8 == 7)
+			{
+				ring.EnsureDataReady();
+			}
+		}
+		ring.EnsureDataReady();
+		frames.push_back(std::move(allocs));
+
+		// Together with the frames the GPU could still be reading
+		std::vector<std::pair<uint32_t, uint32_t>> in_flight;
+		for (size_t f = frames.size() - std::min<size_t>(frames.size(), NUM_FRAMES_IN_FLIGHT + 1); f < frames.size(); ++ f)
+		{
+			in_flight.insert(in_flight.end(), frames[f].begin(), frames[f].end());
+		}
+		EXPECT_TRUE(NoOverlap(in_flight, ring.GetStats().capacity));
+
+		ring.OnPresent();
+	}
+
+	auto const stats = ring.GetStats();
+	EXPECT_EQ(stats.num_full, 0U);
+	EXPECT_TRUE(stats.high_water_mark <= stats.capacity);
+}
+
+TEST(ConstantBufferRingTest, FullRingRecovers)
+{
+	ConstantBufferRing ring(16 * ALIGNMENT, ALIGNMENT, NUM_FRAMES_IN_FLIGHT);
+
+	uint8_t data[ALIGNMENT] = {};
+	uint32_t offset;
+	uint32_t num_allocs = 0;
+	while (ring.Alloc(sizeof(data), data, offset))
+	{
+		++ num_allocs;
+	}
+	ring.EnsureDataReady();
+	EXPECT_EQ(num_allocs, 16U);
+	EXPECT_EQ(ring.GetStats().num_full, 1U);
+	EXPECT_EQ(ring.GetStats().high_water_mark, 16 * ALIGNMENT);
+
+	// The space comes back once the frame that filled it is older than the frames in flight
+	uint32_t num_presents = 0;
+	do
+	{
+		ring.OnPresent();
+		++ num_presents;
+	} while (!ring.Alloc(sizeof(data), data, offset));
+	EXPECT_EQ(num_presents, NUM_FRAMES_IN_FLIGHT + 1);
+	EXPECT_EQ(offset, 0U);
+
+	ring.ResetStats();
+	EXPECT_EQ(ring.GetStats().num_full, 0U);
+}
+
+TEST(ConstantBufferRingTest, DISABLED_PerfUpload)
+{
+	uint32_t const num_cbuffers = 1024;
+	uint32_t const num_frames = 100;
+
+	RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+	std::vector<uint8_t> data(2048, 0xCD);
+
+	std::vector<GraphicsBufferPtr> cbuffers(num_cbuffers);
+	uint32_t bytes_per_frame = 0;
+	for (uint32_t i = 0; i < num_cbuffers; ++ i)
+	{
+		cbuffers[i] = rf.MakeConstantBuffer(BU_Dynamic, 0, CBufferSize(i), nullptr);
+		bytes_per_frame += CBufferSize(i);
+	}
+
+	Timer timer;
+	for (uint32_t frame = 0; frame < num_frames; ++ frame)
+	{
+		for (uint32_t i = 0; i < num_cbuffers; ++ i)
+		{
+			cbuffers[i]->UpdateSubresource(0, CBufferSize(i), data.data());
+		}
+	}
+	double const separate_time = timer.elapsed();
+
+	// Like a draw with 4 cbuffers
+	ConstantBufferRing ring(bytes_per_frame * 2 * (NUM_FRAMES_IN_FLIGHT + 1), ALIGNMENT, NUM_FRAMES_IN_FLIGHT);
+	timer.restart();
+	for (uint32_t frame = 0; frame < num_frames; ++ frame)
+	{
+		for (uint32_t i = 0; i < num_cbuffers; ++ i)
+		{
+			uint32_t offset;
+			EXPECT_TRUE(ring.Alloc(CBufferSize(i), data.data(), offset));
+			if (i % 4 == 3)
+			{
+				ring.EnsureDataReady();
+			}
+		}
+		ring.OnPresent();
+	}
+	double const ring_time = timer.elapsed();
+
+	uint32_t const num_updates = num_cbuffers * num_frames;
+	std::cout << num_cbuffers << " cbuffers per frame. Separate buffers " << separate_time * 1e9 / num_updates
+			  << " ns, ring " << ring_time * 1e9 / num_updates << " ns per update, high water mark "
+			  << ring.GetStats().high_water_mark << " bytes" << std::endl;
+}
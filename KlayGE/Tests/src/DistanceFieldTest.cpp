@@ -0,0 +1,79 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/DistanceField.hpp>
+#include <KFL/Math.hpp>
+
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	// Coverage of a ring and a bar, like a glyph, supersampled 4x4 per pixel
+	std::vector<float> GlyphCoverage(uint32_t size)
+	{
+		float const center = size / 2.0f;
+		float const outer_radius = size * 0.4f;
+		float const inner_radius = size * 0.25f;
+
+		std::vector<float> coverage(size * size);
+		for (uint32_t y = 0; y < size; ++ y)
+		{
+			for (uint32_t x = 0; x < size; ++ x)
+			{
+				uint32_t covered = 0;
+				for (uint32_t sy = 0; sy < 4; ++ sy)
+				{
+					for (uint32_t sx = 0; sx < 4; ++ sx)
+					{
+						float2 const pt(x + (sx + 0.5f) / 4, y + (sy + 0.5f) / 4);
+						float const r = MathLib::length(pt - float2(center, center));
+						bool const in_ring = (r < outer_radius) && (r > inner_radius);
+						bool const in_bar = (MathLib::abs(pt.x() - center) < size * 0.05f) && (pt.y() > size * 0.1f) && (pt.y() < size * 0.9f);
+						if (in_ring || in_bar)
+						{
+							++ covered;
+						}
+					}
+				}
+				coverage[y * size + x] = covered / 16.0f;
+			}
+		}
+		return coverage;
+	}
+}
+
+TEST(DistanceFieldTest, ComputeDistance)
+{
+	for (uint32_t size : { 128U, 1024U })
+	{
+		std::vector<float> const aa_2x_data = GlyphCoverage(size);
+
+		std::vector<float> expected;
+		ComputeDistanceReference(aa_2x_data, size, size, expected);
+
+		// The scratch is reused, as it is for every glyph in KFontGen
+		DistanceFieldScratch scratch;
+		std::vector<float> dist_data;
+		for (uint32_t i = 0; i < 2; ++ i)
+		{
+			ComputeDistance(aa_2x_data, size, size, dist_data, scratch);
+		}
+
+		EXPECT_EQ(dist_data.size(), expected.size());
+		float max_error = 0;
+		float sum_error = 0;
+		for (size_t i = 0; i < expected.size(); ++ i)
+		{
+			float const error = MathLib::abs(dist_data[i] - expected[i]);
+			max_error = std::max(max_error, error);
+			sum_error += error;
+		}
+		float const mean_error = sum_error / expected.size();
+
+		// In pixels of the distance field
+		EXPECT_LT(max_error, 1.0f);
+		EXPECT_LT(mean_error, 0.05f);
+	}
+}
@@ -4,7 +4,10 @@
 #include <KlayGE/TexCompressionETC.hpp>
 #include <KlayGE/Texture.hpp>
 #include <KlayGE/ResLoader.hpp>
+#include <KFL/CpuInfo.hpp>
 #include <KFL/Half.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
 
 #include <vector>
 #include <string>
@@ -229,6 +232,318 @@ void TestEncodeDecodeTex(std::string_view input_name, std::string_view tc_name,
 	EXPECT_LT(mse, threshold);
 }
 
+std::unique_ptr<TexCompression> CreateTexCodec(ElementFormat fmt)
+{
+	switch (fmt)
+	{
+	case EF_BC1:
+		return MakeUniquePtr<TexCompressionBC1>();
+
+	case EF_BC3:
+		return MakeUniquePtr<TexCompressionBC3>();
+
+	case EF_BC4:
+		return MakeUniquePtr<TexCompressionBC4>();
+
+	case EF_BC5:
+		return MakeUniquePtr<TexCompressionBC5>();
+
+	case EF_BC7:
+		return MakeUniquePtr<TexCompressionBC7>();
+
+	case EF_ETC1:
+		return MakeUniquePtr<TexCompressionETC1>();
+
+	default:
+		KFL_UNREACHABLE("Unsupported compression format");
+	}
+}
+
+void TestParallelEncodeDecodeTex(std::string_view input_name, ElementFormat fmt, TexCompressionMethod method)
+{
+	Context::Instance().ResLoaderInstance().AddPath("../../Tests/media/EncodeDecodeTex");
+
+	TexturePtr in_tex = LoadSoftwareTexture(input_name);
+	uint32_t const width = in_tex->Width(0);
+	uint32_t const height = in_tex->Height(0);
+	auto const & init_data = checked_cast<SoftwareTexture&>(*in_tex).SubresourceData();
+
+	uint32_t const block_width = BlockWidth(fmt);
+	uint32_t const block_height = BlockHeight(fmt);
+	uint32_t const row_pitch = (width + block_width - 1) / block_width * BlockBytes(fmt);
+	uint32_t const slice_pitch = (height + block_height - 1) / block_height * row_pitch;
+
+	auto codec = CreateTexCodec(fmt);
+	ThreadPool& tp = Context::Instance().ThreadPoolInstance();
+	uint32_t const num_threads = std::max(CpuInfo().NumHWThreads(), 2U);
+
+	std::vector<uint8_t> serial_blocks(slice_pitch);
+	codec->EncodeMemParallel(width, height, serial_blocks.data(), row_pitch, slice_pitch,
+		init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, method, tp, 1);
+
+	std::vector<uint8_t> parallel_blocks(slice_pitch);
+	codec->EncodeMemParallel(width, height, parallel_blocks.data(), row_pitch, slice_pitch,
+		init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, method, tp, num_threads);
+	EXPECT_TRUE(serial_blocks == parallel_blocks);
+
+	uint32_t const pixel_size = NumFormatBytes(DecodedFormat(fmt));
+	std::vector<uint8_t> serial_pixels(width * height * pixel_size);
+	codec->DecodeMem(width, height, serial_pixels.data(), width * pixel_size, width * height * pixel_size,
+		serial_blocks.data(), row_pitch, slice_pitch);
+
+	std::vector<uint8_t> parallel_pixels(width * height * pixel_size);
+	codec->DecodeMemParallel(width, height, parallel_pixels.data(), width * pixel_size, width * height * pixel_size,
+		serial_blocks.data(), row_pitch, slice_pitch, tp, num_threads);
+	EXPECT_TRUE(serial_pixels == parallel_pixels);
+}
+
+void PerfEncodeTex(std::string_view input_name, ElementFormat fmt, std::string_view fmt_name, TexCompressionMethod method)
+{
+	Context::Instance().ResLoaderInstance().AddPath("../../Tests/media/EncodeDecodeTex");
+
+	TexturePtr in_tex = LoadSoftwareTexture(input_name);
+	uint32_t const width = in_tex->Width(0);
+	uint32_t const height = in_tex->Height(0);
+	auto const & init_data = checked_cast<SoftwareTexture&>(*in_tex).SubresourceData();
+
+	uint32_t const block_width = BlockWidth(fmt);
+	uint32_t const block_height = BlockHeight(fmt);
+	uint32_t const row_pitch = (width + block_width - 1) / block_width * BlockBytes(fmt);
+	uint32_t const slice_pitch = (height + block_height - 1) / block_height * row_pitch;
+	std::vector<uint8_t> blocks(slice_pitch);
+
+	auto codec = CreateTexCodec(fmt);
+	ThreadPool& tp = Context::Instance().ThreadPoolInstance();
+	uint32_t const max_threads = CpuInfo().NumHWThreads();
+	for (uint32_t num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+	{
+		Timer timer;
+		codec->EncodeMemParallel(width, height, blocks.data(), row_pitch, slice_pitch,
+			init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, method, tp, num_threads);
+		double const elapsed = timer.elapsed();
+
+		std::cout << input_name << ' ' << fmt_name << ' ' << num_threads << " threads: "
+			<< width * height / elapsed / 1e6 << " MPixel/s" << std::endl;
+	}
+}
+
+// Compares EncodeBlocks against one EncodeBlock call per block, on every block of an ARGB8 texture
+void TestBatchEncodeTex(std::string_view input_name, ElementFormat fmt)
+{
+	Context::Instance().ResLoaderInstance().AddPath("../../Tests/media/EncodeDecodeTex");
+
+	TexturePtr in_tex = LoadSoftwareTexture(input_name);
+	uint32_t const width = in_tex->Width(0);
+	uint32_t const height = in_tex->Height(0);
+	auto const & init_data = checked_cast<SoftwareTexture&>(*in_tex).SubresourceData();
+
+	BOOST_ASSERT(NumFormatBytes(in_tex->Format()) == 4);
+
+	uint32_t const pixel_size = NumFormatBytes(DecodedFormat(fmt));
+	uint32_t const in_block_size = 16 * pixel_size;
+	uint32_t const out_block_size = BlockBytes(fmt);
+	uint32_t const num_blocks = (width / 4) * (height / 4);
+
+	std::vector<uint8_t> uncompressed(num_blocks * in_block_size);
+	for (uint32_t by = 0; by < height / 4; ++ by)
+	{
+		for (uint32_t bx = 0; bx < width / 4; ++ bx)
+		{
+			uint8_t* block = &uncompressed[(by * (width / 4) + bx) * in_block_size];
+			for (uint32_t y = 0; y < 4; ++ y)
+			{
+				uint8_t const * src = static_cast<uint8_t const *>(init_data[0].data) + (by * 4 + y) * init_data[0].row_pitch + bx * 4 * 4;
+				for (uint32_t x = 0; x < 4; ++ x)
+				{
+					uint8_t* dst = block + (y * 4 + x) * pixel_size;
+					switch (pixel_size)
+					{
+					case 1:
+						dst[0] = src[x * 4 + 2];
+						break;
+
+					case 2:
+						dst[0] = src[x * 4 + 2];
+						dst[1] = src[x * 4 + 1];
+						break;
+
+					default:
+						memcpy(dst, &src[x * 4], 4);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	auto codec = CreateTexCodec(fmt);
+	for (auto method : { TCM_Speed, TCM_Balanced, TCM_Quality })
+	{
+		std::vector<uint8_t> single_blocks(num_blocks * out_block_size);
+		for (uint32_t i = 0; i < num_blocks; ++ i)
+		{
+			codec->EncodeBlock(&single_blocks[i * out_block_size], &uncompressed[i * in_block_size], method);
+		}
+
+		std::vector<uint8_t> batch_blocks(num_blocks * out_block_size);
+		codec->EncodeBlocks(batch_blocks.data(), uncompressed.data(), num_blocks, method);
+
+		EXPECT_TRUE(single_blocks == batch_blocks);
+
+		// Batches that don't fill all the SIMD lanes
+		std::vector<uint8_t> partial_blocks(num_blocks * out_block_size);
+		for (uint32_t i = 0, batch = 1; i < num_blocks; i += batch, batch = batch % 11 + 1)
+		{
+			batch = std::min(batch, num_blocks - i);
+			codec->EncodeBlocks(&partial_blocks[i * out_block_size], &uncompressed[i * in_block_size], batch, method);
+		}
+		EXPECT_TRUE(single_blocks == partial_blocks);
+	}
+}
+
+// Returns the PSNR of every BC7 preset on the texture, in the order of BC7Preset
+std::vector<double> PerfBC7Presets(std::string_view input_name)
+{
+	Context::Instance().ResLoaderInstance().AddPath("../../Tests/media/EncodeDecodeTex");
+
+	TexturePtr in_tex = LoadSoftwareTexture(input_name);
+	uint32_t const width = in_tex->Width(0);
+	uint32_t const height = in_tex->Height(0);
+	auto const & init_data = checked_cast<SoftwareTexture&>(*in_tex).SubresourceData();
+
+	BOOST_ASSERT(NumFormatBytes(in_tex->Format()) == 4);
+
+	uint32_t const row_pitch = (width + 3) / 4 * BlockBytes(EF_BC7);
+	uint32_t const slice_pitch = (height + 3) / 4 * row_pitch;
+	std::vector<uint8_t> blocks(slice_pitch);
+	std::vector<uint8_t> decoded(width * height * 4);
+
+	ThreadPool& tp = Context::Instance().ThreadPoolInstance();
+	uint32_t const num_threads = CpuInfo().NumHWThreads();
+
+	static char const * preset_names[] = { "ByMethod", "UltraFast", "Fast", "Basic", "Slow" };
+	std::vector<double> psnrs;
+	for (int preset = BC7P_ByMethod; preset <= BC7P_Slow; ++ preset)
+	{
+		TexCompressionBC7 codec;
+		codec.Preset(static_cast<BC7Preset>(preset));
+
+		Timer timer;
+		codec.EncodeMemParallel(width, height, blocks.data(), row_pitch, slice_pitch,
+			init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, TCM_Balanced, tp, num_threads);
+		double const elapsed = timer.elapsed();
+
+		codec.DecodeMem(width, height, decoded.data(), width * 4, width * height * 4, blocks.data(), row_pitch, slice_pitch);
+
+		double mse = 0;
+		for (uint32_t y = 0; y < height; ++ y)
+		{
+			uint8_t const * src = static_cast<uint8_t const *>(init_data[0].data) + y * init_data[0].row_pitch;
+			uint8_t const * dst = &decoded[y * width * 4];
+			for (uint32_t x = 0; x < width * 4; ++ x)
+			{
+				double const diff = static_cast<double>(src[x]) - dst[x];
+				mse += diff * diff;
+			}
+		}
+		mse /= width * height * 4;
+		double const psnr = (mse > 0) ? 10 * log10(255.0 * 255.0 / mse) : 100.0;
+		psnrs.push_back(psnr);
+
+		std::cout << input_name << " BC7 " << preset_names[preset] << ": PSNR " << psnr << " dB, "
+			<< width * height / elapsed / 1e6 << " MPixel/s on " << num_threads << " threads" << std::endl;
+	}
+
+	return psnrs;
+}
+
+// Encodes the texture at one ETC1 effort level in several ways. The early-outs mustn't make the blocks depend on the thread count
+//  or on the codec instance.
+void TestETC1EffortDeterminism(std::string_view input_name, uint32_t effort, TexCompressionMethod method)
+{
+	Context::Instance().ResLoaderInstance().AddPath("../../Tests/media/EncodeDecodeTex");
+
+	TexturePtr in_tex = LoadSoftwareTexture(input_name);
+	uint32_t const width = in_tex->Width(0);
+	uint32_t const height = in_tex->Height(0);
+	auto const & init_data = checked_cast<SoftwareTexture&>(*in_tex).SubresourceData();
+
+	uint32_t const row_pitch = (width + 3) / 4 * BlockBytes(EF_ETC1);
+	uint32_t const slice_pitch = (height + 3) / 4 * row_pitch;
+
+	TexCompressionETC1 codec;
+	codec.Effort(effort);
+
+	std::vector<uint8_t> blocks(slice_pitch);
+	codec.EncodeMem(width, height, blocks.data(), row_pitch, slice_pitch,
+		init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, method);
+
+	std::vector<uint8_t> single_thread_blocks(slice_pitch);
+	codec.EncodeMemParallel(width, height, single_thread_blocks.data(), row_pitch, slice_pitch,
+		init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, method, Context::Instance().ThreadPoolInstance(), 1);
+	EXPECT_TRUE(blocks == single_thread_blocks);
+
+	std::vector<uint8_t> clone_blocks(slice_pitch);
+	codec.Clone()->EncodeMem(width, height, clone_blocks.data(), row_pitch, slice_pitch,
+		init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, method);
+	EXPECT_TRUE(blocks == clone_blocks);
+}
+
+// Encodes the texture at several ETC1 effort levels. Returns the PSNRs, from the highest effort to the lowest.
+std::vector<double> PerfETC1Effort(std::string_view input_name, TexCompressionMethod method)
+{
+	Context::Instance().ResLoaderInstance().AddPath("../../Tests/media/EncodeDecodeTex");
+
+	TexturePtr in_tex = LoadSoftwareTexture(input_name);
+	uint32_t const width = in_tex->Width(0);
+	uint32_t const height = in_tex->Height(0);
+	auto const & init_data = checked_cast<SoftwareTexture&>(*in_tex).SubresourceData();
+
+	BOOST_ASSERT(NumFormatBytes(in_tex->Format()) == 4);
+
+	uint32_t const row_pitch = (width + 3) / 4 * BlockBytes(EF_ETC1);
+	uint32_t const slice_pitch = (height + 3) / 4 * row_pitch;
+	std::vector<uint8_t> blocks(slice_pitch);
+	std::vector<uint8_t> decoded(width * height * 4);
+
+	std::vector<double> psnrs;
+	for (uint32_t effort : { 100U, 75U, 50U, 25U, 0U })
+	{
+		TexCompressionETC1 codec;
+		codec.Effort(effort);
+
+		Timer timer;
+		codec.EncodeMem(width, height, blocks.data(), row_pitch, slice_pitch,
+			init_data[0].data, init_data[0].row_pitch, init_data[0].slice_pitch, method);
+		double const elapsed = timer.elapsed();
+
+		codec.DecodeMem(width, height, decoded.data(), width * 4, width * height * 4, blocks.data(), row_pitch, slice_pitch);
+
+		double mse = 0;
+		for (uint32_t y = 0; y < height; ++ y)
+		{
+			uint8_t const * src = static_cast<uint8_t const *>(init_data[0].data) + y * init_data[0].row_pitch;
+			uint8_t const * dst = &decoded[y * width * 4];
+			for (uint32_t x = 0; x < width; ++ x)
+			{
+				for (uint32_t c = 0; c < 3; ++ c)
+				{
+					double const diff = static_cast<double>(src[x * 4 + c]) - dst[x * 4 + c];
+					mse += diff * diff;
+				}
+			}
+		}
+		mse /= width * height * 3;
+		double const psnr = (mse > 0) ? 10 * log10(255.0 * 255.0 / mse) : 100.0;
+		psnrs.push_back(psnr);
+
+		std::cout << input_name << " ETC1 method " << method << " effort " << effort << ": PSNR " << psnr << " dB, "
+			<< width * height / elapsed / 1e6 << " MPixel/s" << std::endl;
+	}
+
+	return psnrs;
+}
+
 TEST(EncodeDecodeTexTest, DecodeBC1)
 {
 	TestEncodeDecodeTex("Lenna.dds", "Lenna_bc1.dds", EF_BC1, 4.7f);
@@ -293,3 +608,80 @@ TEST(EncodeDecodeTexTest, EncodeDecodeETC1)
 {
 	TestEncodeDecodeTex("Lenna.dds", "", EF_ETC1, 4.8f);
 }
+
+TEST(EncodeDecodeTexTest, ParallelEncodeDecodeBC1)
+{
+	TestParallelEncodeDecodeTex("Lenna.dds", EF_BC1, TCM_Quality);
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeDecodeBC3)
+{
+	TestParallelEncodeDecodeTex("leaf_v3_green_tex.dds", EF_BC3, TCM_Quality);
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeDecodeBC7)
+{
+	TestParallelEncodeDecodeTex("leaf_v3_green_tex.dds", EF_BC7, TCM_Balanced);
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeDecodeETC1)
+{
+	TestParallelEncodeDecodeTex("Lenna.dds", EF_ETC1, TCM_Balanced);
+}
+
+TEST(EncodeDecodeTexTest, BatchEncodeBC1)
+{
+	TestBatchEncodeTex("leaf_v3_green_tex.dds", EF_BC1);
+}
+
+TEST(EncodeDecodeTexTest, BatchEncodeBC3)
+{
+	TestBatchEncodeTex("leaf_v3_green_tex.dds", EF_BC3);
+}
+
+TEST(EncodeDecodeTexTest, BatchEncodeBC4)
+{
+	TestBatchEncodeTex("Lenna.dds", EF_BC4);
+}
+
+TEST(EncodeDecodeTexTest, BatchEncodeBC5)
+{
+	TestBatchEncodeTex("Lenna.dds", EF_BC5);
+}
+
+TEST(EncodeDecodeTexTest, DISABLED_PerfBC7Presets)
+{
+	for (auto name : { "Lenna.dds", "leaf_v3_green_tex.dds" })
+	{
+		auto const psnrs = PerfBC7Presets(name);
+		EXPECT_GE(psnrs[BC7P_Slow], psnrs[BC7P_UltraFast]);
+	}
+}
+
+TEST(EncodeDecodeTexTest, ETC1EffortDeterminism)
+{
+	for (auto method : { TCM_Speed, TCM_Balanced })
+	{
+		for (uint32_t effort : { 100U, 50U, 0U })
+		{
+			TestETC1EffortDeterminism("Lenna.dds", effort, method);
+		}
+	}
+}
+
+TEST(EncodeDecodeTexTest, DISABLED_PerfETC1Effort)
+{
+	for (auto method : { TCM_Speed, TCM_Balanced })
+	{
+		auto const psnrs = PerfETC1Effort("Lenna.dds", method);
+		EXPECT_GE(psnrs.front(), psnrs.back());
+	}
+}
+
+TEST(EncodeDecodeTexTest, DISABLED_PerfParallelEncode)
+{
+	PerfEncodeTex("Lenna.dds", EF_BC1, "BC1", TCM_Quality);
+	PerfEncodeTex("leaf_v3_green_tex.dds", EF_BC3, "BC3", TCM_Quality);
+	PerfEncodeTex("Lenna.dds", EF_BC7, "BC7", TCM_Balanced);
+	PerfEncodeTex("Lenna.dds", EF_ETC1, "ETC1", TCM_Balanced);
+}
@@ -0,0 +1,204 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/ResIdentifier.hpp>
+#include <KFL/Timer.hpp>
+#include <kfont/kfont.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t constexpr CHAR_SIZE = 32;
+
+	struct TestGlyph
+	{
+		wchar_t ch;
+		uint32_t adv;
+		bool empty;
+		KFont::font_info fi;
+		std::vector<uint8_t> dist;
+	};
+
+	// Every third char is a space-like one without a glyph
+	std::vector<TestGlyph> MakeGlyphs(uint32_t num_chars)
+	{
+		std::ranlux24_base gen(1);
+		std::uniform_int_distribution<uint32_t> dis(0, 255);
+
+		std::vector<TestGlyph> glyphs(num_chars);
+		for (uint32_t i = 0; i < num_chars; ++ i)
+		{
+			auto& glyph = glyphs[i];
+			glyph.ch = static_cast<wchar_t>(0x4E00 + i);
+			glyph.adv = (i << 16) + 16;
+			glyph.empty = (i % 3 == 2);
+			glyph.fi.top = static_cast<int16_t>(i % 7);
+			glyph.fi.left = -static_cast<int16_t>(i % 5);
+			glyph.fi.width = static_cast<uint16_t>(CHAR_SIZE - i % 4);
+			glyph.fi.height = static_cast<uint16_t>(CHAR_SIZE - i % 3);
+			if (!glyph.empty)
+			{
+				// Smooth enough to compress like a distance field
+				glyph.dist.resize(CHAR_SIZE * CHAR_SIZE);
+				uint32_t const bias = dis(gen);
+				for (uint32_t y = 0; y < CHAR_SIZE; ++ y)
+				{
+					for (uint32_t x = 0; x < CHAR_SIZE; ++ x)
+					{
+						glyph.dist[y * CHAR_SIZE + x] = static_cast<uint8_t>((x * 8 + y * 4 + bias) & 0xFF);
+					}
+				}
+			}
+		}
+		return glyphs;
+	}
+
+	void SaveWithKFont(std::vector<TestGlyph> const & glyphs, std::string const & file_name)
+	{
+		KFont kfont;
+		kfont.CharSize(CHAR_SIZE);
+		kfont.DistBase(-100);
+		kfont.DistScale(200);
+		for (auto const & glyph : glyphs)
+		{
+			if (glyph.empty)
+			{
+				kfont.SetLZMADistanceData(glyph.ch, nullptr, 0, glyph.adv, glyph.fi);
+			}
+			else
+			{
+				kfont.SetDistanceData(glyph.ch, glyph.dist.data(), glyph.adv, glyph.fi);
+			}
+		}
+		kfont.Save(file_name);
+	}
+
+	// The glyphs are split among the threads round-robin, so many of them arrive out of order
+	bool SaveWithKFontWriter(std::vector<TestGlyph> const & glyphs, std::string const & file_name, uint32_t num_threads,
+		uint32_t max_pending_glyphs, uint32_t& pending_high_water_mark)
+	{
+		KFontWriter writer(max_pending_glyphs);
+		writer.CharSize(CHAR_SIZE);
+		writer.DistBase(-100);
+		writer.DistScale(200);
+		for (auto const & glyph : glyphs)
+		{
+			if (glyph.empty)
+			{
+				writer.AddChar(glyph.ch, glyph.adv);
+			}
+			else
+			{
+				writer.AddChar(glyph.ch, glyph.adv, glyph.fi);
+			}
+		}
+		if (!writer.Open(file_name))
+		{
+			return false;
+		}
+
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < num_threads; ++ t)
+		{
+			threads.emplace_back([&glyphs, &writer, t, num_threads]
+				{
+					for (uint32_t i = t; i < glyphs.size(); i += num_threads)
+					{
+						auto const & glyph = glyphs[i];
+						if (!glyph.empty)
+						{
+							writer.CommitDistanceData(writer.CharIndex(glyph.ch), glyph.dist.data());
+						}
+					}
+				});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		pending_high_water_mark = writer.MaxPendingGlyphs();
+		return writer.Close();
+	}
+
+	std::vector<char> ReadFile(std::string const & file_name)
+	{
+		std::ifstream file(file_name.c_str(), std::ios_base::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+}
+
+TEST(KFontTest, WriterMatchesSave)
+{
+	auto const glyphs = MakeGlyphs(300);
+
+	SaveWithKFont(glyphs, "KFontTestSave.kfont");
+	uint32_t pending_high_water_mark;
+	EXPECT_TRUE(SaveWithKFontWriter(glyphs, "KFontTestWriter.kfont", 4, 16, pending_high_water_mark));
+	EXPECT_TRUE(pending_high_water_mark <= 16);
+
+	auto const saved = ReadFile("KFontTestSave.kfont");
+	auto const written = ReadFile("KFontTestWriter.kfont");
+	EXPECT_TRUE(!saved.empty());
+	EXPECT_TRUE(saved == written);
+
+	KFont kfont;
+	EXPECT_TRUE(kfont.Load("KFontTestWriter.kfont"));
+	EXPECT_EQ(kfont.CharSize(), CHAR_SIZE);
+	EXPECT_EQ(kfont.DistBase(), -100);
+	EXPECT_EQ(kfont.DistScale(), 200);
+
+	std::vector<uint8_t> dist(CHAR_SIZE * CHAR_SIZE);
+	for (auto const & glyph : glyphs)
+	{
+		EXPECT_EQ(kfont.CharAdvance(glyph.ch), glyph.adv);
+
+		int32_t const index = kfont.CharIndex(glyph.ch);
+		if (glyph.empty)
+		{
+			EXPECT_EQ(index, -1);
+		}
+		else
+		{
+			EXPECT_TRUE(index >= 0);
+			KFont::font_info const & fi = kfont.CharInfo(index);
+			EXPECT_EQ(fi.top, glyph.fi.top);
+			EXPECT_EQ(fi.left, glyph.fi.left);
+			EXPECT_EQ(fi.width, glyph.fi.width);
+			EXPECT_EQ(fi.height, glyph.fi.height);
+
+			kfont.GetDistanceData(dist.data(), CHAR_SIZE, index);
+			EXPECT_TRUE(dist == glyph.dist);
+		}
+	}
+}
+
+TEST(KFontTest, DISABLED_PerfWrite)
+{
+	auto const glyphs = MakeGlyphs(6000);
+
+	Timer timer;
+	SaveWithKFont(glyphs, "KFontTestSave.kfont");
+	std::cout << "KFont::Save: " << timer.elapsed() << " s" << std::endl;
+
+	for (uint32_t num_threads : { 1U, 4U })
+	{
+		timer.restart();
+		uint32_t pending_high_water_mark;
+		EXPECT_TRUE(SaveWithKFontWriter(glyphs, "KFontTestWriter.kfont", num_threads, 1024, pending_high_water_mark));
+		std::cout << "KFontWriter, " << num_threads << " threads: " << timer.elapsed() << " s, at most "
+				  << pending_high_water_mark << " glyphs queued" << std::endl;
+	}
+
+	EXPECT_TRUE(ReadFile("KFontTestSave.kfont") == ReadFile("KFontTestWriter.kfont"));
+}
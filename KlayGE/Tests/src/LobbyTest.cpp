@@ -0,0 +1,161 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Lobby.hpp>
+#include <KlayGE/NetMsg.hpp>
+#include <KlayGE/Socket.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	char constexpr MSG_ECHO = 100;
+	uint32_t constexpr ECHO_PAYLOAD_SIZE = 8;
+
+	class EchoProcessor : public Processor
+	{
+	public:
+		void OnDefault(void* revBuf, [[maybe_unused]] int maxSize, void* sendBuf, int& numSend,
+			[[maybe_unused]] sockaddr_in& from) const override
+		{
+			std::memcpy(static_cast<char*>(sendBuf) + 1, static_cast<char const *>(revBuf) + 1, ECHO_PAYLOAD_SIZE);
+			numSend = ECHO_PAYLOAD_SIZE;
+		}
+	};
+
+	struct BenchmarkResult
+	{
+		uint32_t num_joined;
+		uint32_t num_replies;
+		uint32_t num_wrong_replies;
+		double msgs_per_sec;
+	};
+
+	// Simulated players on their own sockets send echo messages to a lobby on the loopback. The ones past the lobby's
+	// 127 seats don't get in, but are echoed all the same.
+	// At most a group of players have messages in flight, so the lobby's receive buffer doesn't overflow.
+	BenchmarkResult RunLobbyBenchmark(LobbyIOMode mode, uint32_t num_players, uint32_t num_rounds)
+	{
+		uint32_t constexpr GROUP_SIZE = 64;
+
+		// On a port the system picks, so tests running at the same time don't collide
+		EchoProcessor processor;
+		Lobby lobby;
+		lobby.Bind(0);
+		sockaddr_in const lobby_addr = TransAddr("127.0.0.1", ntohs(lobby.SockAddr().sin_port));
+
+		std::thread lobby_thread(
+			[&lobby, &processor, mode]
+			{
+				lobby.Create("Benchmark", 127, 0, processor, mode);
+			});
+
+		std::vector<std::unique_ptr<Socket>> players(num_players);
+		for (auto& player : players)
+		{
+			player = MakeUniquePtr<Socket>();
+			player->Create(SOCK_DGRAM);
+			player->Bind(TransAddr("127.0.0.1", 0));
+			player->TimeOut(1000);
+		}
+
+		BenchmarkResult result{};
+
+		// Joins are retried, like a player would on a lost datagram
+		for (auto& player : players)
+		{
+			char buf[Max_Buffer] = { MSG_JOIN, 'P' };
+			for (uint32_t retry = 0; retry < 3; ++ retry)
+			{
+				player->SendTo(buf, sizeof(buf), lobby_addr);
+
+				char reply[Max_Buffer];
+				sockaddr_in from;
+				if (player->ReceiveFrom(reply, sizeof(reply), from) >= 2)
+				{
+					if ((reply[0] == MSG_JOIN) && (reply[1] == 0))
+					{
+						++ result.num_joined;
+					}
+					break;
+				}
+			}
+		}
+
+		Timer timer;
+		for (uint32_t round = 0; round < num_rounds; ++ round)
+		{
+			for (uint32_t group_start = 0; group_start < num_players; group_start += GROUP_SIZE)
+			{
+				uint32_t const group_end = std::min(group_start + GROUP_SIZE, num_players);
+				for (uint32_t i = group_start; i < group_end; ++ i)
+				{
+					char buf[1 + ECHO_PAYLOAD_SIZE] = { MSG_ECHO };
+					uint32_t const tag = round * num_players + i;
+					std::memcpy(&buf[1], &tag, sizeof(tag));
+					players[i]->SendTo(buf, sizeof(buf), lobby_addr);
+				}
+				for (uint32_t i = group_start; i < group_end; ++ i)
+				{
+					char reply[Max_Buffer];
+					sockaddr_in from;
+					if (players[i]->ReceiveFrom(reply, sizeof(reply), from) == 1 + ECHO_PAYLOAD_SIZE)
+					{
+						uint32_t tag;
+						std::memcpy(&tag, &reply[1], sizeof(tag));
+						if ((reply[0] == MSG_ECHO) && (tag == round * num_players + i))
+						{
+							++ result.num_replies;
+						}
+						else
+						{
+							++ result.num_wrong_replies;
+						}
+					}
+				}
+			}
+		}
+		result.msgs_per_sec = result.num_replies / timer.elapsed();
+
+		// An empty datagram stops the lobby
+		players[0]->SendTo(nullptr, 0, lobby_addr);
+		lobby_thread.join();
+
+		return result;
+	}
+}
+
+TEST(LobbyTest, EventDrivenEcho)
+{
+	uint32_t const num_players = 200;
+	uint32_t const num_rounds = 10;
+	auto const result = RunLobbyBenchmark(LobbyIOMode::EventDriven, num_players, num_rounds);
+
+	// The player count is a char, so only 127 get in
+	EXPECT_EQ(result.num_joined, 127U);
+	EXPECT_EQ(result.num_wrong_replies, 0U);
+	EXPECT_EQ(result.num_replies, num_players * num_rounds);
+}
+
+TEST(LobbyTest, DISABLED_PerfLoopback)
+{
+	// A full lobby. The player count is a char, so that's 127.
+	uint32_t const num_players = 127;
+	uint32_t const num_rounds = 400;
+	for (auto mode : { LobbyIOMode::Blocking, LobbyIOMode::EventDriven })
+	{
+		auto const result = RunLobbyBenchmark(mode, num_players, num_rounds);
+		EXPECT_EQ(result.num_joined, num_players);
+		EXPECT_EQ(result.num_wrong_replies, 0U);
+
+		std::cout << (mode == LobbyIOMode::Blocking ? "Blocking" : "Event driven") << ": " << num_players << " players, "
+			<< result.num_replies << " replies, " << result.msgs_per_sec << " msgs/s" << std::endl;
+	}
+}
@@ -0,0 +1,201 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	// Captures everything logged to std::clog, which is a sink in every build
+	class ClogCapture final
+	{
+	public:
+		ClogCapture()
+		{
+			FlushLog();
+			old_buff_ = std::clog.rdbuf(stream_.rdbuf());
+		}
+
+		~ClogCapture()
+		{
+			FlushLog();
+			std::clog.rdbuf(old_buff_);
+		}
+
+		// Only safe to call when the writer is idle, e.g. after FlushLog()
+		std::string Text() const
+		{
+			return stream_.str();
+		}
+
+		std::vector<std::string> Lines() const
+		{
+			std::vector<std::string> ret;
+			std::istringstream iss(this->Text());
+			std::string line;
+			while (std::getline(iss, line))
+			{
+				ret.push_back(line);
+			}
+			return ret;
+		}
+
+	private:
+		std::ostringstream stream_;
+		std::streambuf* old_buff_;
+	};
+
+	// Records of each thread must come out complete, and in the order they were logged
+	void ExpectThreadRecordsInOrder(std::vector<std::string> const & lines, std::string const & tag, uint32_t num_threads,
+		uint32_t num_records_per_thread)
+	{
+		std::vector<uint32_t> next(num_threads, 0);
+		for (auto const & line : lines)
+		{
+			auto const pos = line.find(tag);
+			if (pos == std::string::npos)
+			{
+				continue;
+			}
+
+			std::istringstream iss(line.substr(pos + tag.size()));
+			uint32_t thread_index = 0;
+			uint32_t record_index = 0;
+			iss >> thread_index >> record_index;
+			ASSERT_LT(thread_index, num_threads);
+			EXPECT_EQ(record_index, next[thread_index]);
+			next[thread_index] = record_index + 1;
+		}
+		for (uint32_t i = 0; i < num_threads; ++ i)
+		{
+			EXPECT_EQ(next[i], num_records_per_thread);
+		}
+	}
+}
+
+TEST(LogTest, RingWraparound)
+{
+	SetLogMode(LogMode::Async);
+
+	ClogCapture capture;
+
+	// Far more records than the ring holds, so it wraps around and producers have to wait for the writer
+	uint32_t const num_threads = 4;
+	uint32_t const num_records_per_thread = 3000;
+	std::vector<std::thread> threads;
+	for (uint32_t i = 0; i < num_threads; ++ i)
+	{
+		threads.emplace_back([i, num_records_per_thread] {
+			for (uint32_t j = 0; j < num_records_per_thread; ++ j)
+			{
+				LogInfo() << "ring " << i << ' ' << j << std::endl;
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	FlushLog();
+
+	ExpectThreadRecordsInOrder(capture.Lines(), "ring ", num_threads, num_records_per_thread);
+}
+
+TEST(LogTest, OrderAfterFlush)
+{
+	SetLogMode(LogMode::Async);
+
+	ClogCapture capture;
+
+	uint32_t const num_records = 100;
+	for (uint32_t i = 0; i < num_records; ++ i)
+	{
+		LogInfo() << "order 0 " << i << std::endl;
+	}
+	// Continues the same record
+	LogInfo() << "first half, ";
+	LogInfo() << "second half" << std::endl;
+	FlushLog();
+
+	auto const lines = capture.Lines();
+	ASSERT_EQ(lines.size(), num_records + 1);
+	ExpectThreadRecordsInOrder(lines, "order ", 1, num_records);
+	EXPECT_NE(lines.back().find("first half, second half"), std::string::npos);
+}
+
+TEST(LogTest, ErrorInRecordNotHeldBack)
+{
+	SetLogMode(LogMode::Async);
+
+	ClogCapture capture;
+
+	// Keeps the writer busy
+	for (uint32_t i = 0; i < 2000; ++ i)
+	{
+		LogInfo() << "busy " << i << std::endl;
+	}
+
+	// The record starts as info, but has an error in it. It must be written before returning, without FlushLog().
+	LogInfo() << "info then ";
+	LogError() << "error" << std::endl;
+	EXPECT_NE(capture.Text().find("info then error"), std::string::npos);
+}
+
+TEST(LogTest, SetLogModeWhilePending)
+{
+	SetLogMode(LogMode::Async);
+
+	{
+		ClogCapture capture;
+
+		uint32_t const num_records = 2000;
+		std::thread thread([num_records] {
+			for (uint32_t i = 0; i < num_records; ++ i)
+			{
+				LogInfo() << "pending 0 " << i << std::endl;
+			}
+		});
+		thread.join();
+
+		// Unfinished record of this thread
+		LogInfo() << "unfinished";
+
+		// Switching waits for the records still in the ring, and ends the unfinished one
+		SetLogMode(LogMode::Sync);
+		LogInfo() << "sync" << std::endl;
+
+		auto const text = capture.Text();
+		auto const last_async_pos = text.find("pending 0 " + std::to_string(num_records - 1));
+		auto const unfinished_pos = text.find("unfinished");
+		auto const sync_pos = text.find("(INFO) KlayGE: sync");
+		ASSERT_NE(last_async_pos, std::string::npos);
+		ASSERT_NE(unfinished_pos, std::string::npos);
+		ASSERT_NE(sync_pos, std::string::npos);
+		EXPECT_LT(last_async_pos, unfinished_pos);
+		EXPECT_LT(unfinished_pos, sync_pos);
+		ExpectThreadRecordsInOrder(capture.Lines(), "pending ", 1, num_records);
+	}
+
+	{
+		ClogCapture capture;
+
+		LogInfo() << "sync unfinished";
+		SetLogMode(LogMode::Async);
+		LogInfo() << "async" << std::endl;
+		FlushLog();
+
+		auto const text = capture.Text();
+		auto const sync_pos = text.find("sync unfinished");
+		auto const async_pos = text.find("KlayGE: async");
+		ASSERT_NE(sync_pos, std::string::npos);
+		ASSERT_NE(async_pos, std::string::npos);
+		EXPECT_LT(sync_pos, async_pos);
+	}
+}
@@ -818,3 +818,30 @@ TEST_F(MeshConverterTest, StaticMeshML)
 {
 	RunTest("tree2a.lod.meshml", "", "tree2a.lod.meshml");
 }
+
+TEST_F(MeshConverterTest, ModelBinChunks)
+{
+	SaveModel(*LoadSoftwareModel("anim.glb"), "anim_chunks.model_bin");
+	RunTest("anim.fbx", "", "anim_chunks.model_bin");
+
+	// Skipping the animation chunks gives a static model with the same meshes
+	auto model = LoadSoftwareModel("anim_chunks.model_bin");
+	auto static_model = LoadSoftwareModel("anim_chunks.model_bin", false);
+	EXPECT_TRUE(model->IsSkinned());
+	EXPECT_FALSE(static_model->IsSkinned());
+	EXPECT_EQ(static_model->NumMaterials(), model->NumMaterials());
+	EXPECT_EQ(static_model->NumMeshes(), model->NumMeshes());
+	for (uint32_t i = 0; i < model->NumMeshes(); ++ i)
+	{
+		auto const& mesh = checked_cast<StaticMesh&>(*model->Mesh(i));
+		auto const& static_mesh = checked_cast<StaticMesh&>(*static_model->Mesh(i));
+		EXPECT_EQ(static_mesh.NumVertices(0), mesh.NumVertices(0));
+		EXPECT_EQ(static_mesh.NumIndices(0), mesh.NumIndices(0));
+	}
+}
+
+TEST_F(MeshConverterTest, ModelBinLZ4)
+{
+	SaveModel(*LoadSoftwareModel("anim.glb"), "anim_lz4.model_bin", CodecType::LZ4);
+	RunTest("anim.fbx", "", "anim_lz4.model_bin");
+}
@@ -0,0 +1,196 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/ParticleSystem.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	// Moves every particle it's given by 1 along x, and counts them
+	class CountingParticleUpdater final : public ParticleUpdater
+	{
+	public:
+		CountingParticleUpdater()
+			: ParticleUpdater(ParticleSystemPtr())
+		{
+		}
+
+		std::string const & Type() const override
+		{
+			static std::string const type("counting");
+			return type;
+		}
+		ParticleUpdaterPtr Clone() override
+		{
+			return MakeSharedPtr<CountingParticleUpdater>();
+		}
+
+		void Update(Particle& par, [[maybe_unused]] float elapse_time) override
+		{
+			par.pos.x() += 1;
+			++ num_updates;
+		}
+		using ParticleUpdater::Update;
+
+		void SnapParams() override
+		{
+		}
+
+		uint32_t num_updates = 0;
+	};
+
+	// Alive and dead particles, with lives that end at different points of the polylines
+	void RandomParticles(ParticleStore& particles, std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> pos_dist(-10, 10);
+		std::uniform_real_distribution<float> life_dist(-0.5f, 3);
+		std::uniform_real_distribution<float> init_life_dist(3, 5);
+		for (uint32_t i = 0; i < particles.Size(); ++ i)
+		{
+			Particle par;
+			par.pos = float3(pos_dist(gen), pos_dist(gen), pos_dist(gen));
+			par.vel = float3(pos_dist(gen), pos_dist(gen), pos_dist(gen));
+			par.life = life_dist(gen);
+			par.spin = pos_dist(gen);
+			par.size = 1;
+			par.alpha = 1;
+			par.init_life = init_life_dist(gen);
+			particles.Set(i, par);
+		}
+	}
+
+	void ExpectParticleNear(Particle const & lhs, Particle const & rhs)
+	{
+		auto tolerance = [](float value)
+		{
+			return 1e-4f * std::max(1.0f, MathLib::abs(value));
+		};
+		for (uint32_t c = 0; c < 3; ++ c)
+		{
+			EXPECT_NEAR(lhs.pos[c], rhs.pos[c], tolerance(rhs.pos[c]));
+			EXPECT_NEAR(lhs.vel[c], rhs.vel[c], tolerance(rhs.vel[c]));
+		}
+		EXPECT_NEAR(lhs.life, rhs.life, tolerance(rhs.life));
+		EXPECT_NEAR(lhs.spin, rhs.spin, tolerance(rhs.spin));
+		EXPECT_NEAR(lhs.size, rhs.size, tolerance(rhs.size));
+		EXPECT_NEAR(lhs.alpha, rhs.alpha, tolerance(rhs.alpha));
+		EXPECT_EQ(lhs.init_life, rhs.init_life);
+	}
+}
+
+TEST(ParticleSystemTest, StoreResize)
+{
+	ParticleStore particles;
+	particles.Resize(10);
+
+	// Padded to a multiple of 4, with dead particles that are safe to compute on
+	EXPECT_EQ(particles.Size(), 12U);
+	for (auto const * arr : { &particles.pos_x, &particles.pos_y, &particles.pos_z, &particles.vel_x, &particles.vel_y,
+			 &particles.vel_z, &particles.life, &particles.spin, &particles.size, &particles.alpha, &particles.init_life })
+	{
+		EXPECT_EQ(arr->size(), particles.Size());
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(arr->data()) % 16, 0U);
+	}
+	for (uint32_t i = 0; i < particles.Size(); ++ i)
+	{
+		EXPECT_EQ(particles.life[i], 0.0f);
+		EXPECT_EQ(particles.init_life[i], 1.0f);
+	}
+}
+
+TEST(ParticleSystemTest, StoreAddRemove)
+{
+	ParticleStore particles;
+	particles.Resize(10);
+
+	// Adding is setting a slot
+	Particle par;
+	par.pos = float3(1, 2, 3);
+	par.vel = float3(4, 5, 6);
+	par.life = 7;
+	par.spin = 8;
+	par.size = 9;
+	par.alpha = 0.5f;
+	par.init_life = 10;
+	for (uint32_t i = 0; i < 10; ++ i)
+	{
+		particles.Set(i, par);
+	}
+	Particle const got = particles.Get(5);
+	EXPECT_EQ(got.pos, par.pos);
+	EXPECT_EQ(got.vel, par.vel);
+	EXPECT_EQ(got.life, par.life);
+	EXPECT_EQ(got.spin, par.spin);
+	EXPECT_EQ(got.size, par.size);
+	EXPECT_EQ(got.alpha, par.alpha);
+	EXPECT_EQ(got.init_life, par.init_life);
+
+	// Removing is ending the life. Updaters skip dead particles, and the padding.
+	particles.life[3] = 0;
+	particles.life[7] = -1;
+
+	CountingParticleUpdater updater;
+	EXPECT_FALSE(updater.ThreadSafe());
+	updater.Update(particles, 0, particles.Size(), 0.1f);
+	EXPECT_EQ(updater.num_updates, 8U);
+	for (uint32_t i = 0; i < particles.Size(); ++ i)
+	{
+		bool const alive = (i < 10) && (i != 3) && (i != 7);
+		EXPECT_EQ(particles.pos_x[i], alive ? par.pos.x() + 1 : ((i < 10) ? par.pos.x() : 0.0f));
+	}
+}
+
+TEST(ParticleSystemTest, PolylineBatchMatchesPerParticle)
+{
+	auto ps = MakeSharedPtr<ParticleSystem>(1);
+	ps->Gravity(0.5f);
+	ps->Force(float3(0.1f, 0, -0.2f));
+	ps->MediaDensity(0.5f);
+
+	PolylineParticleUpdater updater(ps);
+	updater.SizeOverLife({ float2(0, 0.1f), float2(0.5f, 0.3f), float2(1, 0.05f) });
+	updater.MassOverLife({ float2(0, 1), float2(1, 2) });
+	updater.OpacityOverLife({ float2(0, 1), float2(0.3f, 0.8f), float2(1, 0) });
+	updater.SnapParams();
+	EXPECT_TRUE(updater.ThreadSafe());
+
+	ParticleStore batched;
+	batched.Resize(258);
+	std::ranlux24_base gen;
+	RandomParticles(batched, gen);
+	ParticleStore per_particle = batched;
+	ParticleStore const initial = batched;
+
+	for (uint32_t frame = 0; frame < 4; ++ frame)
+	{
+		updater.Update(batched, 0, batched.Size(), 0.3f);
+		updater.ParticleUpdater::Update(per_particle, 0, per_particle.Size(), 0.3f);
+	}
+
+	for (uint32_t i = 0; i < batched.Size(); ++ i)
+	{
+		if (initial.life[i] > 0)
+		{
+			ExpectParticleNear(batched.Get(i), per_particle.Get(i));
+		}
+		else
+		{
+			// Dead ones are left alone, bit for bit
+			Particle const before = initial.Get(i);
+			Particle const after = batched.Get(i);
+			EXPECT_EQ(after.pos, before.pos);
+			EXPECT_EQ(after.vel, before.vel);
+			EXPECT_EQ(after.life, before.life);
+			EXPECT_EQ(after.spin, before.spin);
+			EXPECT_EQ(after.size, before.size);
+			EXPECT_EQ(after.alpha, before.alpha);
+		}
+	}
+}
@@ -0,0 +1,319 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX20/span.hpp>
+#include <KFL/Hash.hpp>
+#include <KFL/Timer.hpp>
+#include <KFL/XMLDom.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/ResLoader.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <nonstd/scope.hpp>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	char const* const effect_names[] = { "DeferredRendering.fxml", "PostProcess.fxml", "GBuffer.fxml", "Copy.fxml" };
+
+	// What the lookups did before they were indexed
+	RenderEffectParameter const* LinearParameterByName(RenderEffect const& effect, std::string_view name)
+	{
+		size_t const name_hash = HashValue(name);
+		for (uint32_t i = 0; i < effect.NumParameters(); ++ i)
+		{
+			if (effect.ParameterByIndex(i)->NameHash() == name_hash)
+			{
+				return effect.ParameterByIndex(i);
+			}
+		}
+		return nullptr;
+	}
+
+	RenderEffectParameter const* LinearParameterBySemantic(RenderEffect const& effect, std::string_view semantic)
+	{
+		size_t const semantic_hash = HashValue(semantic);
+		for (uint32_t i = 0; i < effect.NumParameters(); ++ i)
+		{
+			if (effect.ParameterByIndex(i)->SemanticHash() == semantic_hash)
+			{
+				return effect.ParameterByIndex(i);
+			}
+		}
+		return nullptr;
+	}
+
+	RenderTechnique* LinearTechniqueByName(RenderEffect const& effect, std::string_view name)
+	{
+		size_t const name_hash = HashValue(name);
+		for (uint32_t i = 0; i < effect.NumTechniques(); ++ i)
+		{
+			if (effect.TechniqueByIndex(i)->NameHash() == name_hash)
+			{
+				return effect.TechniqueByIndex(i);
+			}
+		}
+		return nullptr;
+	}
+
+	// Compiles the effect from scratch, and returns the .kfx it writes
+	std::vector<char> CompileToKfx(std::string const& name)
+	{
+		auto& res_loader = Context::Instance().ResLoaderInstance();
+		std::filesystem::path const fxml_path = res_loader.Locate(name);
+		std::string const kfx_name = fxml_path.stem().string() + ".kfx";
+		std::string const old_kfx_path = res_loader.Locate(kfx_name);
+		if (!old_kfx_path.empty())
+		{
+			std::filesystem::remove(old_kfx_path);
+		}
+		std::filesystem::path const kfx_path = fxml_path.parent_path() / kfx_name;
+
+		RenderEffect effect;
+		effect.Load(std::span<std::string const>(&name, 1));
+		effect.CompileShaders();
+
+		std::ifstream kfx(kfx_path, std::ios_base::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(kfx), std::istreambuf_iterator<char>());
+	}
+
+	void WriteTextFile(std::filesystem::path const& path, std::string_view text)
+	{
+		std::ofstream ofs(path, std::ios_base::binary);
+		ofs.write(text.data(), text.size());
+	}
+
+	// Loads the effect the way SyncLoadRenderEffect does, compiling only if the .kfx is missing or stale
+	void LoadAndCompile(std::string const& name)
+	{
+		RenderEffect effect;
+		effect.Load(std::span<std::string const>(&name, 1));
+		effect.CompileShaders();
+	}
+}
+
+TEST(RenderEffectTest, LookupMatchesLinearScan)
+{
+	for (auto const* effect_name : effect_names)
+	{
+		auto effect = SyncLoadRenderEffect(effect_name);
+		ASSERT_TRUE(effect);
+		RenderEffect const& const_effect = *effect;
+
+		for (uint32_t i = 0; i < effect->NumParameters(); ++ i)
+		{
+			auto const* param = effect->ParameterByIndex(i);
+			EXPECT_EQ(const_effect.ParameterByName(param->Name()), LinearParameterByName(*effect, param->Name()));
+			EXPECT_EQ(effect->ParameterByName(param->Name()), param);
+			if (param->HasSemantic())
+			{
+				EXPECT_EQ(const_effect.ParameterBySemantic(param->Semantic()), LinearParameterBySemantic(*effect, param->Semantic()));
+			}
+		}
+		for (uint32_t i = 0; i < effect->NumTechniques(); ++ i)
+		{
+			auto const* tech = effect->TechniqueByIndex(i);
+			EXPECT_EQ(effect->TechniqueByName(tech->Name()), LinearTechniqueByName(*effect, tech->Name()));
+		}
+
+		EXPECT_EQ(effect->ParameterByName("not_a_parameter"), nullptr);
+		EXPECT_EQ(effect->ParameterBySemantic("NOT_A_SEMANTIC"), nullptr);
+		EXPECT_EQ(effect->TechniqueByName("NotATechnique"), nullptr);
+
+		// Clones share the index, but find their own parameters
+		auto clone = effect->Clone();
+		for (uint32_t i = 0; i < clone->NumParameters(); ++ i)
+		{
+			auto const* param = clone->ParameterByIndex(i);
+			EXPECT_EQ(clone->ParameterByName(param->Name()), param);
+		}
+	}
+}
+
+TEST(RenderEffectTest, DISABLED_PerfLookup)
+{
+	for (auto const* effect_name : effect_names)
+	{
+		auto effect = SyncLoadRenderEffect(effect_name);
+
+		std::vector<std::string> param_names;
+		for (uint32_t i = 0; i < effect->NumParameters(); ++ i)
+		{
+			param_names.push_back(effect->ParameterByIndex(i)->Name());
+		}
+		std::vector<std::string> tech_names;
+		for (uint32_t i = 0; i < effect->NumTechniques(); ++ i)
+		{
+			tech_names.push_back(effect->TechniqueByIndex(i)->Name());
+		}
+
+		uint32_t const num_iterations = 1000;
+		size_t num_found = 0;
+
+		Timer timer;
+		for (uint32_t iter = 0; iter < num_iterations; ++ iter)
+		{
+			for (auto const& name : param_names)
+			{
+				num_found += (LinearParameterByName(*effect, name) != nullptr);
+			}
+			for (auto const& name : tech_names)
+			{
+				num_found += (LinearTechniqueByName(*effect, name) != nullptr);
+			}
+		}
+		double const linear_time = timer.elapsed();
+
+		timer.restart();
+		for (uint32_t iter = 0; iter < num_iterations; ++ iter)
+		{
+			for (auto const& name : param_names)
+			{
+				num_found += (effect->ParameterByName(name) != nullptr);
+			}
+			for (auto const& name : tech_names)
+			{
+				num_found += (effect->TechniqueByName(name) != nullptr);
+			}
+		}
+		double const indexed_time = timer.elapsed();
+
+		EXPECT_EQ(num_found, (param_names.size() + tech_names.size()) * num_iterations * 2);
+
+		uint32_t const num_lookups = static_cast<uint32_t>(param_names.size() + tech_names.size()) * num_iterations;
+		std::cout << effect_name << ": " << param_names.size() << " parameters, " << tech_names.size() << " techniques. Linear "
+				  << linear_time * 1e9 / num_lookups << " ns, indexed " << indexed_time * 1e9 / num_lookups << " ns per lookup"
+				  << std::endl;
+	}
+}
+
+TEST(RenderEffectTest, CompileIsDeterministic)
+{
+	for (std::string const name : { "PostProcess.fxml", "GBuffer.fxml" })
+	{
+		auto const first = CompileToKfx(name);
+		auto const second = CompileToKfx(name);
+		EXPECT_TRUE(!first.empty());
+		EXPECT_TRUE(first == second);
+	}
+}
+
+TEST(RenderEffectTest, IncludeChangeRecompiles)
+{
+	auto& res_loader = Context::Instance().ResLoaderInstance();
+
+	std::filesystem::path const dir = std::filesystem::temp_directory_path() / "KlayGETests_IncludeChangeRecompiles";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	res_loader.AddPath(dir.string());
+	auto on_exit = nonstd::make_scope_exit([&res_loader, &dir] {
+		res_loader.DelPath(dir.string());
+		std::filesystem::remove_all(dir);
+	});
+
+	WriteTextFile(dir / "IncludeChangeRecompilesInc.fxml",
+		"<?xml version='1.0'?>\n"
+		"<effect>\n"
+		"\t<parameter type=\"float4\" name=\"color\"/>\n"
+		"</effect>\n");
+	WriteTextFile(dir / "IncludeChangeRecompiles.fxml",
+		"<?xml version='1.0'?>\n"
+		"<effect>\n"
+		"\t<include name=\"IncludeChangeRecompilesInc.fxml\"/>\n"
+		"\t<shader>\n"
+		"\t\t<![CDATA[\n"
+		"float4 IncludeChangeVS(float4 pos : POSITION) : SV_Position\n"
+		"{\n"
+		"\treturn pos;\n"
+		"}\n"
+		"float4 IncludeChangePS() : SV_Target\n"
+		"{\n"
+		"\treturn color;\n"
+		"}\n"
+		"\t\t]]>\n"
+		"\t</shader>\n"
+		"\t<technique name=\"IncludeChange\">\n"
+		"\t\t<pass name=\"p0\">\n"
+		"\t\t\t<state name=\"vertex_shader\" value=\"IncludeChangeVS()\"/>\n"
+		"\t\t\t<state name=\"pixel_shader\" value=\"IncludeChangePS()\"/>\n"
+		"\t\t</pass>\n"
+		"\t</technique>\n"
+		"</effect>\n");
+
+	std::string const name = "IncludeChangeRecompiles.fxml";
+	std::filesystem::path const kfx_path = dir / "IncludeChangeRecompiles.kfx";
+	std::filesystem::path const include_path = dir / "IncludeChangeRecompilesInc.fxml";
+
+	LoadAndCompile(name);
+	ASSERT_TRUE(std::filesystem::exists(kfx_path));
+
+	// Backdates the .kfx, so a rewrite shows up however coarse the file times are. Only the sources are in its manifest.
+	auto const old_kfx_time = std::filesystem::last_write_time(kfx_path) - std::chrono::hours(1);
+	std::filesystem::last_write_time(kfx_path, old_kfx_time);
+
+	LoadAndCompile(name);
+	EXPECT_TRUE(std::filesystem::last_write_time(kfx_path) == old_kfx_time);
+
+	std::filesystem::last_write_time(include_path, std::filesystem::last_write_time(include_path) + std::chrono::hours(1));
+
+	LoadAndCompile(name);
+	EXPECT_TRUE(std::filesystem::last_write_time(kfx_path) != old_kfx_time);
+
+	// And the new manifest is up to date again
+	auto const new_kfx_time = std::filesystem::last_write_time(kfx_path) - std::chrono::hours(1);
+	std::filesystem::last_write_time(kfx_path, new_kfx_time);
+	LoadAndCompile(name);
+	EXPECT_TRUE(std::filesystem::last_write_time(kfx_path) == new_kfx_time);
+}
+
+TEST(RenderEffectTest, DISABLED_PerfWarmLoad)
+{
+	auto& res_loader = Context::Instance().ResLoaderInstance();
+
+	std::vector<std::string> effect_names;
+	std::filesystem::path const fx_dir = std::filesystem::path(res_loader.Locate("Copy.fxml")).parent_path();
+	for (auto const& entry : std::filesystem::directory_iterator(fx_dir))
+	{
+		if (entry.path().extension() == ".fxml")
+		{
+			effect_names.push_back(entry.path().filename().string());
+		}
+	}
+	std::sort(effect_names.begin(), effect_names.end());
+	EXPECT_TRUE(!effect_names.empty());
+
+	// Warms up the cache, so every .kfx is there and up to date
+	for (auto const& name : effect_names)
+	{
+		SyncLoadRenderEffect(name);
+	}
+
+	// What a warm start used to pay before looking at the .kfx, not counting the includes
+	Timer timer;
+	for (auto const& name : effect_names)
+	{
+		XMLNode const root = LoadXml(*res_loader.Open(name));
+		EXPECT_TRUE(root.FirstNode() != nullptr);
+	}
+	double const parse_time = timer.elapsed();
+
+	timer.restart();
+	for (auto const& name : effect_names)
+	{
+		RenderEffect effect;
+		effect.Load(std::span<std::string const>(&name, 1));
+	}
+	double const load_time = timer.elapsed();
+
+	std::cout << effect_names.size() << " effects. Warm load " << load_time * 1000 << " ms, parsing the .fxml alone "
+			  << parse_time * 1000 << " ms" << std::endl;
+}
@@ -1,12 +1,105 @@
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/Hash.hpp>
+#include <KlayGE/Package.hpp>
 #include <KlayGE/ResLoader.hpp>
 
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include "KlayGETests.hpp"
 
 using namespace KlayGE;
 
 std::string const sanity_string = "This is a test for ResLoader.";
 
+struct NameLoadingStats
+{
+	uint32_t num_loads = 0;
+	std::vector<std::string> finish_order;
+};
+
+// A resource that is just its name. The hash is given from outside so collisions can be forced.
+class NameLoadingDesc : public ResLoadingDesc
+{
+public:
+	NameLoadingDesc(std::string_view name, size_t hash, NameLoadingStats& stats, bool has_sub_thread_stage = false)
+		: name_(name), hash_(hash), stats_(&stats), has_sub_thread_stage_(has_sub_thread_stage)
+	{
+	}
+
+	uint64_t Type() const override
+	{
+		return CtHash("NameLoadingDesc");
+	}
+
+	bool StateLess() const override
+	{
+		return true;
+	}
+
+	void SubThreadStage() override
+	{
+	}
+
+	void MainThreadStage() override
+	{
+		res_ = MakeSharedPtr<std::string>(name_);
+		++ stats_->num_loads;
+		stats_->finish_order.push_back(name_);
+	}
+
+	bool HasSubThreadStage() const override
+	{
+		return has_sub_thread_stage_;
+	}
+
+	size_t Hash() const override
+	{
+		return hash_;
+	}
+
+	bool Match(ResLoadingDesc const & rhs) const override
+	{
+		if (this->Type() == rhs.Type())
+		{
+			return name_ == static_cast<NameLoadingDesc const &>(rhs).name_;
+		}
+		return false;
+	}
+
+	void CopyDataFrom(ResLoadingDesc const & rhs) override
+	{
+		BOOST_ASSERT(this->Type() == rhs.Type());
+
+		NameLoadingDesc const & nld = static_cast<NameLoadingDesc const &>(rhs);
+		name_ = nld.name_;
+		res_ = nld.res_;
+	}
+
+	std::shared_ptr<void> CloneResourceFrom(std::shared_ptr<void> const & resource) override
+	{
+		return resource;
+	}
+
+	// Hands the only reference over to the caller, so the cache can see the resource expire
+	std::shared_ptr<void> Resource() const override
+	{
+		return std::move(res_);
+	}
+
+private:
+	std::string name_;
+	size_t hash_;
+	NameLoadingStats* stats_;
+	bool has_sub_thread_stage_;
+	mutable std::shared_ptr<std::string> res_;
+};
+
 std::string ReadWholeFile(ResIdentifierPtr const & res)
 {
 	res->seekg(0, std::ios_base::end);
@@ -17,6 +110,170 @@ std::string ReadWholeFile(ResIdentifierPtr const & res)
 	return str;
 }
 
+namespace
+{
+	uint32_t Crc32(std::string_view data)
+	{
+		uint32_t crc = 0xFFFFFFFF;
+		for (char ch : data)
+		{
+			crc ^= static_cast<uint8_t>(ch);
+			for (uint32_t k = 0; k < 8; ++ k)
+			{
+				crc = (crc >> 1) ^ (0xEDB88320 & (0U - (crc & 1)));
+			}
+		}
+		return ~crc;
+	}
+
+	template <typename T>
+	void WriteLE(std::string& out, T value)
+	{
+		for (size_t i = 0; i < sizeof(T); ++ i)
+		{
+			out.push_back(static_cast<char>(static_cast<uint64_t>(value) >> (i * 8)));
+		}
+	}
+
+	// 7z's variable length number. The count of leading 1 bits in the first byte is the count of bytes that follow.
+	void Write7zNumber(std::string& out, uint64_t value)
+	{
+		uint8_t first_byte = 0;
+		uint8_t mask = 0x80;
+		uint32_t num_extra = 0;
+		for (; num_extra < 8; ++ num_extra)
+		{
+			if (value < (1ULL << (7 * (num_extra + 1))))
+			{
+				first_byte |= static_cast<uint8_t>(value >> (8 * num_extra));
+				break;
+			}
+			first_byte |= mask;
+			mask >>= 1;
+		}
+		out.push_back(static_cast<char>(first_byte));
+		for (uint32_t i = 0; i < num_extra; ++ i)
+		{
+			out.push_back(static_cast<char>(value >> (8 * i)));
+		}
+	}
+
+	// Builds a 7z archive in memory. Every inner vector is one solid block of (name, contents), stored with the Copy method.
+	std::string BuildSolid7z(std::vector<std::vector<std::pair<std::string, std::string>>> const & blocks)
+	{
+		std::string packed;
+		for (auto const & block : blocks)
+		{
+			for (auto const & file : block)
+			{
+				packed += file.second;
+			}
+		}
+
+		std::string header;
+		header.push_back(0x01); // kHeader
+		header.push_back(0x04); // kMainStreamsInfo
+
+		header.push_back(0x06); // kPackInfo
+		Write7zNumber(header, 0);
+		Write7zNumber(header, blocks.size());
+		header.push_back(0x09); // kSize
+		for (auto const & block : blocks)
+		{
+			uint64_t block_size = 0;
+			for (auto const & file : block)
+			{
+				block_size += file.second.size();
+			}
+			Write7zNumber(header, block_size);
+		}
+		header.push_back(0x00);
+
+		header.push_back(0x07); // kUnpackInfo
+		header.push_back(0x0B); // kFolder
+		Write7zNumber(header, blocks.size());
+		header.push_back(0x00); // Not external
+		for (size_t i = 0; i < blocks.size(); ++ i)
+		{
+			Write7zNumber(header, 1);
+			header.push_back(0x01); // A simple coder with a 1 byte id
+			header.push_back(0x00); // Copy
+		}
+		header.push_back(0x0C); // kCodersUnpackSize
+		for (auto const & block : blocks)
+		{
+			uint64_t block_size = 0;
+			for (auto const & file : block)
+			{
+				block_size += file.second.size();
+			}
+			Write7zNumber(header, block_size);
+		}
+		header.push_back(0x00);
+
+		header.push_back(0x08); // kSubStreamsInfo
+		header.push_back(0x0D); // kNumUnpackStream
+		for (auto const & block : blocks)
+		{
+			Write7zNumber(header, block.size());
+		}
+		header.push_back(0x09); // kSize, all but the last file of every block
+		for (auto const & block : blocks)
+		{
+			for (size_t i = 0; i + 1 < block.size(); ++ i)
+			{
+				Write7zNumber(header, block[i].second.size());
+			}
+		}
+		header.push_back(0x0A); // kCRC
+		header.push_back(0x01); // All defined
+		for (auto const & block : blocks)
+		{
+			for (auto const & file : block)
+			{
+				WriteLE<uint32_t>(header, Crc32(file.second));
+			}
+		}
+		header.push_back(0x00);
+		header.push_back(0x00);
+
+		std::string names;
+		size_t num_files = 0;
+		for (auto const & block : blocks)
+		{
+			for (auto const & file : block)
+			{
+				for (char ch : file.first)
+				{
+					WriteLE<uint16_t>(names, static_cast<uint8_t>(ch));
+				}
+				WriteLE<uint16_t>(names, 0);
+				++ num_files;
+			}
+		}
+		header.push_back(0x05); // kFilesInfo
+		Write7zNumber(header, num_files);
+		header.push_back(0x11); // kName
+		Write7zNumber(header, names.size() + 1);
+		header.push_back(0x00); // Not external
+		header += names;
+		header.push_back(0x00);
+		header.push_back(0x00);
+
+		std::string start_header;
+		WriteLE<uint64_t>(start_header, packed.size());
+		WriteLE<uint64_t>(start_header, header.size());
+		WriteLE<uint32_t>(start_header, Crc32(header));
+
+		std::string archive("7z\xBC\xAF\x27\x1C\x00\x04", 8);
+		WriteLE<uint32_t>(archive, Crc32(start_header));
+		archive += start_header;
+		archive += packed;
+		archive += header;
+		return archive;
+	}
+}
+
 TEST(ResLoaderTest, AddDelPath)
 {
 	auto& res_loader = Context::Instance().ResLoaderInstance();
@@ -33,6 +290,53 @@ TEST(ResLoaderTest, AddDelPath)
 	EXPECT_TRUE(res_loader.Locate("Test.txt").empty());
 }
 
+TEST(ResLoaderTest, MappedFile)
+{
+	auto& res_loader = Context::Instance().ResLoaderInstance();
+
+	// Small files are cheaper to read than to map
+	res_loader.AddPath("../../Tests/media/ResLoader");
+	{
+		auto res = res_loader.Open("Test.txt");
+		EXPECT_TRUE(res);
+		EXPECT_TRUE(res->Data().empty());
+		EXPECT_EQ(ReadWholeFile(res), sanity_string);
+	}
+	res_loader.DelPath("../../Tests/media/ResLoader");
+
+	std::filesystem::path const dir = std::filesystem::temp_directory_path() / "KlayGETests_MappedFile";
+	std::filesystem::create_directories(dir);
+	std::string content;
+	while (content.size() < 256 * 1024)
+	{
+		content += sanity_string;
+	}
+	{
+		std::ofstream ofs(dir / "Big.txt", std::ios_base::binary);
+		ofs.write(content.data(), content.size());
+	}
+
+	res_loader.AddPath(dir.string());
+	{
+		auto res = res_loader.Open("Big.txt");
+		EXPECT_TRUE(res);
+		auto const data = res->Data();
+		EXPECT_EQ(std::string(data.begin(), data.end()), content);
+
+		// Views and reads share the same position
+		char first[4];
+		res->read(first, sizeof(first));
+		EXPECT_EQ(std::string(first, first + sizeof(first)), content.substr(0, sizeof(first)));
+		auto const view = res->ReadView(content.size());
+		EXPECT_EQ(view.data(), data.data() + sizeof(first));
+		EXPECT_EQ(std::string(view.begin(), view.end()), content.substr(sizeof(first)));
+		EXPECT_EQ(ReadWholeFile(res), content);
+	}
+	res_loader.DelPath(dir.string());
+
+	std::filesystem::remove_all(dir);
+}
+
 TEST(ResLoaderTest, MountUnmountPath)
 {
 	auto& res_loader = Context::Instance().ResLoaderInstance();
@@ -107,3 +411,192 @@ TEST(ResLoaderTest, MountUnmountInsideEncrypt7zPath)
 	res_loader.Unmount("ResLoaderTestData", "../../Tests/media/ResLoader/TestPassword.7z|1234/ResLoader");
 	EXPECT_TRUE(res_loader.Locate("ResLoaderTestData/Test.txt").empty());
 }
+
+TEST(ResLoaderTest, PackageExtract)
+{
+	auto& res_loader = Context::Instance().ResLoaderInstance();
+
+	res_loader.AddPath("../../Tests/media/ResLoader");
+	auto archive = res_loader.Open("Test.7z");
+	EXPECT_TRUE(archive);
+
+	Package package(archive);
+	EXPECT_TRUE(package.Locate("ResLoader/Test.txt"));
+	EXPECT_TRUE(package.Locate("resloader/TEST.TXT"));
+	EXPECT_FALSE(package.Locate("ResLoader/NotExist.txt"));
+	EXPECT_FALSE(package.Extract("ResLoader/NotExist.txt", "NotExist.txt"));
+
+	// A block of one file isn't cached, there is nothing else in it to save decoding
+	for (uint32_t i = 0; i < 2; ++ i)
+	{
+		auto res = package.Extract("ResLoader/Test.txt", "Test.txt");
+		EXPECT_TRUE(res);
+		EXPECT_EQ(ReadWholeFile(res), sanity_string);
+		EXPECT_EQ(package.NumDecodePasses(), i + 1);
+	}
+
+	package.SolidBlockCacheBudget(0);
+	std::string_view const paths[] = {"ResLoader/Test.txt", "ResLoader/NotExist.txt", "resloader/test.txt"};
+	std::string_view const names[] = {"Test.txt", "NotExist.txt", "test.txt"};
+	auto const res = package.ExtractMany(paths, names);
+	EXPECT_EQ(res.size(), 3U);
+	EXPECT_EQ(ReadWholeFile(res[0]), sanity_string);
+	EXPECT_FALSE(res[1]);
+	EXPECT_EQ(ReadWholeFile(res[2]), sanity_string);
+	EXPECT_EQ(res[2]->ResName(), "test.txt");
+
+	res_loader.DelPath("../../Tests/media/ResLoader");
+}
+
+TEST(ResLoaderTest, PackageSolidBlockCache)
+{
+	std::vector<std::vector<std::pair<std::string, std::string>>> blocks;
+	for (char block : { 'a', 'b', 'c' })
+	{
+		blocks.emplace_back();
+		for (char file : { '0', '1' })
+		{
+			blocks.back().emplace_back(
+				std::string{block, file} + ".txt", std::string("Solid block ") + block + ", file " + file + ".");
+		}
+	}
+	std::shared_ptr<std::istream> const archive_is =
+		MakeSharedPtr<std::istringstream>(BuildSolid7z(blocks), std::ios_base::in | std::ios_base::binary);
+
+	Package package(MakeSharedPtr<ResIdentifier>("Solid.7z", 0, archive_is));
+
+	// Room for two of the three blocks
+	package.SolidBlockCacheBudget(blocks[0][0].second.size() + blocks[0][1].second.size()
+		+ blocks[1][0].second.size() + blocks[1][1].second.size());
+
+	auto extract = [&package, &blocks](uint32_t block, uint32_t file)
+	{
+		std::string const & name = blocks[block][file].first;
+		auto res = package.Extract(name, name);
+		ASSERT_TRUE(res);
+		EXPECT_EQ(ReadWholeFile(res), blocks[block][file].second);
+	};
+
+	extract(0, 0);
+	EXPECT_EQ(package.NumDecodePasses(), 1U);
+
+	// The rest of the block was decoded with the first file
+	extract(0, 1);
+	extract(0, 0);
+	EXPECT_EQ(package.NumDecodePasses(), 1U);
+
+	extract(1, 0);
+	EXPECT_EQ(package.NumDecodePasses(), 2U);
+
+	// a is used after b, so c evicts b
+	extract(0, 1);
+	extract(2, 0);
+	EXPECT_EQ(package.NumDecodePasses(), 3U);
+	extract(0, 0);
+	extract(2, 1);
+	EXPECT_EQ(package.NumDecodePasses(), 3U);
+
+	// c is used after a, so b evicts a
+	extract(1, 1);
+	EXPECT_EQ(package.NumDecodePasses(), 4U);
+	extract(2, 0);
+	extract(1, 0);
+	EXPECT_EQ(package.NumDecodePasses(), 4U);
+	extract(0, 1);
+	EXPECT_EQ(package.NumDecodePasses(), 5U);
+
+	// Without a budget, every file is decoded again
+	package.SolidBlockCacheBudget(0);
+	extract(0, 1);
+	extract(0, 1);
+	EXPECT_EQ(package.NumDecodePasses(), 7U);
+}
+
+TEST(ResLoaderTest, QueryCache)
+{
+	auto& res_loader = Context::Instance().ResLoaderInstance();
+
+	NameLoadingStats stats;
+	uint32_t const & num_loads = stats.num_loads;
+	auto query = [&res_loader, &stats](std::string_view name, size_t hash)
+	{
+		return res_loader.SyncQueryT<std::string>(MakeSharedPtr<NameLoadingDesc>(name, hash, stats));
+	};
+
+	auto a = query("a", HashValue(std::string_view("a")));
+	EXPECT_EQ(*a, "a");
+	EXPECT_EQ(num_loads, 1U);
+
+	auto a2 = query("a", HashValue(std::string_view("a")));
+	EXPECT_EQ(a, a2);
+	EXPECT_EQ(num_loads, 1U);
+
+	// Same hash, but Match tells them apart
+	auto b = query("b", HashValue(std::string_view("a")));
+	EXPECT_EQ(*b, "b");
+	EXPECT_NE(a, b);
+	EXPECT_EQ(num_loads, 2U);
+	EXPECT_EQ(query("b", HashValue(std::string_view("a"))), b);
+	EXPECT_EQ(query("a", HashValue(std::string_view("a"))), a);
+	EXPECT_EQ(num_loads, 2U);
+
+	// Once released, a resource has to be loaded again, even if its expired entry is still in the cache
+	a.reset();
+	a2.reset();
+	a = query("a", HashValue(std::string_view("a")));
+	EXPECT_EQ(*a, "a");
+	EXPECT_EQ(num_loads, 3U);
+
+	// Enough short-lived resources to trigger sweeps of the expired entries
+	for (uint32_t i = 0; i < 5000; ++ i)
+	{
+		std::string const name = "tmp" + std::to_string(i);
+		EXPECT_EQ(*query(name, HashValue(name)), name);
+	}
+	EXPECT_EQ(num_loads, 5003U);
+	EXPECT_EQ(query("a", HashValue(std::string_view("a"))), a);
+	EXPECT_EQ(query("b", HashValue(std::string_view("a"))), b);
+	EXPECT_EQ(num_loads, 5003U);
+
+	res_loader.Unload(a);
+	EXPECT_NE(query("a", HashValue(std::string_view("a"))), a);
+	EXPECT_EQ(num_loads, 5004U);
+}
+
+TEST(ResLoaderTest, ASyncQueryPriority)
+{
+	auto& res_loader = Context::Instance().ResLoaderInstance();
+
+	NameLoadingStats stats;
+	std::vector<std::shared_ptr<NameLoadingDesc>> descs;
+	for (uint32_t i = 0; i < 8; ++ i)
+	{
+		auto desc = MakeSharedPtr<NameLoadingDesc>("async" + std::to_string(i), i, stats, true);
+		res_loader.ASyncQuery(desc, static_cast<float>(i));
+		descs.push_back(desc);
+	}
+
+	EXPECT_TRUE(res_loader.CancelASyncQuery(descs[3]));
+	EXPECT_FALSE(res_loader.CancelASyncQuery(descs[3]));
+	EXPECT_EQ(res_loader.NumLoadingResources(), 7U);
+
+	// The workers mark a load ready only after its SubThreadStage returns. Waits for that, but not forever.
+	for (uint32_t i = 0; (i < 10000) && (res_loader.NumReadyResources() < 7); ++ i)
+	{
+		Sleep(1);
+	}
+	ASSERT_EQ(res_loader.NumReadyResources(), 7U);
+
+	// With a tiny budget, every Update finishes one resource, the highest priority first
+	float const budget = res_loader.MainThreadStageBudget();
+	res_loader.MainThreadStageBudget(1e-6f);
+	for (uint32_t i = 7; i > 0; -- i)
+	{
+		res_loader.Update();
+		EXPECT_EQ(res_loader.NumLoadingResources(), i - 1);
+	}
+	res_loader.MainThreadStageBudget(budget);
+
+	std::vector<std::string> const expected_order = { "async7", "async6", "async5", "async4", "async2", "async1", "async0" };
+	EXPECT_EQ(stats.finish_order, expected_order);
+}
@@ -1,9 +1,13 @@
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX20/bit.hpp>
 #include <KFL/Math.hpp>
 #include <KFL/SIMDMath.hpp>
 
 #include "KlayGETests.hpp"
 
+#include <array>
+#include <limits>
+#include <random>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -31,3 +35,128 @@ TEST(SIMDMathTest, NormalizeVector4)
 	v = SIMDMathLib::NormalizeVector4(v);
 	EXPECT_LT(MathLib::abs(SIMDMathLib::GetX(SIMDMathLib::LengthVector4(v)) - 1.0f), 1e-3f);
 }
+
+TEST(SIMDMathTest, IntersectAABBFrustum)
+{
+	float4x4 const view = MathLib::look_at_lh(float3(1, 2, -5), float3(0, 0, 0));
+	float4x4 const proj = MathLib::perspective_fov_lh(PI / 4, 4.0f / 3, 1.0f, 100.0f);
+	float4x4 const view_proj = view * proj;
+	Frustum frustum;
+	frustum.ClipMatrix(view_proj, MathLib::inverse(view_proj));
+
+	uint32_t const num_boxes = 4096;
+	std::ranlux24_base gen;
+	std::uniform_real_distribution<float> pos_dist(-60, 60);
+	std::uniform_real_distribution<float> size_dist(0, 10);
+	std::vector<float> min_x(num_boxes), min_y(num_boxes), min_z(num_boxes);
+	std::vector<float> max_x(num_boxes), max_y(num_boxes), max_z(num_boxes);
+	std::vector<AABBox> boxes(num_boxes);
+	for (uint32_t i = 0; i < num_boxes; ++ i)
+	{
+		float3 const min_pt(pos_dist(gen), pos_dist(gen), pos_dist(gen));
+		float3 const max_pt = min_pt + float3(size_dist(gen), size_dist(gen), size_dist(gen));
+		boxes[i] = AABBox(min_pt, max_pt);
+		min_x[i] = min_pt.x();
+		min_y[i] = min_pt.y();
+		min_z[i] = min_pt.z();
+		max_x[i] = max_pt.x();
+		max_y[i] = max_pt.y();
+		max_z[i] = max_pt.z();
+	}
+
+	std::vector<BoundOverlap> expected(num_boxes);
+	for (uint32_t i = 0; i < num_boxes; ++ i)
+	{
+		expected[i] = MathLib::intersect_aabb_frustum(boxes[i], frustum);
+	}
+
+	std::vector<BoundOverlap> results(num_boxes);
+	for (uint32_t i = 0; i < num_boxes; i += 4)
+	{
+		SIMDMathLib::IntersectAABBFrustum(&results[i], SIMDMathLib::SetVector(min_x[i], min_x[i + 1], min_x[i + 2], min_x[i + 3]),
+			SIMDMathLib::SetVector(min_y[i], min_y[i + 1], min_y[i + 2], min_y[i + 3]),
+			SIMDMathLib::SetVector(min_z[i], min_z[i + 1], min_z[i + 2], min_z[i + 3]),
+			SIMDMathLib::SetVector(max_x[i], max_x[i + 1], max_x[i + 2], max_x[i + 3]),
+			SIMDMathLib::SetVector(max_y[i], max_y[i + 1], max_y[i + 2], max_y[i + 3]),
+			SIMDMathLib::SetVector(max_z[i], max_z[i + 1], max_z[i + 2], max_z[i + 3]), frustum);
+	}
+
+	EXPECT_TRUE(results == expected);
+	for (auto bo : { BoundOverlap::No, BoundOverlap::Partial, BoundOverlap::Yes })
+	{
+		EXPECT_TRUE(std::find(expected.begin(), expected.end(), bo) != expected.end());
+	}
+}
+
+namespace
+{
+	std::array<uint32_t, 4> MaskBits(SIMDVectorF4 const & v)
+	{
+		alignas(16) float fs[4];
+		SIMDMathLib::StoreVector4(fs, v);
+		std::array<uint32_t, 4> ret;
+		for (size_t i = 0; i < 4; ++ i)
+		{
+			ret[i] = std::bit_cast<uint32_t>(fs[i]);
+		}
+		return ret;
+	}
+}
+
+TEST(SIMDMathTest, LoadStoreVector4)
+{
+	alignas(16) float const src[] = { 1, -2, 3.5f, -0.0f };
+	SIMDVectorF4 const v = SIMDMathLib::LoadVector4(src);
+	EXPECT_EQ(SIMDMathLib::GetX(v), src[0]);
+	EXPECT_EQ(SIMDMathLib::GetY(v), src[1]);
+	EXPECT_EQ(SIMDMathLib::GetZ(v), src[2]);
+	EXPECT_EQ(SIMDMathLib::GetW(v), src[3]);
+
+	alignas(16) float dst[4] = { 0, 0, 0, 0 };
+	SIMDMathLib::StoreVector4(dst, v);
+	for (size_t i = 0; i < 4; ++ i)
+	{
+		EXPECT_EQ(std::bit_cast<uint32_t>(dst[i]), std::bit_cast<uint32_t>(src[i]));
+	}
+}
+
+TEST(SIMDMathTest, Compare)
+{
+	uint32_t const t = 0xFFFFFFFFU;
+	uint32_t const f = 0;
+
+	// -0 and 0 are equal
+	SIMDVectorF4 const lhs = SIMDMathLib::SetVector(1, 2, 3, -0.0f);
+	SIMDVectorF4 const rhs = SIMDMathLib::SetVector(2, 2, 1, 0.0f);
+	EXPECT_TRUE(MaskBits(SIMDMathLib::Less(lhs, rhs)) == (std::array<uint32_t, 4>{ t, f, f, f }));
+	EXPECT_TRUE(MaskBits(SIMDMathLib::LessEqual(lhs, rhs)) == (std::array<uint32_t, 4>{ t, t, f, t }));
+	EXPECT_TRUE(MaskBits(SIMDMathLib::Greater(lhs, rhs)) == (std::array<uint32_t, 4>{ f, f, t, f }));
+	EXPECT_TRUE(MaskBits(SIMDMathLib::GreaterEqual(lhs, rhs)) == (std::array<uint32_t, 4>{ f, t, t, t }));
+
+	// Nothing compares true with a NaN
+	float const nan = std::numeric_limits<float>::quiet_NaN();
+	SIMDVectorF4 const nans = SIMDMathLib::SetVector(nan, 1, nan, nan);
+	SIMDVectorF4 const ones = SIMDMathLib::SetVector(1, nan, nan, 1);
+	for (auto const & mask : { SIMDMathLib::Less(nans, ones), SIMDMathLib::LessEqual(nans, ones), SIMDMathLib::Greater(nans, ones),
+			 SIMDMathLib::GreaterEqual(nans, ones) })
+	{
+		EXPECT_TRUE(MaskBits(mask) == (std::array<uint32_t, 4>{ f, f, f, f }));
+	}
+}
+
+TEST(SIMDMathTest, Select)
+{
+	SIMDVectorF4 const mask = SIMDMathLib::Greater(SIMDMathLib::SetVector(1, -1, 1, -1), SIMDVectorF4::Zero());
+	SIMDVectorF4 const if_true = SIMDMathLib::SetVector(10, 20, 30, -0.0f);
+	SIMDVectorF4 const if_false = SIMDMathLib::SetVector(-10, -20, -30, -40);
+	SIMDVectorF4 const v = SIMDMathLib::Select(mask, if_true, if_false);
+	EXPECT_EQ(SIMDMathLib::GetX(v), 10.0f);
+	EXPECT_EQ(SIMDMathLib::GetY(v), -20.0f);
+	EXPECT_EQ(SIMDMathLib::GetZ(v), 30.0f);
+	EXPECT_EQ(SIMDMathLib::GetW(v), -40.0f);
+
+	// Bits are taken as they are
+	SIMDVectorF4 const all = SIMDMathLib::GreaterEqual(if_false, if_false);
+	EXPECT_TRUE(MaskBits(SIMDMathLib::Select(all, if_true, if_false)) == MaskBits(if_true));
+	EXPECT_TRUE(MaskBits(SIMDMathLib::Select(SIMDVectorF4::Zero(), if_true, if_false)) == MaskBits(if_false));
+}
@@ -0,0 +1,263 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Timer.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/ShaderCache.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	std::string const cache_dir = "ShaderCacheTest";
+
+	std::vector<uint8_t> MakeData(uint32_t seed, uint32_t size)
+	{
+		std::vector<uint8_t> data(size);
+		for (uint32_t i = 0; i < size; ++ i)
+		{
+			data[i] = static_cast<uint8_t>(seed * 31 + i);
+		}
+		return data;
+	}
+
+	std::string MakeKey(uint32_t index)
+	{
+		return "d3d_11_0 vs_5_0 VSMain\nKEY=" + std::to_string(index);
+	}
+
+	std::vector<std::filesystem::path> EntryFiles(ShaderCache const& cache)
+	{
+		std::vector<std::filesystem::path> files;
+		for (auto const& entry : std::filesystem::directory_iterator(cache.Directory()))
+		{
+			files.push_back(entry.path());
+		}
+		return files;
+	}
+
+	uint64_t DirectorySize(ShaderCache const& cache)
+	{
+		uint64_t size = 0;
+		for (auto const& file : EntryFiles(cache))
+		{
+			size += std::filesystem::file_size(file);
+		}
+		return size;
+	}
+}
+
+TEST(ShaderCacheTest, StoreLoad)
+{
+	std::filesystem::remove_all(cache_dir);
+	ShaderCache cache(cache_dir, 1024 * 1024);
+
+	std::vector<uint8_t> data;
+	EXPECT_FALSE(cache.Load(MakeKey(0), data));
+
+	cache.Store(MakeKey(0), MakeData(0, 1000));
+	cache.Store(MakeKey(1), MakeData(1, 2000));
+	cache.Store(MakeKey(2), {});
+
+	EXPECT_TRUE(cache.Load(MakeKey(0), data));
+	EXPECT_TRUE(data == MakeData(0, 1000));
+	EXPECT_TRUE(cache.Load(MakeKey(1), data));
+	EXPECT_TRUE(data == MakeData(1, 2000));
+	EXPECT_TRUE(cache.Load(MakeKey(2), data));
+	EXPECT_TRUE(data.empty());
+	EXPECT_FALSE(cache.Load(MakeKey(3), data));
+
+	// Another process sees the same entries
+	ShaderCache other_cache(cache_dir, 1024 * 1024);
+	EXPECT_TRUE(other_cache.Load(MakeKey(1), data));
+	EXPECT_TRUE(data == MakeData(1, 2000));
+
+	auto const stats = cache.GetStats();
+	EXPECT_EQ(stats.num_hits, 3U);
+	EXPECT_EQ(stats.num_misses, 2U);
+	EXPECT_EQ(stats.num_stores, 3U);
+	EXPECT_EQ(stats.num_evictions, 0U);
+}
+
+TEST(ShaderCacheTest, RejectsDamagedEntries)
+{
+	std::filesystem::remove_all(cache_dir);
+	ShaderCache cache(cache_dir, 1024 * 1024);
+
+	cache.Store(MakeKey(0), MakeData(0, 1000));
+	auto const files = EntryFiles(cache);
+	EXPECT_EQ(files.size(), 1U);
+
+	// Like a file that was cut short
+	std::filesystem::resize_file(files[0], std::filesystem::file_size(files[0]) - 1);
+	std::vector<uint8_t> data;
+	EXPECT_FALSE(cache.Load(MakeKey(0), data));
+
+	// Or one that was stored under another key with the same hash
+	cache.Store(MakeKey(0), MakeData(0, 1000));
+	std::filesystem::rename(files[0], cache.Directory() / "tmp");
+	cache.Store(MakeKey(1), MakeData(1, 1000));
+	for (auto const& file : EntryFiles(cache))
+	{
+		if (file.filename() != "tmp")
+		{
+			std::filesystem::rename(file, files[0]);
+		}
+	}
+	EXPECT_FALSE(cache.Load(MakeKey(0), data));
+}
+
+TEST(ShaderCacheTest, RejectsDamagedLength)
+{
+	std::filesystem::remove_all(cache_dir);
+	ShaderCache cache(cache_dir, 1024 * 1024);
+
+	std::string const key = MakeKey(0);
+	cache.Store(key, MakeData(0, 1000));
+	auto const files = EntryFiles(cache);
+	EXPECT_EQ(files.size(), 1U);
+
+	// The data length comes after the fourcc, the version, the key length and the key
+	std::streamoff const data_len_pos = 3 * sizeof(uint32_t) + key.size();
+	for (uint32_t data_len : { 0xFFFFFFF0U, 1001U, 999U, 0U })
+	{
+		{
+			std::fstream file(files[0], std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+			file.seekp(data_len_pos);
+			uint32_t const le_data_len = Native2LE(data_len);
+			file.write(reinterpret_cast<char const*>(&le_data_len), sizeof(le_data_len));
+		}
+
+		// A miss, without allocating the length it claims
+		std::vector<uint8_t> data;
+		EXPECT_FALSE(cache.Load(key, data));
+		EXPECT_TRUE(data.empty());
+	}
+}
+
+TEST(ShaderCacheTest, EvictsLeastRecentlyUsed)
+{
+	std::filesystem::remove_all(cache_dir);
+	uint32_t const max_size = 64 * 1024;
+	uint32_t const entry_size = 7 * 1024;
+	ShaderCache cache(cache_dir, max_size);
+
+	// Entry i is used i minutes later than entry 0
+	auto const start = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+	for (uint32_t i = 0; i < 8; ++ i)
+	{
+		cache.Store(MakeKey(i), MakeData(i, entry_size));
+		for (auto const& file : EntryFiles(cache))
+		{
+			if (std::filesystem::last_write_time(file) > start + std::chrono::minutes(i))
+			{
+				std::filesystem::last_write_time(file, start + std::chrono::minutes(i));
+			}
+		}
+	}
+	EXPECT_EQ(cache.GetStats().num_evictions, 0U);
+
+	// Makes entry 0 the most recently used one
+	std::vector<uint8_t> data;
+	EXPECT_TRUE(cache.Load(MakeKey(0), data));
+
+	for (uint32_t i = 8; i < 12; ++ i)
+	{
+		cache.Store(MakeKey(i), MakeData(i, entry_size));
+	}
+
+	EXPECT_TRUE(cache.GetStats().num_evictions > 0);
+	EXPECT_TRUE(DirectorySize(cache) <= max_size);
+	EXPECT_TRUE(cache.Load(MakeKey(0), data));
+	EXPECT_TRUE(data == MakeData(0, entry_size));
+	EXPECT_FALSE(cache.Load(MakeKey(1), data));
+	EXPECT_TRUE(cache.Load(MakeKey(11), data));
+}
+
+TEST(ShaderCacheTest, ConcurrentProcesses)
+{
+	std::filesystem::remove_all(cache_dir);
+
+	// Each cache stands for a process, with threads that compile the same stages at once
+	uint32_t const num_keys = 32;
+	ShaderCache caches[] = {ShaderCache(cache_dir, 1024 * 1024), ShaderCache(cache_dir, 1024 * 1024)};
+	std::vector<std::thread> threads;
+	std::vector<uint32_t> num_wrong_data(8, 0);
+	for (uint32_t t = 0; t < num_wrong_data.size(); ++ t)
+	{
+		threads.emplace_back([&cache = caches[t % std::size(caches)], &num_wrong = num_wrong_data[t], t]
+			{
+				std::vector<uint8_t> data;
+				for (uint32_t round = 0; round < 4; ++ round)
+				{
+					for (uint32_t i = 0; i < num_keys; ++ i)
+					{
+						uint32_t const key = (i + t) % num_keys;
+						if (cache.Load(MakeKey(key), data))
+						{
+							num_wrong += (data != MakeData(key, 4096 + key));
+						}
+						else
+						{
+							cache.Store(MakeKey(key), MakeData(key, 4096 + key));
+						}
+					}
+				}
+			});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	for (uint32_t const num_wrong : num_wrong_data)
+	{
+		EXPECT_EQ(num_wrong, 0U);
+	}
+
+	std::vector<uint8_t> data;
+	for (uint32_t i = 0; i < num_keys; ++ i)
+	{
+		EXPECT_TRUE(caches[0].Load(MakeKey(i), data));
+		EXPECT_TRUE(data == MakeData(i, 4096 + i));
+	}
+
+	// No temporary files are left
+	EXPECT_EQ(EntryFiles(caches[0]).size(), num_keys);
+}
+
+TEST(ShaderCacheTest, DISABLED_PerfLoad)
+{
+	std::filesystem::remove_all(cache_dir);
+	ShaderCache cache(cache_dir, 64 * 1024 * 1024);
+
+	// About the size of a compiled pixel shader with its reflection
+	uint32_t const num_keys = 256;
+	uint32_t const entry_size = 16 * 1024;
+
+	Timer timer;
+	for (uint32_t i = 0; i < num_keys; ++ i)
+	{
+		cache.Store(MakeKey(i), MakeData(i, entry_size));
+	}
+	double const store_time = timer.elapsed();
+
+	std::vector<uint8_t> data;
+	timer.restart();
+	for (uint32_t i = 0; i < num_keys; ++ i)
+	{
+		EXPECT_TRUE(cache.Load(MakeKey(i), data));
+	}
+	double const load_time = timer.elapsed();
+
+	std::cout << num_keys << " entries of " << entry_size / 1024 << " KB. Store " << store_time * 1e6 / num_keys << " us, load "
+			  << load_time * 1e6 / num_keys << " us per entry" << std::endl;
+}
@@ -0,0 +1,140 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Sort.hpp>
+#include <KFL/Timer.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	// Depths of particles with their index, like the ones ParticleSystem sorts
+	std::vector<std::pair<uint32_t, float>> RandomDepths(uint32_t num, std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> depth_dist(-100, 1000);
+		std::vector<std::pair<uint32_t, float>> ret(num);
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			ret[i] = { i, depth_dist(gen) };
+		}
+		return ret;
+	}
+
+	// Moves every depth a little, like one frame of motion
+	void JitterDepths(std::vector<std::pair<uint32_t, float>>& items, std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> jitter_dist(-0.01f, 0.01f);
+		for (auto& item : items)
+		{
+			item.second += jitter_dist(gen);
+		}
+	}
+
+	float DepthKey(std::pair<uint32_t, float> const & item)
+	{
+		return item.second;
+	}
+
+	std::vector<std::pair<uint32_t, float>> StableSorted(std::vector<std::pair<uint32_t, float>> items)
+	{
+		std::stable_sort(items.begin(), items.end(),
+			[](std::pair<uint32_t, float> const & lhs, std::pair<uint32_t, float> const & rhs)
+			{
+				return lhs.second < rhs.second;
+			});
+		return items;
+	}
+}
+
+TEST(SortTest, FloatToSortableUInt)
+{
+	std::vector<float> const values = { -1e30f, -100, -1, -1e-20f, 0, 1e-20f, 1, 100, 1e30f };
+	for (size_t i = 1; i < values.size(); ++ i)
+	{
+		EXPECT_LT(FloatToSortableUInt(values[i - 1]), FloatToSortableUInt(values[i]));
+	}
+}
+
+TEST(SortTest, RadixSort)
+{
+	std::ranlux24_base gen;
+	std::vector<std::pair<uint32_t, float>> scratch;
+	for (uint32_t num : { 0U, 1U, 50U, 1000U, 100000U })
+	{
+		auto items = RandomDepths(num, gen);
+		// Some ties to check the stability
+		for (uint32_t i = 0; i < num / 4; ++ i)
+		{
+			items[i * 4 + 1].second = items[i * 4].second;
+		}
+
+		auto const expected = StableSorted(items);
+		RadixSort(std::span(items), scratch, DepthKey);
+		EXPECT_TRUE(items == expected);
+	}
+}
+
+TEST(SortTest, IncrementalSort)
+{
+	std::ranlux24_base gen;
+	std::vector<std::pair<uint32_t, float>> scratch;
+
+	auto items = RandomDepths(100000, gen);
+	RadixSort(std::span(items), scratch, DepthKey);
+
+	// Little motion is repaired by the insertion pass
+	JitterDepths(items, gen);
+	auto expected = StableSorted(items);
+	EXPECT_TRUE(IncrementalSort(std::span(items), scratch, DepthKey));
+	EXPECT_TRUE(items == expected);
+
+	// A shuffled order falls back to the radix sort
+	std::shuffle(items.begin(), items.end(), gen);
+	expected = StableSorted(items);
+	EXPECT_FALSE(IncrementalSort(std::span(items), scratch, DepthKey));
+	EXPECT_TRUE(items == expected);
+}
+
+TEST(SortTest, DISABLED_PerfSort)
+{
+	std::ranlux24_base gen;
+	std::vector<std::pair<uint32_t, float>> scratch;
+	for (uint32_t num : { 10000U, 100000U, 1000000U })
+	{
+		auto const items = RandomDepths(num, gen);
+
+		auto std_sorted = items;
+		Timer timer;
+		std::sort(std_sorted.begin(), std_sorted.end(),
+			[](std::pair<uint32_t, float> const & lhs, std::pair<uint32_t, float> const & rhs)
+			{
+				return lhs.second < rhs.second;
+			});
+		double const std_sort_time = timer.elapsed();
+
+		auto radix_sorted = items;
+		timer.restart();
+		RadixSort(std::span(radix_sorted), scratch, DepthKey);
+		double const radix_sort_time = timer.elapsed();
+
+		// Next frame, starting from the sorted order
+		auto next_frame = radix_sorted;
+		JitterDepths(next_frame, gen);
+		auto const expected = StableSorted(next_frame);
+		timer.restart();
+		IncrementalSort(std::span(next_frame), scratch, DepthKey);
+		double const incremental_sort_time = timer.elapsed();
+
+		EXPECT_TRUE(radix_sorted == StableSorted(items));
+		EXPECT_TRUE(next_frame == expected);
+
+		std::cout << num << " keys: std::sort " << std_sort_time * 1000 << " ms, radix " << radix_sort_time * 1000
+			<< " ms, incremental " << incremental_sort_time * 1000 << " ms" << std::endl;
+	}
+}
@@ -0,0 +1,204 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/TransientBuffer.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t constexpr ALLOC_SIZE = 64;
+
+	// Every byte of an alloc is its index in what ConcurrentAlloc returns
+	uint8_t AllocFill(size_t index)
+	{
+		return static_cast<uint8_t>(index);
+	}
+
+	// Each thread allocates its own blocks, like UI, font and debug draw filling one buffer
+	std::vector<SubAlloc> ConcurrentAlloc(TransientBuffer& tb, uint32_t num_threads, uint32_t num_allocs_per_thread)
+	{
+		std::vector<std::vector<SubAlloc>> thread_allocs(num_threads);
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < num_threads; ++ t)
+		{
+			threads.emplace_back([&tb, &allocs = thread_allocs[t], t, num_allocs_per_thread]
+				{
+					uint8_t data[ALLOC_SIZE];
+					for (uint32_t i = 0; i < num_allocs_per_thread; ++ i)
+					{
+						std::fill(std::begin(data), std::end(data), AllocFill(t * num_allocs_per_thread + i));
+						allocs.push_back(tb.Alloc(sizeof(data), data));
+					}
+				});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		std::vector<SubAlloc> allocs;
+		for (auto const& ta : thread_allocs)
+		{
+			allocs.insert(allocs.end(), ta.begin(), ta.end());
+		}
+		return allocs;
+	}
+
+	bool NoOverlap(std::vector<SubAlloc> allocs, uint32_t capacity)
+	{
+		std::sort(allocs.begin(), allocs.end(), [](SubAlloc const& lhs, SubAlloc const& rhs) { return lhs.offset_ < rhs.offset_; });
+		for (size_t i = 0; i < allocs.size(); ++ i)
+		{
+			if (allocs[i].offset_ + allocs[i].length_ > capacity)
+			{
+				return false;
+			}
+			if ((i > 0) && (allocs[i - 1].offset_ + allocs[i - 1].length_ > allocs[i].offset_))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Reads the GPU buffer back after EnsureDataReady. Each alloc has to hold what was written to it.
+	bool ContentsMatch(TransientBuffer const& tb, std::vector<SubAlloc> const& allocs)
+	{
+		auto& buffer = *tb.GetBuffer();
+		auto& rf = Context::Instance().RenderFactoryInstance();
+		auto buffer_cpu = rf.MakeVertexBuffer(BU_Static, EAH_CPU_Read, buffer.Size(), nullptr);
+		buffer.CopyToBuffer(*buffer_cpu);
+
+		GraphicsBuffer::Mapper mapper(*buffer_cpu, BA_Read_Only);
+		uint8_t const* data = mapper.Pointer<uint8_t>();
+		for (size_t i = 0; i < allocs.size(); ++ i)
+		{
+			uint8_t const expected = AllocFill(i);
+			if (!std::all_of(data + allocs[i].offset_, data + allocs[i].offset_ + allocs[i].length_,
+					[expected](uint8_t v) { return v == expected; }))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST(TransientBufferTest, RingConcurrentAlloc)
+{
+	uint32_t const num_threads = 4;
+	uint32_t const num_allocs_per_thread = 256;
+	uint32_t const frame_size = num_threads * num_allocs_per_thread * ALLOC_SIZE;
+
+	// Room for 4 frames, more than the ones in flight
+	TransientBuffer tb(frame_size * 4, TransientBuffer::BF_Vertex, TransientBuffer::AM_Ring);
+	for (uint32_t frame = 0; frame < 16; ++ frame)
+	{
+		auto const allocs = ConcurrentAlloc(tb, num_threads, num_allocs_per_thread);
+		EXPECT_EQ(allocs.size(), num_threads * num_allocs_per_thread);
+		EXPECT_TRUE(NoOverlap(allocs, tb.GetStats().capacity));
+
+		tb.EnsureDataReady();
+		EXPECT_TRUE(tb.GetBuffer()->Size() >= tb.GetStats().capacity);
+		EXPECT_TRUE(ContentsMatch(tb, allocs));
+		tb.OnPresent();
+	}
+
+	auto const stats = tb.GetStats();
+	EXPECT_EQ(stats.capacity, frame_size * 4);
+	EXPECT_EQ(stats.num_wrap_stalls, 0U);
+	EXPECT_TRUE(stats.high_water_mark >= frame_size);
+	EXPECT_TRUE(stats.high_water_mark <= stats.capacity);
+}
+
+TEST(TransientBufferTest, RingGrowsOnWrapStall)
+{
+	uint32_t const num_threads = 4;
+	uint32_t const num_allocs_per_thread = 256;
+	uint32_t const frame_size = num_threads * num_allocs_per_thread * ALLOC_SIZE;
+
+	// Too small for even one frame
+	TransientBuffer tb(frame_size / 8, TransientBuffer::BF_Index, TransientBuffer::AM_Ring);
+	for (uint32_t frame = 0; frame < 8; ++ frame)
+	{
+		auto const allocs = ConcurrentAlloc(tb, num_threads, num_allocs_per_thread);
+		EXPECT_TRUE(NoOverlap(allocs, tb.GetStats().capacity));
+
+		// Allocs from before a growth are still in the new buffer
+		tb.EnsureDataReady();
+		EXPECT_TRUE(ContentsMatch(tb, allocs));
+		tb.OnPresent();
+	}
+
+	auto const stats = tb.GetStats();
+	EXPECT_TRUE(stats.num_wrap_stalls > 0);
+	EXPECT_TRUE(stats.capacity >= frame_size);
+	EXPECT_TRUE(tb.GetBuffer()->Size() >= stats.capacity);
+
+	// Once it's large enough, it stops growing
+	tb.ResetStats();
+	for (uint32_t frame = 0; frame < 8; ++ frame)
+	{
+		ConcurrentAlloc(tb, num_threads, num_allocs_per_thread);
+		tb.EnsureDataReady();
+		tb.OnPresent();
+	}
+	EXPECT_EQ(tb.GetStats().num_wrap_stalls, 0U);
+	EXPECT_EQ(tb.GetStats().capacity, stats.capacity);
+}
+
+TEST(TransientBufferTest, DISABLED_PerfAlloc)
+{
+	uint32_t const num_allocs_per_frame = 4096;
+	uint32_t const num_frames = 100;
+	uint32_t const size = num_allocs_per_frame * ALLOC_SIZE * 4;
+
+	uint8_t data[ALLOC_SIZE] = {};
+
+	{
+		TransientBuffer tb(size, TransientBuffer::BF_Vertex, TransientBuffer::AM_FreeList);
+		std::vector<SubAlloc> allocs;
+		Timer timer;
+		for (uint32_t frame = 0; frame < num_frames; ++ frame)
+		{
+			for (uint32_t i = 0; i < num_allocs_per_frame; ++ i)
+			{
+				allocs.push_back(tb.Alloc(sizeof(data), data));
+			}
+			tb.EnsureDataReady();
+			for (auto const& alloc : allocs)
+			{
+				tb.Dealloc(alloc);
+			}
+			allocs.clear();
+			tb.OnPresent();
+		}
+		std::cout << "Free list: " << timer.elapsed() * 1e9 / (num_allocs_per_frame * num_frames) << " ns per alloc" << std::endl;
+	}
+
+	for (uint32_t num_threads : { 1U, 4U })
+	{
+		TransientBuffer tb(size, TransientBuffer::BF_Vertex, TransientBuffer::AM_Ring);
+		Timer timer;
+		for (uint32_t frame = 0; frame < num_frames; ++ frame)
+		{
+			ConcurrentAlloc(tb, num_threads, num_allocs_per_frame / num_threads);
+			tb.EnsureDataReady();
+			tb.OnPresent();
+		}
+		auto const stats = tb.GetStats();
+		std::cout << "Ring, " << num_threads << " threads: " << timer.elapsed() * 1e9 / (num_allocs_per_frame * num_frames)
+				  << " ns per alloc, high water mark " << stats.high_water_mark << " of " << stats.capacity << " bytes, "
+				  << stats.num_wrap_stalls << " wrap stalls" << std::endl;
+	}
+}
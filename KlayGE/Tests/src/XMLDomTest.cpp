@@ -0,0 +1,184 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX20/span.hpp>
+#include <KFL/ResIdentifier.hpp>
+#include <KFL/Timer.hpp>
+#include <KFL/XMLDom.hpp>
+#include <KlayGE/ResLoader.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace KlayGE;
+
+namespace
+{
+	std::string_view const test_xml = R"(<effect name="test">
+	<parameter type="float4" name="color" value="1 0.5 0.25 1"/>
+	<parameter type="int" name="count" value="42"/>
+	<shader><![CDATA[float4 Func() { return color; }]]></shader>
+	<!-- comment -->
+	<technique name="Tech" inherit="Base">
+		<pass name="p0">
+			<state name="cull_mode" value="none"/>
+			<state name="depth_enable" value="false"/>
+		</pass>
+		text &amp; entities
+	</technique>
+</effect>)";
+
+	XMLNode LoadXmlFromString(std::string_view xml, XMLDomMode mode)
+	{
+		auto data = MakeSharedPtr<std::string>(xml);
+		ResIdentifier res("test.xml", 0, std::span(reinterpret_cast<uint8_t const*>(data->data()), data->size()), data);
+		return LoadXml(res, mode);
+	}
+
+	void ExpectSameTree(XMLNode const& lhs, XMLNode const& rhs)
+	{
+		EXPECT_TRUE(lhs.Type() == rhs.Type());
+		EXPECT_EQ(lhs.Name(), rhs.Name());
+		EXPECT_EQ(lhs.ValueString(), rhs.ValueString());
+
+		auto const* lhs_attr = lhs.FirstAttrib();
+		auto const* rhs_attr = rhs.FirstAttrib();
+		for (; lhs_attr && rhs_attr; lhs_attr = lhs.NextAttrib(*lhs_attr), rhs_attr = rhs.NextAttrib(*rhs_attr))
+		{
+			EXPECT_EQ(lhs_attr->Name(), rhs_attr->Name());
+			EXPECT_EQ(lhs_attr->ValueString(), rhs_attr->ValueString());
+			EXPECT_EQ(lhs_attr->Parent(), &lhs);
+		}
+		EXPECT_TRUE((lhs_attr == nullptr) && (rhs_attr == nullptr));
+
+		auto const* lhs_child = lhs.FirstNode();
+		auto const* rhs_child = rhs.FirstNode();
+		for (; lhs_child && rhs_child; lhs_child = lhs_child->NextSibling(), rhs_child = rhs_child->NextSibling())
+		{
+			EXPECT_EQ(lhs_child->Parent(), &lhs);
+			ExpectSameTree(*lhs_child, *rhs_child);
+		}
+		EXPECT_TRUE((lhs_child == nullptr) && (rhs_child == nullptr));
+	}
+}
+
+TEST(XMLDomTest, ArenaMatchesCopy)
+{
+	XMLNode const copy_root = LoadXmlFromString(test_xml, XMLDomMode::Copy);
+	XMLNode const arena_root = LoadXmlFromString(test_xml, XMLDomMode::Arena);
+	ExpectSameTree(arena_root, copy_root);
+
+	EXPECT_EQ(arena_root.AttribString("name", ""), "test");
+	EXPECT_EQ(arena_root.FirstNode("parameter")->NextSibling("parameter")->AttribInt("value", 0), 42);
+	EXPECT_EQ(arena_root.FirstNode("technique")->FirstNode("pass")->LastNode("state")->AttribBool("value", true), false);
+
+	// Copies of arena nodes live on the heap, with their own parents
+	XMLNode const arena_copy = arena_root;
+	ExpectSameTree(arena_copy, copy_root);
+}
+
+TEST(XMLDomTest, ArenaNodesOutliveDocument)
+{
+	XMLNode technique(XMLNodeType::Element, "");
+	XMLAttribute attr("");
+	{
+		XMLNode root = LoadXmlFromString(test_xml, XMLDomMode::Arena);
+		technique = *root.FirstNode("technique");
+		attr = *root.FirstNode("parameter")->Attrib("value");
+	}
+
+	EXPECT_EQ(technique.Name(), "technique");
+	EXPECT_EQ(technique.AttribString("inherit", ""), "Base");
+	EXPECT_EQ(technique.FirstNode("pass")->FirstNode("state")->AttribString("value", ""), "none");
+	EXPECT_EQ(attr.ValueString(), "1 0.5 0.25 1");
+
+	// Moving the whole document keeps it alive as well
+	XMLNode moved(XMLNodeType::Element, "");
+	{
+		XMLNode root = LoadXmlFromString(test_xml, XMLDomMode::Arena);
+		moved = std::move(root);
+	}
+	EXPECT_EQ(moved.FirstNode("technique")->FirstNode("pass")->AttribString("name", ""), "p0");
+}
+
+TEST(XMLDomTest, EditArenaNodes)
+{
+	XMLNode root = LoadXmlFromString(test_xml, XMLDomMode::Arena);
+
+	root.Name("effect2");
+	root.Attrib("name")->Value(std::string_view("renamed"));
+	EXPECT_EQ(root.Name(), "effect2");
+	EXPECT_EQ(root.AttribString("name", ""), "renamed");
+
+	// Grows the arena-allocated child and attribute lists
+	XMLNode* pass = root.FirstNode("technique")->FirstNode("pass");
+	for (uint32_t i = 0; i < 100; ++ i)
+	{
+		XMLNode state(XMLNodeType::Element, "state");
+		state.AppendAttrib(XMLAttribute("name", "state" + std::to_string(i)));
+		state.AppendAttrib(XMLAttribute("value", i));
+		pass->AppendNode(std::move(state));
+		pass->AppendAttrib(XMLAttribute("attr" + std::to_string(i), i));
+	}
+	pass->InsertAfterNode(*pass->FirstNode(), XMLNode(XMLNodeType::Element, "inserted"));
+	pass->RemoveNode(*pass->FirstNode("state"));
+	pass->RemoveAttrib(*pass->Attrib("name"));
+
+	EXPECT_EQ(pass->FirstNode()->Name(), "inserted");
+	EXPECT_EQ(pass->FirstNode("state")->AttribString("name", ""), "depth_enable");
+	EXPECT_EQ(pass->LastNode()->AttribUInt("value", 0), 99U);
+	EXPECT_EQ(pass->LastNode()->Parent(), pass);
+	EXPECT_EQ(pass->FirstAttrib()->Name(), "attr0");
+	EXPECT_EQ(pass->AttribUInt("attr99", 0), 99U);
+
+	uint32_t num_states = 0;
+	for (auto const* state = pass->FirstNode("state"); state; state = state->NextSibling("state"))
+	{
+		EXPECT_EQ(state->Parent(), pass);
+		++ num_states;
+	}
+	EXPECT_EQ(num_states, 101U);
+}
+
+TEST(XMLDomTest, DISABLED_PerfParse)
+{
+	std::string_view const effect_names[] = { "ClusteredDeferredRendering.fxml", "DeferredRendering.fxml", "GBuffer.fxml",
+		"LightIndexedDeferredRendering.fxml", "InfTerrain.fxml", "PostProcess.fxml", "Copy.fxml", "Lighting.fxml" };
+
+	std::vector<std::string> sources;
+	size_t total_size = 0;
+	for (auto const& name : effect_names)
+	{
+		if (auto res = Context::Instance().ResLoaderInstance().Open(name))
+		{
+			res->seekg(0, std::ios_base::end);
+			size_t const size = static_cast<size_t>(res->tellg());
+			res->seekg(0, std::ios_base::beg);
+			std::string& source = sources.emplace_back(size, '\0');
+			res->read(source.data(), size);
+			total_size += size;
+		}
+	}
+	EXPECT_TRUE(!sources.empty());
+
+	uint32_t const num_iterations = 20;
+	for (XMLDomMode mode : { XMLDomMode::Copy, XMLDomMode::Arena })
+	{
+		size_t num_root_attrs = 0;
+		Timer timer;
+		for (uint32_t i = 0; i < num_iterations; ++ i)
+		{
+			for (auto const& source : sources)
+			{
+				XMLNode const root = LoadXmlFromString(source, mode);
+				num_root_attrs += (root.FirstAttrib() != nullptr);
+			}
+		}
+		double const elapsed = timer.elapsed();
+		EXPECT_EQ(num_root_attrs % num_iterations, 0U);
+
+		std::cout << (mode == XMLDomMode::Copy ? "Copy" : "Arena") << ": " << elapsed * 1000 / num_iterations << " ms per "
+			<< total_size / 1024 << " KB, " << total_size * num_iterations / elapsed / (1024 * 1024) << " MB/s" << std::endl;
+	}
+}
@@ -29,20 +29,30 @@
  */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/CpuInfo.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Hash.hpp>
 #include <KFL/StringUtil.hpp>
+#include <KFL/Thread.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/JudaTexture.hpp>
 #include <KlayGE/RenderDeviceCaps.hpp>
 #include <KlayGE/ResLoader.hpp>
 
+#include <atomic>
+#include <exception>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <iomanip>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <regex>
 
+#include <boost/assert.hpp>
+
 #include <nonstd/scope.hpp>
 
 #ifndef KLAYGE_DEBUG
@@ -146,156 +156,431 @@ MeshMetadata LoadMeshMetadata(std::string const & res_name, MeshMetadata const &
 	}
 }
 
-void Cook(std::vector<std::string> const& res_names, std::string_view res_type, RenderDeviceCaps const& caps, std::string_view platform,
-	std::string_view dest_folder)
+// Mobile builds care more about download size, desktops about loading time
+CodecType DefaultModelCodec(std::string_view platform)
 {
-	size_t const res_type_hash = HashValue(std::move(res_type));
+	if (platform.starts_with("gles"))
+	{
+		return CodecType::LZMA;
+	}
+	else
+	{
+		return CodecType::LZ4;
+	}
+}
+
+// Bump these when a converter changes its output, so that the assets are cooked again
+uint32_t constexpr TEXTURE_COOK_VERSION = 1;
+uint32_t constexpr MODEL_COOK_VERSION = 1;
 
-	if ((CtHash("albedo") == res_type_hash)
+bool IsTextureResType(size_t res_type_hash)
+{
+	return (CtHash("albedo") == res_type_hash)
 		|| (CtHash("emissive") == res_type_hash)
 		|| (CtHash("glossiness") == res_type_hash)
 		|| (CtHash("metalness") == res_type_hash)
 		|| (CtHash("normal") == res_type_hash)
 		|| (CtHash("bump") == res_type_hash)
-		|| (CtHash("height") == res_type_hash))
-	{
-		TexMetadata const default_metadata = DefaultTextureMetadata(res_type_hash, caps);
+		|| (CtHash("height") == res_type_hash);
+}
 
-		TexConverter tc;
-		for (size_t i = 0; i < res_names.size(); ++ i)
+// Mixes the name and content of a resource into the seed
+void HashResource(size_t& seed, std::string_view name)
+{
+	HashCombine(seed, HashValue(name));
+
+	ResIdentifierPtr res = Context::Instance().ResLoaderInstance().Open(name);
+	if (res)
+	{
+		std::vector<char> buff(64 * 1024);
+		for (;;)
 		{
-			std::string_view real_res_type;
-			auto metadata = LoadTextureMetadata(res_names[i], default_metadata);
-			switch (metadata.Slot())
+			res->read(buff.data(), buff.size());
+			int64_t const num_read = res->gcount();
+			if (num_read <= 0)
 			{
-			case RenderMaterial::TS_Albedo:
-				real_res_type = "albedo";
-				break;
-			case RenderMaterial::TS_MetalnessGlossiness:
-				real_res_type = "metalness & glossiness";
-				break;
-			case RenderMaterial::TS_Emissive:
-				real_res_type = "emissive";
-				break;
-			case RenderMaterial::TS_Normal:
-				real_res_type = "normal";
 				break;
-			case RenderMaterial::TS_Height:
-				real_res_type = "height";
-				break;
-			case RenderMaterial::TS_Occlusion:
-				real_res_type = "occlusion";
-				break;
-
-			default:
-				KFL_UNREACHABLE("Invalid texture slot");
 			}
+			HashRange(seed, buff.begin(), buff.begin() + num_read);
+		}
+	}
+}
 
-			std::cout << "Cooking " << res_names[i] << " to " << real_res_type << std::endl;
+// Remembers which key every output was cooked with. A key hashes the source bytes, the metadata, the cooking settings and the
+// converter version, so an output with the same key doesn't need to be cooked again. Outputs also keep the files their
+// converter read besides the listed sources, whose bytes go into the key of the next run.
+class CookDatabase final
+{
+	KLAYGE_NONCOPYABLE(CookDatabase);
+
+	static uint32_t constexpr VERSION = 2;
+
+	struct Entry
+	{
+		size_t key;
+		std::vector<std::string> dependencies;
+	};
 
-			auto output_tex = tc.Load(metadata);
-			if (output_tex)
+public:
+	explicit CookDatabase(std::filesystem::path path)
+		: path_(std::move(path))
+	{
+		// A database of another version is dropped, everything is cooked again
+		std::ifstream ifs(path_);
+		std::string magic;
+		uint32_t version;
+		if ((ifs >> magic >> version) && (magic == "cookdb") && (version == VERSION))
+		{
+			size_t key;
+			std::string output;
+			size_t num_dependencies;
+			while (ifs >> std::hex >> key >> std::quoted(output) >> std::dec >> num_dependencies)
 			{
-				std::filesystem::path res_path(res_names[i]);
-				if (!dest_folder.empty())
+				Entry entry{key, std::vector<std::string>(num_dependencies)};
+				for (auto& dependency : entry.dependencies)
 				{
-					res_path = std::filesystem::path(dest_folder) / res_path.filename();
+					ifs >> std::quoted(dependency);
 				}
-				SaveTexture(output_tex, res_path.string() + ".dds");
+				entries_[output] = std::move(entry);
 			}
 		}
 	}
-	else if (CtHash("model") == res_type_hash)
-	{
-		MeshMetadata const default_metadata;
 
-		MeshConverter mc;
-		for (size_t i = 0; i < res_names.size(); ++ i)
+	std::vector<std::string> Dependencies(std::string const& output) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto iter = entries_.find(output);
+		if (iter == entries_.end())
 		{
-			std::cout << "Cooking " << res_names[i] << " to " << res_type << std::endl;
+			return {};
+		}
+		return iter->second.dependencies;
+	}
 
-			auto metadata = LoadMeshMetadata(res_names[i], default_metadata);
-			auto output_model = mc.Load(metadata);
-			if (output_model)
+	bool UpToDate(std::string const& output, size_t key) const
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto iter = entries_.find(output);
+			if ((iter == entries_.end()) || (iter->second.key != key))
 			{
-				std::filesystem::path res_path(res_names[i]);
-				if (!dest_folder.empty())
-				{
-					res_path = std::filesystem::path(dest_folder) / res_path.filename();
-				}
-				SaveModel(*output_model, res_path.string() + ".model_bin");
+				return false;
 			}
 		}
+		return std::filesystem::exists(output);
 	}
-	else
+
+	void Update(std::string const& output, size_t key, std::vector<std::string> dependencies = {})
 	{
-		std::ofstream ofs("convert.bat");
+		std::lock_guard<std::mutex> lock(mutex_);
+		entries_[output] = Entry{key, std::move(dependencies)};
+	}
 
-		if (CtHash("cubemap") == res_type_hash)
+	void Save() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::ofstream ofs(path_);
+		ofs << "cookdb " << VERSION << '\n';
+		for (auto const& entry : entries_)
 		{
-			std::string y_fmt;
-			std::string c_fmt;
-			if (caps.BestMatchTextureFormat(MakeSpan({EF_R16, EF_R16F})) == EF_R16)
-			{
-				y_fmt = "R16";
-			}
-			else
+			ofs << std::hex << entry.second.key << ' ' << std::quoted(entry.first) << ' ' << std::dec << entry.second.dependencies.size();
+			for (auto const& dependency : entry.second.dependencies)
 			{
-				y_fmt = "R16F";
+				ofs << ' ' << std::quoted(dependency);
 			}
-			if (caps.BestMatchTextureFormat(MakeSpan({EF_BC5, EF_BC3})) == EF_BC5)
+			ofs << '\n';
+		}
+	}
+
+private:
+	std::filesystem::path path_;
+	std::unordered_map<std::string, Entry> entries_;
+	mutable std::mutex mutex_;
+};
+
+std::string CookedName(std::string const& res_name, std::string_view dest_folder, std::string_view ext)
+{
+	std::filesystem::path res_path(res_name);
+	if (!dest_folder.empty())
+	{
+		res_path = std::filesystem::path(dest_folder) / res_path.filename();
+	}
+	res_path += ext;
+	return std::filesystem::absolute(res_path).lexically_normal().string();
+}
+
+// Textures and models are cooked by a group of workers, each with its own converters. Everything up to date in the database is skipped.
+void CookAssets(std::vector<std::string> const& res_names, std::vector<std::string> const& res_types, RenderDeviceCaps const& caps,
+	std::string_view platform, CodecType model_codec, std::string_view dest_folder, uint32_t num_threads, bool force)
+{
+	BOOST_ASSERT(res_names.size() == res_types.size());
+
+	CookDatabase db(std::filesystem::path(dest_folder.empty() ? "." : dest_folder) / "Cooker.cookdb");
+
+	std::mutex cout_mutex;
+	std::atomic<uint32_t> next_job(0);
+	std::atomic<uint32_t> num_cooked(0);
+	std::atomic<uint32_t> num_skipped(0);
+	std::atomic<uint32_t> num_failed(0);
+
+	auto worker = [&]()
+	{
+		std::unique_ptr<TexConverter> tc;
+		std::unique_ptr<MeshConverter> mc;
+
+		for (uint32_t i = next_job ++; i < res_names.size(); i = next_job ++)
+		{
+			std::string const& res_name = res_names[i];
+			size_t const res_type_hash = HashValue(std::string_view(res_types[i]));
+
+			size_t key = 0;
+			HashCombine(key, HashValue(std::string_view(res_types[i])));
+			HashCombine(key, HashValue(platform));
+			HashResource(key, res_name + ".kmeta");
+
+			if (IsTextureResType(res_type_hash))
 			{
-				c_fmt = "BC5";
+				auto const metadata = LoadTextureMetadata(res_name, DefaultTextureMetadata(res_type_hash, caps));
+
+				HashCombine(key, TEXTURE_COOK_VERSION);
+				for (uint32_t array_index = 0; array_index < metadata.ArraySize(); ++ array_index)
+				{
+					for (uint32_t mip = 0; !metadata.PlaneFileName(array_index, mip).empty(); ++ mip)
+					{
+						HashResource(key, metadata.PlaneFileName(array_index, mip));
+					}
+				}
+
+				std::string const output_name = CookedName(res_name, dest_folder, ".dds");
+				if (!force && db.UpToDate(output_name, key))
+				{
+					++ num_skipped;
+					continue;
+				}
+
+				std::string_view real_res_type;
+				switch (metadata.Slot())
+				{
+				case RenderMaterial::TS_Albedo:
+					real_res_type = "albedo";
+					break;
+				case RenderMaterial::TS_MetalnessGlossiness:
+					real_res_type = "metalness & glossiness";
+					break;
+				case RenderMaterial::TS_Emissive:
+					real_res_type = "emissive";
+					break;
+				case RenderMaterial::TS_Normal:
+					real_res_type = "normal";
+					break;
+				case RenderMaterial::TS_Height:
+					real_res_type = "height";
+					break;
+				case RenderMaterial::TS_Occlusion:
+					real_res_type = "occlusion";
+					break;
+
+				default:
+					KFL_UNREACHABLE("Invalid texture slot");
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(cout_mutex);
+					std::cout << "Cooking " << res_name << " to " << real_res_type << std::endl;
+				}
+
+				if (!tc)
+				{
+					tc = MakeUniquePtr<TexConverter>();
+				}
+				auto output_tex = tc->Load(metadata);
+				if (output_tex)
+				{
+					SaveTexture(output_tex, output_name);
+					db.Update(output_name, key);
+					++ num_cooked;
+				}
+				else
+				{
+					++ num_failed;
+				}
 			}
 			else
 			{
-				c_fmt = "BC3";
-			}
+				BOOST_ASSERT(CtHash("model") == res_type_hash);
 
-			for (size_t i = 0; i < res_names.size(); ++ i)
-			{
-				std::cout << "Cooking " << res_names[i] << " to " << res_type << std::endl;
+				auto const metadata = LoadMeshMetadata(res_name, MeshMetadata());
 
-				ofs << "@echo Processing: " << res_names[i] << std::endl;
+				HashCombine(key, MODEL_COOK_VERSION);
+				HashCombine(key, static_cast<uint32_t>(model_codec));
+				for (uint32_t lod = 0; lod < metadata.NumLods(); ++ lod)
+				{
+					HashResource(key, metadata.LodFileName(lod));
+				}
+				for (uint32_t mtl_index = 0; mtl_index < metadata.NumMaterials(); ++ mtl_index)
+				{
+					HashResource(key, metadata.MaterialFileName(mtl_index));
+				}
 
-				ofs << "@echo off" << std::endl << std::endl;
-				ofs << "HDRCompressor \"" << res_names[i] << "\" " << y_fmt << ' ' << c_fmt;
-				if (!dest_folder.empty())
+				// The importer reads sidecars, like glTF buffers or OBJ materials, that only the last cook knows about.
+				// If the source changed to reference others, the source's own hash differs anyway.
+				std::string const output_name = CookedName(res_name, dest_folder, ".model_bin");
+				auto const add_dependencies = [key](std::vector<std::string> const& dependencies)
 				{
-					ofs << " \"" << dest_folder << "\"";
+					size_t ret = key;
+					for (auto const& dependency : dependencies)
+					{
+						HashResource(ret, dependency);
+					}
+					return ret;
+				};
+				if (!force && db.UpToDate(output_name, add_dependencies(db.Dependencies(output_name))))
+				{
+					++ num_skipped;
+					continue;
 				}
-				ofs << std::endl;
-				ofs << "@echo on" << std::endl << std::endl;
-			}
-		}
-		else if (CtHash("effect") == res_type_hash)
-		{
-			for (size_t i = 0; i < res_names.size(); ++ i)
-			{
-				std::cout << "Cooking " << res_names[i] << " to " << res_type << std::endl;
 
-				ofs << "@echo Processing: " << res_names[i] << std::endl;
+				{
+					std::lock_guard<std::mutex> lock(cout_mutex);
+					std::cout << "Cooking " << res_name << " to model" << std::endl;
+				}
 
-				ofs << "@echo off" << std::endl << std::endl;
-				ofs << "FxmlJit -P " << platform << " -I \"" << res_names[i] << "\"";
-				if (!dest_folder.empty())
+				if (!mc)
+				{
+					mc = MakeUniquePtr<MeshConverter>();
+				}
+				std::vector<std::string> dependencies;
+				auto output_model = mc->Load(metadata, dependencies);
+				if (output_model)
+				{
+					SaveModel(*output_model, output_name, model_codec);
+					size_t const full_key = add_dependencies(dependencies);
+					db.Update(output_name, full_key, std::move(dependencies));
+					++ num_cooked;
+				}
+				else
 				{
-					ofs << " -D \"" << dest_folder << "\"";
+					++ num_failed;
 				}
-				ofs << std::endl;
-				ofs << "@echo on" << std::endl << std::endl;
 			}
 		}
+	};
+
+	num_threads = std::min(num_threads, static_cast<uint32_t>(res_names.size()));
+	if (num_threads > 1)
+	{
+		ThreadPool& tp = Context::Instance().ThreadPoolInstance();
+		std::vector<std::future<void>> joiners(num_threads - 1);
+		for (auto& joiner : joiners)
+		{
+			joiner = tp.QueueThread(worker);
+		}
+		std::exception_ptr worker_exception;
+		try
+		{
+			worker();
+		}
+		catch (...)
+		{
+			worker_exception = std::current_exception();
+		}
+
+		// The workers use the locals here, so all of them have to finish before an error leaves, without saving the database
+		for (auto& joiner : joiners)
+		{
+			joiner.wait();
+		}
+		if (worker_exception)
+		{
+			std::rethrow_exception(worker_exception);
+		}
+		for (auto& joiner : joiners)
+		{
+			joiner.get();
+		}
+	}
+	else
+	{
+		worker();
+	}
+
+	db.Save();
+
+	std::cout << num_cooked << " cooked, " << num_skipped << " up to date, " << num_failed << " failed." << std::endl;
+}
+
+// Cube maps and effects are cooked by other tools, through a script
+void CookWithScript(std::vector<std::string> const& res_names, std::string_view res_type, RenderDeviceCaps const& caps,
+	std::string_view platform, std::string_view dest_folder)
+{
+	size_t const res_type_hash = HashValue(std::move(res_type));
+
+	std::ofstream ofs("convert.bat");
+
+	if (CtHash("cubemap") == res_type_hash)
+	{
+		std::string y_fmt;
+		std::string c_fmt;
+		if (caps.BestMatchTextureFormat(MakeSpan({EF_R16, EF_R16F})) == EF_R16)
+		{
+			y_fmt = "R16";
+		}
 		else
 		{
-			std::cout << "Error: Unknown resource type." << std::endl;
+			y_fmt = "R16F";
+		}
+		if (caps.BestMatchTextureFormat(MakeSpan({EF_BC5, EF_BC3})) == EF_BC5)
+		{
+			c_fmt = "BC5";
+		}
+		else
+		{
+			c_fmt = "BC3";
+		}
+
+		for (size_t i = 0; i < res_names.size(); ++ i)
+		{
+			std::cout << "Cooking " << res_names[i] << " to " << res_type << std::endl;
+
+			ofs << "@echo Processing: " << res_names[i] << std::endl;
+
+			ofs << "@echo off" << std::endl << std::endl;
+			ofs << "HDRCompressor \"" << res_names[i] << "\" " << y_fmt << ' ' << c_fmt;
+			if (!dest_folder.empty())
+			{
+				ofs << " \"" << dest_folder << "\"";
+			}
+			ofs << std::endl;
+			ofs << "@echo on" << std::endl << std::endl;
 		}
+	}
+	else if (CtHash("effect") == res_type_hash)
+	{
+		for (size_t i = 0; i < res_names.size(); ++ i)
+		{
+			std::cout << "Cooking " << res_names[i] << " to " << res_type << std::endl;
 
-		ofs.close();
+			ofs << "@echo Processing: " << res_names[i] << std::endl;
 
-		[[maybe_unused]] int err = system("convert.bat");
-		err = system("del convert.bat");
+			ofs << "@echo off" << std::endl << std::endl;
+			ofs << "FxmlJit -P " << platform << " -I \"" << res_names[i] << "\"";
+			if (!dest_folder.empty())
+			{
+				ofs << " -D \"" << dest_folder << "\"";
+			}
+			ofs << std::endl;
+			ofs << "@echo on" << std::endl << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << "Error: Unknown resource type." << std::endl;
 	}
+
+	ofs.close();
+
+	[[maybe_unused]] int err = system("convert.bat");
+	err = system("del convert.bat");
 }
 
 int main(int argc, char* argv[])
@@ -308,7 +593,10 @@ int main(int argc, char* argv[])
 	std::vector<std::string> res_names;
 	std::string res_type;
 	std::string platform;
+	std::string codec;
 	std::string dest_folder;
+	uint32_t num_threads = CpuInfo().NumHWThreads();
+	bool force = false;
 
 	cxxopts::Options options("Cooker", "KlayGE Cooker");
 	// clang-format off
@@ -317,7 +605,10 @@ int main(int argc, char* argv[])
 		("I,input-path", "Input resource path.", cxxopts::value<std::string>())
 		("T,type", "Resource type (auto by default).", cxxopts::value<std::string>())
 		("P,platform", "Platform name.", cxxopts::value<std::string>())
+		("C,codec", "Compression codec of models, lzma or lz4 (auto by default).", cxxopts::value<std::string>())
 		("D,dest-folder", "Destination folder.", cxxopts::value<std::string>())
+		("J,jobs", "Number of cooking threads (number of cores by default).", cxxopts::value<uint32_t>())
+		("F,force", "Cook everything again, even if it's up to date.")
 		("v,version", "Version.");
 	// clang-format on
 
@@ -331,13 +622,21 @@ int main(int argc, char* argv[])
 	}
 	if (vm.count("version") > 0)
 	{
-		cout << "KlayGE Cooker, Version 2.0.0" << endl;
+		cout << "KlayGE Cooker, Version 2.1.0" << endl;
 		return 1;
 	}
 	if (vm.count("dest-folder") > 0)
 	{
 		dest_folder = vm["dest-folder"].as<std::string>();
 	}
+	if (vm.count("jobs") > 0)
+	{
+		num_threads = std::max(vm["jobs"].as<uint32_t>(), 1U);
+	}
+	if (vm.count("force") > 0)
+	{
+		force = true;
+	}
 	if (vm.count("input-path") > 0)
 	{
 		std::string input_name_str = vm["input-path"].as<std::string>();
@@ -438,24 +737,31 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
+	// Without a type, every resource gets its own, so textures and models can be cooked together
+	std::vector<std::string> res_types;
 	if (vm.count("type") > 0)
 	{
 		res_type = vm["type"].as<std::string>();
+		StringUtil::ToLower(res_type);
+		res_types.assign(res_names.size(), res_type);
 	}
 	else
 	{
-		if (TexConverter::IsSupported(res_names[0]))
+		for (auto const& res_name : res_names)
 		{
-			res_type = "albedo";
-		}
-		else if (MeshConverter::IsSupported(res_names[0]))
-		{
-			res_type = "model";
-		}
-		else
-		{
-			cout << "Need resource type name." << endl;
-			return 1;
+			if (TexConverter::IsSupported(res_name))
+			{
+				res_types.push_back("albedo");
+			}
+			else if (MeshConverter::IsSupported(res_name))
+			{
+				res_types.push_back("model");
+			}
+			else
+			{
+				cout << "Need resource type name for " << res_name << '.' << endl;
+				return 1;
+			}
 		}
 	}
 	if (vm.count("platform") > 0)
@@ -467,7 +773,6 @@ int main(int argc, char* argv[])
 		platform = "d3d_11_0";
 	}
 
-	StringUtil::ToLower(res_type);
 	StringUtil::ToLower(platform);
 
 	if (("pc_dx11" == platform) || ("pc_dx10" == platform) || ("pc_dx9" == platform) || ("win_tegra3" == platform)
@@ -512,8 +817,36 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	CodecType model_codec = DefaultModelCodec(platform);
+	if (vm.count("codec") > 0)
+	{
+		codec = vm["codec"].as<std::string>();
+		StringUtil::ToLower(codec);
+		if ("lzma" == codec)
+		{
+			model_codec = CodecType::LZMA;
+		}
+		else if ("lz4" == codec)
+		{
+			model_codec = CodecType::LZ4;
+		}
+		else
+		{
+			cout << "Unknown codec " << codec << '.' << endl;
+			return 1;
+		}
+	}
+
 	PlatformDefinition platform_def(platform + ".plat");
-	Cook(res_names, res_type, platform_def.device_caps, platform, dest_folder);
+	size_t const res_type_hash = HashValue(std::string_view(res_types[0]));
+	if (IsTextureResType(res_type_hash) || (CtHash("model") == res_type_hash))
+	{
+		CookAssets(res_names, res_types, platform_def.device_caps, platform, model_codec, dest_folder, num_threads, force);
+	}
+	else
+	{
+		CookWithScript(res_names, res_types[0], platform_def.device_caps, platform, dest_folder);
+	}
 
 	return 0;
 }
@@ -182,6 +182,7 @@ public:
 		std::vector<uint8_t> char_bitmap(internal_char_size_ / 8 * internal_char_size_);
 		std::vector<float> aa_char_bitmap_2x(char_size_ * char_size_ * 4);
 		std::vector<float> dist_data(char_size_ * char_size_);
+		DistanceFieldScratch dist_scratch;
 
 		raster_user_struct raster_user;
 		raster_user.internal_char_size = internal_char_size_;
@@ -267,7 +268,7 @@ public:
 						}
 					}
 
-					ComputeDistance(aa_char_bitmap_2x, char_size_ * 2, char_size_ * 2, dist_data);
+					ComputeDistance(aa_char_bitmap_2x, char_size_ * 2, char_size_ * 2, dist_data, dist_scratch);
 
 					for (uint32_t i = 0; i < dist_data.size(); ++ i)
 					{
@@ -423,13 +424,16 @@ struct quantizer_chars_param
 	font_info const * char_info;
 	float const * char_dist_data;
 	uint32_t char_size_sq;
-	uint32_t s;
-	uint32_t e;
+	uint32_t num_chars;
+	uint32_t num_chars_per_package;
+	std::atomic<uint32_t>* cur_package;
+	KFontWriter* kfont_output;
 };
 
-void quantizer_chars(std::vector<uint8_t>& lzma_dist, float& mse, quantizer_chars_param const & param)
+// Quantizes and compresses packages of glyphs until all are taken. Each glyph goes straight to the writer,
+// which puts them in order, so nothing is gathered here.
+void quantizer_chars(float& mse, quantizer_chars_param const & param)
 {
-	lzma_dist.clear();
 	mse = 0;
 
 	float const min_value = param.min_value;
@@ -439,53 +443,54 @@ void quantizer_chars(std::vector<uint8_t>& lzma_dist, float& mse, quantizer_char
 
 	LZMACodec lzma_enc;
 	std::vector<uint8_t> uint8_dist(param.char_size_sq);
-	std::vector<uint8_t> char_lzma_dist;
-	for (uint32_t i = param.s; i < param.e; ++ i)
+	for (;;)
 	{
-		int const ch = param.char_index[i].first;
-		float const * dist = &param.char_dist_data[param.char_info[ch].dist_index];
-		for (size_t j = 0; j < param.char_size_sq; ++ j)
+		uint32_t const s = (*param.cur_package) ++ * param.num_chars_per_package;
+		if (s >= param.num_chars)
 		{
-			uint8_dist[j] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>((dist[j] - min_value) * inv_scale + 0.5f), 0, 255));
-
-			float const d = dist[j] - (uint8_dist[j] * frscale + fbase);
-			mse += d * d;
+			break;
 		}
 
-		lzma_enc.Encode(char_lzma_dist, uint8_dist);
-		uint64_t len = static_cast<uint64_t>(char_lzma_dist.size());
+		uint32_t const e = std::min(s + param.num_chars_per_package, param.num_chars);
+		for (uint32_t i = s; i < e; ++ i)
+		{
+			int const ch = param.char_index[i].first;
+			float const * dist = &param.char_dist_data[param.char_info[ch].dist_index];
+			for (size_t j = 0; j < param.char_size_sq; ++ j)
+			{
+				uint8_dist[j] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>((dist[j] - min_value) * inv_scale + 0.5f), 0, 255));
 
-		lzma_dist.insert(lzma_dist.end(), reinterpret_cast<uint8_t*>(&len), reinterpret_cast<uint8_t*>(&len + 1));
-		lzma_dist.insert(lzma_dist.end(), char_lzma_dist.begin(), char_lzma_dist.end());
+				float const d = dist[j] - (uint8_dist[j] * frscale + fbase);
+				mse += d * d;
+			}
+
+			std::vector<uint8_t> char_lzma_dist;
+			lzma_enc.Encode(char_lzma_dist, uint8_dist);
+			param.kfont_output->CommitLZMADistanceData(param.char_index[i].second, std::move(char_lzma_dist));
+		}
 	}
 }
 
-void quantizer(std::vector<uint8_t>& lzma_dist, uint32_t non_empty_chars,
+void quantizer(KFontWriter& kfont_output, uint32_t non_empty_chars,
 				int num_threads, std::pair<int32_t, int32_t> const * char_index,
 				font_info const * char_info, float const * char_dist_data,
 				uint32_t char_size_sq, float min_value, float max_value,
-				int16_t& base, int16_t& scale)
+				int16_t base, int16_t scale)
 {
 	ThreadPool tp(1, num_threads);
 
 	std::vector<std::future<void>> joiners(num_threads);
 
-	float fscale = max_value - min_value;
-	base = static_cast<int16_t>(min_value * 32768 + 0.5f);
-	scale = static_cast<int16_t>((fscale - 1) * 32768 + 0.5f);
-	float inv_scale = 255 / fscale;
+	float const fscale = max_value - min_value;
+	float const inv_scale = 255 / fscale;
 
 	float const frscale = (scale / 32768.0f + 1) / 255.0f;
 	float const fbase = base / 32768.0f;
 
-	std::vector<std::vector<uint8_t>> lzma_dists(num_threads);
+	std::atomic<uint32_t> cur_package(0);
 	std::vector<float> mses(num_threads);
 	for (int i = 0; i < num_threads; ++ i)
 	{
-		uint32_t n = (non_empty_chars + num_threads - 1) / num_threads;
-		uint32_t s = i * n;
-		uint32_t e = std::min(s + n, non_empty_chars);
-
 		quantizer_chars_param param;
 		param.min_value = min_value;
 		param.inv_scale = inv_scale;
@@ -495,9 +500,11 @@ void quantizer(std::vector<uint8_t>& lzma_dist, uint32_t non_empty_chars,
 		param.char_info = char_info;
 		param.char_dist_data = char_dist_data;
 		param.char_size_sq = char_size_sq;
-		param.s = s;
-		param.e = e;
-		joiners[i] = tp.QueueThread([&lzma_dists, &mses, param, i] { quantizer_chars(lzma_dists[i], mses[i], param); });
+		param.num_chars = non_empty_chars;
+		param.num_chars_per_package = 64;
+		param.cur_package = &cur_package;
+		param.kfont_output = &kfont_output;
+		joiners[i] = tp.QueueThread([&mses, param, i] { quantizer_chars(mses[i], param); });
 	}
 
 	float mse = 0;
@@ -506,10 +513,10 @@ void quantizer(std::vector<uint8_t>& lzma_dist, uint32_t non_empty_chars,
 		joiners[i].wait();
 
 		mse += mses[i];
-		lzma_dist.insert(lzma_dist.end(), lzma_dists[i].begin(), lzma_dists[i].end());
 	}
 
 	cout << "Quantize MSE: " << mse << endl;
+	cout << "Max queued glyphs: " << kfont_output.MaxPendingGlyphs() << endl;
 }
 
 int main(int argc, char* argv[])
@@ -714,14 +721,59 @@ int main(int argc, char* argv[])
 	}
 	cout << "Time elapsed: " << timer_stage.elapsed() << " s" << endl;
 
-	cout << "Quantize..." << endl;
+	if (!char_index.empty())
+	{
+		header.base = static_cast<int16_t>(min_value * 32768 + 0.5f);
+		header.scale = static_cast<int16_t>((max_value - min_value - 1) * 32768 + 0.5f);
+	}
+	else
+	{
+		header.base = 0;
+		header.scale = 0;
+	}
+
+	// The char tables are written first, then the glyphs are streamed in as they are compressed
+	KFontWriter kfont_output;
+	kfont_output.CharSize(header.char_size);
+	kfont_output.DistBase(header.base);
+	kfont_output.DistScale(header.scale);
+	for (auto const & adv : advance)
+	{
+		int const ch = adv.first;
+		uint32_t const packed_adv = (adv.second.second << 16) + adv.second.first;
+		if (char_info[ch].dist_index != static_cast<uint32_t>(-1))
+		{
+			KFont::font_info fi;
+			fi.left = char_info[ch].left;
+			fi.top = char_info[ch].top;
+			fi.width = char_info[ch].width;
+			fi.height = char_info[ch].height;
+			kfont_output.AddChar(static_cast<wchar_t>(ch), packed_adv, fi);
+		}
+		else
+		{
+			kfont_output.AddChar(static_cast<wchar_t>(ch), packed_adv);
+		}
+	}
+	if (!kfont_output.Open(kfont_name.string()))
+	{
+		cout << "Can't open " << kfont_name << endl;
+		return 1;
+	}
+	BOOST_ASSERT(kfont_output.NumGlyphs() == header.non_empty_chars);
+
+	cout << "Quantize and write..." << endl;
 	timer_stage.restart();
-	std::vector<uint8_t> lzma_dist;
 	if (!char_index.empty())
 	{
-		quantizer(lzma_dist, header.non_empty_chars, num_threads, &char_index[0], &char_info[0], &char_dist_data[0],
+		quantizer(kfont_output, header.non_empty_chars, num_threads, &char_index[0], &char_info[0], &char_dist_data[0],
 			header.char_size * header.char_size, min_value, max_value, header.base, header.scale);
 	}
+	if (!kfont_output.Close())
+	{
+		cout << "Fail to write " << kfont_name << endl;
+		return 1;
+	}
 	cout << "Time elapsed: " << timer_stage.elapsed() << " s" << endl;
 
 	int processed_chars = 0;
@@ -735,74 +787,4 @@ int main(int argc, char* argv[])
 
 	cout.precision(2);
 	cout << fixed << processed_chars / timer_total.elapsed() << " Characters/Second" << endl;
-
-	{
-		KFont kfont_output;
-		kfont_output.CharSize(header.char_size);
-		kfont_output.DistBase(header.base);
-		kfont_output.DistScale(header.scale);
-
-		if (!advance.empty())
-		{
-			unordered_map<int32_t, std::pair<int32_t, uint32_t>> char_index_advance;
-			for (size_t i = 0; i < advance.size(); ++ i)
-			{
-				char_index_advance.emplace(advance[i].first, std::make_pair(-1, (advance[i].second.second << 16) + advance[i].second.first));
-			}
-			for (size_t i = 0; i < char_index.size(); ++ i)
-			{
-				auto iter = char_index_advance.find(char_index[i].first);
-				BOOST_ASSERT(iter != char_index_advance.end());
-
-				iter->second.first = char_index[i].second;
-			}
-
-			std::vector<size_t> distances_size(char_index.size());
-			std::vector<size_t> distances_addr(char_index.size());
-			if (!lzma_dist.empty())
-			{
-				uint8_t const * p0 = &lzma_dist[0];
-				uint8_t const * p = p0;
-				for (uint32_t i = 0; i < char_index.size(); ++ i)
-				{
-					uint64_t len;
-					std::memcpy(&len, p, sizeof(len));
-					p += sizeof(len);
-
-					distances_size[i] = static_cast<size_t>(len);
-					distances_addr[i] = p - p0;
-
-					p += len;
-				}
-			}
-		
-			for (auto const & cia : char_index_advance)
-			{
-				int const ch = cia.first;
-				int const index = cia.second.first;
-
-				KFont::font_info fi;
-				fi.left = char_info[ch].left;
-				fi.top = char_info[ch].top;
-				fi.width = char_info[ch].width;
-				fi.height = char_info[ch].height;
-
-				uint8_t const * p;
-				uint32_t size;
-				if (index != -1)
-				{
-					p = &lzma_dist[distances_addr[index]];
-					size = static_cast<uint32_t>(distances_size[index]);
-				}
-				else
-				{
-					p = nullptr;
-					size = 0;
-				}
-				kfont_output.SetLZMADistanceData(static_cast<wchar_t>(ch), p, size, cia.second.second, fi);
-			}
-		}
-
-		kfont_output.Save(kfont_name.string());
-	}
 }
@@ -35,6 +35,10 @@
 
 #include <vector>
 #include <istream>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <condition_variable>
 #include <unordered_map>
 
 #ifdef kfont_EXPORTS			// Build dll
@@ -108,6 +112,56 @@ namespace KlayGE
 		ResIdentifierPtr kfont_input_;
 		int64_t distances_lzma_start_;
 	};
+
+	// Writes a .kfont straight to the file, without holding all the glyphs in memory.
+	// The chars are added first, then Open writes the header and the char tables. The compressed glyphs
+	// can be committed from any thread in any order. They are appended in index order, with the ones that
+	// come early waiting in a queue. A commit blocks if it's too far ahead of the next glyph to write,
+	// so each thread should commit its glyphs in increasing index order.
+	class KFONT_API KFontWriter final
+	{
+	public:
+		explicit KFontWriter(uint32_t max_pending_glyphs = 4096);
+		~KFontWriter();
+
+		void CharSize(uint32_t size);
+		void DistBase(int16_t base);
+		void DistScale(int16_t scale);
+		void AddChar(wchar_t ch, uint32_t adv);
+		void AddChar(wchar_t ch, uint32_t adv, KFont::font_info const & fi);
+
+		bool Open(std::string const & file_name);
+		bool Close();
+
+		// Glyph indices are in the order of chars, valid after Open
+		int32_t CharIndex(wchar_t ch) const;
+		uint32_t NumGlyphs() const;
+
+		void CommitDistanceData(int32_t index, uint8_t const * p);
+		void CommitLZMADistanceData(int32_t index, std::vector<uint8_t> lzma_data);
+
+		uint32_t MaxPendingGlyphs() const;
+
+	private:
+		void WriteGlyph(std::vector<uint8_t> const & lzma_data);
+
+	private:
+		uint32_t char_size_ = 0;
+		int16_t dist_base_ = 0;
+		int16_t dist_scale_ = 0;
+		std::map<int32_t, std::pair<int32_t, uint32_t>> char_index_advance_;
+		std::map<int32_t, KFont::font_info> char_info_;
+
+		std::ofstream kfont_output_;
+		bool opened_ = false;
+
+		std::mutex commit_mutex_;
+		std::condition_variable commit_cv_;
+		std::map<int32_t, std::vector<uint8_t>> pending_glyphs_;
+		int32_t next_index_ = 0;
+		uint32_t const max_pending_glyphs_;
+		uint32_t pending_high_water_mark_ = 0;
+	};
 }
 
 #endif		// _KFONT_KFONT_HPP
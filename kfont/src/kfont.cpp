@@ -116,6 +116,19 @@ namespace KlayGE
 	};
 	std::unique_ptr<LZMALoader> LZMALoader::instance_;
 
+	std::vector<uint8_t> CompressDistanceData(uint8_t const * p, uint32_t char_size)
+	{
+		uint64_t len = char_size * char_size;
+		SizeT out_len = static_cast<SizeT>(std::max(len * 11 / 10, static_cast<uint64_t>(32)));
+		std::vector<uint8_t> output(LZMA_PROPS_SIZE + out_len);
+		SizeT out_props_size = LZMA_PROPS_SIZE;
+		LZMALoader::Instance().LzmaCompress(&output[LZMA_PROPS_SIZE], &out_len, static_cast<Byte const *>(p), static_cast<SizeT>(len),
+			&output[0], &out_props_size, 5, std::min(static_cast<uint32_t>(len), 1U << 24), 3, 0, 2, 32, 1);
+
+		output.resize(LZMA_PROPS_SIZE + out_len);
+		return output;
+	}
+
 	KFont::KFont() = default;
 
 	bool KFont::Load(std::string const & file_name)
@@ -404,15 +417,7 @@ namespace KlayGE
 
 	void KFont::SetDistanceData(wchar_t ch, uint8_t const * p, uint32_t adv, font_info const & fi)
 	{
-		uint64_t len = char_size_ * char_size_;
-		SizeT out_len = static_cast<SizeT>(std::max(len * 11 / 10, static_cast<uint64_t>(32)));
-		std::vector<uint8_t> output(LZMA_PROPS_SIZE + out_len);
-		SizeT out_props_size = LZMA_PROPS_SIZE;
-		LZMALoader::Instance().LzmaCompress(&output[LZMA_PROPS_SIZE], &out_len, static_cast<Byte const *>(p), static_cast<SizeT>(len),
-			&output[0], &out_props_size, 5, std::min(static_cast<uint32_t>(len), 1U << 24), 3, 0, 2, 32, 1);
-
-		output.resize(LZMA_PROPS_SIZE + out_len);
-
+		std::vector<uint8_t> const output = CompressDistanceData(p, char_size_);
 		this->SetLZMADistanceData(ch, &output[0], static_cast<uint32_t>(output.size()), adv, fi);
 	}
 
@@ -482,4 +487,200 @@ namespace KlayGE
 		distances_addr_ = new_distances_addr;
 		distances_lzma_ = new_distances_lzma;
 	}
+
+	KFontWriter::KFontWriter(uint32_t max_pending_glyphs)
+		: max_pending_glyphs_(std::max(max_pending_glyphs, 1U))
+	{
+	}
+
+	KFontWriter::~KFontWriter()
+	{
+		this->Close();
+	}
+
+	void KFontWriter::CharSize(uint32_t size)
+	{
+		char_size_ = size;
+	}
+
+	void KFontWriter::DistBase(int16_t base)
+	{
+		dist_base_ = base;
+	}
+
+	void KFontWriter::DistScale(int16_t scale)
+	{
+		dist_scale_ = scale;
+	}
+
+	void KFontWriter::AddChar(wchar_t ch, uint32_t adv)
+	{
+		BOOST_ASSERT(!opened_);
+
+		char_index_advance_[ch] = std::make_pair(-1, adv);
+		char_info_.erase(ch);
+	}
+
+	void KFontWriter::AddChar(wchar_t ch, uint32_t adv, KFont::font_info const & fi)
+	{
+		BOOST_ASSERT(!opened_);
+
+		char_index_advance_[ch] = std::make_pair(0, adv);
+		char_info_[ch] = fi;
+	}
+
+	bool KFontWriter::Open(std::string const & file_name)
+	{
+		BOOST_ASSERT(!opened_);
+
+		kfont_output_.open(file_name.c_str(), std::ios_base::binary | std::ios_base::out);
+		if (!kfont_output_)
+		{
+			return false;
+		}
+
+		int32_t num_glyphs = 0;
+		for (auto& cia : char_index_advance_)
+		{
+			if (cia.second.first != -1)
+			{
+				cia.second.first = num_glyphs;
+				++ num_glyphs;
+			}
+		}
+		BOOST_ASSERT(static_cast<size_t>(num_glyphs) == char_info_.size());
+
+		kfont_header header;
+		header.fourcc = Native2LE(MakeFourCC<'K', 'F', 'N', 'T'>::value);
+		header.version = Native2LE(KFONT_VERSION);
+		header.start_ptr = Native2LE(static_cast<uint32_t>(sizeof(header)));
+		header.validate_chars = Native2LE(static_cast<uint32_t>(char_index_advance_.size()));
+		header.non_empty_chars = Native2LE(static_cast<uint32_t>(num_glyphs));
+		header.char_size = Native2LE(char_size_);
+		header.base = Native2LE(dist_base_);
+		header.scale = Native2LE(dist_scale_);
+
+		kfont_output_.write(reinterpret_cast<char*>(&header), sizeof(header));
+
+		for (auto const & cia : char_index_advance_)
+		{
+			if (cia.second.first != -1)
+			{
+				auto tci = std::make_pair(Native2LE(cia.first), Native2LE(cia.second.first));
+				kfont_output_.write(reinterpret_cast<char*>(&tci), sizeof(tci));
+			}
+		}
+		for (auto const & cia : char_index_advance_)
+		{
+			auto tca = std::make_pair(Native2LE(cia.first), Native2LE(cia.second.second));
+			kfont_output_.write(reinterpret_cast<char*>(&tca), sizeof(tca));
+		}
+
+		for (auto const & ci : char_info_)
+		{
+			int16_t itmp;
+			itmp = Native2LE(ci.second.top);
+			kfont_output_.write(reinterpret_cast<char*>(&itmp), sizeof(itmp));
+			itmp = Native2LE(ci.second.left);
+			kfont_output_.write(reinterpret_cast<char*>(&itmp), sizeof(itmp));
+			uint16_t utmp;
+			utmp = Native2LE(ci.second.width);
+			kfont_output_.write(reinterpret_cast<char*>(&utmp), sizeof(utmp));
+			utmp = Native2LE(ci.second.height);
+			kfont_output_.write(reinterpret_cast<char*>(&utmp), sizeof(utmp));
+		}
+
+		next_index_ = 0;
+		pending_high_water_mark_ = 0;
+		opened_ = true;
+
+		return static_cast<bool>(kfont_output_);
+	}
+
+	bool KFontWriter::Close()
+	{
+		if (!opened_)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(commit_mutex_);
+
+		BOOST_ASSERT(pending_glyphs_.empty());
+		bool const complete = (static_cast<uint32_t>(next_index_) == char_info_.size()) && pending_glyphs_.empty();
+		kfont_output_.close();
+		opened_ = false;
+
+		return complete && !kfont_output_.fail();
+	}
+
+	int32_t KFontWriter::CharIndex(wchar_t ch) const
+	{
+		BOOST_ASSERT(opened_);
+
+		auto iter = char_index_advance_.find(ch);
+		if (iter != char_index_advance_.end())
+		{
+			return iter->second.first;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	uint32_t KFontWriter::NumGlyphs() const
+	{
+		return static_cast<uint32_t>(char_info_.size());
+	}
+
+	void KFontWriter::CommitDistanceData(int32_t index, uint8_t const * p)
+	{
+		this->CommitLZMADistanceData(index, CompressDistanceData(p, char_size_));
+	}
+
+	void KFontWriter::CommitLZMADistanceData(int32_t index, std::vector<uint8_t> lzma_data)
+	{
+		BOOST_ASSERT(opened_);
+		BOOST_ASSERT((index >= 0) && (static_cast<uint32_t>(index) < char_info_.size()));
+
+		std::unique_lock<std::mutex> lock(commit_mutex_);
+
+		// The next glyph to write never waits, so the queue always drains
+		commit_cv_.wait(lock, [this, index] { return static_cast<uint32_t>(index - next_index_) < max_pending_glyphs_; });
+
+		if (index == next_index_)
+		{
+			this->WriteGlyph(lzma_data);
+			++ next_index_;
+
+			for (auto iter = pending_glyphs_.begin(); (iter != pending_glyphs_.end()) && (iter->first == next_index_);
+				iter = pending_glyphs_.erase(iter))
+			{
+				this->WriteGlyph(iter->second);
+				++ next_index_;
+			}
+
+			commit_cv_.notify_all();
+		}
+		else
+		{
+			BOOST_ASSERT(index > next_index_);
+
+			pending_glyphs_.emplace(index, std::move(lzma_data));
+			pending_high_water_mark_ = std::max(pending_high_water_mark_, static_cast<uint32_t>(pending_glyphs_.size()));
+		}
+	}
+
+	uint32_t KFontWriter::MaxPendingGlyphs() const
+	{
+		return pending_high_water_mark_;
+	}
+
+	void KFontWriter::WriteGlyph(std::vector<uint8_t> const & lzma_data)
+	{
+		uint64_t const len_le = Native2LE(static_cast<uint64_t>(lzma_data.size()));
+		kfont_output_.write(reinterpret_cast<char const *>(&len_le), sizeof(len_le));
+		kfont_output_.write(reinterpret_cast<char const *>(lzma_data.data()), static_cast<std::streamsize>(lzma_data.size()));
+	}
 }